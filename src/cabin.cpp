@@ -10,7 +10,14 @@
 #include "metadata/method.h"
 #include "objects/array.h"
 #include "interpreter/interpreter.h"
+#include "interpreter/inline_cache.h"
+#include "interpreter/method_profile.h"
+#include "interpreter/intrinsics.h"
+#include "interpreter/superinstructions.h"
+#include "jit/jit.h"
+#include "runtime/signals.h"
 #include "heap/heap.h"
+#include "heap/gc.h"
 #include "platform/sysinfo.h"
 #include "objects/mh.h"
 #include "classpath/classpath.h"
@@ -46,6 +53,9 @@ static char main_class_name[FILENAME_MAX] = { 0 };
 static char *main_func_args[METHOD_PARAMETERS_MAX_COUNT];
 static int main_func_args_count = 0;
 
+static bool print_inline_cache_stats = false; // -XX:+PrintInlineCacheStats
+static bool print_method_profiles = false; // -XX:+PrintMethodProfiles
+
 string g_java_home;
 
 u2 g_classfile_major_version = 0;
@@ -54,6 +64,25 @@ u2 g_classfile_manor_version = 0;
 Object *g_app_class_loader;
 Object *g_platform_class_loader;
 
+/*
+ * 解析 -Xss 等选项中的大小，可以带单位 k, m, g（不区分大小写）。
+ * 格式错误时返回 0
+ */
+static size_t parseMemorySize(const char *s)
+{
+    char *end;
+    unsigned long long n = strtoull(s, &end, 10);
+    if (end == s)
+        return 0;
+    switch (*end) {
+        case 'k': case 'K': n <<= 10; end++; break;
+        case 'm': case 'M': n <<= 20; end++; break;
+        case 'g': case 'G': n <<= 30; end++; break;
+        default: break;
+    }
+    return *end == 0 ? (size_t) n : 0;
+}
+
 static void parseCommandLine(int argc, char *argv[])
 {
     // 可执行程序的名字为 argv[0]
@@ -78,6 +107,25 @@ static void parseCommandLine(int argc, char *argv[])
             } else if (strcmp(name, "-version") == 0) {
                 showVersionAndCopyright();
                 exit(0);
+            } else if (strcmp(name, "-XX:+PrintInlineCacheStats") == 0) {
+                print_inline_cache_stats = true;
+            } else if (strcmp(name, "-XX:+PrintMethodProfiles") == 0) {
+                print_method_profiles = true;
+            } else if (strcmp(name, "-XX:-UseIntrinsics") == 0) {
+                use_intrinsics = false;
+            } else if (strcmp(name, "-Xint") == 0) {
+                jit_enabled = false;
+            } else if (strcmp(name, "-verbose:gc") == 0) {
+                verbose_gc = true;
+            } else if (strcmp(name, "-XX:+PrintCompilation") == 0) {
+                print_compilation = true;
+            } else if (strncmp(name, "-Xss", 4) == 0) {
+                size_t size = parseMemorySize(name + 4);
+                if (size < VM_STACK_MIN_SIZE) {
+                    printf("Invalid thread stack size: %s, the minimum is %dk\n", name, VM_STACK_MIN_SIZE / 1024);
+                    exit(-1);
+                }
+                vm_stack_size = size;
             } else {
                 printf("Unrecognised command line option: %s\n", argv[i]);
                 showUsage(vm_name);
@@ -230,6 +278,8 @@ void initJVM(int argc, char *argv[])
     initHeap();
     initProperties();
     initJNI();
+    initIntrinsics();
+    initSignalHandlers();
     initClassLoader();
     initMainThread();
     initMethodHandle();
@@ -290,6 +340,16 @@ static void showUsage(const char *name)
     printf("\t\t   :jni print out native method dynamic resolution\n");
     printf("  -version\t   print out version number and copyright information\n");// todo
     printf("  -? -help\t   print out this message\n");
+    printf("  -XX:+PrintInlineCacheStats\n");
+    printf("\t\t   print out statistics of call site inline caches at exit\n");
+    printf("  -XX:+PrintMethodProfiles\n");
+    printf("\t\t   print out per-method execution profiles at exit\n");
+    printf("  -XX:-UseIntrinsics\n");
+    printf("\t\t   execute the bytecode of JDK methods that have built-in C++ implementations\n");
+    printf("  -Xint\t\t   interpreted mode execution only\n");
+    printf("  -Xss<size>\t   set the vm stack size of every thread, e.g. -Xss1m\n");
+    printf("  -XX:+PrintCompilation\n");
+    printf("\t\t   print out methods compiled by the JIT\n");
 
 //    printf("  -Xbootclasspath:%s\n", BCP_MESSAGE);
 //    printf("\t\t   locations where to find the system classes\n");
@@ -405,6 +465,18 @@ int main(int argc, char* argv[])
 
     // todo main_thread 退出，做一些清理工作。
 
+    if (print_inline_cache_stats) {
+        printInlineCacheStats();
+    }
+
+    if (print_method_profiles) {
+        printMethodProfiles();
+    }
+
+#if PROFILE_BYTECODE_SEQUENCES
+    printBytecodeSequences();
+#endif
+
     time_t time2;
     time(&time2);
 
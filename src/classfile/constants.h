@@ -453,6 +453,60 @@ enum {
     JVM_OPC_jsr_w               = 201,
     JVM_OPC_breakpoint          = 202,
 
+    /*
+     * 以下是虚拟机内部使用的快速指令（quick opcodes），不会出现在 class 文件中。
+     * 指令第一次执行并解析成功后，其在线索化代码（见 threaded_code.h）中的 handler
+     * 被原地改写为对应的 _quick 版本，字节码本身保持不变。
+     * 之后再执行时直接使用常量池中已解析的结果，不再加锁，也不再做各种检查。
+     * 快速指令的操作数与原指令相同。
+     * 带 2 的版本用于 long 和 double（category two）类型的字段。
+     */
+    JVM_OPC_ldc_quick               = 203,
+    JVM_OPC_ldc_w_quick             = 204,
+    JVM_OPC_ldc2_w_quick            = 205,
+    JVM_OPC_getstatic_quick         = 206,
+    JVM_OPC_getstatic2_quick        = 207,
+    JVM_OPC_putstatic_quick         = 208,
+    JVM_OPC_putstatic2_quick        = 209,
+    JVM_OPC_getfield_quick          = 210,
+    JVM_OPC_getfield2_quick         = 211,
+    JVM_OPC_putfield_quick          = 212,
+    JVM_OPC_putfield2_quick         = 213,
+    JVM_OPC_invokevirtual_quick     = 214,
+    JVM_OPC_invokenonvirtual_quick  = 215, // invokevirtual 调用 private 或 final 方法
+    JVM_OPC_invokestatic_quick      = 216,
+    JVM_OPC_new_quick               = 217,
+    JVM_OPC_invokeinterface_quick   = 218,
+
+    /*
+     * 超级指令（superinstructions），只出现在线索化代码中，见 superinstructions.h。
+     * 一条超级指令执行一个指令序列，序列中的 xload_<n>, xstore_<n>, iconst_<n>
+     * 和 sipush 都已规范化为带操作数的 xload, xstore 和 bipush。
+     */
+    JVM_OPC_aload_getfield              = 219,
+    JVM_OPC_dup_getfield                = 220,
+    JVM_OPC_iload_iload_if_icmpeq       = 221,
+    JVM_OPC_iload_iload_if_icmpne       = 222,
+    JVM_OPC_iload_iload_if_icmplt       = 223,
+    JVM_OPC_iload_iload_if_icmpge       = 224,
+    JVM_OPC_iload_iload_if_icmpgt       = 225,
+    JVM_OPC_iload_iload_if_icmple       = 226,
+    JVM_OPC_iload_iconst_iadd_istore    = 227,
+    JVM_OPC_aload_iload_iaload          = 228,
+
+    // invokedynamic 链接完成后改写为此快速指令，直接调用已链接的调用点
+    JVM_OPC_invokedynamic_quick         = 229,
+
+    /*
+     * 类层次分析（见 metadata/cha.h）表明被调用的方法只有一个实现时，
+     * invokevirtual 和 invokeinterface 改写为此快速指令，不经分派直接调用这个实现。
+     * 操作数与 invokevirtual_quick 相同，方法有了其他实现后改回原来的快速指令。
+     */
+    JVM_OPC_invokedirect_quick          = 230,
+
+    // 引用类型字段的 putfield_quick，写入后经过写屏障（见 heap/barrier.h）
+    JVM_OPC_putfield_ref_quick          = 231,
+
     JVM_OPC_impdep1             = 254,
     JVM_OPC_impdep2             = 255,
     JVM_OPC_invokenative        = JVM_OPC_impdep1,
@@ -663,7 +717,24 @@ enum {
    3,   /* ifnull */                    \
    3,   /* ifnonnull */                 \
    5,   /* goto_w */                    \
-   5    /* jsr_w */                     \
+   5,   /* jsr_w */                     \
+   1,   /* breakpoint */                \
+   2,   /* ldc_quick */                 \
+   3,   /* ldc_w_quick */               \
+   3,   /* ldc2_w_quick */              \
+   3,   /* getstatic_quick */           \
+   3,   /* getstatic2_quick */          \
+   3,   /* putstatic_quick */           \
+   3,   /* putstatic2_quick */          \
+   3,   /* getfield_quick */            \
+   3,   /* getfield2_quick */           \
+   3,   /* putfield_quick */            \
+   3,   /* putfield2_quick */           \
+   3,   /* invokevirtual_quick */       \
+   3,   /* invokenonvirtual_quick */    \
+   3,   /* invokestatic_quick */        \
+   3,   /* new_quick */                 \
+   5    /* invokeinterface_quick */     \
 }
 
 #endif // CABIN_CONSTANTS_H
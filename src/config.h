@@ -8,7 +8,20 @@
 // size of heap
 #define VM_HEAP_SIZE (512*1024*1024) // 512Mb
 
-// every thread has a vm stack
+// 年轻代的大小，包括 eden 和两个 survivor 空间，见 heap/heap.h
+#define VM_YOUNG_GEN_SIZE (128*1024*1024) // 128Mb
+
+// 线程本地分配缓冲（TLAB）的大小范围，见 heap/tlab.h
+#define TLAB_MIN_SIZE (8*1024)       // 8Kb
+#define TLAB_MAX_SIZE (1024*1024)    // 1Mb
+
+// every thread has a vm stack，默认的大小，可用 -Xss 修改
 #define VM_STACK_SIZE (512*1024)     // 512Kb
 
+// 虚拟机栈末尾留给 StackOverflowError 使用的空间，见 Thread
+#define VM_STACK_RESERVED_SIZE (64*1024) // 64Kb
+
+// -Xss 允许的最小值
+#define VM_STACK_MIN_SIZE (VM_STACK_RESERVED_SIZE + 64*1024)
+
 #endif //CABIN_CONFIG_H
@@ -12,4 +12,17 @@
 
 #define PRINT_TRACE printvm
 
+/*
+ * 调试用的检查
+ */
+
+// 用 lookupMethod 交叉验证 vtable/itable 分派的结果，不一致时打印出来
+#define CHECK_DISPATCH 0
+
+/*
+ * 离线统计连续执行的指令对和三元组的频率，退出时打印超级指令的候选表（C++ 代码）。
+ * 统计时不生成超级指令，见 superinstructions.h
+ */
+#define PROFILE_BYTECODE_SEQUENCES 0
+
 #endif //CABIN_DEBUG_H
@@ -15,17 +15,25 @@ Object *JavaException::getExcep()
     // }
 
     if (excep == nullptr) {
+        excep = newException(excep_class_name, msg.empty() ? nullptr : msg.c_str());
+    }
+
+    return excep;
+}
+
+Object *newException(const char *excep_class_name, const char *msg)
+{
+    assert(excep_class_name != nullptr);
 
-        Class *ec = loadBootClass(excep_class_name);
-        assert(ec != nullptr); // todo
+    Class *ec = loadBootClass(excep_class_name);
+    assert(ec != nullptr); // todo
 
-        initClass(ec);
-        excep = ec->allocObject();
-        if (msg.empty()) {
-            execJavaFunc(ec->getConstructor(S(___V)), { excep });
-        } else {
-            execJavaFunc(ec->getConstructor(S(_java_lang_String__V)), { excep, newString(msg.c_str()) });
-        }
+    initClass(ec);
+    Object *excep = ec->allocObject();
+    if (msg == nullptr) {
+        execJavaFunc(ec->getConstructor(S(___V)), { excep });
+    } else {
+        execJavaFunc(ec->getConstructor(S(_java_lang_String__V)), { excep, newString(msg) });
     }
 
     return excep;
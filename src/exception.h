@@ -59,11 +59,19 @@ DEF_EXCEP_CLASS(java_lang_NoSuchMethodError);
 DEF_EXCEP_CLASS(java_lang_IllegalArgumentException);
 DEF_EXCEP_CLASS(java_lang_CloneNotSupportedException);
 DEF_EXCEP_CLASS(java_lang_VirtualMachineError);
+DEF_EXCEP_CLASS(java_lang_StackOverflowError);
+DEF_EXCEP_CLASS(java_lang_OutOfMemoryError);
 DEF_EXCEP_CLASS(java_io_IOException);
 DEF_EXCEP_CLASS(java_io_FileNotFoundException);
 
 #undef DEF_EXCEP_CLASS
 
+/*
+ * 创建异常对象（调用其构造函数），但不抛出。
+ * @msg: detail message，可以为 nullptr
+ */
+Object *newException(const char *excep_class_name, const char *msg = nullptr);
+
 void printStackTrace(Object *e);
 
 #endif //CABIN_EXCEPTION_H
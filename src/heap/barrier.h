@@ -0,0 +1,48 @@
+#ifndef CABIN_BARRIER_H
+#define CABIN_BARRIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "../cabin.h"
+
+/*
+ * 分代 GC 的写屏障（见 heap/gc.cpp）
+ *
+ * 堆按 CARD_SIZE 字节分为卡（card），每张卡在卡表（card table）中占一个字节。
+ * 把引用写入堆中的对象后，把写入位置所在的卡标记为脏。
+ * minor GC 只扫描老年代中脏卡上的对象，从中找到老年代到年轻代的引用，不用扫描整个老年代。
+ *
+ * 屏障是无条件的：不判断被写的对象是否在老年代、写入的引用是否指向年轻代，
+ * 只有一次移位和一次写，卡表覆盖整个堆，年轻代中的卡被标记了也没有关系。
+ *
+ * 静态属性保存在类的元数据中（见 Field::static_value），不在堆中，
+ * minor GC 把它们作为根扫描，putstatic 不需要写屏障。
+ */
+
+#define CARD_SHIFT 9
+#define CARD_SIZE (1 << CARD_SHIFT)
+
+#define CARD_CLEAN 0
+#define CARD_DIRTY 1
+
+// 卡表按堆的起始地址偏移后的基址，地址 p 的卡为 g_card_table_base[p >> CARD_SHIFT]
+extern u1 *g_card_table_base;
+
+// 引用写入了 @field（堆中的地址）之后调用
+static inline void postWriteBarrier(const void *field)
+{
+    g_card_table_base[(uintptr_t) field >> CARD_SHIFT] = CARD_DIRTY;
+}
+
+// 引用写入了 [@start, @start + @len) 之后调用，比如复制引用数组
+static inline void postWriteBarrier(const void *start, size_t len)
+{
+    if (len == 0)
+        return;
+    uintptr_t first = (uintptr_t) start >> CARD_SHIFT;
+    uintptr_t last = ((uintptr_t) start + len - 1) >> CARD_SHIFT;
+    for (uintptr_t i = first; i <= last; i++)
+        g_card_table_base[i] = CARD_DIRTY;
+}
+
+#endif //CABIN_BARRIER_H
@@ -0,0 +1,263 @@
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+#include <vector>
+#include "free_list.h"
+
+using namespace std;
+
+#define BIT(i) ((u8) 1 << (i))
+
+void FreeList::clear()
+{
+    fill(begin(small_bins), end(small_bins), nullptr);
+    small_map = 0;
+    fill(begin(tree_bins), end(tree_bins), nullptr);
+    tree_map = 0;
+    free_bytes = 0;
+}
+
+void FreeList::add(uintptr_t head, size_t len)
+{
+    assert(head % FREE_LIST_ALIGN == 0 && len % FREE_LIST_ALIGN == 0);
+    if (len < FREE_LIST_MIN_CHUNK)
+        return; // 放不下元数据，等下次清除时回收
+
+    free_bytes += len;
+    if (len < FREE_LIST_SMALL_LIMIT)
+        insertSmall(head, len);
+    else
+        insertTree(head, len);
+}
+
+void FreeList::insertSmall(uintptr_t head, size_t size)
+{
+    int i = smallIndex(size);
+    auto c = (Chunk *) head;
+    c->size = size;
+    c->next = small_bins[i];
+    small_bins[i] = c;
+    small_map |= BIT(i);
+}
+
+void FreeList::insertTree(uintptr_t head, size_t size)
+{
+    int i = treeIndex(size);
+    auto x = (TreeChunk *) head;
+    x->size = size;
+    x->child[0] = x->child[1] = nullptr;
+    x->bin = i;
+
+    if ((tree_map & BIT(i)) == 0) {
+        tree_map |= BIT(i);
+        tree_bins[i] = x;
+        x->parent = nullptr;
+        x->fd = x->bk = x;
+        return;
+    }
+
+    // 从第 i-1 位开始，按 size 的各位从高到低选择子树
+    TreeChunk *t = tree_bins[i];
+    size_t k = size << (64 - i);
+    while (t->size != size) {
+        TreeChunk **c = &t->child[k >> 63];
+        k <<= 1;
+        if (*c == nullptr) {
+            *c = x;
+            x->parent = t;
+            x->fd = x->bk = x;
+            return;
+        }
+        t = *c;
+    }
+
+    // 已有同样大小的块，加入它的环中
+    TreeChunk *f = t->fd;
+    t->fd = f->bk = x;
+    x->fd = f;
+    x->bk = t;
+    x->parent = nullptr;
+}
+
+void FreeList::unlinkTree(TreeChunk *x)
+{
+    TreeChunk *xp = x->parent;
+    TreeChunk *r; // 代替 x 在树中位置的块
+
+    if (x->bk != x) {
+        // 环中还有同样大小的块
+        TreeChunk *f = x->fd;
+        r = x->bk;
+        f->bk = r;
+        r->fd = f;
+    } else {
+        // 用 x 的子树中任一叶子代替它
+        TreeChunk **rp;
+        if ((r = *(rp = &x->child[1])) != nullptr || (r = *(rp = &x->child[0])) != nullptr) {
+            TreeChunk **cp;
+            while (*(cp = &r->child[1]) != nullptr || *(cp = &r->child[0]) != nullptr) {
+                r = *(rp = cp);
+            }
+            *rp = nullptr;
+        }
+    }
+
+    if (xp == nullptr && tree_bins[x->bin] != x)
+        return; // x 只在环中，不在树上
+
+    if (xp == nullptr) {
+        tree_bins[x->bin] = r;
+        if (r == nullptr)
+            tree_map &= ~BIT(x->bin);
+    } else {
+        xp->child[xp->child[0] == x ? 0 : 1] = r;
+    }
+
+    if (r != nullptr) {
+        r->parent = xp;
+        for (int i = 0; i < 2; i++) {
+            TreeChunk *c = x->child[i];
+            if (c != nullptr) {
+                r->child[i] = c;
+                c->parent = r;
+            }
+        }
+    }
+}
+
+/*
+ * 树中的最佳适配，同 dlmalloc 的 tmalloc_large：
+ * 先沿着 @len 的各位向下查找，记录途中最接近的块，以及没有走的、键都比 @len 大的最深的右子树；
+ * 没有完全相同的大小时，再在这棵子树（或更大的树箱）中沿最左的路径找最小的块。
+ */
+FreeList::TreeChunk *FreeList::bestFitTree(size_t len) const
+{
+    TreeChunk *v = nullptr;
+    size_t rsize = SIZE_MAX;
+    TreeChunk *t = nullptr;
+
+    int from = 0; // 从哪个树箱开始找更大的块
+    if (len >= FREE_LIST_SMALL_LIMIT) {
+        int i = treeIndex(len);
+        from = i + 1;
+        t = tree_bins[i];
+        if (t != nullptr) {
+            TreeChunk *rst = nullptr;
+            size_t bits = len << (64 - i);
+            for (;;) {
+                if (t->size >= len && t->size - len < rsize) {
+                    v = t;
+                    rsize = t->size - len;
+                    if (rsize == 0)
+                        return v;
+                }
+                TreeChunk *rt = t->child[1];
+                t = t->child[bits >> 63];
+                if (rt != nullptr && rt != t)
+                    rst = rt;
+                if (t == nullptr) {
+                    t = rst;
+                    break;
+                }
+                bits <<= 1;
+            }
+        }
+    }
+
+    if (t == nullptr && v == nullptr && from < TREE_BINS) {
+        u8 bins = tree_map & (~(u8) 0 << from);
+        if (bins != 0)
+            t = tree_bins[__builtin_ctzll(bins)];
+    }
+
+    for (; t != nullptr; t = t->child[0] != nullptr ? t->child[0] : t->child[1]) {
+        if (t->size >= len && t->size - len < rsize) {
+            v = t;
+            rsize = t->size - len;
+        }
+    }
+
+    return v;
+}
+
+uintptr_t FreeList::takeBestFit(size_t len, size_t &size)
+{
+    if (len < FREE_LIST_SMALL_LIMIT) {
+        // 小块的类是精确的，不小于 len 的第一个非空的类就是最佳适配
+        u8 bins = small_map & (~(u8) 0 << smallIndex(len));
+        if (bins != 0) {
+            int i = __builtin_ctzll(bins);
+            Chunk *c = small_bins[i];
+            small_bins[i] = c->next;
+            if (c->next == nullptr)
+                small_map &= ~BIT(i);
+            size = c->size;
+            free_bytes -= size;
+            return (uintptr_t) c;
+        }
+    }
+
+    TreeChunk *t = bestFitTree(len);
+    if (t == nullptr)
+        return 0;
+    unlinkTree(t);
+    size = t->size;
+    free_bytes -= size;
+    return (uintptr_t) t;
+}
+
+void *FreeList::alloc(size_t len)
+{
+    assert(len > 0 && len % FREE_LIST_ALIGN == 0);
+
+    size_t size;
+    uintptr_t head = takeBestFit(len, size);
+    if (head == 0)
+        return nullptr;
+
+    assert(size >= len);
+    add(head + len, size - len);
+    return (void *) head;
+}
+
+string FreeList::toString() const
+{
+    ostringstream oss;
+    oss << "free: " << free_bytes << " bytes" << endl;
+
+    oss << "small bins: |";
+    for (int i = 0; i < SMALL_BINS; i++) {
+        size_t n = 0;
+        for (Chunk *c = small_bins[i]; c != nullptr; c = c->next)
+            n++;
+        if (n > 0)
+            oss << i * FREE_LIST_ALIGN << "B x " << n << '|';
+    }
+    oss << endl;
+
+    oss << "tree bins: |";
+    for (int i = 0; i < TREE_BINS; i++) {
+        // 树中所有的块（包括环中的）
+        size_t n = 0;
+        vector<const TreeChunk *> stack;
+        if (tree_bins[i] != nullptr)
+            stack.push_back(tree_bins[i]);
+        while (!stack.empty()) {
+            const TreeChunk *t = stack.back();
+            stack.pop_back();
+            const TreeChunk *x = t;
+            do {
+                n++;
+                x = x->fd;
+            } while (x != t);
+            for (const TreeChunk *c: t->child) {
+                if (c != nullptr)
+                    stack.push_back(c);
+            }
+        }
+        if (n > 0)
+            oss << "2^" << i << " x " << n << '|';
+    }
+
+    return oss.str();
+}
@@ -0,0 +1,101 @@
+#ifndef CABIN_FREE_LIST_H
+#define CABIN_FREE_LIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "../cabin.h"
+
+/*
+ * 堆的空闲空间，按大小分离适配（segregated fit）
+ *
+ * 空闲块的元数据写在空闲块自身中，不在 C++ 堆上分配节点：
+ *   a. 小块（小于 FREE_LIST_SMALL_LIMIT 字节）按大小精确分类，每类一个单链表，
+ *      非空的类记在一个位图中，找更大的类只需一次位运算；
+ *   b. 中、大块按大小所在的 2 的幂次分到树箱（tree bin）中，每个树箱是以大小的各位为键的字典树，
+ *      同样大小的块链成环挂在同一个树节点上（同 dlmalloc）。
+ *      树的深度不超过大小的位数，最佳适配（best fit）的查找和删除都与空闲块的数量无关。
+ * 空闲空间的总量随插入和删除更新，查询是 O(1) 的。
+ *
+ * 空闲块不合并：GC 清除时按存活的对象重建全部空闲块，相邻的空隙自然是合并好的（见 Heap::sweep）。
+ * 小于 FREE_LIST_MIN_CHUNK 的空隙放不下元数据，不计入空闲空间，等下次清除时回收。
+ *
+ * 不加锁，调用者负责同步。
+ */
+
+// 空闲块的对齐与大小的单位，和 HEAP_GRANULE 一致
+#define FREE_LIST_ALIGN 8
+
+// 最小的空闲块，放得下 size 和 next
+#define FREE_LIST_MIN_CHUNK 16
+
+// 小块的上限（不含），小块的类刚好用一个字的位图
+#define FREE_LIST_SMALL_LIMIT (64 * FREE_LIST_ALIGN)
+
+class FreeList {
+    struct Chunk {
+        size_t size;
+        Chunk *next;
+    };
+
+    // 树箱中的块，只有大于等于 FREE_LIST_SMALL_LIMIT 的块才是，所以放得下这些字段
+    struct TreeChunk {
+        size_t size;
+        TreeChunk *fd;       // 同样大小的块组成的环
+        TreeChunk *bk;
+        TreeChunk *child[2];
+        TreeChunk *parent;   // 树根和不在树上的块（只在环中）为 nullptr
+        u4 bin;
+    };
+
+    static constexpr int SMALL_BINS = FREE_LIST_SMALL_LIMIT / FREE_LIST_ALIGN;
+    static constexpr int TREE_BINS = 64;
+
+    // 小块按 size / FREE_LIST_ALIGN 分类，0 和 1 不用
+    Chunk *small_bins[SMALL_BINS] = { };
+    u8 small_map = 0;
+
+    // 第 i 个树箱放大小在 [2^i, 2^(i+1)) 中的块
+    TreeChunk *tree_bins[TREE_BINS] = { };
+    u8 tree_map = 0;
+
+    size_t free_bytes = 0;
+
+    static int smallIndex(size_t size) { return (int) (size / FREE_LIST_ALIGN); }
+    static int treeIndex(size_t size) { return 63 - __builtin_clzll(size); }
+
+    bool isTreeNode(const TreeChunk *x) const
+    {
+        return x->parent != nullptr || tree_bins[x->bin] == x;
+    }
+
+    void insertSmall(uintptr_t head, size_t size);
+    void insertTree(uintptr_t head, size_t size);
+    void unlinkTree(TreeChunk *x);
+
+    // 大小不小于 @len 的最小的块，没有时返回 nullptr
+    TreeChunk *bestFitTree(size_t len) const;
+
+    // 取出能放下 @len 字节的最小的空闲块，@size 返回它的大小；没有时返回 0
+    uintptr_t takeBestFit(size_t len, size_t &size);
+
+public:
+    // 丢弃所有的空闲块
+    void clear();
+
+    // 把 [@head, @head + @len) 加入空闲空间，@head 和 @len 都按 FREE_LIST_ALIGN 对齐
+    void add(uintptr_t head, size_t len);
+
+    // 最佳适配 @len（按 FREE_LIST_ALIGN 对齐）字节，空间不够时返回 nullptr
+    void *alloc(size_t len);
+
+    // 空闲空间的总量，以字节为单位
+    size_t freeBytes() const
+    {
+        return free_bytes;
+    }
+
+    std::string toString() const;
+};
+
+#endif //CABIN_FREE_LIST_H
@@ -1,134 +1,429 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <vector>
 #include "gc.h"
 #include "../cabin.h"
 #include "heap.h"
+#include "barrier.h"
+#include "ref_map.h"
 #include "../runtime/vm_thread.h"
 #include "../runtime/frame.h"
+#include "../runtime/safepoint.h"
 #include "../objects/class_loader.h"
 #include "../objects/object.h"
 #include "../objects/array.h"
 #include "../metadata/class.h"
+#include "../metadata/method.h"
+#include "../metadata/field.h"
 #include "../util/encoding.h"
 
 using namespace std;
 
 /*
- * 分析一个可达的对象
+ * 分代垃圾收集，在所有 Java 线程都停下后进行（见 runtime/safepoint.h），堆的布局见 heap/heap.h。
+ *
+ * 可作为 GC Roots 的有：
+ *   a. 虚拟机栈中 frame 的局部变量表和操作数栈，按方法的引用映射精确扫描；
+ *   b. 本地栈（虚拟机的 C++ 代码和本地方法持有的引用），保守扫描：
+ *      值落在某个已分配对象内的字都视为对它的引用；
+ *   c. 所有类的类元数据：静态属性、常量池中已解析的字符串、类对象等（见 getAllClasses）；
+ *   d. 类加载器、字符串池、Thread 对象和虚拟机全局变量引用的对象。
+ *
+ * minor GC 复制年轻代中存活的对象：
+ *   本地栈中的字不一定是引用，不能修改，所以保守扫描到的年轻对象原地固定（pin），不复制；
+ *   类加载器按地址保存在 getAllClassLoaders() 中，也原地固定。
+ *   其余的根和老年代脏卡上的引用（见 heap/barrier.h）指向的年轻对象被复制到 to 或者晋升到老年代，
+ *   原处留下转发地址，引用随之更新；复制过的对象压入栈中，再逐个更新它们的字段。
+ *   晋升的对象仍引用年轻对象时，把字段所在的卡标记为脏。
+ *   只访问存活的年轻对象、根和脏卡上的对象，不访问死对象，也不扫描整个老年代。
+ *   to 和老年代都放不下的对象也原地固定，minor GC 结束后接着进行 full GC。
+ *
+ * full GC 从根出发标记整个堆中可达的对象，清除时线性扫描位图（见 Heap::sweep），不移动对象。
+ * 标记时重建卡表：老年代的对象引用年轻对象时把字段所在的卡标记为脏。
+ *
+ * 开始前丢弃所有线程的 TLAB，它们未用的空间在清除时回收（见 heap/tlab.h）。
+ * 不调用 finalize()，java.lang.ref.Reference 的 referent 也当作强引用。
+ */
+
+bool verbose_gc = false;
+
+// 已标记（full GC）或者已复制、已固定（minor GC）但字段还没有处理的对象
+static vector<Object *> mark_stack;
+
+// minor GC 中有对象既不能复制到 to，也不能晋升到老年代
+static bool promotion_failed;
+
+using RootVisitor = void (*)(Object **slot);
+
+/*
+ * 对 @obj 中落在 [@start, @end) 的引用类型的字段（数组元素）调用 @visit。
+ * 对象引用的类对象是类元数据的一部分，不在这里访问。
  */
-static void analysisReachableObject(jref obj)
-{
-    assert (obj != nullptr);
-    assert (obj->accessible = 1);
-
-    if (obj->clazz->isRefArrayClass()) {
-        Array *arr = dynamic_cast<Array *>(obj);
-        assert(arr != nullptr);
-        for (int i = 0; i < arr->arr_len; i++) {
-            jref o = arr->get<jref>(i);
-            if (o != nullptr) {
-                o->accessible = 1; // 此对象可达
-                analysisReachableObject(o);
-            }
+template <typename Visitor>
+static void forEachRefSlot(Object *obj, address start, address end, Visitor visit)
+{
+    Class *c = obj->clazz;
+    assert(c != nullptr);
+
+    if (c->isArrayClass()) {
+        if (c->isRefArrayClass()) {
+            auto arr = (Array *) obj;
+            auto first = max((Object **) arr->data, (Object **) start);
+            auto last = min((Object **) arr->data + arr->arr_len, (Object **) end);
+            for (Object **p = first; p < last; p++)
+                visit(p);
         }
     } else {
-        int count = obj->clazz->inst_fields_count;
-        for (int i = 0; i < count; i++) {
-            slot_t slot = obj->data[i];
-            // todo  这里要先判断 slot 存放的是不是 jref
-            jref o = slot::getRef(&slot);
-            o->accessible = 1;
-            analysisReachableObject(o);
+        // 只访问引用类型的字段，见 Class::inst_ref_slots
+        for (int i : c->inst_ref_slots) {
+            auto p = (Object **) (obj->data + i);
+            if (start <= (address) p && (address) p < end)
+                visit(p);
         }
     }
 }
 
+template <typename Visitor>
+static void forEachRefSlot(Object *obj, Visitor visit)
+{
+    forEachRefSlot(obj, 0, UINTPTR_MAX, visit);
+}
+
+// 类元数据中引用的对象
+static void visitClass(Class *c, RootVisitor visit)
+{
+    visit(&c->java_mirror);
+    visit(&c->loader);
+
+    // 类可能正在构造（见 Class::registration），还没有创建的字段和方法为 nullptr
+    for (Field *f: c->static_ref_fields)
+        visit(&f->static_value.r);
+    for (Field *f: c->fields) {
+        if (f != nullptr)
+            visit(&f->cachedType());
+    }
+    for (Method *m: c->methods) {
+        if (m != nullptr)
+            visit((Object **) &m->cachedExceptionTypes());
+    }
+
+    c->cp.forEachResolvedString(visit);
+    for (auto &x: c->indy_call_sites) {
+        visit(&x.second->call_site);
+        visit(&x.second->invoker);
+    }
+    visit(&c->enclosing.name);
+    visit(&c->enclosing.descriptor);
+}
+
 /*
- * 判断对象是否可达(GC Roots Analysis)
- *
- * 可作为GC Roots对象的包括如下几种：
-    a.虚拟机栈(栈桢中的本地变量表)中的引用的对象  todo 操作栈中的引用的对象呢？？？？？
-    b.方法区中的类静态属性引用的对象
-    c.方法区中的常量引用的对象
-    d.本地方法栈中JNI的引用的对象
-    e.ClassObject对象（保存在本地内存）中所引用的对象
+ * 访问 @frame 的局部变量表和操作数栈中的引用，哪些 slot 保存引用由方法的引用映射给出。
+ * 操作数栈只扫描到 frame 保存的栈顶：正在调用的方法的实参已经出栈，
+ * 它们所在的 slot 属于被调用者的局部变量表（见 interpreter.cpp 中的 _invoke_method）。
  */
-static void reachabilityAnalysis()
+static void visitFrame(Frame *frame, RootVisitor visit)
 {
-    /****** 虚拟机栈(栈桢中的本地变量表)中的引用的对象 ******/
+    RefMap *map = RefMap::of(frame->method);
+    if (map == nullptr) // 没有代码
+        return;
+
+    auto visitSlot = [visit](slot_t *slot) {
+        assert(slot::getRef(slot) == nullptr || g_heap->isObject((address) slot::getRef(slot)));
+        visit((Object **) slot);
+    };
+
+    const RefMapEntry *e = map->at(frame);
+    for (int i = 0; i < frame->method->max_locals; i++) {
+        if (map->isLocalRef(e, i))
+            visitSlot(frame->lvars + i);
+    }
+
+    auto base = (slot_t *) (frame + 1);
+    auto depth = min<ptrdiff_t>(e->stack_depth, frame->ostack - base);
+    for (ptrdiff_t i = 0; i < depth; i++) {
+        if (map->isStackRef(e, (int) i))
+            visitSlot(base + i);
+    }
+}
+
+// 除本地栈和类加载器之外的根，@visit 可以更新引用
+static void visitRoots(RootVisitor visit)
+{
+    /****** 各线程的虚拟机栈 ******/
     for (Thread *thread : g_all_threads) {
+        visit(&thread->tobj);
+        if (thread->terminated)
+            continue;
+
+        assert(thread->at_safepoint);
         for (Frame *frame = thread->getTopFrame(); frame != nullptr; frame = frame->prev) {
-            slot_t *lvars = frame->lvars;
-            u2 max_locals = frame->method->max_locals;
-            for (u2 i = 0; i < max_locals; i++) {
-                // todo 这里要先判断 locals[i] 存放的是不是 jref
-//                jref o = RSLOT(lvars + i);
-//                o->accessible = 1;
-//                analysisObject(o);
-            }
-
-            // todo How about frame->ostack？？？？
+            visitFrame(frame, visit);
         }
     }
 
-    /****** 类静态属性引用的对象 和 类对象中引用的对象 ******/
-    const unordered_set<const Object *> &loaders = getAllClassLoaders();
-    for (const Object *loader: loaders) {
-        unordered_map<const utf8_t *, Class *, utf8::Hash, utf8::Comparator> *classes;
-        if (loader == BOOT_CLASS_LOADER) {
-            classes = getAllBootClasses();
-        } else {
-            classes = loader->classes;
+    /****** 所有的类 ******/
+    for (Class *c: getAllClasses())
+        visitClass(c, visit);
+
+    /****** 字符串池和虚拟机的全局变量 ******/
+    if (g_string_class != nullptr)
+        g_string_class->forEachInternedString(visit);
+    visit(&g_sys_thread_group);
+    visit(&g_app_class_loader);
+    visit(&g_platform_class_loader);
+}
+
+// 保守地扫描各线程的本地栈，对值落在已分配对象内的字调用 @found
+static void scanNativeStacks(void (*found)(Object *obj))
+{
+    for (Thread *thread : g_all_threads) {
+        if (thread->terminated)
+            continue;
+
+        auto p = (const address *) ((address) thread->native_sp & ~(sizeof(address) - 1));
+        for (; p < (const address *) thread->native_stack_base; p++) {
+            Object *obj = g_heap->objectContaining(*p);
+            if (obj != nullptr)
+                found(obj);
         }
+    }
+}
+
+static void forEachClassLoader(void (*visit)(Object *obj))
+{
+    for (const Object *loader: getAllClassLoaders()) {
+        if (loader != BOOT_CLASS_LOADER)
+            visit(const_cast<Object *>(loader));
+    }
+}
+
+static bool isYoungRef(const Object *ref)
+{
+    return ref != nullptr && g_heap->isYoung((address) ref);
+}
+
+/****************************** full GC ******************************/
+
+static void markObject(Object *obj)
+{
+    if (obj != nullptr && g_heap->mark(obj))
+        mark_stack.push_back(obj);
+}
+
+static void markSlot(Object **slot)
+{
+    markObject(*slot);
+}
+
+static void collectFull()
+{
+    // TLAB 未用的空间在清除时回收
+    g_heap->retireTlabs();
+
+    // 死对象上的卡不用再扫描，存活对象上的卡在标记时重新记录
+    g_heap->clearCards();
+
+    scanNativeStacks(markObject);
+    forEachClassLoader(markObject);
+    visitRoots(markSlot);
 
-        assert(classes != nullptr);
-        for (auto &x: *(classes)) {
-            Class *c = x.second;
-
-            // 1. 分析类静态属性引用的对象
-            for (Field *f: c->fields) {
-                if (!f->isStatic() || f->isPrim())
-                    continue;
-
-                // static and reference field of a class
-                jref o = f->static_value.r;
-                o->accessible = 1;
-                analysisReachableObject(o);
-            }
-
-            // 2. 分析类对象中引用的对象
-            ClsObj *co = c->java_mirror;
-            assert(co->accessible = 1);
-            analysisReachableObject(co);
+    while (!mark_stack.empty()) {
+        Object *obj = mark_stack.back();
+        mark_stack.pop_back();
+
+        bool old = g_heap->isOld((address) obj);
+        forEachRefSlot(obj, [old](Object **slot) {
+            markObject(*slot);
+            if (old && isYoungRef(*slot))
+                postWriteBarrier(slot);
+        });
+    }
+
+    g_heap->sweep();
+}
+
+/****************************** minor GC ******************************/
+
+// 转发地址写在原处对象的 clazz 中，最低位置 1
+static bool isForwarded(const Object *obj)
+{
+    return ((address) obj->clazz & 1) != 0;
+}
+
+static Object *forwardee(const Object *obj)
+{
+    return (Object *) ((address) obj->clazz & ~(address) 1);
+}
+
+// 年轻对象 @obj 原地固定，它的字段稍后处理
+static void pin(Object *obj)
+{
+    if (g_heap->isYoung((address) obj) && g_heap->mark(obj))
+        mark_stack.push_back(obj);
+}
+
+/*
+ * 复制年轻对象 @obj，返回新的地址。
+ * 熬过 TENURING_THRESHOLD 次 minor GC 的对象和 to 放不下的对象晋升到老年代。
+ * to 中的对象被标记，区别于需要复制的对象；老年代中的对象不用标记，minor GC 不处理它们。
+ */
+static Object *evacuate(Object *obj)
+{
+    size_t size = Heap::alignSize(obj->size());
+    u1 age = obj->gc_age + 1;
+
+    void *p = nullptr;
+    if (age < TENURING_THRESHOLD)
+        p = g_heap->allocSurvivor(size);
+    if (p == nullptr)
+        p = g_heap->allocInOld(size);
+    if (p == nullptr) {
+        // 无处可放，原地固定，minor GC 结束后进行 full GC
+        promotion_failed = true;
+        pin(obj);
+        return obj;
+    }
+
+    memcpy(p, obj, size);
+    auto copy = (Object *) p;
+    copy->data = (slot_t *) ((address) copy + ((address) obj->data - (address) obj));
+    copy->gc_age = age;
+    if (g_heap->isYoung((address) copy))
+        g_heap->mark(copy);
+
+    obj->clazz = (Class *) ((address) copy | 1);
+    mark_stack.push_back(copy);
+    return copy;
+}
+
+// 把 @slot 中的引用更新为年轻对象复制后的地址
+static void evacuateSlot(Object **slot)
+{
+    Object *obj = *slot;
+    if (obj == nullptr || !g_heap->isYoung((address) obj) || g_heap->isMarked(obj))
+        return; // 老年代的对象，或者已经在 to 中、原地固定的对象
+    *slot = isForwarded(obj) ? forwardee(obj) : evacuate(obj);
+}
+
+// 更新老年代对象 @obj 中落在 [@start, @end) 的引用，仍引用年轻对象的字段所在的卡重新标记为脏
+static void evacuateOldSlots(Object *obj, address start, address end)
+{
+    forEachRefSlot(obj, start, end, [](Object **slot) {
+        evacuateSlot(slot);
+        if (isYoungRef(*slot))
+            postWriteBarrier(slot);
+    });
+}
+
+/*
+ * 扫描老年代中的脏卡：先清除卡，再更新卡上对象落在卡中的引用。
+ * 卡和位图的一个字一一对应（见 Heap::forEachObjectStartingInCard），
+ * 只有跨入卡中的对象需要向前查找，连续的脏卡上的同一个对象只查找一次。
+ */
+static void scanDirtyCards()
+{
+    u1 *card = g_heap->cardFor(g_heap->oldStart());
+    u1 *end = g_heap->cardFor(g_heap->end());
+
+    // 上一个处理过的对象，跨到后面的卡中时不用再查找
+    Object *prev = nullptr;
+    address prev_end = 0;
+
+    while (card < end) {
+        if (*card == CARD_CLEAN) {
+            // 成片的干净卡一次跳过一个字
+            if (((address) card & 7) == 0 && card + 8 <= end && *(u8 *) card == 0)
+                card += 8;
+            else
+                card++;
+            continue;
+        }
+
+        *card = CARD_CLEAN;
+        address start = Heap::cardStart(card);
+        address stop = start + CARD_SIZE;
+        auto scan = [&](Object *obj) {
+            evacuateOldSlots(obj, start, stop);
+            prev = obj;
+            prev_end = (address) obj + obj->size();
+        };
+
+        Object *first = prev_end > start ? prev : g_heap->objectContaining(start);
+        if (first != nullptr && (address) first < start)
+            scan(first);
+        g_heap->forEachObjectStartingInCard(start, scan);
+        card++;
+    }
+}
+
+static void collectYoung()
+{
+    g_heap->retireTlabs();
+    promotion_failed = false;
+
+    // 先固定所有不能移动的对象，之后才开始复制
+    scanNativeStacks(pin);
+    forEachClassLoader(pin);
+
+    visitRoots(evacuateSlot);
+    scanDirtyCards();
+
+    while (!mark_stack.empty()) {
+        Object *obj = mark_stack.back();
+        mark_stack.pop_back();
+
+        if (g_heap->isOld((address) obj)) {
+            evacuateOldSlots(obj, 0, UINTPTR_MAX); // 晋升的对象
+        } else {
+            forEachRefSlot(obj, evacuateSlot);
         }
     }
 
-    // todo ..... c,d 中的判断
+    g_heap->finishMinorGc();
 }
 
-void gc()
+static void collect(bool full)
 {
     assert(g_heap != nullptr);
-    g_heap->lock();
+    if (getCurrentThread() == nullptr) {
+        // 虚拟机还在初始化，没有 Java 线程，无法确定本地栈的范围
+        return;
+    }
 
-    // todo 是不是要先将全部对象视为不可达？？？？ 然后再判断，可达的予以标记？？？？
+    g_heap->lock();
 
-    address mem = g_heap->mem;
-    const address end = mem + g_heap->size;
+    auto start = chrono::steady_clock::now();
+    size_t used_before = g_heap->totalMemory() - g_heap->freeMemory();
 
-    while (mem < end) {
-        mem = g_heap->jumpFreelist(mem);
+    // 当前线程也进入安全区域，它的本地栈和其他线程的一样扫描
+    inSafeRegion([&full] {
+        stopTheWorld();
+        if (!full) {
+            collectYoung();
+            full = promotion_failed;
+        }
+        if (full)
+            collectFull();
+        resumeTheWorld();
+    });
 
-        auto obj = (Object *) mem;
-        obj->accessible = 0;
-//        if (!accessible(obj)) {
-//            obj->marked = 1;
-//            // todo 调用 finalize() 后进行二次标记，然后才可以归还
-//            g_heap->back(mem, obj->size());
-//        }
-        mem += obj->size();
+    if (verbose_gc) {
+        size_t used_after = g_heap->totalMemory() - g_heap->freeMemory();
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        printf("[%s %zuK->%zuK(%zuK), %.3f ms]\n", full ? "Full GC" : "GC",
+                used_before / 1024, used_after / 1024, g_heap->totalMemory() / 1024, elapsed.count());
     }
 
-    reachabilityAnalysis();
-
     g_heap->unlock();
 }
+
+void gc()
+{
+    collect(true);
+}
+
+void minorGc()
+{
+    collect(false);
+}
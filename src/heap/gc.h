@@ -3,6 +3,19 @@
 
 #include "../cabin.h"
 
+/*
+ * 停止所有 Java 线程，进行一次 full GC：标记-清除整个堆。
+ * 老年代的空间不够时自动进行（见 Heap::alloc），Runtime.gc() 也调用它。
+ */
 void gc();
 
+/*
+ * 停止所有 Java 线程，进行一次 minor GC：只收集年轻代。
+ * eden 满时自动进行（见 Heap::alloc）。
+ */
+void minorGc();
+
+// -verbose:gc 每次 GC 后打印堆的使用情况
+extern bool verbose_gc;
+
 #endif //CABIN_GC_H
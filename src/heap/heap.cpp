@@ -1,174 +1,287 @@
 #include <vector>
 #include "heap.h"
+#include "gc.h"
 #include "../metadata/class.h"
 #include "../metadata/method.h"
 #include "../metadata/field.h"
+#include "../objects/object.h"
+#include "../exception.h"
 #include "../config.h"
+#include "../runtime/vm_thread.h"
 
 using namespace std;
 
+u1 *g_card_table_base;
+
 Heap::Heap() noexcept
 {
     size = VM_HEAP_SIZE;
     assert(size > 0);
+    assert(size % (HEAP_GRANULE * 64) == 0);
 
-    mem = (address) malloc(size);
-    assert(mem != 0);    
+    // 起始地址对齐后，TLAB 按绝对地址对齐即可与位图的字对齐
+    raw_mem = malloc(size + TLAB_ALIGNMENT);
+    assert(raw_mem != nullptr);
+    mem = ((address) raw_mem + TLAB_ALIGNMENT - 1) & ~(address) (TLAB_ALIGNMENT - 1);
 
-    freelist = new Node(mem, size, nullptr);
-}
+    size_t young_size = VM_YOUNG_GEN_SIZE;
+    assert(young_size % TLAB_ALIGNMENT == 0 && young_size < size);
+    size_t survivor_size = (young_size / SURVIVOR_RATIO) & ~(size_t) (TLAB_ALIGNMENT - 1);
 
-Heap::~Heap()
-{    
-    for (auto p = freelist; p != nullptr;) {
-        auto t = p->next;
-        delete p;
-        p = t;
-    }
+    young_end = mem + young_size;
+    address eden_end = young_end - 2 * survivor_size;
+    eden.init(mem, eden_end);
+    survivors[0].init(eden_end, eden_end + survivor_size);
+    survivors[1].init(eden_end + survivor_size, young_end);
+
+    bitmap_words = size / HEAP_GRANULE / 64;
+    alloc_bits = (u8 *) calloc(bitmap_words, sizeof(u8));
+    mark_bits = (u8 *) calloc(bitmap_words, sizeof(u8));
+    assert(alloc_bits != nullptr && mark_bits != nullptr);
 
-    free((void *) mem);
+    card_table = (u1 *) calloc(size / CARD_SIZE, sizeof(u1));
+    assert(card_table != nullptr);
+    g_card_table_base = card_table - (mem >> CARD_SHIFT);
+
+    free_list.add(young_end, mem + size - young_end);
 }
 
+Heap::~Heap()
+{
+    free(alloc_bits);
+    free(mark_bits);
+    free(card_table);
+    free(raw_mem);
+}
 
-address Heap::jumpFreelist(address p)
+void *Heap::allocInNewTlab(Thread *thread, size_t len)
 {
-    assert(in(p));
+    Tlab &tlab = thread->tlab;
+    if (!tlab.accepts(len) || !tlab.shouldRefill())
+        return nullptr;
 
-    Node *curr = freelist;
-    for (; curr != nullptr; curr = curr->next) {
-        if (p < curr->head)
-            return p; // p is not in freelist
-        auto offset = p - curr->head;
-        if (0 <= offset and offset <= curr->len) {
-            // p is in freelist, jump
-            return p + curr->len;
+    lock();
+    // 等待锁时可能发生了 GC，TLAB 已被丢弃并调整了大小
+    void *p = tlab.alloc(len);
+    if (p == nullptr && tlab.accepts(len)) {
+        size_t size = tlab.nextSize();
+        void *block = eden.alloc(size, TLAB_ALIGNMENT);
+        if (block == nullptr && size > TLAB_MIN_SIZE) {
+            // eden 快满了，先用最小的 TLAB
+            size = TLAB_MIN_SIZE;
+            block = eden.alloc(size, TLAB_ALIGNMENT);
         }
+        if (block != nullptr) {
+            tlab.fill((address) block, size);
+            p = tlab.alloc(len);
+        }
+    }
+    unlock();
+    return p;
+}
+
+void *Heap::allocShared(size_t len)
+{
+    void *p = nullptr;
+    bool young = len < PRETENURE_SIZE_THRESHOLD;
+
+    if (young && (p = eden.alloc(len, HEAP_GRANULE)) == nullptr) {
+        minorGc();
+        p = eden.alloc(len, HEAP_GRANULE);
+    }
+
+    if (p != nullptr) {
+        setAllocBit((address) p);
+        largest_object = max(largest_object, len);
+        return p;
     }
 
-    return p; // p is not in freelist
+    if ((p = allocInOld(len)) == nullptr) {
+        gc();
+        p = allocInOld(len);
+    }
+    return p;
 }
 
 void *Heap::alloc(size_t len)
 {
     assert(len > 0);
-    lock();
+    len = alignSize(len);
 
     void *p = nullptr;
-    Node *prev = nullptr;
-    Node *curr = freelist;
-    for (; curr != nullptr; prev = curr, curr = curr->next) {
-        if (curr->len == len) {
-            if (prev != nullptr) {
-                prev->next = curr->next;
-            } else {
-                assert(curr == freelist);
-                freelist = curr->next;
-            }
-            p = (void *) curr->head;
-            delete curr;
-
-            goto over;
-        }
+    Thread *thread = getCurrentThread();
+    // 大对象不进 TLAB，在堆中分配并更新 largest_object（见 objectContaining）
+    if (thread != nullptr && thread->tlab.accepts(len)) {
+        p = thread->tlab.alloc(len);
+        if (p == nullptr)
+            p = allocInNewTlab(thread, len);
+    }
 
-        if (curr->len > len) {
-            p = (void *) (curr->head);
-            curr->head += len;
-            curr->len -= len;
+    if (p != nullptr) {
+        // TLAB 覆盖位图中完整的字，这些字只有本线程会写
+        setAllocBit((address) p);
+    } else {
+        // 不在 TLAB 中分配的对象可能和别的对象共用位图的字，在锁中设置分配位
+        lock();
+        p = allocShared(len);
+        unlock();
 
-            goto over;
+        if (p == nullptr) {
+            throw java_lang_OutOfMemoryError("Java heap space");
         }
     }
 
-over:
+    memset(p, 0, len);
+    return p;
+}
+
+void *Heap::allocOld(size_t len)
+{
+    assert(len > 0);
+    len = alignSize(len);
+
+    lock();
+    void *p = allocInOld(len);
+    if (p == nullptr) {
+        gc();
+        p = allocInOld(len);
+    }
     unlock();
 
+    if (p == nullptr) {
+        throw java_lang_OutOfMemoryError("Java heap space");
+    }
+
+    memset(p, 0, len);
+    return p;
+}
+
+void *Heap::allocSurvivor(size_t len)
+{
+    void *p = toSpace().alloc(len, HEAP_GRANULE);
+    if (p != nullptr)
+        setAllocBit((address) p);
+    return p;
+}
+
+void *Heap::allocInOld(size_t len)
+{
+    void *p = free_list.alloc(len);
     if (p != nullptr) {
-        memset(p, 0, len);
-        return p;
+        setAllocBit((address) p);
+        largest_object = max(largest_object, len);
     }
+    return p;
+}
 
-//    throw "java_lang_OutOfMemoryError";
-    JVM_PANIC("java_lang_OutOfMemoryError"); // todo 堆可以扩张
+void Heap::retireTlabs()
+{
+    size_t total = 0;
+    for (Thread *t : g_all_threads)
+        total += t->tlab.allocatedSinceGc();
+    for (Thread *t : g_all_threads)
+        t->tlab.resize(total, eden.capacity());
 }
 
-void Heap::back(address p, size_t len)
+Object *Heap::objectContaining(address p)
 {
-    assert(in(p));
-    assert(len > 0);
+    if (!in(p))
+        return nullptr;
 
-    lock();
+    // 对象的起始位置不会早于 lowest
+    size_t i = granuleOf(p);
+    size_t lowest = i - min(i, largest_object / HEAP_GRANULE);
+
+    // 向前查找最近的对象起始位置
+    size_t w = i / 64;
+    u8 bits = alloc_bits[w] & (~(u8) 0 >> (63 - i % 64));
+    while (bits == 0) {
+        if (w * 64 <= lowest)
+            return nullptr;
+        bits = alloc_bits[--w];
+    }
+
+    size_t start = w * 64 + 63 - __builtin_clzll(bits);
+    if (start < lowest)
+        return nullptr;
+
+    auto obj = (Object *) (mem + start * HEAP_GRANULE);
+    return p < (address) obj + obj->size() ? obj : nullptr;
+}
+
+void Heap::clearCards()
+{
+    memset(card_table, CARD_CLEAN, size / CARD_SIZE);
+}
+
+void Heap::sweepSpace(Space &space)
+{
+    size_t first = granuleOf(space.getBottom()) / 64;
+    size_t last = (space.highWater() - mem + CARD_SIZE - 1) / CARD_SIZE; // 不含
 
-    Node *prev = nullptr;
-    Node *curr = freelist;
-    for (; curr != nullptr; prev = curr, curr = curr->next) {
-        if (p > curr->head)
-            continue;
-
-        assert(p + len <= curr->head);
-        if (prev == nullptr) {
-            assert(curr == freelist);
-            if (p + len == curr->head) { // 空间右连续
-                curr->head = p;
-                curr->len += len;
-                goto over;
-            } else { // 右不连续
-                freelist = new Node(p, len, curr);
-                goto over;
-            }
+    space.clear();
+    address free_head = space.getBottom(); // 当前空隙的开始
+    for (size_t w = first; w < last; w++) {
+        u8 live = alloc_bits[w] & mark_bits[w];
+        alloc_bits[w] = live; // 死对象和复制走的对象的起始位置被清除
+        mark_bits[w] = 0;
+
+        for (; live != 0; live &= live - 1) {
+            address obj = mem + (w * 64 + __builtin_ctzll(live)) * HEAP_GRANULE;
+            space.addFree(free_head, obj);
+            free_head = obj + alignSize(((Object *) obj)->size());
         }
+    }
+    space.addFree(free_head, space.getEnd());
+}
+
+void Heap::finishMinorGc()
+{
+    sweepSpace(eden);
+    sweepSpace(survivors[0]);
+    sweepSpace(survivors[1]);
+    from = 1 - from;
+}
+
+void Heap::sweep()
+{
+    sweepSpace(eden);
+    sweepSpace(survivors[0]);
+    sweepSpace(survivors[1]);
+
+    free_list.clear();
 
-        assert(prev != nullptr);
-        assert(prev->head + prev->len <= p);
-        if (prev->head + prev->len == p) {
-            if (p + len == curr->head) {
-                // 左右都连续
-                prev->len += (len + curr->len);
-                prev->next = curr->next;
-                delete curr;
-                goto over;
-            } else {
-                // 左连续，右不连续
-                prev->len += len;
-                goto over;
-            }
-        } else {
-            if (p + len == curr->head) {
-                // 左不连续，右连续
-                curr->len += len;
-                curr->head = p;
-                goto over;
-            } else {
-                // 左右都不连续
-                prev->next = new Node(p, len, curr);
-                goto over;
-            }
+    address free_head = young_end; // 当前空隙的开始
+    for (size_t w = granuleOf(young_end) / 64; w < bitmap_words; w++) {
+        u8 live = alloc_bits[w] & mark_bits[w];
+        alloc_bits[w] = live; // 死对象的起始位置被清除
+        mark_bits[w] = 0;
+
+        for (; live != 0; live &= live - 1) {
+            address obj = mem + (w * 64 + __builtin_ctzll(live)) * HEAP_GRANULE;
+            free_list.add(free_head, obj - free_head);
+            free_head = obj + alignSize(((Object *) obj)->size());
         }
     }
 
-over:
-    unlock();
+    free_list.add(free_head, mem + size - free_head);
 }
 
 size_t Heap::freeMemory()
 {
-    size_t free_mem = 0;
-    for (auto node = freelist; node != nullptr; node = node->next) {
-        free_mem += node->len;
-    }
+    lock();
+    size_t free_mem = eden.freeBytes() + survivors[from].freeBytes() + free_list.freeBytes();
+    unlock();
     return free_mem;
 }
 
 string Heap::toString()
 {
     lock();
-    stringstream ss;
-
-    ss << "freelist: " << endl << '|';
-    for (auto node = freelist; node != nullptr; node = node->next) {
-        ss << (void *) node->head << ',';
-        ss << node->len << "(0x" << hex << node->len << ")|";
-    }
-
+    ostringstream oss;
+    oss << "eden: " << eden.freeBytes() << "/" << eden.capacity() << " bytes free, ";
+    oss << "survivor: " << survivors[from].freeBytes() << "/" << survivors[from].capacity() << " bytes free, ";
+    oss << "old: " << free_list.toString();
     unlock();
-    return ss.str();
-}
\ No newline at end of file
+    return oss.str();
+}
@@ -9,56 +9,236 @@
 #include <cassert>
 #include <mutex>
 #include "../cabin.h"
+#include "../runtime/safepoint.h"
+#include "tlab.h"
+#include "free_list.h"
+#include "space.h"
+#include "barrier.h"
 
 using address = uintptr_t;
 
+// 堆分配的单位，对象的起始地址按它对齐，大小向上取整为它的整数倍
+#define HEAP_GRANULE 8
+
+// 每个 survivor 空间占年轻代的 1/SURVIVOR_RATIO，其余是 eden
+#define SURVIVOR_RATIO 10
+
+// 对象熬过这么多次 minor GC 后晋升到老年代
+#define TENURING_THRESHOLD 6
+
+// 不小于此值的对象直接在老年代中分配，不在年轻代中来回复制
+#define PRETENURE_SIZE_THRESHOLD TLAB_MAX_SIZE
+
+static_assert(TLAB_ALIGNMENT == 64 * HEAP_GRANULE, "a tlab must cover whole words of the heap bitmaps");
+static_assert(CARD_SIZE == 64 * HEAP_GRANULE, "a card must cover exactly one word of the heap bitmaps");
+static_assert(FREE_LIST_ALIGN == HEAP_GRANULE, "free chunks must be aligned to granules");
+
+/*
+ * 分代的堆
+ *
+ *   |<-------------- 年轻代 --------------->|<------- 老年代 ------->|
+ *   +----------------------+-------+-------+------------------------+
+ *   |         eden         |  S0   |  S1   |                        |
+ *   +----------------------+-------+-------+------------------------+
+ *   mem                                    young_end          mem + size
+ *
+ * 新对象在 eden 中按移动指针分配（大多在 TLAB 中）。eden 满时进行 minor GC，
+ * 把 eden 和 from（上次 GC 后存活的对象所在的 survivor 空间）中存活的对象复制到 to，
+ * 熬过 TENURING_THRESHOLD 次的和 to 放不下的对象晋升到老年代，然后交换 from 和 to。
+ * 复制只访问存活的对象，minor GC 的代价与年轻代中存活的数据量成正比，与 eden 的大小无关。
+ *
+ * 老年代按空闲链表分配（见 heap/free_list.h），只有 full GC 才会整体标记-清除。
+ * 老年代到年轻代的引用由写屏障记录在卡表中（见 heap/barrier.h），minor GC 只扫描脏卡。
+ *
+ * 被保守扫描到的对象不能移动（见 heap/gc.cpp），原地留在年轻代中，
+ * 所以年轻代的空间不总是空的，见 heap/space.h。
+ */
 class Heap {
-    address mem;
+    void *raw_mem; // malloc 返回的地址
+    address mem;   // 按 TLAB_ALIGNMENT 对齐
     size_t size;
 
-    struct Node {
-        address head;
-        size_t len;
-        Node *next;
-        Node(address head, size_t len, Node *next): head(head), len(len), next(next) { }
-    } *freelist;
+    address young_end;
+    Space eden;
+    Space survivors[2];
+    int from = 0; // survivors[from] 保存上次 minor GC 后存活的对象，另一个是 to
+
+    // 老年代的空闲空间
+    FreeList free_list;
+
+    // 卡表，每 CARD_SIZE 字节一项，覆盖整个堆
+    u1 *card_table;
+
+    /*
+     * 堆的位图，每个 granule 对应一位：
+     * alloc_bits 标记已分配对象的起始位置，分配时置位，清除时回收的对象被清零；
+     * mark_bits 记录 GC 中存活的对象，GC 结束后全部清零。
+     * 标记不写在对象头中，清除时只读位图，不用访问死对象。
+     */
+    u8 *alloc_bits;
+    u8 *mark_bits;
+    size_t bitmap_words;
+
+    /*
+     * 分配过的最大对象的大小，限制 objectContaining 向前查找的范围。
+     * 在 TLAB 中分配的对象不更新它，所以初始值为 TLAB 中对象的最大值
+     */
+    size_t largest_object = TLAB_MAX_SIZE / TLAB_OBJECT_FRACTION;
 
     std::recursive_mutex mutex;
 
-    bool in(address p)
+    size_t granuleOf(address p) const
     {
-        return mem <= p and p < mem + size;
+        assert(in(p));
+        return (p - mem) / HEAP_GRANULE;
     }
 
-    void lock() { mutex.lock(); }
-    void unlock() { mutex.unlock(); }
+    void setAllocBit(address p)
+    {
+        size_t i = granuleOf(p);
+        alloc_bits[i / 64] |= (u8) 1 << (i % 64);
+    }
+
+    Space &toSpace() { return survivors[1 - from]; }
 
-    void back(address p, size_t len);
+    // 当前线程的 TLAB 放不下 @len 字节时调用，返回 nullptr 表示对象应在 TLAB 之外分配
+    void *allocInNewTlab(Thread *thread, size_t len);
+
+    // 在 TLAB 之外分配，调用者持有锁
+    void *allocShared(size_t len);
 
     /*
-     * 如果不在 freelist 里面，返回 p，
-     * 负责跳过此 freelist's Node.
+     * 回收 @space 中没有标记的对象，清除标记，按留下的对象重建空闲区间。
+     * 只需处理分配过的部分，与 @space 的大小无关。
      */
-    address jumpFreelist(address p);
+    void sweepSpace(Space &space);
 
 public:
     Heap() noexcept;
     ~Heap();
-    
+
+    static size_t alignSize(size_t len)
+    {
+        return (len + HEAP_GRANULE - 1) & ~(size_t) (HEAP_GRANULE - 1);
+    }
+
+    /*
+     * 分配 @len 字节并清零。
+     * 小对象在当前线程的 TLAB 中分配，不加锁；TLAB 用完时才获取锁，从 eden 中重新填充（见 heap/tlab.h）。
+     * eden 满时进行 minor GC，大对象和 minor GC 后仍放不下的对象在老年代中分配，
+     * 老年代也放不下时进行 full GC，仍然不够时抛出 java_lang_OutOfMemoryError。
+     */
     void *alloc(size_t len);
 
-    // 堆总大小，以字节为单位。
+    // 同 alloc，但直接在老年代中分配，对象不会被移动
+    void *allocOld(size_t len);
+
+    /*
+     * GC 时调用（所有线程都停在安全点）：丢弃所有线程的 TLAB，
+     * 它们未用的空间在清除后回到 eden 中，并按各线程的分配速率调整 TLAB 的大小。
+     */
+    void retireTlabs();
+
+    // 等待堆的锁时不阻止 GC（持有锁的线程可能正在 GC）
+    void lock() { lockSafely(mutex); }
+    void unlock() { mutex.unlock(); }
+
+    bool in(address p) const
+    {
+        return mem <= p and p < mem + size;
+    }
+
+    bool isYoung(address p) const
+    {
+        return mem <= p and p < young_end;
+    }
+
+    bool isOld(address p) const
+    {
+        return young_end <= p and p < mem + size;
+    }
+
+    address oldStart() const { return young_end; }
+    address end() const { return mem + size; }
+
+    /*
+     * 返回 @p 所指向的已分配对象，@p 可以指向对象的内部。
+     * @p 不在任何已分配的对象中时返回 nullptr，用于保守地扫描本地栈。
+     */
+    Object *objectContaining(address p);
+
+    // @p 是否为已分配对象的起始位置
+    bool isObject(address p) const
+    {
+        if (!in(p) || (p & (HEAP_GRANULE - 1)) != 0)
+            return false;
+        size_t i = granuleOf(p);
+        return (alloc_bits[i / 64] >> (i % 64)) & 1;
+    }
+
+    // 对起始位置在 [@start, @start + CARD_SIZE) 中的每个对象调用 @visit，@start 按 CARD_SIZE 对齐
+    template <typename Visitor>
+    void forEachObjectStartingInCard(address start, Visitor visit)
+    {
+        assert(start % CARD_SIZE == 0);
+        size_t w = granuleOf(start) / 64;
+        for (u8 bits = alloc_bits[w]; bits != 0; bits &= bits - 1)
+            visit((Object *) (start + __builtin_ctzll(bits) * HEAP_GRANULE));
+    }
+
+    // 标记对象 @obj，之前没有标记时返回 true
+    bool mark(const Object *obj)
+    {
+        size_t i = granuleOf((address) obj);
+        u8 bit = (u8) 1 << (i % 64);
+        if (mark_bits[i / 64] & bit)
+            return false;
+        mark_bits[i / 64] |= bit;
+        return true;
+    }
+
+    bool isMarked(const Object *obj) const
+    {
+        size_t i = granuleOf((address) obj);
+        return (mark_bits[i / 64] >> (i % 64)) & 1;
+    }
+
+    /*
+     * 在 to 中或者老年代中分配 @len（已按 granule 对齐）字节并设置分配位，不清零。
+     * 空间不够时返回 nullptr。供 GC 复制对象和持有锁的分配路径调用。
+     */
+    void *allocSurvivor(size_t len);
+    void *allocInOld(size_t len);
+
+    // 地址 @p 所在的卡和卡 @card 的起始地址，见 heap/barrier.h
+    u1 *cardFor(address p) const { return g_card_table_base + (p >> CARD_SHIFT); }
+    static address cardStart(const u1 *card) { return (address) (card - g_card_table_base) << CARD_SHIFT; }
+
+    // 清除所有的卡，full GC 重新记录老年代到年轻代的引用
+    void clearCards();
+
+    /*
+     * minor GC 复制结束后调用：回收 eden 和两个 survivor 空间中没有标记的对象
+     * （已复制走的对象和死对象），重建它们的空闲区间，然后交换 from 和 to。
+     */
+    void finishMinorGc();
+
+    /*
+     * full GC 标记结束后调用：回收整个堆中没有标记的对象，
+     * 老年代中存活对象之间的空隙重建为空闲块，并清除全部标记。
+     */
+    void sweep();
+
+    // 堆总大小，以字节为单位，不包括总是空着的 to
     size_t totalMemory()
     {
-        return size;
+        return size - toSpace().capacity();
     }
 
-    // 堆还有多少剩余空间，以字节为单位。
+    // 堆还有多少剩余空间，以字节为单位。O(1)，不包括各线程 TLAB 中未用的空间
     size_t freeMemory();
-    
-    std::string toString();
 
-    friend void gc();
+    std::string toString();
 };
 
 #endif //CABIN_HEAP_H
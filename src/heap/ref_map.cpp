@@ -0,0 +1,814 @@
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+#include "ref_map.h"
+#include "../classfile/bytecode_reader.h"
+#include "../metadata/class.h"
+#include "../metadata/method.h"
+#include "../interpreter/threaded_code.h"
+#include "../runtime/frame.h"
+
+using namespace std;
+
+/*
+ * 抽象解释中 slot 的类型。
+ * jsr 压入的返回地址的类型为 T_RETADDR 加上子程序的 pc，ret 据此找到返回的位置。
+ */
+enum : u4 {
+    T_TOP,    // 没有初始化，或者在不同的路径上类型不一致
+    T_VALUE,  // int, float, long, double 等非引用的值
+    T_REF,
+    T_RETADDR,
+};
+
+// 某条指令开始执行时局部变量表和操作数栈的类型
+struct State {
+    vector<u4> locals;
+    vector<u4> stack;
+    vector<bool> written; // 进入当前子程序（见 jsr）后写过的局部变量
+
+    void push(u4 t) { stack.push_back(t); }
+    void push2()    { push(T_VALUE); push(T_VALUE); }
+
+    u4 pop()
+    {
+        if (stack.empty())
+            JVM_PANIC("operand stack underflow\n");
+        u4 t = stack.back();
+        stack.pop_back();
+        return t;
+    }
+
+    void pop(size_t n)
+    {
+        while (n-- > 0)
+            pop();
+    }
+
+    u4 load(u2 i) const
+    {
+        if (i >= locals.size())
+            JVM_PANIC("local variable index out of range: %d\n", i);
+        return locals[i];
+    }
+
+    void store(u2 i, u4 t)
+    {
+        if (i >= locals.size())
+            JVM_PANIC("local variable index out of range: %d\n", i);
+        locals[i] = t;
+        written[i] = true;
+    }
+
+    void store2(u2 i)
+    {
+        store(i, T_VALUE);
+        store(i + 1, T_VALUE);
+    }
+
+    // 复制栈顶的 @n 个 slot，插入到它们下面的 @below 个 slot 之下（dup 系列指令）
+    void dup(size_t n, size_t below)
+    {
+        if (stack.size() < n + below)
+            JVM_PANIC("operand stack underflow\n");
+        vector<u4> top(stack.end() - n, stack.end());
+        stack.insert(stack.end() - n - below, top.begin(), top.end());
+    }
+};
+
+/*
+ * 把描述符 @d 开头的一个类型占用的 slot 追加到 @slots 中（void 不占用 slot），
+ * 返回下一个类型的位置。
+ */
+static const char *appendType(const char *d, vector<u4> &slots)
+{
+    switch (*d) {
+        case 'J': case 'D':
+            slots.push_back(T_VALUE);
+            slots.push_back(T_VALUE);
+            return d + 1;
+        case 'L':
+            slots.push_back(T_REF);
+            return strchr(d, ';') + 1;
+        case '[':
+            slots.push_back(T_REF);
+            while (*d == '[')
+                d++;
+            return *d == 'L' ? strchr(d, ';') + 1 : d + 1;
+        case 'V':
+            return d + 1;
+        default:
+            slots.push_back(T_VALUE);
+            return d + 1;
+    }
+}
+
+// 方法描述符 @descriptor 中参数占用的 slot
+static vector<u4> argSlots(const utf8_t *descriptor)
+{
+    vector<u4> slots;
+    const char *d = strchr(descriptor, '(') + 1;
+    while (*d != ')')
+        d = appendType(d, slots);
+    return slots;
+}
+
+// 类型描述符 @descriptor（字段的类型或者方法的返回值）占用 slot 的数量
+static size_t slotsOf(const char *descriptor)
+{
+    return *descriptor == 'V' ? 0 : (*descriptor == 'J' || *descriptor == 'D') ? 2 : 1;
+}
+
+namespace {
+
+struct Handler {
+    u2 start_pc;
+    u2 end_pc;
+    u2 handler_pc;
+};
+
+// 对方法的字节码做数据流分析，求出每条可达的指令开始执行时的状态
+class Analyzer {
+    Method *m;
+    ConstantPool &cp;
+    vector<Handler> handlers;
+
+    vector<unique_ptr<State>> states; // 以 pc 为下标，不是可达指令开头的为空
+    vector<size_t> worklist;
+    vector<bool> queued;
+
+    unordered_map<size_t, vector<size_t>> jsr_sites; // 子程序的 pc -> 调用它的 jsr 指令的 pc
+    unordered_map<size_t, State> ret_states;         // 子程序的 pc -> 从它返回时的状态
+
+    void merge(size_t pc, const State &s);
+    void returnFrom(size_t jsr_pc, const State &ret);
+    void ret(size_t pc, const State &s, u2 index);
+    void execute(size_t pc, const State &in);
+
+public:
+    Analyzer(Method *m, vector<Handler> handlers);
+
+    void run(const State &entry);
+
+    [[nodiscard]] const State *stateAt(size_t pc) const { return states[pc].get(); }
+};
+
+}
+
+Analyzer::Analyzer(Method *m, vector<Handler> handlers0)
+        : m(m), cp(m->clazz->cp), handlers(move(handlers0)),
+          states(m->code_len), queued(m->code_len, false)
+{
+    BytecodeReader r(m->code, m->code_len);
+    while (r.hasMore()) {
+        size_t pc = r.pc;
+        u1 opcode = r.readu1();
+        switch (opcode) {
+            case JVM_OPC_jsr:
+                jsr_sites[pc + r.reads2()].push_back(pc);
+                break;
+            case JVM_OPC_jsr_w:
+                jsr_sites[pc + (s4) r.readu4()].push_back(pc);
+                break;
+            case JVM_OPC_tableswitch: {
+                r.align4();
+                r.readu4(); // default
+                s4 low = r.readu4();
+                s4 high = r.readu4();
+                r.pc += (size_t) (high - low + 1) * 4;
+                break;
+            }
+            case JVM_OPC_lookupswitch: {
+                r.align4();
+                r.readu4(); // default
+                s4 npairs = r.readu4();
+                r.pc += (size_t) npairs * 8;
+                break;
+            }
+            case JVM_OPC_wide:
+                r.pc = pc + (r.readu1() == JVM_OPC_iinc ? 6 : 4);
+                break;
+            default: {
+                static const u1 opcode_length[JVM_OPC_MAX + 1] = JVM_OPCODE_LENGTH_INITIALIZER;
+                r.pc = pc + max<u1>(opcode_length[opcode], 1);
+                break;
+            }
+        }
+    }
+}
+
+void Analyzer::merge(size_t pc, const State &s)
+{
+    if (pc >= m->code_len)
+        JVM_PANIC("branch out of code: %s, pc %zu\n", m->toString().c_str(), pc);
+
+    unique_ptr<State> &t = states[pc];
+    bool changed = false;
+    if (t == nullptr) {
+        t = make_unique<State>(s);
+        changed = true;
+    } else {
+        if (t->stack.size() != s.stack.size())
+            JVM_PANIC("inconsistent stack depth: %s, pc %zu\n", m->toString().c_str(), pc);
+
+        // 类型不一致的 slot 变为 T_TOP，每个 slot 最多变化一次，分析一定会终止
+        for (size_t i = 0; i < s.locals.size(); i++) {
+            if (t->locals[i] != s.locals[i] && t->locals[i] != T_TOP) {
+                t->locals[i] = T_TOP;
+                changed = true;
+            }
+            if (s.written[i] && !t->written[i]) {
+                t->written[i] = true;
+                changed = true;
+            }
+        }
+        for (size_t i = 0; i < s.stack.size(); i++) {
+            if (t->stack[i] != s.stack[i] && t->stack[i] != T_TOP) {
+                t->stack[i] = T_TOP;
+                changed = true;
+            }
+        }
+    }
+
+    if (changed && !queued[pc]) {
+        queued[pc] = true;
+        worklist.push_back(pc);
+    }
+}
+
+/*
+ * 从子程序返回到 @jsr_pc 处的 jsr 指令之后。
+ * 子程序中写过的局部变量取返回时的类型，其他的保持调用子程序时的类型：
+ * 不同的调用者在子程序没有用到的局部变量中可以保存不同类型的值。
+ */
+void Analyzer::returnFrom(size_t jsr_pc, const State &ret)
+{
+    const State *caller = states[jsr_pc].get();
+    if (caller == nullptr) // 这个 jsr 还没有执行到
+        return;
+
+    State s = *caller;
+    s.stack = ret.stack;
+    for (size_t i = 0; i < s.locals.size(); i++) {
+        if (ret.written[i]) {
+            s.locals[i] = ret.locals[i];
+            s.written[i] = true;
+        }
+    }
+    merge(jsr_pc + (m->code[jsr_pc] == JVM_OPC_jsr ? 3 : 5), s);
+}
+
+// 执行 @pc 处的 ret 指令，返回地址在局部变量 @index 中
+void Analyzer::ret(size_t pc, const State &s, u2 index)
+{
+    u4 t = s.load(index);
+    if (t < T_RETADDR)
+        JVM_PANIC("ret without return address: %s, pc %zu\n", m->toString().c_str(), pc);
+
+    size_t sub = t - T_RETADDR;
+    auto iter = ret_states.find(sub);
+    if (iter == ret_states.end()) {
+        iter = ret_states.emplace(sub, s).first;
+    } else {
+        State &rs = iter->second;
+        for (size_t i = 0; i < rs.locals.size(); i++) {
+            if (rs.locals[i] != s.locals[i])
+                rs.locals[i] = T_TOP;
+            rs.written[i] = rs.written[i] || s.written[i];
+        }
+        for (size_t i = 0; i < rs.stack.size() && i < s.stack.size(); i++) {
+            if (rs.stack[i] != s.stack[i])
+                rs.stack[i] = T_TOP;
+        }
+    }
+
+    for (size_t jsr_pc : jsr_sites[sub])
+        returnFrom(jsr_pc, iter->second);
+}
+
+void Analyzer::execute(size_t pc, const State &in)
+{
+    State s = in;
+    BytecodeReader r(m->code, m->code_len);
+    r.pc = pc;
+
+    u1 opcode = r.readu1();
+    bool falls_through = true;
+    u2 index;
+
+    switch (opcode) {
+        case JVM_OPC_nop:
+            break;
+        case JVM_OPC_aconst_null:
+            s.push(T_REF);
+            break;
+        case JVM_OPC_iconst_m1: case JVM_OPC_iconst_0: case JVM_OPC_iconst_1:
+        case JVM_OPC_iconst_2: case JVM_OPC_iconst_3: case JVM_OPC_iconst_4:
+        case JVM_OPC_iconst_5: case JVM_OPC_fconst_0: case JVM_OPC_fconst_1:
+        case JVM_OPC_fconst_2:
+            s.push(T_VALUE);
+            break;
+        case JVM_OPC_lconst_0: case JVM_OPC_lconst_1:
+        case JVM_OPC_dconst_0: case JVM_OPC_dconst_1:
+            s.push2();
+            break;
+        case JVM_OPC_bipush:
+            r.readu1();
+            s.push(T_VALUE);
+            break;
+        case JVM_OPC_sipush:
+            r.readu2();
+            s.push(T_VALUE);
+            break;
+        case JVM_OPC_ldc:
+        case JVM_OPC_ldc_w: {
+            index = opcode == JVM_OPC_ldc ? r.readu1() : r.readu2();
+            u1 type = cp.getType(index);
+            if (type == JVM_CONSTANT_Integer || type == JVM_CONSTANT_Float) {
+                s.push(T_VALUE);
+            } else if (type == JVM_CONSTANT_String || type == JVM_CONSTANT_ResolvedString
+                       || type == JVM_CONSTANT_Class || type == JVM_CONSTANT_ResolvedClass
+                       || type == JVM_CONSTANT_MethodType || type == JVM_CONSTANT_MethodHandle) {
+                s.push(T_REF);
+            } else {
+                s.push(T_TOP); // 不支持的常量，执行时会抛出异常
+            }
+            break;
+        }
+        case JVM_OPC_ldc2_w:
+            r.readu2();
+            s.push2();
+            break;
+
+        case JVM_OPC_iload: case JVM_OPC_fload:
+            r.readu1();
+            s.push(T_VALUE);
+            break;
+        case JVM_OPC_lload: case JVM_OPC_dload:
+            r.readu1();
+            s.push2();
+            break;
+        case JVM_OPC_aload:
+            s.push(s.load(r.readu1()));
+            break;
+        case JVM_OPC_iload_0: case JVM_OPC_iload_1: case JVM_OPC_iload_2: case JVM_OPC_iload_3:
+        case JVM_OPC_fload_0: case JVM_OPC_fload_1: case JVM_OPC_fload_2: case JVM_OPC_fload_3:
+            s.push(T_VALUE);
+            break;
+        case JVM_OPC_lload_0: case JVM_OPC_lload_1: case JVM_OPC_lload_2: case JVM_OPC_lload_3:
+        case JVM_OPC_dload_0: case JVM_OPC_dload_1: case JVM_OPC_dload_2: case JVM_OPC_dload_3:
+            s.push2();
+            break;
+        case JVM_OPC_aload_0: case JVM_OPC_aload_1: case JVM_OPC_aload_2: case JVM_OPC_aload_3:
+            s.push(s.load(opcode - JVM_OPC_aload_0));
+            break;
+
+        case JVM_OPC_iaload: case JVM_OPC_faload: case JVM_OPC_baload:
+        case JVM_OPC_caload: case JVM_OPC_saload:
+            s.pop(2);
+            s.push(T_VALUE);
+            break;
+        case JVM_OPC_laload: case JVM_OPC_daload:
+            s.pop(2);
+            s.push2();
+            break;
+        case JVM_OPC_aaload:
+            s.pop(2);
+            s.push(T_REF);
+            break;
+
+        case JVM_OPC_istore: case JVM_OPC_fstore:
+            s.pop();
+            s.store(r.readu1(), T_VALUE);
+            break;
+        case JVM_OPC_lstore: case JVM_OPC_dstore:
+            s.pop(2);
+            s.store2(r.readu1());
+            break;
+        case JVM_OPC_astore: {
+            u4 t = s.pop(); // 引用，或者 jsr 压入的返回地址
+            s.store(r.readu1(), t);
+            break;
+        }
+        case JVM_OPC_istore_0: case JVM_OPC_istore_1: case JVM_OPC_istore_2: case JVM_OPC_istore_3:
+            s.pop();
+            s.store(opcode - JVM_OPC_istore_0, T_VALUE);
+            break;
+        case JVM_OPC_fstore_0: case JVM_OPC_fstore_1: case JVM_OPC_fstore_2: case JVM_OPC_fstore_3:
+            s.pop();
+            s.store(opcode - JVM_OPC_fstore_0, T_VALUE);
+            break;
+        case JVM_OPC_lstore_0: case JVM_OPC_lstore_1: case JVM_OPC_lstore_2: case JVM_OPC_lstore_3:
+            s.pop(2);
+            s.store2(opcode - JVM_OPC_lstore_0);
+            break;
+        case JVM_OPC_dstore_0: case JVM_OPC_dstore_1: case JVM_OPC_dstore_2: case JVM_OPC_dstore_3:
+            s.pop(2);
+            s.store2(opcode - JVM_OPC_dstore_0);
+            break;
+        case JVM_OPC_astore_0: case JVM_OPC_astore_1: case JVM_OPC_astore_2: case JVM_OPC_astore_3: {
+            u4 t = s.pop();
+            s.store(opcode - JVM_OPC_astore_0, t);
+            break;
+        }
+
+        case JVM_OPC_iastore: case JVM_OPC_fastore: case JVM_OPC_aastore:
+        case JVM_OPC_bastore: case JVM_OPC_castore: case JVM_OPC_sastore:
+            s.pop(3);
+            break;
+        case JVM_OPC_lastore: case JVM_OPC_dastore:
+            s.pop(4);
+            break;
+
+        case JVM_OPC_pop:     s.pop();       break;
+        case JVM_OPC_pop2:    s.pop(2);      break;
+        case JVM_OPC_dup:     s.dup(1, 0);   break;
+        case JVM_OPC_dup_x1:  s.dup(1, 1);   break;
+        case JVM_OPC_dup_x2:  s.dup(1, 2);   break;
+        case JVM_OPC_dup2:    s.dup(2, 0);   break;
+        case JVM_OPC_dup2_x1: s.dup(2, 1);   break;
+        case JVM_OPC_dup2_x2: s.dup(2, 2);   break;
+        case JVM_OPC_swap: {
+            u4 a = s.pop();
+            u4 b = s.pop();
+            s.push(a);
+            s.push(b);
+            break;
+        }
+
+        case JVM_OPC_iadd: case JVM_OPC_fadd: case JVM_OPC_isub: case JVM_OPC_fsub:
+        case JVM_OPC_imul: case JVM_OPC_fmul: case JVM_OPC_idiv: case JVM_OPC_fdiv:
+        case JVM_OPC_irem: case JVM_OPC_frem: case JVM_OPC_ishl: case JVM_OPC_ishr:
+        case JVM_OPC_iushr: case JVM_OPC_iand: case JVM_OPC_ior: case JVM_OPC_ixor:
+        case JVM_OPC_fcmpl: case JVM_OPC_fcmpg:
+            s.pop(2);
+            s.push(T_VALUE);
+            break;
+        case JVM_OPC_ladd: case JVM_OPC_dadd: case JVM_OPC_lsub: case JVM_OPC_dsub:
+        case JVM_OPC_lmul: case JVM_OPC_dmul: case JVM_OPC_ldiv: case JVM_OPC_ddiv:
+        case JVM_OPC_lrem: case JVM_OPC_drem: case JVM_OPC_land: case JVM_OPC_lor:
+        case JVM_OPC_lxor:
+            s.pop(4);
+            s.push2();
+            break;
+        case JVM_OPC_lshl: case JVM_OPC_lshr: case JVM_OPC_lushr:
+            s.pop(3);
+            s.push2();
+            break;
+        case JVM_OPC_ineg: case JVM_OPC_fneg: case JVM_OPC_i2f: case JVM_OPC_f2i:
+        case JVM_OPC_i2b: case JVM_OPC_i2c: case JVM_OPC_i2s:
+            s.pop();
+            s.push(T_VALUE);
+            break;
+        case JVM_OPC_lneg: case JVM_OPC_dneg: case JVM_OPC_l2d: case JVM_OPC_d2l:
+            s.pop(2);
+            s.push2();
+            break;
+        case JVM_OPC_i2l: case JVM_OPC_i2d: case JVM_OPC_f2l: case JVM_OPC_f2d:
+            s.pop();
+            s.push2();
+            break;
+        case JVM_OPC_l2i: case JVM_OPC_l2f: case JVM_OPC_d2i: case JVM_OPC_d2f:
+            s.pop(2);
+            s.push(T_VALUE);
+            break;
+        case JVM_OPC_lcmp: case JVM_OPC_dcmpl: case JVM_OPC_dcmpg:
+            s.pop(4);
+            s.push(T_VALUE);
+            break;
+        case JVM_OPC_iinc:
+            s.store(r.readu1(), T_VALUE);
+            r.readu1();
+            break;
+
+        case JVM_OPC_ifeq: case JVM_OPC_ifne: case JVM_OPC_iflt:
+        case JVM_OPC_ifge: case JVM_OPC_ifgt: case JVM_OPC_ifle:
+        case JVM_OPC_ifnull: case JVM_OPC_ifnonnull:
+            s.pop();
+            merge(pc + r.reads2(), s);
+            break;
+        case JVM_OPC_if_icmpeq: case JVM_OPC_if_icmpne: case JVM_OPC_if_icmplt:
+        case JVM_OPC_if_icmpge: case JVM_OPC_if_icmpgt: case JVM_OPC_if_icmple:
+        case JVM_OPC_if_acmpeq: case JVM_OPC_if_acmpne:
+            s.pop(2);
+            merge(pc + r.reads2(), s);
+            break;
+        case JVM_OPC_goto:
+            merge(pc + r.reads2(), s);
+            falls_through = false;
+            break;
+        case JVM_OPC_goto_w:
+            merge(pc + (s4) r.readu4(), s);
+            falls_through = false;
+            break;
+        case JVM_OPC_jsr:
+        case JVM_OPC_jsr_w: {
+            size_t target = pc + (opcode == JVM_OPC_jsr ? r.reads2() : (s4) r.readu4());
+            State sub = s;
+            sub.push(T_RETADDR + (u4) target);
+            fill(sub.written.begin(), sub.written.end(), false);
+            merge(target, sub);
+
+            auto iter = ret_states.find(target);
+            if (iter != ret_states.end())
+                returnFrom(pc, iter->second);
+            falls_through = false; // jsr 之后的指令由 ret 到达
+            break;
+        }
+        case JVM_OPC_ret:
+            ret(pc, s, r.readu1());
+            falls_through = false;
+            break;
+        case JVM_OPC_tableswitch: {
+            s.pop();
+            r.align4();
+            merge(pc + (s4) r.readu4(), s); // default
+            s4 low = r.readu4();
+            s4 high = r.readu4();
+            for (int64_t n = (int64_t) high - low + 1; n > 0; n--) // high 可能是 INT_MAX
+                merge(pc + (s4) r.readu4(), s);
+            falls_through = false;
+            break;
+        }
+        case JVM_OPC_lookupswitch: {
+            s.pop();
+            r.align4();
+            merge(pc + (s4) r.readu4(), s); // default
+            s4 npairs = r.readu4();
+            for (s4 i = 0; i < npairs; i++) {
+                r.readu4(); // match
+                merge(pc + (s4) r.readu4(), s);
+            }
+            falls_through = false;
+            break;
+        }
+
+        case JVM_OPC_ireturn: case JVM_OPC_lreturn: case JVM_OPC_freturn:
+        case JVM_OPC_dreturn: case JVM_OPC_areturn: case JVM_OPC_return:
+        case JVM_OPC_athrow:
+            falls_through = false;
+            break;
+
+        case JVM_OPC_getstatic:
+            appendType(cp.memberDescriptor(r.readu2()), s.stack);
+            break;
+        case JVM_OPC_putstatic:
+            s.pop(slotsOf(cp.memberDescriptor(r.readu2())));
+            break;
+        case JVM_OPC_getfield:
+            s.pop();
+            appendType(cp.memberDescriptor(r.readu2()), s.stack);
+            break;
+        case JVM_OPC_putfield:
+            s.pop(slotsOf(cp.memberDescriptor(r.readu2())) + 1);
+            break;
+
+        case JVM_OPC_invokevirtual: case JVM_OPC_invokespecial:
+        case JVM_OPC_invokestatic: case JVM_OPC_invokeinterface:
+        case JVM_OPC_invokedynamic: {
+            index = r.readu2();
+            if (opcode == JVM_OPC_invokeinterface || opcode == JVM_OPC_invokedynamic)
+                r.readu2(); // count 和 0
+            const utf8_t *descriptor = cp.memberDescriptor(index);
+            s.pop(argSlots(descriptor).size());
+            if (opcode != JVM_OPC_invokestatic && opcode != JVM_OPC_invokedynamic)
+                s.pop(); // this
+            appendType(strchr(descriptor, ')') + 1, s.stack);
+            break;
+        }
+        case JVM_OPC_invokenative:
+            appendType(strchr(m->descriptor, ')') + 1, s.stack);
+            break;
+
+        case JVM_OPC_new:
+            r.readu2();
+            s.push(T_REF);
+            break;
+        case JVM_OPC_newarray:
+            r.readu1();
+            s.pop();
+            s.push(T_REF);
+            break;
+        case JVM_OPC_anewarray:
+        case JVM_OPC_checkcast:
+            r.readu2();
+            s.pop();
+            s.push(T_REF);
+            break;
+        case JVM_OPC_arraylength:
+            s.pop();
+            s.push(T_VALUE);
+            break;
+        case JVM_OPC_instanceof:
+            r.readu2();
+            s.pop();
+            s.push(T_VALUE);
+            break;
+        case JVM_OPC_monitorenter:
+        case JVM_OPC_monitorexit:
+            s.pop();
+            break;
+        case JVM_OPC_multianewarray: {
+            r.readu2();
+            u1 dim = r.readu1();
+            s.pop(dim);
+            s.push(T_REF);
+            break;
+        }
+
+        case JVM_OPC_wide: {
+            opcode = r.readu1();
+            index = r.readu2();
+            switch (opcode) {
+                case JVM_OPC_iload: case JVM_OPC_fload: s.push(T_VALUE); break;
+                case JVM_OPC_lload: case JVM_OPC_dload: s.push2(); break;
+                case JVM_OPC_aload: s.push(s.load(index)); break;
+                case JVM_OPC_istore: case JVM_OPC_fstore: s.pop(); s.store(index, T_VALUE); break;
+                case JVM_OPC_lstore: case JVM_OPC_dstore: s.pop(2); s.store2(index); break;
+                case JVM_OPC_astore: { u4 t = s.pop(); s.store(index, t); break; }
+                case JVM_OPC_iinc: s.store(index, T_VALUE); r.readu2(); break;
+                case JVM_OPC_ret: ret(pc, s, index); falls_through = false; break;
+                default:
+                    JVM_PANIC("wrong wide opcode: %d, %s\n", opcode, m->toString().c_str());
+            }
+            break;
+        }
+
+        default:
+            JVM_PANIC("unknown opcode: %d, %s\n", opcode, m->toString().c_str());
+    }
+
+    // 抛出异常时，局部变量可能是执行前的状态，也可能是执行后的状态（比如 store 之后）
+    for (const Handler &h : handlers) {
+        if (h.start_pc <= pc && pc < h.end_pc) {
+            State e = in;
+            e.stack.assign(1, T_REF);
+            merge(h.handler_pc, e);
+            e.locals = s.locals;
+            e.written = s.written;
+            merge(h.handler_pc, e);
+        }
+    }
+
+    if (falls_through)
+        merge(r.pc, s);
+}
+
+void Analyzer::run(const State &entry)
+{
+    merge(0, entry);
+    while (!worklist.empty()) {
+        size_t pc = worklist.back();
+        worklist.pop_back();
+        queued[pc] = false;
+        State in = *states[pc]; // execute 可能改变 states[pc]（比如自己跳转到自己）
+        execute(pc, in);
+    }
+}
+
+bool isSafepoint(u1 opcode)
+{
+    return opcode == JVM_OPC_ldc || opcode == JVM_OPC_ldc_w // 解析 String, Class 等常量
+           || (JVM_OPC_iaload <= opcode && opcode <= JVM_OPC_saload)
+           || (JVM_OPC_iastore <= opcode && opcode <= JVM_OPC_sastore)
+           || (JVM_OPC_idiv <= opcode && opcode <= JVM_OPC_lrem)
+           // 跳转，返回，字段访问，调用，对象分配，类型检查，athrow 和 monitor
+           || (JVM_OPC_ifeq <= opcode && opcode <= JVM_OPC_jsr_w && opcode != JVM_OPC_wide)
+           || opcode == JVM_OPC_invokenative;
+}
+
+RefMap::RefMap(Method *m): method(m), max_locals(m->max_locals)
+{
+    assert(m != nullptr && m->code != nullptr);
+
+    // 方法开始执行之前的状态：参数，其他局部变量没有初始化
+    State entry;
+    entry.locals.assign(m->max_locals, T_TOP);
+    entry.written.assign(m->max_locals, false);
+    u2 n = 0;
+    if (!m->isStatic())
+        entry.locals[n++] = T_REF;
+    // 签名多态方法实际的参数与描述符不同，在其中不会分配对象（见 MethodHandle.invokeExact），只记录 this
+    if (!m->isSignaturePolymorphic()) {
+        for (u4 t : argSlots(m->descriptor)) {
+            if (n >= m->max_locals)
+                JVM_PANIC("max_locals is too small: %s\n", m->toString().c_str());
+            entry.locals[n++] = t;
+        }
+    }
+
+    vector<Handler> handlers;
+    for (const Method::ExceptionTable &t : m->exception_tables)
+        handlers.push_back({ t.start_pc, t.end_pc, t.handler_pc });
+
+    Analyzer analyzer(m, move(handlers));
+    analyzer.run(entry);
+
+    // 生成位图，相同的只保存一份。先记录位图的偏移，bits 不再增长之后再转为指针
+    size_t words = max<size_t>((m->max_locals + m->max_stack + 31) / 32, 1);
+    map<vector<u4>, size_t> offsets;
+    auto add = [&](const State &s) -> size_t {
+        if (s.stack.size() > m->max_stack)
+            JVM_PANIC("operand stack overflow: %s\n", m->toString().c_str());
+        vector<u4> b(words, 0);
+        for (size_t i = 0; i < s.locals.size(); i++) {
+            if (s.locals[i] == T_REF)
+                b[i >> 5] |= 1u << (i & 31);
+        }
+        for (size_t i = 0; i < s.stack.size(); i++) {
+            size_t j = m->max_locals + i;
+            if (s.stack[i] == T_REF)
+                b[j >> 5] |= 1u << (j & 31);
+        }
+        auto iter = offsets.find(b);
+        if (iter != offsets.end())
+            return iter->second;
+        size_t offset = bits.size();
+        bits.insert(bits.end(), b.begin(), b.end());
+        offsets.emplace(move(b), offset);
+        return offset;
+    };
+
+    vector<size_t> entry_offsets;
+    size_t offset = add(entry);
+    for (size_t pc = 0; pc < m->code_len; pc++) {
+        const State *s = analyzer.stateAt(pc);
+        if (s == nullptr)
+            continue;
+        u1 opcode = m->code[pc];
+        if (opcode == JVM_OPC_wide)
+            opcode = m->code[pc + 1];
+        if (!isSafepoint(opcode))
+            continue;
+        entries.push_back({ (u4) pc, (u2) s->stack.size(), nullptr });
+        entry_offsets.push_back(add(*s));
+    }
+
+    entry_map = { 0, 0, bits.data() + offset };
+    for (size_t i = 0; i < entries.size(); i++)
+        entries[i].bits = bits.data() + entry_offsets[i];
+}
+
+RefMap *RefMap::of(Method *m)
+{
+    assert(m != nullptr);
+
+    RefMap *p = m->ref_map.load(memory_order_acquire);
+    if (p != nullptr || m->code == nullptr)
+        return p;
+
+    auto t = new RefMap(m);
+    if (m->ref_map.compare_exchange_strong(p, t, memory_order_acq_rel))
+        return t;
+    delete t; // 其他线程已经创建了
+    return p;
+}
+
+const RefMapEntry *RefMap::at(size_t pc) const
+{
+    auto iter = lower_bound(entries.begin(), entries.end(), pc,
+                            [](const RefMapEntry &e, size_t pc) { return e.pc < pc; });
+    return iter != entries.end() && iter->pc == pc ? &*iter : nullptr;
+}
+
+const RefMapEntry *RefMap::at(const Frame *frame) const
+{
+    assert(frame != nullptr && frame->method == method);
+
+    ThreadedCode *tc = method->threaded_code.load(memory_order_acquire);
+    if (frame->ip == nullptr || tc == nullptr || frame->ip == tc->code)
+        return &entry_map;
+
+    size_t pc = frame->pc();
+    const RefMapEntry *e = at(pc);
+    if (e == nullptr)
+        JVM_PANIC("no reference map: %s, pc %zu\n", method->toString().c_str(), pc);
+    return e;
+}
+
+string RefMap::toString() const
+{
+    ostringstream oss;
+    oss << method->toString() << endl;
+
+    auto print = [&](const RefMapEntry &e) {
+        oss << "    ";
+        for (int i = 0; i < max_locals; i++)
+            oss << (isLocalRef(&e, i) ? 'R' : '.');
+        oss << " | ";
+        for (int i = 0; i < e.stack_depth; i++)
+            oss << (isStackRef(&e, i) ? 'R' : '.');
+        oss << endl;
+    };
+
+    oss << "  entry:" << endl;
+    print(entry_map);
+    for (const RefMapEntry &e : entries) {
+        oss << "  pc " << e.pc << ":" << endl;
+        print(e);
+    }
+    return oss.str();
+}
@@ -0,0 +1,77 @@
+#ifndef CABIN_REF_MAP_H
+#define CABIN_REF_MAP_H
+
+#include <vector>
+#include "../cabin.h"
+
+class Method;
+class Frame;
+
+/*
+ * 引用映射（reference map）
+ *
+ * 解释器的 slot 不带类型，GC 扫描 frame 时要知道局部变量表和操作数栈中哪些 slot 保存的是引用。
+ * 方法第一次被调用、翻译为线索化代码时（见 translate），对其字节码做一遍抽象解释
+ * （与类型推导的校验器相同的数据流分析），
+ * 得到每条指令开始执行时各 slot 的类型：引用、非引用，或者在不同路径上不一致（不扫描）。
+ * 只为安全点（见 isSafepoint）保存结果，相同的位图只存一份。
+ *
+ * 类型不一致的 slot 在之后的指令中不会被当作引用使用（字节码通过了校验），
+ * 其中的对象即使还在也已经死了，不扫描是安全的；没有初始化的局部变量也不扫描。
+ *
+ * 不在 GC 时才分析：分析要读常量池（要加锁），而停在安全点的线程可能正持有常量池的锁。
+ *
+ * 没有使用 StackMapTable：老版本的 class 文件没有它，而且它只在分支目标处有记录，
+ * 其他安全点仍然要从它开始推导，直接分析整个方法更简单，也支持 jsr/ret。
+ */
+
+// 某个安全点处的引用映射
+struct RefMapEntry {
+    u4 pc;
+    u2 stack_depth; // 操作数栈中 slot 的数量
+    const u4 *bits; // 前 max_locals 位对应局部变量表，之后对应操作数栈，为 1 的 slot 保存引用
+};
+
+class RefMap {
+    Method *method;
+    u2 max_locals;
+
+    std::vector<u4> bits;             // 去重后的位图，依次存放
+    std::vector<RefMapEntry> entries; // 按 pc 排序
+    RefMapEntry entry_map;            // 方法开始执行之前（只有参数）
+
+    explicit RefMap(Method *m);
+
+public:
+    // 返回方法 @m 的引用映射，不存在则创建
+    static RefMap *of(Method *m);
+
+    /*
+     * 返回 @frame 当前位置的引用映射，frame 须停在安全点或者还没有开始执行（见 Frame::ip）。
+     * 正在执行的 frame 只在安全点保存 ip 和 ostack（见 interpreter.cpp 中的 SAVE_STATE）。
+     */
+    const RefMapEntry *at(const Frame *frame) const;
+
+    // 返回 @pc 处的引用映射，@pc 不是可达的安全点时返回 nullptr
+    [[nodiscard]] const RefMapEntry *at(size_t pc) const;
+
+    [[nodiscard]] bool isLocalRef(const RefMapEntry *e, int i) const
+    {
+        return (e->bits[i >> 5] >> (i & 31)) & 1;
+    }
+
+    [[nodiscard]] bool isStackRef(const RefMapEntry *e, int i) const
+    {
+        return isLocalRef(e, max_locals + i);
+    }
+
+    [[nodiscard]] std::string toString() const;
+};
+
+/*
+ * 判断 @opcode 指令是否为安全点：可能分配对象、调用方法、抛出异常或者跳转（回边上轮询）的指令，
+ * 以及返回指令。其他指令（常量、局部变量的读写、栈操作和不会抛出异常的运算）执行时不会发生 GC。
+ */
+bool isSafepoint(u1 opcode);
+
+#endif //CABIN_REF_MAP_H
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cassert>
+#include "space.h"
+#include "tlab.h"
+
+using namespace std;
+
+static inline uintptr_t alignUp(uintptr_t p, size_t align)
+{
+    return (p + align - 1) & ~(uintptr_t) (align - 1);
+}
+
+void Space::init(uintptr_t bottom0, uintptr_t end0)
+{
+    assert(bottom0 % TLAB_ALIGNMENT == 0 && end0 % TLAB_ALIGNMENT == 0);
+    bottom = bottom0;
+    end = end0;
+    clear();
+    addFree(bottom, end);
+}
+
+void *Space::alloc(size_t len, size_t align)
+{
+    assert(len > 0 && (align & (align - 1)) == 0);
+
+    // 当前区间剩下的太少时换到下一个区间，剩下的部分下次 GC 时回收
+    for (;;) {
+        uintptr_t p = alignUp(top, align);
+        if (p <= limit && len <= limit - p) {
+            top = p + len;
+            high = max(high, top);
+            return (void *) p;
+        }
+        if (limit - top >= TLAB_MIN_SIZE || next == ranges.size())
+            break;
+        top = ranges[next].start;
+        limit = ranges[next].end;
+        rest_bytes -= limit - top;
+        next++;
+    }
+
+    // 大对象：不放弃当前区间，在后面的区间中首次适配
+    for (size_t i = next; i < ranges.size(); i++) {
+        Range &r = ranges[i];
+        uintptr_t p = alignUp(r.start, align);
+        if (p <= r.end && len <= r.end - p) {
+            rest_bytes -= p + len - r.start;
+            r.start = p + len;
+            high = max(high, r.start);
+            return (void *) p;
+        }
+    }
+
+    return nullptr;
+}
+
+void Space::clear()
+{
+    top = limit = bottom;
+    ranges.clear();
+    next = 0;
+    rest_bytes = 0;
+    high = bottom;
+}
+
+void Space::addFree(uintptr_t start, uintptr_t end0)
+{
+    assert(bottom <= start && start <= end0 && end0 <= end);
+
+    // 区间之前留在原地的对象也算分配过的
+    high = max(high, start);
+    start = alignUp(start, TLAB_ALIGNMENT);
+    end0 &= ~(uintptr_t) (TLAB_ALIGNMENT - 1);
+    if (start >= end0)
+        return;
+
+    if (top == limit && next == ranges.size()) {
+        // 第一个区间直接作为当前区间
+        top = start;
+        limit = end0;
+    } else {
+        assert(ranges.empty() || ranges.back().end <= start);
+        ranges.push_back({ start, end0 });
+        rest_bytes += end0 - start;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef CABIN_SPACE_H
+#define CABIN_SPACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../cabin.h"
+
+/*
+ * 年轻代中按移动指针（bump pointer）分配的空间：eden 和两个 survivor 空间，见 heap/heap.h。
+ *
+ * GC 后空间中通常没有对象了，但被保守扫描到的对象（见 heap/gc.cpp）不能移动，只能留在原地，
+ * 所以空闲的部分是若干按地址排列的区间。分配时在当前区间中移动指针，
+ * 当前区间剩下的太少时换到下一个区间；放不下的大对象在后面的区间中首次适配。
+ * 区间的两端都按 TLAB_ALIGNMENT 对齐，TLAB 可以直接在其中分配（见 heap/tlab.h）。
+ *
+ * 不加锁，调用者负责同步。
+ */
+class Space {
+    struct Range {
+        uintptr_t start;
+        uintptr_t end;
+    };
+
+    uintptr_t bottom = 0;
+    uintptr_t end = 0;
+
+    // 当前区间中未分配的部分
+    uintptr_t top = 0;
+    uintptr_t limit = 0;
+
+    // 还没有用到的区间，从 next 开始
+    std::vector<Range> ranges;
+    size_t next = 0;
+    size_t rest_bytes = 0; // 这些区间的大小之和
+
+    // 分配过的最高地址，GC 只需处理 [bottom, high) 中的位图
+    uintptr_t high = 0;
+
+public:
+    void init(uintptr_t bottom, uintptr_t end);
+
+    bool contains(uintptr_t p) const
+    {
+        return bottom <= p && p < end;
+    }
+
+    uintptr_t getBottom() const { return bottom; }
+    uintptr_t getEnd() const { return end; }
+    uintptr_t highWater() const { return high; }
+
+    size_t capacity() const
+    {
+        return end - bottom;
+    }
+
+    size_t freeBytes() const
+    {
+        return (limit - top) + rest_bytes;
+    }
+
+    // 分配起始地址按 @align（2 的幂）对齐的 @len 字节，不清零。空间不够时返回 nullptr
+    void *alloc(size_t len, size_t align);
+
+    /*
+     * 重建空闲区间：先调用 clear()，再按地址顺序对每个空闲的部分调用 addFree()。
+     * 两端向内对齐到 TLAB_ALIGNMENT，对齐后为空的部分被丢弃。
+     */
+    void clear();
+    void addFree(uintptr_t start, uintptr_t end);
+};
+
+#endif //CABIN_SPACE_H
@@ -0,0 +1,46 @@
+#include <algorithm>
+#include <cassert>
+#include "tlab.h"
+
+using namespace std;
+
+// allocation_fraction 的指数平均中，新值的权重
+#define FRACTION_WEIGHT 0.35
+
+static size_t alignTlabSize(size_t size)
+{
+    size = (size + TLAB_ALIGNMENT - 1) & ~(size_t) (TLAB_ALIGNMENT - 1);
+    return clamp<size_t>(size, TLAB_MIN_SIZE, TLAB_MAX_SIZE);
+}
+
+void Tlab::fill(uintptr_t start, size_t size)
+{
+    assert(start % TLAB_ALIGNMENT == 0 && size % TLAB_ALIGNMENT == 0);
+
+    top = start;
+    end = start + size;
+    refills++;
+    allocated += size;
+
+    if (refills > TLAB_TARGET_REFILLS) {
+        // 分配得比预期的快，不等到 GC 就加大
+        desired_size = alignTlabSize(desired_size * 2);
+        refills = 0;
+    }
+    refill_waste_limit = desired_size / TLAB_REFILL_WASTE_FRACTION;
+}
+
+void Tlab::resize(size_t total_allocated, size_t heap_size)
+{
+    retire();
+
+    if (total_allocated > 0) {
+        double fraction = (double) allocated / total_allocated;
+        allocation_fraction = FRACTION_WEIGHT * fraction + (1 - FRACTION_WEIGHT) * allocation_fraction;
+        desired_size = alignTlabSize((size_t) (heap_size * allocation_fraction / TLAB_TARGET_REFILLS));
+    }
+
+    refill_waste_limit = desired_size / TLAB_REFILL_WASTE_FRACTION;
+    refills = 0;
+    allocated = 0;
+}
@@ -0,0 +1,114 @@
+#ifndef CABIN_TLAB_H
+#define CABIN_TLAB_H
+
+#include <cstddef>
+#include <cstdint>
+#include "../cabin.h"
+#include "../config.h"
+
+/*
+ * 线程本地分配缓冲（thread-local allocation buffer）
+ *
+ * 每个线程从 eden（见 heap/heap.h）中取一块内存作为自己的 TLAB，小对象在其中移动指针（bump pointer）分配，不加锁。
+ * 只有 TLAB 用完、重新填充（refill）时才获取堆的锁，见 Heap::alloc。
+ *
+ * TLAB 的起始地址和大小都是 TLAB_ALIGNMENT 的整数倍，
+ * 堆位图（见 Heap）的每个字都只属于一个 TLAB，线程设置分配位时不需要原子操作。
+ *
+ * TLAB 的大小随线程的分配速率调整：每次 GC 时按线程在上一轮中分配的份额，
+ * 使它在一轮中大约填充 TLAB_TARGET_REFILLS 次；两次 GC 之间填充次数超过这个数时加倍。
+ * 分配少的线程用小的 TLAB，浪费的空间少；分配多的线程用大的 TLAB，很少需要获取锁。
+ *
+ * TLAB 剩余的空间不退回 eden，GC 后按留下的对象重建 eden 的空闲区间，它们自然被回收。
+ */
+
+// TLAB 的对齐，对应堆位图中的一个字（64 个 granule）
+#define TLAB_ALIGNMENT (64 * 8)
+
+// 两次 GC 之间每个线程期望填充 TLAB 的次数
+#define TLAB_TARGET_REFILLS 50
+
+/*
+ * 大于 TLAB 大小的 1/TLAB_OBJECT_FRACTION 的对象直接在堆中分配，
+ * 所以 TLAB 中的对象都不超过 TLAB_MAX_SIZE / TLAB_OBJECT_FRACTION
+ */
+#define TLAB_OBJECT_FRACTION 8
+
+// TLAB 剩余的空间不超过其大小的 1/TLAB_REFILL_WASTE_FRACTION 时才丢弃它、重新填充
+#define TLAB_REFILL_WASTE_FRACTION 64
+
+class Tlab {
+    uintptr_t top = 0;
+    uintptr_t end = 0;
+
+    size_t desired_size = TLAB_MIN_SIZE;
+
+    // 剩余的空间超过此值时，放不下的对象在堆中分配，不丢弃 TLAB（见 shouldRefill）
+    size_t refill_waste_limit = TLAB_MIN_SIZE / TLAB_REFILL_WASTE_FRACTION;
+
+    // 自上次 GC 以来填充的次数和取得的空间
+    u4 refills = 0;
+    size_t allocated = 0;
+
+    // 线程分配的空间占所有线程的份额，按每次 GC 时的值指数平均
+    double allocation_fraction = 0;
+
+public:
+    // 在 TLAB 中分配 @len（已按 granule 对齐）字节，空间不够时返回 nullptr
+    void *alloc(size_t len)
+    {
+        if (end - top < len)
+            return nullptr;
+        auto p = (void *) top;
+        top += len;
+        return p;
+    }
+
+    // @len 字节的对象能否在 TLAB 中分配
+    bool accepts(size_t len) const
+    {
+        return len <= desired_size / TLAB_OBJECT_FRACTION;
+    }
+
+    /*
+     * 当前 TLAB 放不下 @len 字节时，是丢弃它并重新填充，还是把对象分配在堆中。
+     * 每次选择后者都放宽限制，避免剩余空间较多的 TLAB 一直不被替换。
+     */
+    bool shouldRefill()
+    {
+        if (end - top <= refill_waste_limit)
+            return true;
+        refill_waste_limit += 4 * sizeof(uintptr_t);
+        return false;
+    }
+
+    // 下次填充的大小
+    size_t nextSize() const
+    {
+        return desired_size;
+    }
+
+    // 用 [@start, @start + @size) 作为新的 TLAB，丢弃当前的
+    void fill(uintptr_t start, size_t size);
+
+    // 丢弃当前的 TLAB
+    void retire()
+    {
+        top = end = 0;
+    }
+
+    size_t allocatedSinceGc() const
+    {
+        return allocated;
+    }
+
+    /*
+     * GC 时调用（所有线程都停在安全点）：丢弃当前的 TLAB，
+     * 按本线程在这一轮中分配的份额调整 TLAB 的大小。
+     * @total_allocated: 这一轮所有线程取得的 TLAB 空间之和
+     * @heap_size: TLAB 所在的空间（eden）的大小
+     */
+    void resize(size_t total_allocated, size_t heap_size);
+};
+
+#endif //CABIN_TLAB_H
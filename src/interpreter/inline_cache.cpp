@@ -0,0 +1,137 @@
+#include "inline_cache.h"
+#include "../metadata/class.h"
+#include "../metadata/method.h"
+#include "../objects/class_loader.h"
+
+using namespace std;
+
+Method *InlineCache::miss(Class *receiver, Method *resolved)
+{
+    assert(receiver != nullptr && resolved != nullptr);
+
+    Method *target = receiver->dispatch(resolved);
+    if (target == nullptr)
+        return nullptr;  // 由调用者抛出异常，不缓存
+
+    if (megamorphic.load(memory_order_relaxed)) {
+        megamorphic_calls.fetch_add(1, memory_order_relaxed);
+        return target;
+    }
+
+    misses.fetch_add(1, memory_order_relaxed);
+
+    lock_guard<std::mutex> lock(this->mutex);
+    int n = count.load(memory_order_relaxed);
+    for (int i = 0; i < n; i++) {
+        if (entries[i].receiver.load(memory_order_relaxed) == receiver)
+            return target; // 其他线程已经添加了
+    }
+
+    if (n == IC_POLYMORPHIC_SIZE) {
+        megamorphic.store(true, memory_order_relaxed);
+        return target;
+    }
+
+    entries[n].target = target;
+    entries[n].receiver.store(receiver, memory_order_release);
+    count.store(n + 1, memory_order_release);
+    return target;
+}
+
+InlineCache *InlineCache::of(Method *m, size_t pc)
+{
+    assert(m != nullptr);
+    assert(pc < m->code_len);
+
+    atomic<InlineCache *> *ics = m->inline_caches.load(memory_order_acquire);
+    if (ics == nullptr) {
+        auto t = new atomic<InlineCache *>[m->code_len]();
+        if (m->inline_caches.compare_exchange_strong(ics, t, memory_order_acq_rel)) {
+            ics = t;
+        } else {
+            delete[] t; // 其他线程已经创建了，ics 为其创建的表
+        }
+    }
+
+    InlineCache *ic = ics[pc].load(memory_order_acquire);
+    if (ic == nullptr) {
+        auto t = new InlineCache;
+        if (ics[pc].compare_exchange_strong(ic, t, memory_order_acq_rel)) {
+            ic = t;
+        } else {
+            delete t;
+        }
+    }
+
+    return ic;
+}
+
+InlineCache *InlineCache::peek(const Method *m, size_t pc)
+{
+    assert(m != nullptr);
+    assert(pc < m->code_len);
+
+    atomic<InlineCache *> *ics = m->inline_caches.load(memory_order_acquire);
+    return ics != nullptr ? ics[pc].load(memory_order_acquire) : nullptr;
+}
+
+void InlineCacheStats::add(const InlineCache *ic)
+{
+    assert(ic != nullptr);
+
+    call_sites++;
+    if (ic->megamorphic.load(memory_order_relaxed)) {
+        megamorphic_sites++;
+    } else if (ic->count.load(memory_order_relaxed) > 1) {
+        polymorphic_sites++;
+    } else {
+        monomorphic_sites++;
+    }
+
+    hits += ic->hits.load(memory_order_relaxed);
+    misses += ic->misses.load(memory_order_relaxed);
+    megamorphic_calls += ic->megamorphic_calls.load(memory_order_relaxed);
+}
+
+static void addStats(InlineCacheStats &stats, const Class *c)
+{
+    for (Method *m : c->methods) {
+        atomic<InlineCache *> *ics = m->inline_caches.load(memory_order_acquire);
+        if (ics == nullptr)
+            continue;
+        for (size_t pc = 0; pc < m->code_len; pc++) {
+            InlineCache *ic = ics[pc].load(memory_order_acquire);
+            if (ic != nullptr)
+                stats.add(ic);
+        }
+    }
+}
+
+InlineCacheStats getInlineCacheStats()
+{
+    InlineCacheStats stats;
+
+    for (auto &iter : *getAllBootClasses()) {
+        addStats(stats, iter.second);
+    }
+
+    for (const Object *loader : getAllClassLoaders()) {
+        if (loader == BOOT_CLASS_LOADER || loader->classes == nullptr)
+            continue;
+        for (auto &iter : *loader->classes) {
+            addStats(stats, iter.second);
+        }
+    }
+
+    return stats;
+}
+
+void printInlineCacheStats()
+{
+    InlineCacheStats s = getInlineCacheStats();
+    printf("inline caches: %llu call sites (%llu monomorphic, %llu polymorphic, %llu megamorphic)\n",
+            (unsigned long long) s.call_sites, (unsigned long long) s.monomorphic_sites,
+            (unsigned long long) s.polymorphic_sites, (unsigned long long) s.megamorphic_sites);
+    printf("inline caches: %llu hits, %llu misses, %llu megamorphic calls\n",
+            (unsigned long long) s.hits, (unsigned long long) s.misses, (unsigned long long) s.megamorphic_calls);
+}
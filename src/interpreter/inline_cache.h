@@ -0,0 +1,99 @@
+#ifndef CABIN_INLINE_CACHE_H
+#define CABIN_INLINE_CACHE_H
+
+#include <atomic>
+#include <mutex>
+#include "../cabin.h"
+
+class Class;
+class Method;
+struct InlineCacheStats;
+
+// 多态内联缓存最多缓存的 (receiver class, method) 对的数量
+#define IC_POLYMORPHIC_SIZE 4
+
+/*
+ * 虚方法调用点（invokevirtual, invokeinterface）的内联缓存（inline cache）。
+ *
+ * 缓存以 (Method, pc) 为键保存在 Method 的旁路表中，不改动字节码。
+ * 状态只会单向转换：
+ *   未初始化 -> 单态（monomorphic，1个条目）-> 多态（polymorphic，最多 IC_POLYMORPHIC_SIZE 个条目）-> 超多态（megamorphic）
+ * 超多态的调用点不再缓存，直接回退到完整的方法查找。
+ *
+ * 条目只追加不修改，读取无需加锁：
+ * 先写 target，再以 release 语义写 receiver，最后发布 count。
+ */
+class InlineCache {
+    struct Entry {
+        std::atomic<Class *> receiver{nullptr};
+        Method *target = nullptr;
+    } entries[IC_POLYMORPHIC_SIZE];
+
+    std::atomic<int> count{0};
+    std::atomic<bool> megamorphic{false};
+    std::mutex mutex; // 只在更新缓存时使用
+
+    std::atomic<u8> hits{0};
+    std::atomic<u8> misses{0};
+    std::atomic<u8> megamorphic_calls{0};
+
+    Method *miss(Class *receiver, Method *resolved);
+
+public:
+    /*
+     * 返回接收者类型为 @receiver 时，调用 @resolved 实际要执行的方法。
+     * @resolved: 调用指令中解析出的方法。
+     */
+    Method *lookup(Class *receiver, Method *resolved)
+    {
+        int n = count.load(std::memory_order_acquire);
+        for (int i = 0; i < n; i++) {
+            if (entries[i].receiver.load(std::memory_order_acquire) == receiver) {
+                hits.fetch_add(1, std::memory_order_relaxed);
+                return entries[i].target;
+            }
+        }
+        return miss(receiver, resolved);
+    }
+
+    [[nodiscard]] bool isMegamorphic() const { return megamorphic.load(std::memory_order_relaxed); }
+
+    // 单态的缓存返回其唯一的 (receiver class, method) 对，供优化编译器内联使用
+    bool monomorphic(Class *&receiver, Method *&target) const
+    {
+        if (megamorphic.load(std::memory_order_relaxed) || count.load(std::memory_order_acquire) != 1)
+            return false;
+        receiver = entries[0].receiver.load(std::memory_order_acquire);
+        target = entries[0].target;
+        return true;
+    }
+
+    // 返回调用点 (@m, @pc) 的内联缓存，不存在则创建。
+    static InlineCache *of(Method *m, size_t pc);
+
+    // 返回调用点 (@m, @pc) 的内联缓存，不存在时返回 nullptr
+    static InlineCache *peek(const Method *m, size_t pc);
+
+    friend struct InlineCacheStats;
+    friend InlineCacheStats getInlineCacheStats();
+};
+
+struct InlineCacheStats {
+    u8 call_sites = 0;
+    u8 monomorphic_sites = 0;
+    u8 polymorphic_sites = 0;
+    u8 megamorphic_sites = 0;
+
+    u8 hits = 0;
+    u8 misses = 0;
+    u8 megamorphic_calls = 0; // 在超多态调用点上发生的调用，不计入 misses
+
+    void add(const InlineCache *ic);
+};
+
+// 汇总所有调用点的内联缓存统计信息
+InlineCacheStats getInlineCacheStats();
+
+void printInlineCacheStats();
+
+#endif //CABIN_INLINE_CACHE_H
@@ -1,25 +1,35 @@
 #include <iostream>
 #include <cmath>
+#include <atomic>
 #include "../cabin.h"
 #include "interpreter.h"
 #include "../objects/mh.h"
 #include "../objects/object.h"
 #include "../metadata/class.h"
 #include "../metadata/method.h"
+#include "../metadata/cha.h"
 #include "../debug.h"
 #include "../runtime/vm_thread.h"
 #include "../runtime/frame.h"
 #include "../objects/array.h"
 #include "../exception.h"
+#include "inline_cache.h"
+#include "method_profile.h"
+#include "intrinsics.h"
+#include "threaded_code.h"
+#include "superinstructions.h"
+#include "../jit/jit.h"
+#include "../runtime/signals.h"
+#include "../runtime/safepoint.h"
 
 using namespace std;
 using namespace utf8;
 using namespace slot;
 using namespace method_handles;
 
-#if TRACE_INTERPRETER
+#if TRACE_INTERPRETER || PROFILE_BYTECODE_SEQUENCES
 // the mapping of instructions's code and name
-static const char *instruction_names[] = {
+const char *const instruction_names[] = {
         "nop",
 
         // Constants [0x01 ... 0x14]
@@ -92,10 +102,24 @@ static const char *instruction_names[] = {
 #undef U
 #define U "unused"
         "breakpoint",
-        U, U, U, U, U, // [0xcb ... 0xcf]
-        U, U, U, U, U, U, U, U, // [0xd0 ... 0xd7]
-        U, U, U, U, U, U, U, U, // [0xd8 ... 0xdf]
-        U, U, U, U, U, U, U, U, // [0xe0 ... 0xe7]
+
+        // Quick [0xcb ... 0xda]
+        "ldc_quick", "ldc_w_quick", "ldc2_w_quick",
+        "getstatic_quick", "getstatic2_quick", "putstatic_quick", "putstatic2_quick",
+        "getfield_quick", "getfield2_quick", "putfield_quick", "putfield2_quick",
+        "invokevirtual_quick", "invokenonvirtual_quick", "invokestatic_quick", "new_quick",
+        "invokeinterface_quick",
+
+        // Superinstructions [0xdb ... 0xe4]
+        "aload_getfield", "dup_getfield",
+        "iload_iload_if_icmpeq", "iload_iload_if_icmpne", "iload_iload_if_icmplt",
+        "iload_iload_if_icmpge", "iload_iload_if_icmpgt", "iload_iload_if_icmple",
+        "iload_iconst_iadd_istore", "aload_iload_iaload",
+
+        "invokedynamic_quick", // [0xe5]
+        "invokedirect_quick",  // [0xe6]
+        "putfield_ref_quick",  // [0xe7]
+
         U, U, U, U, U, U, U, U, // [0xe8 ... 0xef]
         U, U, U, U, U, U, U, U, // [0xf0 ... 0xf7]
         U, U, U, U, U, U, // [0xf8 ... 0xfd]
@@ -103,22 +127,111 @@ static const char *instruction_names[] = {
 #undef U        
 };
 
+#endif
+
+#if TRACE_INTERPRETER
 #define TRACE PRINT_TRACE
-#define PRINT_OPCODE TRACE("%d(0x%x), %s, pc = %d\n", opcode, opcode, instruction_names[opcode], (int)frame->reader.pc);
+#define PRINT_OPCODE \
+{ \
+    size_t __pc = frame->method->threaded_code.load()->pcOf(ip); \
+    u1 __opc = frame->method->code[__pc]; \
+    TRACE("%d(0x%x), %s, pc = %d\n", __opc, __opc, instruction_names[__opc], (int) __pc); \
+}
 #else
 #define TRACE(...)
 #define PRINT_OPCODE
 #endif
 
-static unsigned char opcode_len[JVM_OPC_MAX+1] = JVM_OPCODE_LENGTH_INITIALIZER;
-
 static void callJNIMethod(Frame *frame);
+static Field *resolveAccessorField(Method *m);
+
+/*
+ * 不创建 frame 执行访问器方法 @m（见 Method::AccessorKind），实参从 @args 开始，返回值写在 @args 处。
+ * 返回执行后调用者的栈顶。字段还没有解析或者接收者为 null 时返回 nullptr，
+ * 由调用者正常地调用方法：在方法自己的 frame 中解析字段或抛出异常，栈轨迹保持正确。
+ */
+static inline slot_t *invokeAccessor(Method *m, slot_t *args)
+{
+    if (m->accessor_kind == Method::ACCESSOR_EMPTY)
+        return args;
+
+    Field *f = m->accessor_field.load(memory_order_acquire);
+    if (f == nullptr && (f = resolveAccessorField(m)) == nullptr)
+        return nullptr;
+
+    jref obj = getRef(args);
+    if (obj == jnull)
+        return nullptr;
+
+    slot_t *data = obj->data + f->id;
+    if (m->accessor_kind == Method::ACCESSOR_GETTER) {
+        args[0] = data[0];
+        if (f->category_two) {
+            args[1] = data[1];
+            return args + 2;
+        }
+        return args + 1;
+    }
+
+    // ACCESSOR_SETTER
+    data[0] = args[1];
+    if (f->category_two)
+        data[1] = args[2];
+    else if (f->isReference())
+        postWriteBarrier(data);
+    return args;
+}
+
 static bool checkcast(Class *s, Class *t);
+static InvokeDynamicCallSite *linkInvokeDynamic(Class *clazz, u2 i);
+
+#if IMPLICIT_NULL_CHECKS
+/*
+ * exec() 单独放在一个段中，链接器生成段的起止符号，据此判断出错的指令是否位于解释器中。
+ * 指定了段的函数不会被拆分出冷代码（-freorder-blocks-and-partition），整个函数都在段内。
+ */
+#define INTERPRETER_SECTION __attribute__((section("cabin_interpreter"), noinline))
+extern "C" const char __start_cabin_interpreter[], __stop_cabin_interpreter[];
+#else
+#define INTERPRETER_SECTION
+#endif
+
+bool isInterpreterCode(const void *pc)
+{
+#if IMPLICIT_NULL_CHECKS
+    return __start_cabin_interpreter <= (const char *) pc && (const char *) pc < __stop_cabin_interpreter;
+#else
+    return false;
+#endif
+}
+
+/*
+ * 缓存的栈顶 tos（见 exec()）与 jint, jfloat, jref 之间的转换。
+ * 与 slot::setInt, slot::getInt 等在内存中的表示相同，但按值转换，不取 tos 的地址，
+ * tos 才能一直留在寄存器中。
+ */
+template <typename T>
+static inline slot_t toSlot(T v)
+{
+    static_assert(sizeof(T) <= sizeof(slot_t));
+    slot_t s = 0;
+    memcpy(&s, &v, sizeof(T));
+    return s;
+}
+
+template <typename T>
+static inline T fromSlot(slot_t s)
+{
+    static_assert(sizeof(T) <= sizeof(slot_t));
+    T v;
+    memcpy(&v, &s, sizeof(T));
+    return v;
+}
 
 /*
  * 执行当前线程栈顶的frame
  */
-static slot_t *exec(jref &excep)
+INTERPRETER_SECTION static slot_t *exec(jref &excep)
 {    
     static void *handlers[] = {
         &&opc_nop, 
@@ -201,10 +314,24 @@ static slot_t *exec(jref &excep)
 #undef U
 #define U &&opc_unused
         &&opc_breakpoint, 
-        U, U, U, U, U,          // [0xcb ... 0xcf]
-        U, U, U, U, U, U, U, U, // [0xd0 ... 0xd7]
-        U, U, U, U, U, U, U, U, // [0xd8 ... 0xdf]
-        U, U, U, U, U, U, U, U, // [0xe0 ... 0xe7]
+
+        // Quick [0xcb ... 0xda]
+        &&opc_ldc_quick, &&opc_ldc_w_quick, &&opc_ldc2_w_quick,
+        &&opc_getstatic_quick, &&opc_getstatic2_quick, &&opc_putstatic_quick, &&opc_putstatic2_quick,
+        &&opc_getfield_quick, &&opc_getfield2_quick, &&opc_putfield_quick, &&opc_putfield2_quick,
+        &&opc_invokevirtual_quick, &&opc_invokenonvirtual_quick, &&opc_invokestatic_quick,
+        &&opc_new_quick, &&opc_invokeinterface_quick,
+
+        // Superinstructions [0xdb ... 0xe4]
+        &&opc_aload_getfield, &&opc_dup_getfield,
+        &&opc_iload_iload_if_icmpeq, &&opc_iload_iload_if_icmpne, &&opc_iload_iload_if_icmplt,
+        &&opc_iload_iload_if_icmpge, &&opc_iload_iload_if_icmpgt, &&opc_iload_iload_if_icmple,
+        &&opc_iload_iconst_iadd_istore, &&opc_aload_iload_iaload,
+
+        &&opc_invokedynamic_quick, // [0xe5]
+        &&opc_invokedirect_quick,  // [0xe6]
+        &&opc_putfield_ref_quick,  // [0xe7]
+
         U, U, U, U, U, U, U, U, // [0xe8 ... 0xef]
         U, U, U, U, U, U, U, U, // [0xf0 ... 0xf7]
         U, U, U, U, U, U,       // [0xf8 ... 0xfd]
@@ -214,344 +341,506 @@ static slot_t *exec(jref &excep)
 
     Thread *thread = getCurrentThread();
     Method *resolved_method;
+    slot_t *args; // 调用 resolved_method 的实参，已从调用者的操作数栈中弹出，见 POP_ARGS
+    InvokeDynamicCallSite *call_site;
 
     Frame *frame = thread->getTopFrame();
     TRACE("executing frame: %s\n", frame->toString().c_str());
     
     int index;
 
-    BytecodeReader *reader = &frame->reader;
+    Cell *ip = frame->ip; // 指向下一条要执行的指令（或当前指令的下一个操作数）
+    slot_t *ostack = frame->ostack - 1; // 栈顶在操作数栈中的位置，栈顶的值缓存在 tos 中，见下
+    slot_t tos = *ostack;
     Class *clazz = frame->method->clazz;
     ConstantPool *cp = &frame->method->clazz->cp;
-    // slot_t *ostack = frame->ostack;
     slot_t *lvars = frame->lvars;
 
     jref _this = frame->method->isStatic() ? (jref) clazz : getRef(lvars);
 
+/*
+ * 栈顶缓存（top-of-stack caching）：
+ * 操作数栈最上面的一个 slot 不写在内存中，而是缓存在局部变量 tos 中，ostack 指向它在栈中的位置
+ * （栈为空时指向 Frame::below_ostack）。编译器可以把 ostack 和 tos 一直放在寄存器里，
+ * 入栈时把旧的栈顶写到内存，新值留在 tos 中；出栈时从 tos 中取值，再从内存读入下面的 slot。
+ * 这样 iadd 这样的指令只读一次内存，结果留在 tos 中，也不写内存。
+ *
+ * jlong 和 jdouble 的值在两个 slot 中的第一个中（见 slot.h），tos 中缓存的是不用的第二个 slot，
+ * 它们的运算直接读写内存中的第一个 slot。
+ *
+ * 只在调用、返回、异常、对象分配和可能执行 Java 代码的慢路径前把 tos 写回内存，
+ * 并把 ip 和栈顶写回 frame（见 SAVE_STATE 和 CHANGE_FRAME），
+ * 这些位置都是安全点，GC 按写回的 ip 和 ostack 扫描 frame（见 heap/ref_map.h）。
+ * 慢路径中可能发生 GC，移动 tos 引用的对象，之后要从内存中重新读入 tos（见 RELOAD_TOS）。
+ * 抛出异常时操作数栈也要保持完整，所以检查在操作数出栈之前进行。
+ */
+static_assert(sizeof(jlong) <= sizeof(slot_t) && sizeof(jdouble) <= sizeof(slot_t),
+              "the second slot of a jlong or jdouble must be unused");
+
+// 把缓存的栈顶写回内存，之后操作数栈全部在内存中，栈顶之上是 ostack + 1
+#define SPILL_TOS (*ostack = tos)
+
+// 内存中的栈顶已被更新（慢路径中发生了 GC，或者被编译后的代码改写），重新读入
+#define RELOAD_TOS (tos = *ostack)
+
+// 从完全在内存中的操作数栈开始使用栈顶缓存，@top 为内存中的栈顶之上（即 frame->ostack）
+#define LOAD_STACK(top) (ostack = (top) - 1, tos = *ostack)
+
+#define PUSH(v)  do { slot_t __v = (v); *ostack++ = tos; tos = __v; } while(false)
+#define PUSHI(v) PUSH(toSlot<jint>(v))
+#define PUSHF(v) PUSH(toSlot<jfloat>(v))
+#define PUSHR(v) PUSH(toSlot<jref>(v))
+#define PUSHL(v) do { jlong __v = (v); *ostack = tos; setLong(ostack + 1, __v); ostack += 2; } while(false)
+#define PUSHD(v) do { jdouble __v = (v); *ostack = tos; setDouble(ostack + 1, __v); ostack += 2; } while(false)
+
+// 压入 @slots 开始的两个 slot（category two 的值）
+#define PUSH2(slots) \
+do { \
+    const slot_t *__s = (slots); \
+    ostack[0] = tos; \
+    ostack[1] = __s[0]; \
+    tos = __s[1]; \
+    ostack += 2; \
+} while(false)
+
+#define POP()  exchange(tos, *--ostack)
+#define DROP(n) (ostack -= (n), RELOAD_TOS) // 弹出 @n 个 slot，不取值
+#define POPI() fromSlot<jint>(POP())
+#define POPF() fromSlot<jfloat>(POP())
+#define POPR() fromSlot<jref>(POP())
+#define POPL() (ostack -= 2, tos = *ostack, getLong(ostack + 1))
+#define POPD() (ostack -= 2, tos = *ostack, getDouble(ostack + 1))
+
+// 弹出两个 slot（category two 的值）到 @slots 处
+#define POP2(slots) \
+do { \
+    slot_t *__s = (slots); \
+    __s[0] = ostack[-1]; \
+    __s[1] = tos; \
+    ostack -= 2; \
+    tos = *ostack; \
+} while(false)
+
+/*
+ * 弹出调用的 @n 个 slot 的实参，args 指向它们，实参在内存中依次排列。
+ * 之后 args 就是调用者 frame 写回的栈顶（见 _invoke_method）。
+ */
+#define POP_ARGS(n) (SPILL_TOS, args = ostack + 1 - (n), LOAD_STACK(args))
+
+    /*
+     * 异常离开 exec() 时保存当前的执行位置，
+     * execJavaFunc 捕获异常后会重新进入 exec() 并从 frame->ip 处继续处理异常。
+     */
+    try {
+
+    if (ip == nullptr) {
+        ip = getThreadedCode(frame->method, handlers)->code;
+    }
+
     if (excep != nullptr) {
-        frame->pushr(excep);
+        PUSHR(excep);
         excep = nullptr;
         goto opc_athrow;
     }
 
+/*
+ * 在解释器内部抛出异常：创建异常对象后直接跳转到 athrow 查找异常处理代码，
+ * 不经过 C++ 的 throw/catch，也不用重新进入 exec()。
+ * 解释器中常见的隐式异常（空指针、数组越界、类型转换等）都走这条路径，
+ * C++ 异常只用于解析、链接等慢路径和虚拟机/本地方法的边界。
+ * @msg: const char *，可以为 nullptr
+ */
+#define THROW_JAVA_EXCEPTION(excep_class_name, msg) \
+do { \
+    SAVE_STATE; \
+    jref __excep = newException(excep_class_name, msg); \
+    RELOAD_TOS; \
+    PUSHR(__excep); \
+    goto opc_athrow; \
+} while(false)
+
 #define NULL_POINTER_CHECK(ref) \
 do { \
     if (ref == nullptr) \
-        throw java_lang_NullPointerException(); \
+        THROW_JAVA_EXCEPTION(S(java_lang_NullPointerException), nullptr); \
 } while(false)
 
+/*
+ * 紧接着就要在 exec() 中访问 ref 所指对象的成员时使用。
+ * 打开隐式空指针检查后不再比较，null 引用在访问时引起段错误，
+ * 由信号处理程序转为 NullPointerException，见 runtime/signals.h
+ */
+#if IMPLICIT_NULL_CHECKS
+#define IMPLICIT_NULL_POINTER_CHECK(ref) ((void) 0)
+#else
+#define IMPLICIT_NULL_POINTER_CHECK(ref) NULL_POINTER_CHECK(ref)
+#endif
+
+#define ARRAY_INDEX_CHECK(arr, index) \
+do { \
+    if (!(arr)->checkBounds(index)) { \
+        char __msg[32]; \
+        snprintf(__msg, sizeof(__msg), "index is %d", (int) (index)); \
+        THROW_JAVA_EXCEPTION(S(java_lang_ArrayIndexOutOfBoundsException), __msg); \
+    } \
+} while(false)
+
+/*
+ * 转到 @new_frame 执行。调用前已用 SAVE_STATE 写回了操作数栈（返回和抛出异常时原 frame 已弹出），
+ * 这里不再写回 tos：慢路径之后它可能已经过时。
+ */
 #define CHANGE_FRAME(new_frame) \
 do { \
-    /*frame->ostack = ostack;  stack指针在变动，需要设置一下 todo */ \
+    frame->ip = ip; \
     frame = new_frame; \
-    reader = &frame->reader; \
+    ip = frame->ip; \
+    LOAD_STACK(frame->ostack); \
     clazz = frame->method->clazz; \
     cp = &frame->method->clazz->cp; \
-    /*ostack = frame->ostack; */                                     \
     lvars = frame->lvars; \
     _this = frame->method->isStatic() ? (jref) clazz : getRef(lvars); \
     TRACE("executing frame: %s\n", frame->toString().c_str()); \
 } while(false)
 
-    u1 opcode;
-    
+/*
+ * 将刚执行完的指令（ip 已越过其 cells_count 个 cell）在指令流中原地改写为快速指令，
+ * 字节码本身保持不变。
+ * 先发布已解析的常量再改写 handler，保证其他线程看到快速指令时也能看到解析结果。
+ */
+#define QUICKEN(quick_opcode, cells_count) \
+do { \
+    atomic_thread_fence(memory_order_release); \
+    ip[-(cells_count)].handler = handlers[quick_opcode]; \
+} while(false)
+
+/*
+ * 改写刚执行完操作数的调用指令（占 3 个 cell）：类层次分析表明 @m 只有一个实现时
+ * 绑定到 invokedirect_quick，否则改写为 @quick_opcode。见 metadata/cha.h
+ */
+#define QUICKEN_INVOKE(m, quick_opcode) \
+do { \
+    if ((m)->polymorphic.load(memory_order_relaxed) \
+            || (m)->unique_impl.load(memory_order_acquire) == nullptr \
+            || bindCallSite(m, ip - 3, handlers[JVM_OPC_invokedirect_quick], handlers[quick_opcode]) == nullptr) \
+        QUICKEN(quick_opcode, 3); \
+} while(false)
+
+// 读取当前指令的下一个操作数
+#define OPERAND ((ip++)->operand)
+
+/*
+ * 执行可能抛出异常或执行 Java 代码的慢路径前，将执行位置、缓存的栈顶和操作数栈指针写回 frame，
+ * 栈轨迹、新 frame 的分配、GC 等都依赖于 frame 中的值。
+ * 慢路径之后还要使用操作数栈时，先 RELOAD_TOS。
+ */
+#define SAVE_STATE (frame->ip = ip, SPILL_TOS, frame->ostack = ostack + 1)
+
+#if PROFILE_BYTECODE_SEQUENCES
+#define PROFILE_SEQUENCE profileBytecodeSequence(frame->method, ip);
+#else
+#define PROFILE_SEQUENCE
+#endif
+
 #define DISPATCH \
 { \
-    opcode = reader->readu1(); \
-    PRINT_OPCODE; \
-    goto *handlers[opcode]; \
+    PRINT_OPCODE \
+    PROFILE_SEQUENCE \
+    goto *(ip++)->handler; \
 }
 
 opc_nop:
     DISPATCH
 opc_aconst_null:
-    frame->pushr(jnull);
+    PUSHR(jnull);
     DISPATCH
 opc_iconst_m1:
-    frame->pushi(-1);
+    PUSHI(-1);
     DISPATCH
 opc_iconst_0:
-    frame->pushi(0);
+    PUSHI(0);
     DISPATCH
 opc_iconst_1:
-    frame->pushi(1);
+    PUSHI(1);
     DISPATCH
 opc_iconst_2:
-    frame->pushi(2);
+    PUSHI(2);
     DISPATCH
 opc_iconst_3:
-    frame->pushi(3);
+    PUSHI(3);
     DISPATCH
 opc_iconst_4:
-    frame->pushi(4);
+    PUSHI(4);
     DISPATCH
 opc_iconst_5:
-    frame->pushi(5);
+    PUSHI(5);
     DISPATCH
 opc_lconst_0:
-    frame->pushl(0);
+    PUSHL(0);
     DISPATCH
 opc_lconst_1:
-    frame->pushl(1);
+    PUSHL(1);
     DISPATCH
 opc_fconst_0:
-    frame->pushf(0);
+    PUSHF(0);
     DISPATCH
 opc_fconst_1:
-    frame->pushf(1);
+    PUSHF(1);
     DISPATCH
 opc_fconst_2:
-    frame->pushf(2);
+    PUSHF(2);
     DISPATCH
 opc_dconst_0:
-    frame->pushd(0);
+    PUSHD(0);
     DISPATCH
 opc_dconst_1:
-    frame->pushd(1);
+    PUSHD(1);
     DISPATCH
 opc_bipush: // Byte Integer push
-    frame->pushi(reader->reads1());
+    PUSHI((jint) OPERAND);
     DISPATCH
 opc_sipush: // Short Integer push
-    frame->pushi(reader->reads2());
+    PUSHI((jint) OPERAND);
     DISPATCH
 opc_ldc:
-    index = reader->readu1();
-    goto _ldc;
-opc_ldc_w:
-    index = reader->readu2();
-_ldc: {
+opc_ldc_w: {
+    index = OPERAND;
     u1 type = cp->getType(index);
     switch (type) {
         case JVM_CONSTANT_Integer:
-            frame->pushi(cp->getInt(index));
+            PUSHI(cp->getInt(index));
             break;
         case JVM_CONSTANT_Float:
-            frame->pushf(cp->getFloat(index));
+            PUSHF(cp->getFloat(index));
             break;
         case JVM_CONSTANT_String:
-        case JVM_CONSTANT_ResolvedString:
-            frame->pushr(cp->resolveString(index));
+        case JVM_CONSTANT_ResolvedString: {
+            SAVE_STATE;
+            jref str = cp->resolveString(index);
+            RELOAD_TOS;
+            PUSHR(str);
             break;
+        }
         case JVM_CONSTANT_Class:
-        case JVM_CONSTANT_ResolvedClass:
-            frame->pushr(cp->resolveClass(index)->java_mirror);
-            break;
+        case JVM_CONSTANT_ResolvedClass: {
+            SAVE_STATE;
+            jref mirror = cp->resolveClass(index)->java_mirror;
+            RELOAD_TOS;
+            PUSHR(mirror);
+            DISPATCH // class 常量压入的是 java_mirror，不改写
+        }
         default:
             throw java_lang_UnknownError("unknown type: " + to_string(type));
             break;
     }
+    // int, float 和已解析的 String 常量直接保存在常量池的 slot 中
+    // ldc 和 ldc_w 在指令流中的区别只在操作数的宽度，改写后没有区别
+    QUICKEN(JVM_OPC_ldc_quick, 2);
     DISPATCH
 }
 opc_ldc2_w: {
-    index = reader->readu2();
+    index = OPERAND;
     u1 type = cp->getType(index);
     switch (type) {
         case JVM_CONSTANT_Long:
-            frame->pushl(cp->getLong(index));
+            PUSHL(cp->getLong(index));
             break;
         case JVM_CONSTANT_Double:
 //             printvm("=====    %f\n", cp->getDouble(index));
-            frame->pushd(cp->getDouble(index));
+            PUSHD(cp->getDouble(index));
             break;
         default:
             throw java_lang_UnknownError("unknown type: " + to_string(type));
             break;
     }
+    QUICKEN(JVM_OPC_ldc2_w_quick, 2);
     DISPATCH
 }
+opc_ldc_quick:
+opc_ldc_w_quick:
+    PUSH(cp->resolved(OPERAND));
+    DISPATCH
+opc_ldc2_w_quick:
+    index = OPERAND;
+    PUSH(cp->resolved(index));
+    PUSH(cp->resolved(index + 1));
+    DISPATCH
 opc_iload:
 opc_fload:
 opc_aload:
-    index = reader->readu1();
-_iload:
-_fload:
-_aload:
-    *frame->ostack++ = lvars[index];
+    index = OPERAND;
+    PUSH(lvars[index]);
     DISPATCH
 opc_lload:
 opc_dload: 
-    index = reader->readu1();
-_lload:
-_dload: 
-    *frame->ostack++ = lvars[index];
-    *frame->ostack++ = lvars[index + 1];
+    index = OPERAND;
+    PUSH2(lvars + index);
     DISPATCH
 opc_iload_0:
 opc_fload_0:
 opc_aload_0:
-    *frame->ostack++ = lvars[0];
+    PUSH(lvars[0]);
     DISPATCH
 opc_iload_1:
 opc_fload_1:
 opc_aload_1:
-    *frame->ostack++ = lvars[1];
+    PUSH(lvars[1]);
     DISPATCH
 opc_iload_2:
 opc_fload_2:
 opc_aload_2:
-    *frame->ostack++ = lvars[2];
+    PUSH(lvars[2]);
     DISPATCH
 opc_iload_3:
 opc_fload_3:
 opc_aload_3:
-    *frame->ostack++ = lvars[3];
+    PUSH(lvars[3]);
     DISPATCH
 opc_lload_0:
 opc_dload_0:
-    *frame->ostack++ = lvars[0];
-    *frame->ostack++ = lvars[1];
+    PUSH2(lvars + 0);
     DISPATCH
 opc_lload_1:
 opc_dload_1:
-    *frame->ostack++ = lvars[1];
-    *frame->ostack++ = lvars[2];
+    PUSH2(lvars + 1);
     DISPATCH
 opc_lload_2:
 opc_dload_2:
-    *frame->ostack++ = lvars[2];
-    *frame->ostack++ = lvars[3];
+    PUSH2(lvars + 2);
     DISPATCH
 opc_lload_3:
 opc_dload_3:
-    *frame->ostack++ = lvars[3];
-    *frame->ostack++ = lvars[4];
+    PUSH2(lvars + 3);
     DISPATCH
     
-#define GET_AND_CHECK_ARRAY \
-    index = frame->popi(); \
-    auto arr = (Array *) frame->popr(); \
-    NULL_POINTER_CHECK(arr); \
-    if (!arr->checkBounds(index)) \
-       throw java_lang_ArrayIndexOutOfBoundsException("index is " + to_string(index));
+/*
+ * 取出数组和下标并检查，它们先不出栈，抛出异常时操作数栈与执行指令前相同。
+ * @value_slots: 数组和下标之上的 slot 数（要存入数组的值占的 slot 数）
+ */
+#define GET_AND_CHECK_ARRAY(value_slots) \
+    index = fromSlot<jint>((value_slots) == 0 ? tos : ostack[-(value_slots)]); \
+    auto arr = fromSlot<Array *>(ostack[-(value_slots) - 1]); \
+    IMPLICIT_NULL_POINTER_CHECK(arr); \
+    ARRAY_INDEX_CHECK(arr, index);
+
+// 数组和下标出栈，@value 入栈
+#define ARRAY_LOAD_RESULT(t, value) \
+do { \
+    ostack--; \
+    tos = toSlot<t>(value); \
+} while(false)
 
 opc_iaload: {
-    GET_AND_CHECK_ARRAY
-    auto value = arr->get<jint>(index);
-    frame->pushi(value);
+    GET_AND_CHECK_ARRAY(0)
+    ARRAY_LOAD_RESULT(jint, arr->get<jint>(index));
     DISPATCH
 }
 opc_faload: {
-    GET_AND_CHECK_ARRAY
-    auto value = arr->get<jfloat>(index);
-    frame->pushf(value);
+    GET_AND_CHECK_ARRAY(0)
+    ARRAY_LOAD_RESULT(jfloat, arr->get<jfloat>(index));
     DISPATCH
 }
 opc_aaload: {
-    GET_AND_CHECK_ARRAY
-    auto value = arr->get<jref>(index);
-    frame->pushr(value);
+    GET_AND_CHECK_ARRAY(0)
+    ARRAY_LOAD_RESULT(jref, arr->get<jref>(index));
     DISPATCH
 }
 opc_baload: {
-    GET_AND_CHECK_ARRAY
-    jint value = arr->get<jbyte>(index);
-    frame->pushi(value);
+    GET_AND_CHECK_ARRAY(0)
+    ARRAY_LOAD_RESULT(jint, arr->get<jbyte>(index));
     DISPATCH
 }
 opc_caload: {
-    GET_AND_CHECK_ARRAY
-    jint value = arr->get<jchar>(index);
-    frame->pushi(value);
+    GET_AND_CHECK_ARRAY(0)
+    ARRAY_LOAD_RESULT(jint, arr->get<jchar>(index));
     DISPATCH
 }
 opc_saload: {
-    GET_AND_CHECK_ARRAY
-    jint value = arr->get<jshort>(index);
-    frame->pushi(value);
+    GET_AND_CHECK_ARRAY(0)
+    ARRAY_LOAD_RESULT(jint, arr->get<jshort>(index));
     DISPATCH
 }
 opc_laload: {
-    GET_AND_CHECK_ARRAY
-    auto value = arr->get<jlong>(index);
-    frame->pushl(value);
+    // 数组和下标的两个 slot 正好放下 jlong
+    GET_AND_CHECK_ARRAY(0)
+    setLong(ostack - 1, arr->get<jlong>(index));
     DISPATCH
 }
 opc_daload: {
-    GET_AND_CHECK_ARRAY
-    auto value = arr->get<jdouble>(index);
-    frame->pushd(value);
+    GET_AND_CHECK_ARRAY(0)
+    setDouble(ostack - 1, arr->get<jdouble>(index));
     DISPATCH
 }
 
+#undef ARRAY_LOAD_RESULT
+
 opc_istore:
 opc_fstore:
 opc_astore:
-    index = reader->readu1();
-_istore:
-_fstore:
-_astore:
-    lvars[index] = *--frame->ostack;
+    index = OPERAND;
+    lvars[index] = POP();
     DISPATCH
 opc_lstore:
 opc_dstore: 
-    index = reader->readu1();
-_lstore:
-_dstore: 
-    lvars[index + 1] = *--frame->ostack;
-    lvars[index] = *--frame->ostack;
+    index = OPERAND;
+    POP2(lvars + index);
     DISPATCH
 opc_istore_0:
 opc_fstore_0:
 opc_astore_0:
-    lvars[0] = *--frame->ostack;
+    lvars[0] = POP();
     DISPATCH
 opc_istore_1:
 opc_fstore_1:
 opc_astore_1:
-    lvars[1] = *--frame->ostack;
+    lvars[1] = POP();
     DISPATCH
 opc_istore_2:
 opc_fstore_2:
 opc_astore_2:
-    lvars[2] = *--frame->ostack;
+    lvars[2] = POP();
     DISPATCH
 opc_istore_3:
 opc_fstore_3:
 opc_astore_3:
-    lvars[3] = *--frame->ostack;
+    lvars[3] = POP();
     DISPATCH
 opc_lstore_0:
 opc_dstore_0:
-    lvars[1] = *--frame->ostack;
-    lvars[0] = *--frame->ostack;
+    POP2(lvars + 0);
     DISPATCH
 opc_lstore_1:
 opc_dstore_1:
-    lvars[2] = *--frame->ostack;
-    lvars[1] = *--frame->ostack;
+    POP2(lvars + 1);
     DISPATCH
 opc_lstore_2:
 opc_dstore_2:
-    lvars[3] = *--frame->ostack;
-    lvars[2] = *--frame->ostack;
+    POP2(lvars + 2);
     DISPATCH
 opc_lstore_3:
 opc_dstore_3:
-    lvars[4] = *--frame->ostack;
-    lvars[3] = *--frame->ostack;
+    POP2(lvars + 3);
     DISPATCH
 opc_iastore: {
-    auto value = frame->popi();
-    GET_AND_CHECK_ARRAY
-    arr->setInt(index, value);
+    GET_AND_CHECK_ARRAY(1)
+    arr->setInt(index, fromSlot<jint>(tos));
+    DROP(3); // 数组、下标和值出栈
     DISPATCH
 }
 opc_fastore: {
-    auto value = frame->popf();
-    GET_AND_CHECK_ARRAY
-    arr->setFloat(index, value);
+    GET_AND_CHECK_ARRAY(1)
+    arr->setFloat(index, fromSlot<jfloat>(tos));
+    DROP(3);
     DISPATCH
 }
 opc_aastore: {
-    auto value = frame->popr();
-    GET_AND_CHECK_ARRAY
-    arr->setRef(index, value);
+    GET_AND_CHECK_ARRAY(1)
+    arr->setRef(index, fromSlot<jref>(tos));
+    DROP(3);
     DISPATCH
 }
 opc_bastore: {
-    auto value = frame->popi();
-    GET_AND_CHECK_ARRAY
+    GET_AND_CHECK_ARRAY(1)
+    auto value = fromSlot<jint>(tos);
     if (arr->clazz->isByteArrayClass()) {
         arr->setByte(index, (jbyte) value);
     } else if (arr->clazz->isBooleanArrayClass()) {  
@@ -559,201 +848,212 @@ opc_bastore: {
     } else {
         JVM_PANIC("never go here"); // todo
     }
+    DROP(3);
     DISPATCH
 }
 opc_castore: {
-    auto value = frame->popi();
-    GET_AND_CHECK_ARRAY
-    arr->setChar(index, (jchar) value);
+    GET_AND_CHECK_ARRAY(1)
+    arr->setChar(index, (jchar) fromSlot<jint>(tos));
+    DROP(3);
     DISPATCH
 }
 opc_sastore: {
-    auto value = frame->popi();
-    GET_AND_CHECK_ARRAY
-    arr->setShort(index, (jshort) value);
+    GET_AND_CHECK_ARRAY(1)
+    arr->setShort(index, (jshort) fromSlot<jint>(tos));
+    DROP(3);
     DISPATCH
 }
 opc_lastore: {
-    auto value = frame->popl();
-    GET_AND_CHECK_ARRAY
-    arr->setLong(index, value);
+    GET_AND_CHECK_ARRAY(2)
+    arr->setLong(index, getLong(ostack - 1));
+    DROP(4);
     DISPATCH
 }
 opc_dastore: {
-    auto value = frame->popd();
-    GET_AND_CHECK_ARRAY
-    arr->setDouble(index, value);
+    GET_AND_CHECK_ARRAY(2)
+    arr->setDouble(index, getDouble(ostack - 1));
+    DROP(4);
     DISPATCH
 }
 #undef GET_AND_CHECK_ARRAY
 
 opc_pop:
-    frame->ostack--;
+    DROP(1);
     DISPATCH
 opc_pop2:
-    frame->ostack -= 2;
+    DROP(2);
     DISPATCH
 opc_dup:
-    frame->ostack[0] = frame->ostack[-1];
-    frame->ostack++;
+    *ostack++ = tos;
     DISPATCH
 opc_dup_x1:
-    frame->ostack[0] = frame->ostack[-1];
-    frame->ostack[-1] = frame->ostack[-2];
-    frame->ostack[-2] = frame->ostack[0];
-    frame->ostack++;
+    // ..., value2, value1 →
+    // ..., value1, value2, value1
+    ostack[0] = ostack[-1];
+    ostack[-1] = tos;
+    ostack++;
     DISPATCH
 opc_dup_x2:
-    frame->ostack[0] = frame->ostack[-1];
-    frame->ostack[-1] = frame->ostack[-2];
-    frame->ostack[-2] = frame->ostack[-3];
-    frame->ostack[-3] = frame->ostack[0];
-    frame->ostack++;
+    // ..., value3, value2, value1 →
+    // ..., value1, value3, value2, value1
+    ostack[0] = ostack[-1];
+    ostack[-1] = ostack[-2];
+    ostack[-2] = tos;
+    ostack++;
     DISPATCH
 opc_dup2:
-    frame->ostack[0] = frame->ostack[-2];
-    frame->ostack[1] = frame->ostack[-1];
-    frame->ostack += 2;
+    ostack[0] = tos;
+    ostack[1] = ostack[-1];
+    ostack += 2;
     DISPATCH
 opc_dup2_x1:
     // ..., value3, value2, value1 →
     // ..., value2, value1, value3, value2, value1
-    frame->ostack[1] = frame->ostack[-1];
-    frame->ostack[0] = frame->ostack[-2];
-    frame->ostack[-1] = frame->ostack[-3];
-    frame->ostack[-2] = frame->ostack[1];
-    frame->ostack[-3] = frame->ostack[0];
-    frame->ostack += 2;
+    ostack[1] = ostack[-1];
+    ostack[0] = ostack[-2];
+    ostack[-1] = tos;
+    ostack[-2] = ostack[1];
+    ostack += 2;
     DISPATCH
 opc_dup2_x2:
     // ..., value4, value3, value2, value1 →
     // ..., value2, value1, value4, value3, value2, value1
-    frame->ostack[1] = frame->ostack[-1];
-    frame->ostack[0] = frame->ostack[-2];
-    frame->ostack[-1] = frame->ostack[-3];
-    frame->ostack[-2] = frame->ostack[-4];
-    frame->ostack[-3] = frame->ostack[1];
-    frame->ostack[-4] = frame->ostack[0];
-    frame->ostack += 2;
+    ostack[1] = ostack[-1];
+    ostack[0] = ostack[-2];
+    ostack[-1] = ostack[-3];
+    ostack[-2] = tos;
+    ostack[-3] = ostack[1];
+    ostack += 2;
     DISPATCH
 opc_swap:
-    swap(frame->ostack[-1], frame->ostack[-2]);
+    swap(tos, ostack[-1]);
     DISPATCH
 
-#define BINARY_OP(type, t, oper) \
+// 占一个 slot 的 @type 的二元运算：v2 在 tos 中，v1 在内存中，结果留在 tos 中
+#define BINARY_OP(type, oper) \
+do { \
+    type v2 = fromSlot<type>(tos); \
+    type v1 = fromSlot<type>(*--ostack); \
+    tos = toSlot<type>(v1 oper v2); \
+    DISPATCH \
+} while(false)
+
+// jlong 和 jdouble 的二元运算，直接在内存中进行，tos 中是它们不用的第二个 slot
+#define BINARY_OP2(type, t, oper) \
 do { \
-    type v2 = frame->pop##t(); \
-    type v1 = frame->pop##t(); \
-    frame->push##t(v1 oper v2); \
+    type v2 = get##t(ostack - 1); \
+    type v1 = get##t(ostack - 3); \
+    ostack -= 2; \
+    set##t(ostack - 1, v1 oper v2); \
     DISPATCH \
 } while(false)
 
 opc_iadd:
-    BINARY_OP(jint, i, +);
+    BINARY_OP(jint, +);
 opc_ladd:
-    BINARY_OP(jlong, l, +);
+    BINARY_OP2(jlong, Long, +);
 opc_fadd:
-    BINARY_OP(jfloat, f, +);
+    BINARY_OP(jfloat, +);
 opc_dadd:
-    BINARY_OP(jdouble, d, +);
+    BINARY_OP2(jdouble, Double, +);
 opc_isub:
-    BINARY_OP(jint, i, -);
+    BINARY_OP(jint, -);
 opc_lsub:
-    BINARY_OP(jlong, l, -);
+    BINARY_OP2(jlong, Long, -);
 opc_fsub:
-    BINARY_OP(jfloat, f, -);
+    BINARY_OP(jfloat, -);
 opc_dsub:
-    BINARY_OP(jdouble, d, -);
+    BINARY_OP2(jdouble, Double, -);
 opc_imul:
-    BINARY_OP(jint, i, *);
+    BINARY_OP(jint, *);
 opc_lmul:
-    BINARY_OP(jlong, l, *);
+    BINARY_OP2(jlong, Long, *);
 opc_fmul:
-    BINARY_OP(jfloat, f, *);
+    BINARY_OP(jfloat, *);
 opc_dmul:
-    BINARY_OP(jdouble, d, *);
+    BINARY_OP2(jdouble, Double, *);
     
 #define ZERO_DIVISOR_CHECK(value) \
 do { \
     if (value == 0) \
-        throw java_lang_ArithmeticException("division by zero"); \
+        THROW_JAVA_EXCEPTION(S(java_lang_ArithmeticException), "division by zero"); \
 } while(false)
 
 opc_idiv:
-    ZERO_DIVISOR_CHECK(getInt(frame->ostack - 1));
-    BINARY_OP(jint, i, /);
+    ZERO_DIVISOR_CHECK(fromSlot<jint>(tos));
+    BINARY_OP(jint, /);
 opc_ldiv:
-    ZERO_DIVISOR_CHECK(getLong(frame->ostack - 2));
-    BINARY_OP(jlong, l, /);
+    ZERO_DIVISOR_CHECK(getLong(ostack - 1));
+    BINARY_OP2(jlong, Long, /);
 opc_fdiv:
-    ZERO_DIVISOR_CHECK(getFloat(frame->ostack - 1));
-    BINARY_OP(jfloat, f, /);
+    ZERO_DIVISOR_CHECK(fromSlot<jfloat>(tos));
+    BINARY_OP(jfloat, /);
 opc_ddiv:
-    ZERO_DIVISOR_CHECK(getDouble(frame->ostack - 2));
-    BINARY_OP(jdouble, d, /);
+    ZERO_DIVISOR_CHECK(getDouble(ostack - 1));
+    BINARY_OP2(jdouble, Double, /);
 opc_irem: 
-    ZERO_DIVISOR_CHECK(getInt(frame->ostack - 1));
-    BINARY_OP(jint, i, %);
+    ZERO_DIVISOR_CHECK(fromSlot<jint>(tos));
+    BINARY_OP(jint, %);
 opc_lrem:
-    ZERO_DIVISOR_CHECK(getLong(frame->ostack - 2));
-    BINARY_OP(jlong, l, %);
+    ZERO_DIVISOR_CHECK(getLong(ostack - 1));
+    BINARY_OP2(jlong, Long, %);
 #undef ZERO_DIVISOR_CHECK
 
 opc_frem: {
-    jfloat v2 = frame->popf();
-    jfloat v1 = frame->popf();
-    frame->pushf(fmod(v1, v2));
+    jfloat v2 = POPF();
+    jfloat v1 = POPF();
+    PUSHF(fmod(v1, v2));
     DISPATCH
 }
 opc_drem: {
-    jdouble v2 = frame->popd();
-    jdouble v1 = frame->popd();
-    frame->pushd(fmod(v1, v2));
+    jdouble v2 = POPD();
+    jdouble v1 = POPD();
+    PUSHD(fmod(v1, v2));
     DISPATCH
 }
 opc_ineg:
-    frame->pushi(-frame->popi());
+    tos = toSlot<jint>(-fromSlot<jint>(tos));
     DISPATCH
 opc_lneg:
-    frame->pushl(-frame->popl());
+    setLong(ostack - 1, -getLong(ostack - 1));
     DISPATCH
 opc_fneg:
-    frame->pushf(-frame->popf());
+    tos = toSlot<jfloat>(-fromSlot<jfloat>(tos));
     DISPATCH
 opc_dneg:
-    frame->pushd(-frame->popd());
+    setDouble(ostack - 1, -getDouble(ostack - 1));
     DISPATCH 
 opc_ishl: {
     // 与0x1f是因为低5位表示位移距离，位移距离实际上被限制在0到31之间。
-    jint shift = frame->popi() & 0x1f;
+    jint shift = POPI() & 0x1f;
     assert(0 <= shift && shift <= 31);
-    jint x = frame->popi();
-    frame->pushi(x << shift);
+    jint x = POPI();
+    PUSHI(x << shift);
     DISPATCH
 }
 opc_lshl: {
     // 与0x3f是因为低6位表示位移距离，位移距离实际上被限制在0到63之间。
-    jint shift = frame->popi() & 0x3f;
+    jint shift = POPI() & 0x3f;
     assert(0 <= shift && shift <= 63);
-    jlong x = frame->popl();
-    frame->pushl(x << shift);
+    jlong x = POPL();
+    PUSHL(x << shift);
     DISPATCH
 }
 opc_ishr: {
     // 算术右移 shift arithmetic right
     // 带符号右移。正数右移高位补0，负数右移高位补1。
     // 对应于Java中的 >>
-    jint shift = frame->popi() & 0x1f;
+    jint shift = POPI() & 0x1f;
     assert(0 <= shift && shift <= 31);
-    jint x = frame->popi();
-    frame->pushi(x >> shift);
+    jint x = POPI();
+    PUSHI(x >> shift);
     DISPATCH
 }
 opc_lshr: {
-    jint shift = frame->popi() & 0x3f;
+    jint shift = POPI() & 0x3f;
     assert(0 <= shift && shift <= 63);
-    jlong x = frame->popl();
-    frame->pushl(x >> shift);
+    jlong x = POPL();
+    PUSHL(x >> shift);
     DISPATCH
 }
 opc_iushr: {
@@ -761,86 +1061,101 @@ opc_iushr: {
     // 无符号右移。无论是正数还是负数，高位通通补0。
     // 对应于Java中的 >>>
     // https://stackoverflow.com/questions/5253194/implementing-logical-right-shift-in-c/
-    jint shift = frame->popi() & 0x1f;
+    jint shift = POPI() & 0x1f;
     assert(0 <= shift && shift <= 31);
-    jint x = frame->popi();
+    jint x = POPI();
     int size = sizeof(jint) * 8 - 1; // bits count
-    frame->pushi((x >> shift) & ~(((((jint)1) << size) >> shift) << 1));
+    PUSHI((x >> shift) & ~(((((jint)1) << size) >> shift) << 1));
     DISPATCH
 }
 opc_lushr: {
-    jint shift = frame->popi() & 0x3f;
+    jint shift = POPI() & 0x3f;
     assert(0 <= shift && shift <= 63);
-    jlong x = frame->popl();
+    jlong x = POPL();
     int size = sizeof(jlong) * 8 - 1; // bits count
-    frame->pushl((x >> shift) & ~(((((jlong)1) << size) >> shift) << 1));
+    PUSHL((x >> shift) & ~(((((jlong)1) << size) >> shift) << 1));
     DISPATCH
 }
 opc_iand:
-    BINARY_OP(jint, i, &);
+    BINARY_OP(jint, &);
 opc_land:
-    BINARY_OP(jlong, l, &);
+    BINARY_OP2(jlong, Long, &);
 opc_ior:
-    BINARY_OP(jint, i, |);
+    BINARY_OP(jint, |);
 opc_lor:
-    BINARY_OP(jlong, l, |);
+    BINARY_OP2(jlong, Long, |);
 opc_ixor:
-    BINARY_OP(jint, i, ^);
+    BINARY_OP(jint, ^);
 opc_lxor:
-    BINARY_OP(jlong, l, ^);
+    BINARY_OP2(jlong, Long, ^);
 #undef BINARY_OP
+#undef BINARY_OP2
 
-opc_iinc: 
-    index = reader->readu1();
-    setInt(lvars + index, getInt(lvars + index) + reader->reads1()); 
-    DISPATCH
-_wide_iinc:  
-    setInt(lvars + index, getInt(lvars + index) + reader->reads2()); 
+opc_iinc: {
+    index = OPERAND;
+    auto c = (jint) OPERAND;
+    setInt(lvars + index, getInt(lvars + index) + c);
     DISPATCH
+}
+/*
+ * 类型转换：占一个 slot 的值在 tos 中转换，jlong 和 jdouble 在内存中转换。
+ * 结果与操作数占的 slot 数不同时，调整 ostack。
+ */
+#define CONVERT_1_TO_1(from, to) tos = toSlot<to>((to) fromSlot<from>(tos))
+#define CONVERT_1_TO_2(from, t, to) set##t(ostack++, (to) fromSlot<from>(tos))
+#define CONVERT_2_TO_1(f, to) tos = toSlot<to>((to) get##f(--ostack))
+#define CONVERT_2_TO_2(f, t, to) set##t(ostack - 1, (to) get##f(ostack - 1))
+
 opc_i2l:
-    frame->pushl(frame->popi());
+    CONVERT_1_TO_2(jint, Long, jlong);
     DISPATCH
 opc_i2f:
-    frame->pushf(frame->popi());
+    CONVERT_1_TO_1(jint, jfloat);
     DISPATCH
 opc_i2d:
-    frame->pushd(frame->popi());
+    CONVERT_1_TO_2(jint, Double, jdouble);
     DISPATCH
 opc_l2i:
-    frame->pushi((jint) frame->popl());
+    CONVERT_2_TO_1(Long, jint);
     DISPATCH
 opc_l2f:
-    frame->pushf((jfloat) frame->popl());
+    CONVERT_2_TO_1(Long, jfloat);
     DISPATCH
 opc_l2d:
-    frame->pushd(frame->popl());
+    CONVERT_2_TO_2(Long, Double, jdouble);
     DISPATCH
 opc_f2i:
-   frame->pushi((jint) frame->popf());
+    CONVERT_1_TO_1(jfloat, jint);
     DISPATCH
 opc_f2l:
-    frame->pushl((jlong) frame->popf());
+    CONVERT_1_TO_2(jfloat, Long, jlong);
     DISPATCH
 opc_f2d:
-    frame->pushd(frame->popf());
+    CONVERT_1_TO_2(jfloat, Double, jdouble);
     DISPATCH
 opc_d2i:
-    frame->pushi((jint) frame->popd());
+    CONVERT_2_TO_1(Double, jint);
     DISPATCH
 opc_d2l:
-    frame->pushl((jlong) frame->popd());
+    CONVERT_2_TO_2(Double, Long, jlong);
     DISPATCH
 opc_d2f:
-    frame->pushf((jfloat) frame->popd());
+    CONVERT_2_TO_1(Double, jfloat);
     DISPATCH
+
+#undef CONVERT_1_TO_1
+#undef CONVERT_1_TO_2
+#undef CONVERT_2_TO_1
+#undef CONVERT_2_TO_2
+
 opc_i2b:
-    frame->pushi(jint2jbyte(frame->popi()));
+    tos = toSlot<jint>(jint2jbyte(fromSlot<jint>(tos)));
     DISPATCH
 opc_i2c:
-    frame->pushi(jint2jchar(frame->popi()));
+    tos = toSlot<jint>(jint2jchar(fromSlot<jint>(tos)));
     DISPATCH
 opc_i2s:
-    frame->pushi(jint2jshort(frame->popi()));
+    tos = toSlot<jint>(jint2jshort(fromSlot<jint>(tos)));
     DISPATCH
 /*
  * NAN 与正常的的浮点数无法比较，即 即不大于 也不小于 也不等于。
@@ -849,85 +1164,159 @@ opc_i2s:
 #define DO_CMP(v1, v2, default_value) \
             (jint)((v1) > (v2) ? 1 : ((v1) == (v2) ? 0 : ((v1) < (v2) ? -1 : (default_value))))
 
-#define CMP(type, t, cmp_result) \
+#define CMP(type, cmp_result) \
+do { \
+    type v2 = fromSlot<type>(tos); \
+    type v1 = fromSlot<type>(*--ostack); \
+    tos = toSlot<jint>(cmp_result); \
+    DISPATCH \
+} while(false)
+
+// 比较内存中的两个 jlong 或 jdouble，结果占一个 slot，放在 tos 中
+#define CMP2(type, t, cmp_result) \
 do { \
-    type v2 = frame->pop##t(); \
-    type v1 = frame->pop##t(); \
-    frame->pushi(cmp_result); \
+    type v2 = get##t(ostack - 1); \
+    type v1 = get##t(ostack - 3); \
+    ostack -= 3; \
+    tos = toSlot<jint>(cmp_result); \
     DISPATCH \
 } while(false)
 
 opc_lcmp: 
-    CMP(jlong, l, DO_CMP(v1, v2, -1));
+    CMP2(jlong, Long, DO_CMP(v1, v2, -1));
 opc_fcmpl: 
-    CMP(jfloat, f, DO_CMP(v1, v2, -1));
+    CMP(jfloat, DO_CMP(v1, v2, -1));
 opc_fcmpg: 
-    CMP(jfloat, f, DO_CMP(v1, v2, 1));
+    CMP(jfloat, DO_CMP(v1, v2, 1));
 opc_dcmpl:
-    CMP(jdouble, d, DO_CMP(v1, v2, -1));
+    CMP2(jdouble, Double, DO_CMP(v1, v2, -1));
 opc_dcmpg:
-    CMP(jdouble, d, DO_CMP(v1, v2, 1));
+    CMP2(jdouble, Double, DO_CMP(v1, v2, 1));
 
 #undef CMP
+#undef CMP2
+
+    // 进入编译后的代码（见 _jit_call）
+    JitCode jit_code;
+    JitExit jit_exit;
+
+/*
+ * 安全点轮询（见 runtime/safepoint.h），在方法入口和循环的回边上进行。
+ * 停下前保存执行位置，GC 按它扫描当前 frame。
+ */
+#define SAFEPOINT_POLL \
+do { \
+    if (g_safepoint_requested.load(memory_order_relaxed)) { \
+        SAVE_STATE; \
+        blockAtSafepoint(); \
+        RELOAD_TOS; \
+    } \
+} while(false)
+
+/*
+ * 跳转到 @target，向后的跳转是循环的回边，计入方法的回边次数（见 jit/jit.h）。
+ * 回边次数每增加 OSR_CHECK_INTERVAL，检查能否在循环头处进行栈上替换。
+ * 跳转前 ip 须指向跳转指令的操作数（跳转指令是安全点）。
+ */
+#define BRANCH(target) \
+do { \
+    Cell *__target = (target); \
+    if (__target < ip) { \
+        SAFEPOINT_POLL; \
+        if ((++frame->method->backedge_count & (OSR_CHECK_INTERVAL - 1)) == 0) { \
+            if (frame->method->invocation_count + frame->method->backedge_count >= PROFILE_THRESHOLD) \
+                MethodProfile::of(frame->method); \
+            ip = __target; \
+            jit_code = getOsrCode(frame->method, frame->method->threaded_code.load()->pcOf(ip)); \
+            if (jit_code != nullptr) \
+                goto _jit_call; \
+        } \
+    } \
+    ip = __target; \
+} while(false)
+
+// 当前方法中 @cell 所属指令的 pc
+#define PC_OF(cell) (frame->method->threaded_code.load(memory_order_relaxed)->pcOf(cell))
+
+/*
+ * 记录当前方法的执行 profile（见 method_profile.h），方法还没有 profile 时什么也不做。
+ * @pc 只在需要记录时才求值。
+ */
+#define PROFILE_BRANCH(pc, taken) \
+do { \
+    MethodProfile *__p = frame->method->profile.load(memory_order_acquire); \
+    if (__p != nullptr) \
+        __p->recordBranch(pc, taken); \
+} while(false)
+
+#define PROFILE_TYPE(pc, c) \
+do { \
+    MethodProfile *__p = frame->method->profile.load(memory_order_acquire); \
+    if (__p != nullptr) \
+        __p->recordType(pc, c); \
+} while(false)
 
-#define IF_COND(cond, opc_len) \
+#define IF_COND(cond) \
 do { \
-    jint v = frame->popi(); \
-    jint offset = reader->reads2(); \
+    jint v = POPI(); \
+    PROFILE_BRANCH(PC_OF(ip), v cond 0); \
     if (v cond 0) \
-        reader->skip(offset - opc_len); \
+        BRANCH(ip->target); \
+    else \
+        ip++; \
     DISPATCH \
 } while(false)
 
 opc_ifeq:
-    IF_COND(==, opcode_len[JVM_OPC_ifeq]);
+    IF_COND(==);
 opc_ifne:
-    IF_COND(!=, opcode_len[JVM_OPC_ifne]);
+    IF_COND(!=);
 opc_iflt:
-    IF_COND(<, opcode_len[JVM_OPC_iflt]);
+    IF_COND(<);
 opc_ifge:
-    IF_COND(>=, opcode_len[JVM_OPC_ifge]);
+    IF_COND(>=);
 opc_ifgt:
-    IF_COND(>, opcode_len[JVM_OPC_ifgt]);
+    IF_COND(>);
 opc_ifle:
-    IF_COND(<=, opcode_len[JVM_OPC_ifle]);
+    IF_COND(<=);
 
 #undef IF_COND
 
-#define IF_CMP_COND(t, cond, opc_len) \
+#define IF_CMP_COND(t, cond) \
 do { \
-    s2 offset = reader->reads2(); \
-    auto v2 = frame->pop##t(); \
-    auto v1 = frame->pop##t(); \
+    auto v2 = POP##t(); \
+    auto v1 = POP##t(); \
+    PROFILE_BRANCH(PC_OF(ip), v1 cond v2); \
     if (v1 cond v2) \
-        reader->skip(offset - opc_len); \
+        BRANCH(ip->target); \
+    else \
+        ip++; \
     DISPATCH \
 } while(false)
 
 opc_if_icmpeq:
-    IF_CMP_COND(i, ==, opcode_len[JVM_OPC_if_icmpeq]);
+    IF_CMP_COND(I, ==);
 opc_if_acmpeq:
-    IF_CMP_COND(r, ==, opcode_len[JVM_OPC_if_acmpeq]);
+    IF_CMP_COND(R, ==);
 opc_if_icmpne:
-    IF_CMP_COND(i, !=, opcode_len[JVM_OPC_if_icmpne]);
+    IF_CMP_COND(I, !=);
 opc_if_acmpne:
-    IF_CMP_COND(r, !=, opcode_len[JVM_OPC_if_acmpne]);
+    IF_CMP_COND(R, !=);
 opc_if_icmplt:
-    IF_CMP_COND(i, <, opcode_len[JVM_OPC_if_icmplt]);
+    IF_CMP_COND(I, <);
 opc_if_icmpge:
-    IF_CMP_COND(i, >=, opcode_len[JVM_OPC_if_icmpge]);
+    IF_CMP_COND(I, >=);
 opc_if_icmpgt:
-    IF_CMP_COND(i, >, opcode_len[JVM_OPC_if_icmpgt]);
+    IF_CMP_COND(I, >);
 opc_if_icmple:
-    IF_CMP_COND(i, <=, opcode_len[JVM_OPC_if_icmple]);
+    IF_CMP_COND(I, <=);
 
 #undef IF_CMP_COND
 
-opc_goto: {
-    s2 offset = reader->reads2();
-    reader->skip(offset - opcode_len[JVM_OPC_goto]);
+opc_goto:
+opc_goto_w:
+    BRANCH(ip->target);
     DISPATCH
-}
 
 // 在Java 6之前，Oracle的Java编译器使用 jsr, jsr_w 和 ret 指令来实现 finally 子句。
 // 从Java 6开始，已经不再使用这些指令
@@ -938,70 +1327,43 @@ opc_ret:
 
 opc_tableswitch: {
     // 实现当各个case值跨度比较小时的 switch 语句
-    size_t saved_pc = reader->pc - 1; // save the pc before 'tableswitch' instruction
-    reader->align4();
-
-    // 默认情况下执行跳转所需字节码的偏移量
-    // 对应于 switch 中的 default 分支。
-    s4 default_offset = reader->reads4();
-
-    // low 和 height 标识了 case 的取值范围。
-    s4 low = reader->reads4();
-    s4 height = reader->reads4();
-
-    // 跳转偏移量表，对应于各个 case 的情况
-    s4 jump_offset_count = height - low + 1;
-    s4 jump_offsets[jump_offset_count];
-    reader->reads4s(jump_offset_count, jump_offsets);
+    // 指令流中的布局：[low][high][default target][jump targets...]
+    s4 low = (s4) ip[0].operand;
+    s4 high = (s4) ip[1].operand;
 
     // 弹出要判断的值
-    index = frame->popi();
-    s4 offset;
-    if (index < low || index > height) {
-        offset = default_offset; // 没在 case 标识的范围内，跳转到 default 分支。
+    index = POPI();
+    if (index < low || index > high) {
+        ip = ip[2].target; // 没在 case 标识的范围内，跳转到 default 分支。
     } else {
-        offset = jump_offsets[index - low]; // 找到对应的case了
+        ip = ip[3 + ((u4) index - (u4) low)].target; // 找到对应的case了。low 为负时 index - low 可能溢出 s4
     }
-
-    // The target address that can be calculated from each jump table
-    // offset, as well as the one that can be calculated from default,
-    // must be the address of an opcode of an instruction within the method
-    // that contains this tableswitch instruction.
-    reader->pc = saved_pc + offset;
     DISPATCH
 }
 opc_lookupswitch: {
     // 实现当各个case值跨度比较大时的 switch 语句
-    size_t saved_pc = reader->pc - 1; // save the pc before 'lookupswitch' instruction
-    reader->align4();
-
-    // 默认情况下执行跳转所需字节码的偏移量
-    // 对应于 switch 中的 default 分支。
-    s4 default_offset = reader->reads4();
-
-    // case的个数
-    s4 npairs = reader->reads4();
-    assert(npairs >= 0); // The npairs must be greater than or equal to 0.
-
-    // match_offsets 有点像 Map，它的 key 是 case 值，value 是跳转偏移量。
-    s4 match_offsets[npairs * 2];
-    reader->reads4s(npairs * 2, match_offsets);
-
-    // 弹出要判断的值
-    jint key = frame->popi();
-    s4 offset = default_offset;
-    for (int i = 0; i < npairs * 2; i += 2) {
-        if (match_offsets[i] == key) { // 找到 case
-            offset = match_offsets[i + 1];
-            break;
-        }
+    // 指令流中的布局：[npairs][default target][keys...][targets...]，keys 已按升序排列
+    auto npairs = (size_t) ip[0].operand;
+    Cell *keys = ip + 2;
+
+    // 弹出要判断的值，二分查找对应的 case
+    jint key = POPI();
+    size_t low = 0, high = npairs;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if ((jint) keys[mid].operand < key)
+            low = mid + 1;
+        else
+            high = mid;
     }
 
-    // The target address is calculated by adding the corresponding offset
-    // to the address of the opcode of this lookupswitch instruction.
-    reader->pc = saved_pc + offset;
+    if (low < npairs && (jint) keys[low].operand == key) {
+        ip = keys[npairs + low].target; // 找到 case
+    } else {
+        ip = ip[1].target; // 跳转到 default 分支。
+    }
     DISPATCH
-}                
+}
 
     int ret_value_slot_count;
 opc_ireturn:
@@ -1020,8 +1382,8 @@ _method_return: {
     thread->popFrame();
     Frame *invoke_frame = thread->getTopFrame();
     TRACE("invoke frame: %s\n", invoke_frame == nullptr ? "NULL" : invoke_frame->toString().c_str());
-    frame->ostack -= ret_value_slot_count;
-    slot_t *ret_value = frame->ostack;
+    SPILL_TOS;
+    slot_t *ret_value = ostack + 1 - ret_value_slot_count;
     if (frame->vm_invoke || invoke_frame == nullptr) {
         if (frame->method->isSynchronized()) {
 //                        _this->unlock();
@@ -1039,57 +1401,110 @@ _method_return: {
     DISPATCH  
 }
 opc_getstatic: {
-    index = reader->readu2();
+    index = OPERAND;
+    SAVE_STATE;
     Field *field = cp->resolveField(index);
     if (!field->isStatic()) {
         throw java_lang_IncompatibleClassChangeError(field->toString());
     }
 
     initClass(field->clazz);
+    RELOAD_TOS;
 
-    *frame->ostack++ = field->static_value.data[0];
     if (field->category_two) {
-        *frame->ostack++ = field->static_value.data[1];
+        PUSH2(field->static_value.data);
+    } else {
+        PUSH(field->static_value.data[0]);
+    }
+
+    if (field->clazz->inited) {
+        QUICKEN(field->category_two ? JVM_OPC_getstatic2_quick : JVM_OPC_getstatic_quick, 2);
     }
     DISPATCH
 }
+opc_getstatic_quick: {
+    Field *field = cp->resolved<Field *>(OPERAND);
+    PUSH(field->static_value.data[0]);
+    DISPATCH
+}
+opc_getstatic2_quick: {
+    Field *field = cp->resolved<Field *>(OPERAND);
+    PUSH2(field->static_value.data);
+    DISPATCH
+}
 opc_putstatic: {
-    index = reader->readu2();
+    index = OPERAND;
+    SAVE_STATE;
     Field *field = cp->resolveField(index);
     if (!field->isStatic()) {
         throw java_lang_IncompatibleClassChangeError(field->toString());
     }
 
     initClass(field->clazz);
+    RELOAD_TOS;
 
     if (field->category_two) {
-        frame->ostack -= 2;
-        field->static_value.data[0] = frame->ostack[0];
-        field->static_value.data[1] = frame->ostack[1];
+        POP2(field->static_value.data);
     } else {
-        field->static_value.data[0] = *--frame->ostack;
+        field->static_value.data[0] = POP();
     }
 
+    if (field->clazz->inited) {
+        QUICKEN(field->category_two ? JVM_OPC_putstatic2_quick : JVM_OPC_putstatic_quick, 2);
+    }
+    DISPATCH
+}
+opc_putstatic_quick: {
+    Field *field = cp->resolved<Field *>(OPERAND);
+    field->static_value.data[0] = POP();
+    DISPATCH
+}
+opc_putstatic2_quick: {
+    Field *field = cp->resolved<Field *>(OPERAND);
+    POP2(field->static_value.data);
     DISPATCH
 }                
 opc_getfield: {
-    index = reader->readu2();
+    index = OPERAND;
+    SAVE_STATE;
     Field *field = cp->resolveField(index);
     if (field->isStatic()) {
         throw java_lang_IncompatibleClassChangeError(field->toString());
     }
 
-    jref obj = frame->popr();
+    RELOAD_TOS;
+    jref obj = fromSlot<jref>(tos);
     NULL_POINTER_CHECK(obj);
 
-    *frame->ostack++ = obj->data[field->id];
     if (field->category_two) {
-        *frame->ostack++ = obj->data[field->id + 1];
+        *ostack++ = obj->data[field->id];
+        tos = obj->data[field->id + 1];
+    } else {
+        tos = obj->data[field->id];
     }
+
+    QUICKEN(field->category_two ? JVM_OPC_getfield2_quick : JVM_OPC_getfield_quick, 2);
+    DISPATCH
+}
+opc_getfield_quick: {
+    // 字段的值替换栈顶的对象引用
+    Field *field = cp->resolved<Field *>(OPERAND);
+    jref obj = fromSlot<jref>(tos);
+    IMPLICIT_NULL_POINTER_CHECK(obj);
+    tos = obj->data[field->id];
+    DISPATCH
+}
+opc_getfield2_quick: {
+    Field *field = cp->resolved<Field *>(OPERAND);
+    jref obj = fromSlot<jref>(tos);
+    IMPLICIT_NULL_POINTER_CHECK(obj);
+    *ostack++ = obj->data[field->id];
+    tos = obj->data[field->id + 1];
     DISPATCH
 }
 opc_putfield: {
-    index = reader->readu2();
+    index = OPERAND;
+    SAVE_STATE;
     Field *field = cp->resolveField(index);
     if (field->isStatic()) {
         throw java_lang_IncompatibleClassChangeError(field->toString());
@@ -1102,33 +1517,70 @@ opc_putfield: {
         }
     }
 
-    if (field->category_two) {
-        frame->ostack -= 2;
-    } else {
-        frame->ostack--;
-    }
-    slot_t *value = frame->ostack;
-
-    jref obj = frame->popr();
+    // tos 已写回，重新读入后操作数栈在内存中也是完整的
+    RELOAD_TOS;
+    slot_t *value = ostack + 1 - (field->category_two ? 2 : 1);
+    jref obj = getRef(value - 1);
     NULL_POINTER_CHECK(obj);
 
     obj->setFieldValue(field, value);
+    ostack = value - 2;
+    RELOAD_TOS;
+
+    // final 字段的检查只和本指令所在的方法有关，通过一次就永远通过
+    if (field->category_two) {
+        QUICKEN(JVM_OPC_putfield2_quick, 2);
+    } else if (field->isReference()) {
+        QUICKEN(JVM_OPC_putfield_ref_quick, 2);
+    } else {
+        QUICKEN(JVM_OPC_putfield_quick, 2);
+    }
+    DISPATCH
+}
+opc_putfield_quick: {
+    Field *field = cp->resolved<Field *>(OPERAND);
+    jref obj = getRef(ostack - 1);
+    IMPLICIT_NULL_POINTER_CHECK(obj);
+    obj->data[field->id] = tos;
+    DROP(2);
+    DISPATCH
+}
+opc_putfield2_quick: {
+    Field *field = cp->resolved<Field *>(OPERAND);
+    jref obj = getRef(ostack - 2);
+    IMPLICIT_NULL_POINTER_CHECK(obj);
+    obj->data[field->id] = ostack[-1];
+    obj->data[field->id + 1] = tos;
+    DROP(3);
+    DISPATCH
+}
+opc_putfield_ref_quick: {
+    Field *field = cp->resolved<Field *>(OPERAND);
+    jref obj = getRef(ostack - 1);
+    IMPLICIT_NULL_POINTER_CHECK(obj);
+    obj->data[field->id] = tos;
+    postWriteBarrier(obj->data + field->id);
+    DROP(2);
     DISPATCH
 }                   
 opc_invokevirtual: {
     // invokevirtual指令用于调用对象的实例方法，根据对象的实际类型进行分派（虚方法分派）。
-    index = reader->readu2();
+    index = OPERAND;
+    auto pc = (size_t) OPERAND; // 本指令的 pc
+    SAVE_STATE;
     Method *m = cp->resolveMethod(index);
     if (m == nullptr) {
         // todo
         JVM_PANIC("m == nullptr");
     }
 
+    RELOAD_TOS;
+
     if (m->isSignaturePolymorphic()) {
         assert(m->isNative());
-//        frame->ostack -= m->arg_slot_count;
+//        POP_ARGS(m->arg_slot_count);
         auto arg_slots_count = Method::calArgsSlotsCount(m->descriptor, true);
-        frame->ostack -= arg_slots_count;
+        POP_ARGS(arg_slots_count);
         resolved_method = m;
         goto _invoke_method;
     }
@@ -1137,20 +1589,52 @@ opc_invokevirtual: {
         throw java_lang_IncompatibleClassChangeError(m->toString());
     }
 
-    frame->ostack -= m->arg_slot_count;
-    jref obj = getRef(frame->ostack);
+    POP_ARGS(m->arg_slot_count);
+    jref obj = getRef(args);
     NULL_POINTER_CHECK(obj);
+    PROFILE_TYPE(pc, obj->clazz);
 
-    if (m->isPrivate()) {
+    if (m->isPrivate() || m->isFinal()) {
+        // private 和 final 方法不会被重写，无需分派
         resolved_method = m;
+        QUICKEN(JVM_OPC_invokenonvirtual_quick, 3);
     } else {
-        // assert(m->vtable_index >= 0);
-        // assert(m->vtable_index < (int) obj->clazz->vtable.size());
-        // resolved_method = obj->clazz->vtable[m->vtable_index];
-        resolved_method = obj->clazz->lookupMethod(m->name, m->descriptor);
+        resolved_method = obj->clazz->dispatch(m);
+        QUICKEN_INVOKE(m, JVM_OPC_invokevirtual_quick);
     }
 
-    // assert(resolved_method == obj->clazz->lookupMethod(m->name, m->descriptor));
+    goto _invoke_method;
+}
+opc_invokevirtual_quick: {
+    Method *m = cp->resolved<Method *>(OPERAND);
+    auto pc = (size_t) OPERAND;
+    POP_ARGS(m->arg_slot_count);
+    jref obj = getRef(args);
+    IMPLICIT_NULL_POINTER_CHECK(obj);
+    PROFILE_TYPE(pc, obj->clazz);
+    if (m->vtable_index >= 0) {
+        assert(m->vtable_index < (int) obj->clazz->vtable.size());
+        resolved_method = obj->clazz->vtable[m->vtable_index];
+    } else {
+        // 调用的是接口中声明的方法（default 或 miranda 方法），走 itable
+        resolved_method = InlineCache::of(frame->method, pc)->lookup(obj->clazz, m);
+    }
+    goto _invoke_method;
+}
+opc_invokenonvirtual_quick: {
+    resolved_method = cp->resolved<Method *>(OPERAND);
+    ip++; // skip pc
+    POP_ARGS(resolved_method->arg_slot_count);
+    NULL_POINTER_CHECK(getRef(args));
+    goto _invoke_method;
+}
+opc_invokedirect_quick: {
+    Method *m = cp->resolved<Method *>(OPERAND);
+    ip++; // skip pc
+    POP_ARGS(m->arg_slot_count);
+    NULL_POINTER_CHECK(getRef(args));
+    // m 变为多态时此调用点已被改回，即使与之并发，这里的接收者也只可能是之前加载的类的对象
+    resolved_method = m->unique_impl.load(memory_order_relaxed);
     goto _invoke_method;
 }
 opc_invokespecial: {
@@ -1158,7 +1642,8 @@ opc_invokespecial: {
     // 1. 构造函数
     // 2. 私有方法
     // 3. 通过super关键字调用的超类方法，或者超接口中的默认方法。
-    index = reader->readu2();
+    index = OPERAND;
+    SAVE_STATE;
     Method *m = cp->resolveMethodOrInterfaceMethod(index);
 
     /*
@@ -1180,8 +1665,9 @@ opc_invokespecial: {
         throw java_lang_IncompatibleClassChangeError(m->toString());
     }
 
-    frame->ostack -= m->arg_slot_count;
-    jref obj = getRef(frame->ostack);
+    RELOAD_TOS;
+    POP_ARGS(m->arg_slot_count);
+    jref obj = getRef(args);
     NULL_POINTER_CHECK(obj);
 
     resolved_method = m;
@@ -1190,7 +1676,8 @@ opc_invokespecial: {
 opc_invokestatic: {
     // invokestatic指令用来调用静态方法。
     // 如果类还没有被初始化，会触发类的初始化。
-    index = reader->readu2();
+    index = OPERAND;
+    SAVE_STATE;
     Method *m = cp->resolveMethodOrInterfaceMethod(index);
     if (m->isAbstract()) {
         throw java_lang_AbstractMethodError(m->toString());
@@ -1201,39 +1688,62 @@ opc_invokestatic: {
 
     initClass(m->clazz);
 
-    frame->ostack -= m->arg_slot_count;
+    if (m->clazz->inited) {
+        QUICKEN(JVM_OPC_invokestatic_quick, 2);
+    }
+
+    RELOAD_TOS;
+    POP_ARGS(m->arg_slot_count);
     resolved_method = m;
     goto _invoke_method;
-}            
+}
+opc_invokestatic_quick:
+    resolved_method = cp->resolved<Method *>(OPERAND);
+    POP_ARGS(resolved_method->arg_slot_count);
+    goto _invoke_method;            
 opc_invokeinterface: {
-    index = reader->readu2();
-
     /*
-     * 此字节的值是给方法传递参数需要的slot数，
-     * 其含义和给method结构体定义的arg_slot_count字段相同。
-     * 这个数是可以根据方法描述符计算出来的，它的存在仅仅是因为历史原因。
+     * 字节码中 index 后面的 count 和 0 两个字节在翻译时已略去：
+     * count 是给方法传递参数需要的slot数，可以根据方法描述符计算出来，它的存在仅仅是因为历史原因；
+     * 0 是留给Oracle的某些Java虚拟机实现用的。
      */
-    reader->readu1();
-    /*
-     * 此字节是留给Oracle的某些Java虚拟机实现用的，它的值必须是0。
-     * 该字节的存在是为了保证Java虚拟机可以向后兼容。
-     */
-    reader->readu1();
+    index = OPERAND;
+    auto pc = (size_t) OPERAND;
+    SAVE_STATE;
 
+    // 接口方法也可能解析到 java/lang/Object 中的 public 方法
     Method *m = cp->resolveInterfaceMethod(index);
-    assert(m->clazz->isInterface());
 
     /* todo 本地方法 */
 
-    frame->ostack -= m->arg_slot_count;
-    jref obj = getRef(frame->ostack);
+    RELOAD_TOS;
+    POP_ARGS(m->arg_slot_count);
+    jref obj = getRef(args);
     NULL_POINTER_CHECK(obj);
+    PROFILE_TYPE(pc, obj->clazz);
+
+    resolved_method = InlineCache::of(frame->method, pc)->lookup(obj->clazz, m);
+    QUICKEN_INVOKE(m, JVM_OPC_invokeinterface_quick);
+    goto _invoke_interface_method;
+}
+opc_invokeinterface_quick: {
+    Method *m = cp->resolved<Method *>(OPERAND);
+    auto pc = (size_t) OPERAND;
+
+    POP_ARGS(m->arg_slot_count);
+    jref obj = getRef(args);
+    IMPLICIT_NULL_POINTER_CHECK(obj);
+    PROFILE_TYPE(pc, obj->clazz);
+
+    resolved_method = InlineCache::of(frame->method, pc)->lookup(obj->clazz, m);
+    goto _invoke_interface_method;
+}
+_invoke_interface_method:
+    if (resolved_method == nullptr) {
+        // 接收者没有实现此接口
+        throw java_lang_IncompatibleClassChangeError();
+    }
 
-    // itable的实现还不对 todo
-    // resolved_method = obj->clazz->findFromITable(m->clazz, m->itable_index);
-    // assert(resolved_method != nullptr);
-    // assert(resolved_method == obj->clazz->lookupMethod(m->name, m->descriptor));
-    resolved_method = obj->clazz->lookupMethod(m->name, m->descriptor);
     if (resolved_method->isAbstract()) {
         throw java_lang_AbstractMethodError(resolved_method->toString());
     }
@@ -1242,73 +1752,36 @@ opc_invokeinterface: {
         throw java_lang_IllegalAccessError(resolved_method->toString());
     }
 
-    goto _invoke_method;
-}           
+    goto _invoke_method;           
 opc_invokedynamic: {
-    printvm("invokedynamic\n"); /////////////////////////////////////////////////////////////////////////////////
-
-    u2 i = reader->readu2(); // point to JVM_CONSTANT_InvokeDynamic_info
-    reader->readu1(); // this byte must always be zero.
-    reader->readu1(); // this byte must always be zero.
-
-    const utf8_t *invoked_name = cp->invokeDynamicMethodName(i);
-    const utf8_t *invoked_descriptor = cp->invokeDynamicMethodType(i);
-
-    jref invoked_type = findMethodType(invoked_descriptor, clazz->loader); // "java/lang/invoke/MethodType"
-    jref caller = getCaller(); // "java/lang/invoke/MethodHandles$Lookup"
-
-    BootstrapMethod &bm = clazz->bootstrap_methods.at(cp->invokeDynamicBootstrapMethodIndex(i));
-    u2 ref_kind = cp->methodHandleReferenceKind(bm.bootstrap_method_ref);
-    u2 ref_index = cp->methodHandleReferenceIndex(bm.bootstrap_method_ref);
-
-    switch (ref_kind) {
-        case JVM_REF_invokeStatic: {
-            const utf8_t *class_name = cp->methodClassName(ref_index);
-            Class *bootstrap_class = loadClass(clazz->loader, class_name);
-
-            // bootstrap method is static,  todo 对不对
-            // 前三个参数固定为 MethodHandles.Lookup caller, String invokedName, MethodType invokedType todo 对不对
-            // 后续的参数由 ref->argc and ref->args 决定
-            Method *bootstrap_method = bootstrap_class->getDeclaredStaticMethod(
-                                    cp->methodName(ref_index), cp->methodType(ref_index));
-            // name: "metafactory"
-            // type: "(Ljava/lang/invoke/MethodHandles$Lookup;Ljava/lang/String;Ljava/lang/invoke/MethodType;Ljava/lang/invoke/MethodType;Ljava/lang/invoke/MethodHandle;Ljava/lang/invoke/MethodType;)Ljava/lang/invoke/CallS"...
-            
-            // args's length is big enough,多余的长度无所谓，bootstrap_method 会按需读取的。
-            slot_t args[3 + bm.bootstrap_arguments.size() * 2];
-            setRef(args, caller);
-            setRef(args + 1, newString(invoked_name));
-            setRef(args + 2, invoked_type);
-            bm.resolveArgs(cp, args + 3);
-            auto call_set = getRef(execJavaFunc(bootstrap_method, args));
-
-            // public abstract MethodHandle dynamicInvoker()
-            auto dyn_invoker = call_set->clazz->lookupInstMethod("dynamicInvoker", "()Ljava/lang/invoke/MethodHandle;");
-            auto exact_method_handle = getRef(execJavaFunc(dyn_invoker, {call_set}));
-
-            // public final Object invokeExact(Object... args) throws Throwable
-            Method *invokeExact = exact_method_handle->clazz->lookupInstMethod(
-                                        S(invokeExact), "([Ljava/lang/Object;)Ljava/lang/Object;");
-            assert(invokeExact->isVarargs());
-            int slots_count = Method::calArgsSlotsCount(invoked_descriptor, false);
-            slot_t _args[slots_count];
-            setRef(_args, exact_method_handle);
-            slots_count--; // 减去"this"
-            frame->ostack -= slots_count; // pop all args
-            memcpy(_args + 1, frame->ostack, slots_count * sizeof(slot_t));
-            // invoke exact method, invokedynamic completely execute over.
-            slot_t *ret = execJavaFunc(invokeExact, _args);
-            frame->pushr(getRef(ret));
-            break;
-        }
-        case JVM_REF_newInvokeSpecial:
-            JVM_PANIC("JVM_REF_newInvokeSpecial"); // todo
-            break;
-        default:
-            JVM_PANIC("never goes here"); // todo
-            break;
-    }
-    DISPATCH
+    auto i = (u2) OPERAND; // point to JVM_CONSTANT_InvokeDynamic_info
+    SAVE_STATE;
+    call_site = linkInvokeDynamic(clazz, i);
+    RELOAD_TOS;
+
+    // 填入已链接的调用点，之后直接调用它
+    (ip++)->operand = (intptr_t) call_site;
+    QUICKEN(JVM_OPC_invokedynamic_quick, 3);
+    goto _invoke_dynamic;
+}
+opc_invokedynamic_quick:
+    ip++; // skip index
+    call_site = (InvokeDynamicCallSite *) OPERAND;
+_invoke_dynamic: {
+    /*
+     * 调用 invoker.invokeExact(args...)
+     * 栈顶是调用点的参数，在它们下面插入 invoker 作为 invokeExact 的 this。
+     * 多占用的一个 slot 位于被调用的 frame 的局部变量表所在的区域，不会越界。
+     */
+    int n = call_site->args_slots_count;
+    SPILL_TOS;
+    slot_t *top = ostack + 1;
+    memmove(top - n + 1, top - n, n * sizeof(slot_t));
+    setRef(top - n, call_site->invoker);
+    args = top - n;
+    LOAD_STACK(args);
+    resolved_method = call_site->invoke_exact;
+    goto _invoke_method;
 }
 opc_invokenative: {
     TRACE("%s\n", frame->toString().c_str());
@@ -1321,13 +1794,15 @@ opc_invokenative: {
     assert(frame->method->native_method != nullptr);
 
 
-    callJNIMethod(frame);
+    SAVE_STATE;
+    callJNIMethod(frame); // 返回值压入 frame->ostack
+    LOAD_STACK(frame->ostack);
 
 //    if (Thread::checkExceptionOccurred()) {
 //        TRACE("native method throw a exception\n");
 //        jref eo = Thread::getException();
 //        Thread::clearException();
-//        frame->pushr(eo);
+//        PUSHR(eo);
 //        goto opc_athrow;
 //    }
 
@@ -1341,7 +1816,7 @@ opc_invokenative: {
 //    Frame *new_frame = thread->allocFrame(resolved_method, false);
 //    TRACE("Alloc new frame: %s\n", new_frame->toString().c_str());
 //
-//    new_frame->lvars = frame->ostack; // todo 什么意思？？？？？？？？
+//    new_frame->lvars = ostack; // todo 什么意思？？？？？？？？
 //    CHANGE_FRAME(new_frame)
 //    if (resolved_method->isSynchronized()) {
 ////        _this->unlock(); // todo why unlock 而不是 lock ................................................
@@ -1350,20 +1825,99 @@ opc_invokenative: {
 //}
 _invoke_method: {
     assert(resolved_method);
+    SAVE_STATE; // 写回的栈顶就是 args
+    if (resolved_method->intrinsic != nullptr) {
+        // 内建方法直接在操作数栈上执行：实参出栈，返回值入栈
+        const Intrinsic *i = resolved_method->intrinsic;
+        LOAD_STACK(i->call(i->func, args, args));
+        DISPATCH
+    }
+    if (resolved_method->accessor_kind != Method::ACCESSOR_NONE) {
+        slot_t *top = invokeAccessor(resolved_method, args);
+        if (top != nullptr) {
+            LOAD_STACK(top);
+            DISPATCH
+        }
+    }
+    ThreadedCode *tc = getThreadedCode(resolved_method, handlers);
     Frame *new_frame = thread->allocFrame(resolved_method, false);
     TRACE("Alloc new frame: %s\n", new_frame->toString().c_str());
 
-    new_frame->lvars = frame->ostack; // todo 什么意思？？？？？？？？
+    new_frame->lvars = args; // todo 什么意思？？？？？？？？
+    new_frame->ip = tc->code;
     CHANGE_FRAME(new_frame);
+    SAFEPOINT_POLL;
+
+    // 计数不要求精确，不加锁
+    if (++resolved_method->invocation_count + resolved_method->backedge_count >= PROFILE_THRESHOLD)
+        MethodProfile::of(resolved_method);
+
+    jit_code = getJitCode(resolved_method);
+    if (jit_code != nullptr)
+        goto _jit_call;
     if (resolved_method->isSynchronized()) {
 //        _this->unlock(); // todo why unlock 而不是 lock ................................................
     }
     DISPATCH
 }
+_jit_call: {
+    /*
+     * 执行编译后的代码，它和解释器使用同一个 frame。
+     * 从方法的开头进入（调用时），或者从循环头进入（栈上替换时，ostack 为当前的栈顶）。
+     */
+    SAVE_STATE;
+    slot_t *top = jit_code(lvars, frame->ostack, &jit_exit);
+    if (top != nullptr) {
+        LOAD_STACK(top);
+        switch (frame->method->ret_type) {
+            case Method::RET_VOID: ret_value_slot_count = 0; break;
+            case Method::RET_LONG:
+            case Method::RET_DOUBLE: ret_value_slot_count = 2; break;
+            default: ret_value_slot_count = 1; break;
+        }
+        goto _method_return;
+    }
+
+    ThreadedCode *tc = frame->method->threaded_code.load(memory_order_acquire);
+    if (jit_exit.kind == JIT_EXIT_DEOPT || jit_exit.kind == JIT_EXIT_SAFEPOINT) {
+        /*
+         * 编译后的代码已把局部变量和操作数栈写回 frame，从 jit_exit.pc 处继续解释执行。
+         * 在安全点退出时 jit_exit.pc 是回边上还没有执行的跳转指令（安全点），在这里停下。
+         */
+        ip = tc->cellOf(jit_exit.pc);
+        LOAD_STACK(frame->ostack + jit_exit.sp);
+        if (jit_exit.kind == JIT_EXIT_SAFEPOINT) {
+            // 与 BRANCH 中相同，停下时 ip 指向跳转指令的操作数
+            ip++;
+            SAFEPOINT_POLL;
+            ip--;
+        }
+        if (jit_exit.kind == JIT_EXIT_DEOPT && ++frame->method->deopt_count >= DEOPT_LIMIT) {
+            // 检查总是失败（比如内联的类型守卫），不再使用优化编译的代码
+            frame->method->opt_state.store(OPT_NOT_COMPILABLE, memory_order_relaxed);
+            frame->method->opt_code.store(nullptr, memory_order_release);
+        }
+        DISPATCH
+    }
+
+    // 编译后的代码遇到了异常，回到解释器中抛出，ip 越过抛出异常的指令的 handler
+    ip = tc->cellOf(jit_exit.pc) + 1;
+    RELOAD_TOS; // 编译后的代码可能改写了内存中的栈顶
+    if (jit_exit.kind == JIT_EXIT_ARITHMETIC) {
+        THROW_JAVA_EXCEPTION(S(java_lang_ArithmeticException), "division by zero");
+    } else if (jit_exit.kind == JIT_EXIT_ARRAY_INDEX) {
+        char msg[32];
+        snprintf(msg, sizeof(msg), "index is %d", jit_exit.index);
+        THROW_JAVA_EXCEPTION(S(java_lang_ArrayIndexOutOfBoundsException), msg);
+    } else {
+        THROW_JAVA_EXCEPTION(S(java_lang_NullPointerException), nullptr);
+    }
+}
 opc_new: {
     // new指令专门用来创建类实例。数组由专门的指令创建
     // 如果类还没有被初始化，会触发类的初始化。
-    Class *c = cp->resolveClass(reader->readu2());
+    SAVE_STATE;
+    Class *c = cp->resolveClass(OPERAND);
     initClass(c);
 
     if (c->isInterface() || c->isAbstract()) {
@@ -1373,67 +1927,97 @@ opc_new: {
     // jref o = newObject(c);
     // if (strcmp(o->clazz->className, "java/lang/invoke/MemberName") == 0)
     //     printvm("%s\n", o->toString().c_str()); /////////////////////////////////////////////////////////////
-    // frame->pushr(o);
-    frame->pushr(c->allocObject());
+    // PUSHR(o);
+    jref o = c->allocObject();
+    RELOAD_TOS;
+    PUSHR(o);
+
+    if (c->inited) {
+        QUICKEN(JVM_OPC_new_quick, 2);
+    }
+    DISPATCH
+}
+opc_new_quick: {
+    SAVE_STATE; // 分配对象可能引发 GC，GC 按保存的 ip 和 ostack 扫描此 frame
+    jref o = cp->resolved<Class *>(OPERAND)->allocObject();
+    RELOAD_TOS;
+    PUSHR(o);
     DISPATCH
 }
 opc_newarray: {
     // 创建一维基本类型数组。
     // 包括 boolean[], byte[], char[], short[], int[], long[], float[] 和 double[] 8种。
-    jint arr_len = frame->popi();
+    jint arr_len = POPI();
     if (arr_len < 0) {
-        throw java_lang_NegativeArraySizeException("len is " + to_string(arr_len));
+        char msg[32];
+        snprintf(msg, sizeof(msg), "len is %d", arr_len);
+        THROW_JAVA_EXCEPTION(S(java_lang_NegativeArraySizeException), msg);
     }
 
-    auto arr_type = reader->readu1();
+    auto arr_type = OPERAND;
+    SAVE_STATE;
     Class *c = loadTypeArrayClass(static_cast<ArrayType>(arr_type));
-    frame->pushr(c->allocArray(arr_len));
+    jref arr = c->allocArray(arr_len);
+    RELOAD_TOS;
+    PUSHR(arr);
     DISPATCH
 }
 opc_anewarray: {
     // 创建一维引用类型数组
-    jint arr_len = frame->popi();
+    jint arr_len = POPI();
     if (arr_len < 0) {
-        throw java_lang_NegativeArraySizeException("len is " + to_string(arr_len));
+        char msg[32];
+        snprintf(msg, sizeof(msg), "len is %d", arr_len);
+        THROW_JAVA_EXCEPTION(S(java_lang_NegativeArraySizeException), msg);
     }
 
-    index = reader->readu2();
+    index = OPERAND;
+    SAVE_STATE;
     Class *ac = cp->resolveClass(index)->arrayClass();
-    frame->pushr(ac->allocArray(arr_len));
+    jref arr = ac->allocArray(arr_len);
+    RELOAD_TOS;
+    PUSHR(arr);
     DISPATCH
 }
 opc_multianewarray: {
     // 创建多维数组
-    index = reader->readu2();
+    index = OPERAND;
+    auto dim = (u1) OPERAND; // 多维数组的维度
+    SAVE_STATE;
     Class *ac = cp->resolveClass(index);
+    RELOAD_TOS;
 
-    u1 dim = reader->readu1(); // 多维数组的维度
     if (dim < 1) { // 必须大于或等于1
         throw java_lang_UnknownError("The dimensions must be greater than or equal to 1.");
     }
 
     jint lens[dim];
     for (int i = dim - 1; i >= 0; i--) {
-        lens[i] = frame->popi();
+        lens[i] = POPI();
         if (lens[i] < 0) {
-            throw java_lang_NegativeArraySizeException("len is %d" + to_string(lens[i]));
+            char msg[32];
+            snprintf(msg, sizeof(msg), "len is %d", lens[i]);
+            THROW_JAVA_EXCEPTION(S(java_lang_NegativeArraySizeException), msg);
         }
     }
-    frame->pushr(ac->allocMultiArray(dim, lens));
+    SAVE_STATE;
+    jref arr = ac->allocMultiArray(dim, lens);
+    RELOAD_TOS;
+    PUSHR(arr);
     DISPATCH
 }           
 opc_arraylength: {
-    Object *o = frame->popr();
-    NULL_POINTER_CHECK(o);
+    Object *o = fromSlot<jref>(tos);
+    IMPLICIT_NULL_POINTER_CHECK(o); // 虚函数调用先读取 o 的虚表指针
     if (!o->isArrayObject()) {
         throw java_lang_UnknownError("not a array");
     }
     
-    frame->pushi(((Array *) o)->arr_len);
+    tos = toSlot<jint>(((Array *) o)->arr_len);
     DISPATCH
 }
 opc_athrow: {
-    jref eo = frame->popr(); // exception object
+    jref eo = POPR(); // exception object
     if (eo == jnull) {
         // 异常对象有可能为空
         // 比如下面的Java代码:
@@ -1443,13 +2027,15 @@ opc_athrow: {
         // } catch (NullPointerException e) {
         //     e.printStackTrace();
         // }
-        throw java_lang_NullPointerException();
+        SAVE_STATE;
+        eo = newException(S(java_lang_NullPointerException), nullptr);
     }
 
     // 遍历虚拟机栈找到可以处理此异常的方法
     while (true) {
-        int handler_pc = frame->method->findExceptionHandler(
-                eo->clazz, reader->pc - opcode_len[JVM_OPC_athrow]); // instruction length todo 好像是错的
+        // ip 已越过抛出异常的指令（或调用指令）的 handler，frame->pc() 为该指令的 pc
+        frame->ip = ip;
+        int handler_pc = frame->method->findExceptionHandler(eo->clazz, frame->pc());
         if (handler_pc >= 0) {  // todo 可以等于0吗
             /*
              * 找到可以处理的代码块了
@@ -1458,8 +2044,9 @@ opc_athrow: {
              * 跳转到异常处理代码之前
              */
             frame->clearStack();
-            frame->pushr(eo);
-            reader->pc = (size_t) handler_pc;
+            LOAD_STACK(frame->ostack);
+            PUSHR(eo);
+            ip = frame->method->threaded_code.load(memory_order_acquire)->cellOf((size_t) handler_pc);
 
             TRACE("athrow: find exception handler: %s\n", frame->toString().c_str());
             break;
@@ -1485,81 +2072,173 @@ opc_athrow: {
 }
     
 opc_checkcast: {
-    jref obj = getRef(frame->ostack - 1); // 不改变操作数栈
-    index = reader->readu2();
+    jref obj = fromSlot<jref>(tos); // 不改变操作数栈
+    index = OPERAND;
+    SAVE_STATE;
 
     // 如果引用是null，则指令执行结束。也就是说，null 引用可以转换成任何类型
     if (obj != jnull) {
+        PROFILE_TYPE(PC_OF(ip - 1), obj->clazz);
         Class *c = cp->resolveClass(index);
         if (!checkcast(obj->clazz, c)) {
-            throw java_lang_ClassCastException(
-                    string(obj->clazz->class_name) + " cannot be cast to " + c->class_name);
+            char msg[512];
+            snprintf(msg, sizeof(msg), "%s cannot be cast to %s", obj->clazz->class_name, c->class_name);
+            THROW_JAVA_EXCEPTION(S(java_lang_ClassCastException), msg);
         }
     }
+    RELOAD_TOS;
     DISPATCH
 }
 
 opc_instanceof: {
-    index =  reader->readu2();
+    index = OPERAND;
+    SAVE_STATE;
     Class *c = cp->resolveClass(index);
+    RELOAD_TOS;
 
-    jref obj = frame->popr();
+    jref obj = POPR();
     if (obj == jnull) {
-        frame->pushi(0);
+        PUSHI(0);
     } else {
-        frame->pushi(checkcast(obj->clazz, c) ? 1 : 0);
+        PROFILE_TYPE(PC_OF(ip - 1), obj->clazz);
+        PUSHI(checkcast(obj->clazz, c) ? 1 : 0);
     }
     DISPATCH
 }
 opc_monitorenter: {
-    jref o = frame->popr();
+    jref o = POPR();
     NULL_POINTER_CHECK(o);
 //                o->lock();
     DISPATCH
 }
 opc_monitorexit: {
-    jref o = frame->popr();
+    jref o = POPR();
     NULL_POINTER_CHECK(o);
 //                o->unlock();
     DISPATCH
 }
-opc_wide:
-    opcode = reader->readu1();
-    PRINT_OPCODE
-    index = reader->readu2();
-    switch (opcode) {
-        case JVM_OPC_iload:  goto _iload;
-        case JVM_OPC_fload:  goto _fload;
-        case JVM_OPC_aload:  goto _aload;
-        case JVM_OPC_lload:  goto _lload;
-        case JVM_OPC_dload:  goto _dload;
-        case JVM_OPC_istore: goto _istore;
-        case JVM_OPC_fstore: goto _fstore;
-        case JVM_OPC_astore: goto _astore;
-        case JVM_OPC_lstore: goto _lstore;
-        case JVM_OPC_dstore: goto _dstore;
-        case JVM_OPC_ret:    goto opc_ret;
-        case JVM_OPC_iinc:   goto _wide_iinc;
-        default:
-            throw java_lang_UnknownError("never goes here.");
-    }  
-opc_ifnull: {
-    s2 offset = reader->reads2();
-    if (frame->popr() == jnull) {
-        reader->skip(offset - opcode_len[JVM_OPC_ifnull]);
+/*
+ * 超级指令，见 superinstructions.h。
+ * 序列中各条指令的 cell 仍然保留在指令流中（只改写了第一条指令的 handler），
+ * ip 逐条越过它们，所以序列中间抛出的异常仍能映射到正确的 pc。
+ */
+
+// ip 指向的 getfield 是否已经被改写为快速指令（字段已解析）
+#define IS_GETFIELD_QUICK \
+    (ip->handler == handlers[JVM_OPC_getfield_quick] || ip->handler == handlers[JVM_OPC_getfield2_quick])
+
+opc_aload_getfield: {
+    // [aload index][getfield cp_index]
+    jref obj = getRef(lvars + OPERAND);
+    if (IS_GETFIELD_QUICK) {
+        ip++;
+        Field *field = cp->resolved<Field *>(OPERAND);
+        IMPLICIT_NULL_POINTER_CHECK(obj);
+        if (field->category_two)
+            PUSH2(obj->data + field->id);
+        else
+            PUSH(obj->data[field->id]);
+    } else {
+        // 只执行 aload，接下来正常分派到 getfield
+        PUSHR(obj);
     }
     DISPATCH
 }
-opc_ifnonnull: {
-    s2 offset = reader->reads2();
-    if (frame->popr() != jnull) {
-        reader->skip(offset - opcode_len[JVM_OPC_ifnonnull]);
+opc_dup_getfield: {
+    // [dup][getfield cp_index]
+    // getfield 弹出的是 dup 复制的引用，相当于直接用栈顶的引用取字段
+    if (IS_GETFIELD_QUICK) {
+        ip++;
+        Field *field = cp->resolved<Field *>(OPERAND);
+        jref obj = fromSlot<jref>(tos);
+        IMPLICIT_NULL_POINTER_CHECK(obj);
+        if (field->category_two)
+            PUSH2(obj->data + field->id);
+        else
+            PUSH(obj->data[field->id]);
+    } else {
+        *ostack++ = tos;
     }
     DISPATCH
 }
-opc_goto_w:
-    throw java_lang_InternalError("goto_w doesn't support");
+
+#undef IS_GETFIELD_QUICK
+
+/*
+ * [iload x][iload y][if_icmp<cond> target]
+ * 布局：ip[0] = x, ip[1] = iload, ip[2] = y, ip[3] = if_icmp<cond>, ip[4] = target
+ */
+#define ILOAD_ILOAD_IF_ICMP(cond) \
+do { \
+    jint v1 = getInt(lvars + ip[0].operand); \
+    jint v2 = getInt(lvars + ip[2].operand); \
+    PROFILE_BRANCH(PC_OF(ip + 3), v1 cond v2); \
+    if (v1 cond v2) { \
+        ip += 4; /* 停在 if_icmp<cond> 的操作数处 */ \
+        BRANCH(ip->target); \
+    } else { \
+        ip += 5; \
+    } \
+    DISPATCH \
+} while(false)
+
+opc_iload_iload_if_icmpeq:
+    ILOAD_ILOAD_IF_ICMP(==);
+opc_iload_iload_if_icmpne:
+    ILOAD_ILOAD_IF_ICMP(!=);
+opc_iload_iload_if_icmplt:
+    ILOAD_ILOAD_IF_ICMP(<);
+opc_iload_iload_if_icmpge:
+    ILOAD_ILOAD_IF_ICMP(>=);
+opc_iload_iload_if_icmpgt:
+    ILOAD_ILOAD_IF_ICMP(>);
+opc_iload_iload_if_icmple:
+    ILOAD_ILOAD_IF_ICMP(<=);
+
+#undef ILOAD_ILOAD_IF_ICMP
+
+opc_iload_iconst_iadd_istore: {
+    // [iload x][bipush c][iadd][istore y]
+    // 布局：ip[0] = x, ip[1] = bipush, ip[2] = c, ip[3] = iadd, ip[4] = istore, ip[5] = y
+    jint v = getInt(lvars + ip[0].operand) + (jint) ip[2].operand;
+    setInt(lvars + ip[5].operand, v);
+    ip += 6;
+    DISPATCH
+}
+opc_aload_iload_iaload: {
+    // [aload a][iload i][iaload]
+    // 布局：ip[0] = a, ip[1] = iload, ip[2] = i, ip[3] = iaload
+    auto arr = (Array *) getRef(lvars + ip[0].operand);
+    index = getInt(lvars + ip[2].operand);
+    ip += 4; // 越过 iaload，之后抛出的异常属于 iaload
+    IMPLICIT_NULL_POINTER_CHECK(arr);
+    ARRAY_INDEX_CHECK(arr, index);
+    PUSHI(arr->get<jint>(index));
     DISPATCH
+}
+
+opc_wide:
+    // wide 在翻译时已合并进它所修饰的指令，不会出现在指令流中
+    throw java_lang_InternalError("wide isn't in threaded code.");
+    DISPATCH
+opc_ifnull: {
+    jref obj = POPR();
+    PROFILE_BRANCH(PC_OF(ip), obj == jnull);
+    if (obj == jnull)
+        BRANCH(ip->target);
+    else
+        ip++;
+    DISPATCH
+}
+opc_ifnonnull: {
+    jref obj = POPR();
+    PROFILE_BRANCH(PC_OF(ip), obj != jnull);
+    if (obj != jnull)
+        BRANCH(ip->target);
+    else
+        ip++;
+    DISPATCH
+}
 opc_jsr_w:
     throw java_lang_InternalError("jsr_w doesn't support after jdk 6.");
     DISPATCH
@@ -1569,9 +2248,106 @@ opc_breakpoint:
 opc_impdep2:
     throw java_lang_InternalError("opc_impdep2 isn't used.");
     DISPATCH            
-opc_unused:
+opc_unused: {
+    frame->ip = ip;
+    u1 opcode = frame->method->code[frame->pc()];
     throw java_lang_InternalError("This instruction isn't used. " + to_string(opcode));
-    DISPATCH    
+    DISPATCH
+}
+
+    } catch (...) {
+        /*
+         * 保存执行位置，execJavaFunc 会重新进入 exec() 处理异常。
+         * 处理异常时操作数栈总是被清空（见 athrow），这里直接清空，不再写回 tos：
+         * 异常可能在慢路径中 GC 之后抛出，tos 已经过时。
+         */
+        frame->ip = ip;
+        frame->clearStack();
+        throw;
+    }
+}
+
+/*
+ * 链接 invokedynamic 调用点：执行 bootstrap method 得到 CallSite。
+ * 每个类的每个 InvokeDynamic 常量只链接一次。
+ * bootstrap method 在锁外执行，多个线程同时链接时只保留先完成的，所有线程得到同一个调用点。
+ * @i: 常量池中 InvokeDynamic 常量的索引
+ */
+static InvokeDynamicCallSite *linkInvokeDynamic(Class *clazz, u2 i)
+{
+    assert(clazz != nullptr);
+
+    {
+        lock_guard<mutex> lock(clazz->indy_mutex);
+        auto iter = clazz->indy_call_sites.find(i);
+        if (iter != clazz->indy_call_sites.end())
+            return iter->second;
+    }
+
+    ConstantPool *cp = &clazz->cp;
+    const utf8_t *invoked_name = cp->invokeDynamicMethodName(i);
+    const utf8_t *invoked_descriptor = cp->invokeDynamicMethodType(i);
+
+    jref invoked_type = findMethodType(invoked_descriptor, clazz->loader); // "java/lang/invoke/MethodType"
+    jref caller = getCaller(); // "java/lang/invoke/MethodHandles$Lookup"
+
+    BootstrapMethod &bm = clazz->bootstrap_methods.at(cp->invokeDynamicBootstrapMethodIndex(i));
+    u2 ref_kind = cp->methodHandleReferenceKind(bm.bootstrap_method_ref);
+    u2 ref_index = cp->methodHandleReferenceIndex(bm.bootstrap_method_ref);
+
+    jref call_set = nullptr;
+    switch (ref_kind) {
+        case JVM_REF_invokeStatic: {
+            const utf8_t *class_name = cp->methodClassName(ref_index);
+            Class *bootstrap_class = loadClass(clazz->loader, class_name);
+
+            // bootstrap method is static,  todo 对不对
+            // 前三个参数固定为 MethodHandles.Lookup caller, String invokedName, MethodType invokedType todo 对不对
+            // 后续的参数由 ref->argc and ref->args 决定
+            Method *bootstrap_method = bootstrap_class->getDeclaredStaticMethod(
+                                    cp->methodName(ref_index), cp->methodType(ref_index));
+            // name: "metafactory"
+            // type: "(Ljava/lang/invoke/MethodHandles$Lookup;Ljava/lang/String;Ljava/lang/invoke/MethodType;Ljava/lang/invoke/MethodType;Ljava/lang/invoke/MethodHandle;Ljava/lang/invoke/MethodType;)Ljava/lang/invoke/CallS"...
+
+            // args's length is big enough,多余的长度无所谓，bootstrap_method 会按需读取的。
+            slot_t args[3 + bm.bootstrap_arguments.size() * 2];
+            setRef(args, caller);
+            setRef(args + 1, newString(invoked_name));
+            setRef(args + 2, invoked_type);
+            bm.resolveArgs(cp, args + 3);
+            call_set = getRef(execJavaFunc(bootstrap_method, args));
+            break;
+        }
+        case JVM_REF_newInvokeSpecial:
+            JVM_PANIC("JVM_REF_newInvokeSpecial"); // todo
+            break;
+        default:
+            JVM_PANIC("never goes here"); // todo
+            break;
+    }
+
+    // public abstract MethodHandle dynamicInvoker()
+    auto dyn_invoker = call_set->clazz->lookupInstMethod("dynamicInvoker", "()Ljava/lang/invoke/MethodHandle;");
+    auto exact_method_handle = getRef(execJavaFunc(dyn_invoker, {call_set}));
+
+    // public final Object invokeExact(Object... args) throws Throwable
+    Method *invokeExact = exact_method_handle->clazz->lookupInstMethod(
+                                S(invokeExact), "([Ljava/lang/Object;)Ljava/lang/Object;");
+    assert(invokeExact->isVarargs());
+
+    auto site = new InvokeDynamicCallSite;
+    site->call_site = call_set;
+    site->invoker = exact_method_handle;
+    site->invoke_exact = invokeExact;
+    site->args_slots_count = Method::calArgsSlotsCount(invoked_descriptor, true);
+
+    lock_guard<mutex> lock(clazz->indy_mutex);
+    auto result = clazz->indy_call_sites.emplace(i, site);
+    if (!result.second) {
+        // 其他线程已经完成了链接，使用它的
+        delete site;
+    }
+    return result.first->second;
 }
 
 // check can s cast to t?
@@ -1701,177 +2477,44 @@ slot_t *execJavaFunc(Method *m, jref _this, Array *args)
     return execJavaFunc(m, real_args);
 }
 
+/*
+ * 访问器方法第一次不创建 frame 执行前，取出它的 getfield/putfield 已经解析的字段。
+ * 常量还没有解析时返回 nullptr，方法照常执行一次后会解析它。
+ * 字段不适合不建 frame 访问时（静态、final、类型不符），方法不再作为访问器。
+ */
+static Field *resolveAccessorField(Method *m)
+{
+    ConstantPool &cp = m->clazz->cp;
+    if (cp.getType(m->accessor_index) != JVM_CONSTANT_ResolvedField)
+        return nullptr;
+
+    auto f = cp.resolved<Field *>(m->accessor_index);
+    bool two_slots;
+    if (m->accessor_kind == Method::ACCESSOR_GETTER) {
+        u1 ret = m->code[4];
+        two_slots = ret == JVM_OPC_lreturn || ret == JVM_OPC_dreturn;
+    } else {
+        u1 load = m->code[1];
+        two_slots = load == JVM_OPC_lload_1 || load == JVM_OPC_dload_1;
+    }
+
+    if (f->isStatic() || f->category_two != two_slots
+                || (m->accessor_kind == Method::ACCESSOR_SETTER && f->isFinal())) {
+        m->accessor_kind = Method::ACCESSOR_NONE;
+        return nullptr;
+    }
+
+    m->accessor_field.store(f, memory_order_release);
+    return f;
+}
+
 static void callJNIMethod(Frame *frame)
 {
     assert(frame != nullptr && frame->method != nullptr);
     assert(frame->method->isNative() && frame->method->native_method != nullptr);
     assert(frame->method->native_method->func != nullptr);
+    assert(frame->method->native_trampoline != nullptr);
 
-    const slot_t *lvars = frame->lvars;
-    const type_info &type = frame->method->native_method->type;
-    void *func = frame->method->native_method->func;
-
-    // 应对 java/lang/invoke/MethodHandle.java 中的 invoke* native methods.
-    // 比如：
-    // public final native @PolymorphicSignature Object invoke(Object... args) throws Throwable;
-    if (frame->method->isSignaturePolymorphic()
-            && !frame->method->isStatic()
-            && type == typeid(jref(*)(const slot_t *))) {
-        jref ret = ((jref(*)(const slot_t *)) func)(lvars);
-        frame->pushr(ret);
-        return;
-    }
-
-    // 应对 java/lang/invoke/MethodHandle.java 中的 linkTo* native methods.
-    // 比如：
-    // static native @PolymorphicSignature Object linkToStatic(Object... args) throws Throwable;
-    if (frame->method->isSignaturePolymorphic()
-        && frame->method->isStatic()
-        && type == typeid(jref(*)(u2, const slot_t *))) {
-        jref ret = ((jref(*)(u2, const slot_t *)) func)(frame->method->arg_slot_count, lvars);
-        frame->pushr(ret);
-        return;
-    }
-
-#undef B
-#undef Z
-#undef I
-#undef F
-#undef R
-//#undef A
-#undef L
-#undef D
-
-#define B(name) jbyte name = getByte(lvars++);
-#define Z(name) jbool name = getBool(lvars++);
-#define I(name) jint name = getInt(lvars++);
-#define F(name) jfloat name = getFloat(lvars++);
-#define R(name) jref name = getRef(lvars++);
-//#define A(name) jarrref name = (jarrref) getRef(lvars++);
-#define L(name) jlong name = getLong(lvars); lvars += 2;
-#define D(name) jdouble name = getDouble(lvars); lvars += 2;
-
-#define INVOKE_0(func_type, push_func) \
-    if (type == typeid(func_type)) { \
-        push_func(((func_type) func)()); \
-        return; \
-    }
-
-#define INVOKE_1(func_type, arg, push_func) \
-    if (type == typeid(func_type)) { \
-        arg(a) \
-        push_func(((func_type) func)(a)); \
-        return; \
-    }
-
-#define INVOKE_2(func_type, arg1, arg2, push_func) \
-    if (type == typeid(func_type)) { \
-        arg1(a) arg2(b) \
-        push_func(((func_type) func)(a, b)); \
-        return; \
-    }
-
-#define INVOKE_3(func_type, arg1, arg2, arg3, push_func) \
-    if (type == typeid(func_type)) { \
-        arg1(a) arg2(b) arg3(c) \
-        push_func(((func_type) func)(a, b, c)); \
-        return; \
-    }
-
-#define INVOKE_4(func_type, arg1, arg2, arg3, arg4, push_func) \
-    if (type == typeid(func_type)) { \
-        arg1(a) arg2(b) arg3(c) arg4(d) \
-        push_func(((func_type) func)(a, b, c, d)); \
-        return; \
-    }
-
-#define INVOKE_5(func_type, arg1, arg2, arg3, arg4, arg5, push_func) \
-    if (type == typeid(func_type)) { \
-        arg1(a) arg2(b) arg3(c) arg4(d) arg5(e) \
-        push_func(((func_type) func)(a, b, c, d, e)); \
-        return; \
-    }
-
-#define INVOKE_7(func_type, arg1, arg2, arg3, arg4, arg5, arg6, arg7, push_func) \
-    if (type == typeid(func_type)) { \
-        arg1(a) arg2(b) arg3(c) arg4(d) arg5(e) arg6(f) arg7(g) \
-        push_func(((func_type) func)(a, b, c, d, e, f, g)); \
-        return; \
-    }
-
-    INVOKE_0(void(*)(), )
-    INVOKE_0(jbool(*)(), frame->pushi)
-    INVOKE_0(jint(*)(), frame->pushi)
-    INVOKE_0(jref(*)(), frame->pushr)
-    INVOKE_0(jlong(*)(), frame->pushl)
-
-    INVOKE_1(void(*)(jint), I, )
-    INVOKE_1(void(*)(jref), R, )
-    INVOKE_1(void(*)(jlong), L, )
-    INVOKE_1(jref(*)(jbool), Z, frame->pushr)
-    INVOKE_1(jint(*)(jint), I, frame->pushi)
-    INVOKE_1(jbool(*)(jint), I, frame->pushi)
-    INVOKE_1(jlong(*)(jint), I, frame->pushl)
-    INVOKE_1(jlong(*)(jdouble), D, frame->pushl)
-    INVOKE_1(jdouble(*)(jlong), L, frame->pushd)
-    INVOKE_1(jlong(*)(jlong), L, frame->pushl)
-    INVOKE_1(jbyte(*)(jlong), L, frame->pushi)
-    INVOKE_1(jint(*)(jfloat), F, frame->pushi)
-    INVOKE_1(jref(*)(jref), R, frame->pushr)
-    INVOKE_1(jbool(*)(jref), R, frame->pushi)
-    INVOKE_1(jint(*)(jref), R, frame->pushi)
-    INVOKE_1(jlong(*)(jref), R, frame->pushl)
-
-    INVOKE_2(void(*)(jlong, jlong), L, L, )
-    INVOKE_2(void(*)(jref, jbool), R, Z, )
-    INVOKE_2(void(*)(jref, jint), R, I, )
-    INVOKE_2(void(*)(jref, jref), R, R, )
-    INVOKE_2(void(*)(jref, jlong), R, L, )
-    INVOKE_2(jlong(*)(jint, jlong), I, L, frame->pushl)
-    INVOKE_2(jref(*)(jref, jint), R, I, frame->pushr)
-    INVOKE_2(jlong(*)(jref, jint), R, I, frame->pushl)
-    INVOKE_2(jbool(*)(jref, jbool), R, Z, frame->pushi)
-    INVOKE_2(jbool(*)(jref, jref), R, R, frame->pushi)
-    INVOKE_2(jint(*)(jref, jref), R, R, frame->pushi)
-    INVOKE_2(jlong(*)(jref, jref), R, R, frame->pushl)
-    INVOKE_2(jbyte(*)(jref, jlong), R, L, frame->pushi)
-    INVOKE_2(jint(*)(jref, jlong), R, L, frame->pushi)
-    INVOKE_2(jref(*)(jref, jlong), R, L, frame->pushr)
-    INVOKE_2(jlong(*)(jref, jlong), R, L, frame->pushl)
-    INVOKE_2(jref(*)(jref, jbool), R, Z, frame->pushr)
-    INVOKE_2(jref(*)(jref, jref), R, R, frame->pushr)
-//    INVOKE_2(jref(*)(jref, jarrref), R, A, frame->pushr)
-
-    INVOKE_3(void(*)(jref, jint, jref), R, I, R, )
-    INVOKE_3(void(*)(jref, jlong, jlong), R, L, L, )
-    INVOKE_3(void(*)(jref, jref, jbool), R, R, Z, )
-    INVOKE_3(jref(*)(jref, jref, jref), R, R, R, frame->pushr)
-    INVOKE_3(jbool(*)(jref, jref, jref), R, R, R, frame->pushi)
-    INVOKE_3(jlong(*)(jref, jref, jref), R, R, R, frame->pushl)
-    INVOKE_3(jref(*)(jref, jref, jlong), R, R, L, frame->pushr)
-    INVOKE_3(jint(*)(jref, jref, jlong), R, R, L, frame->pushi)
-
-    INVOKE_4(void(*)(jref, jint, jint, jbool), R, I, I, Z, )
-    INVOKE_4(void(*)(jref, jref, jlong, jref), R, R, L, R, )
-    INVOKE_4(jbool(*)(jref, jlong, jint, jint), R, L, I, I, frame->pushi)
-    INVOKE_4(jint(*)(jref, jref, jint, jint), R, R, I, I, frame->pushi)
-    INVOKE_4(jbool(*)(jref, jlong, jlong, jlong), R, L, L, L, frame->pushi)
-    INVOKE_4(jbool(*)(jref, jlong, jref, jref), R, L, R, R, frame->pushi)
-    INVOKE_4(jref(*)(jref, jbool, jref, jref), R, Z, R, R, frame->pushr)
-    INVOKE_4(jref(*)(jref, jref, jref, jref), R, R, R, R, frame->pushr)
-
-    INVOKE_5(void(*)(jref, jref, jint, jint, jbool), R, R, I, I, Z, )
-    INVOKE_5(void(*)(jref, jint, jref, jint, jint), R, I, R, I, I, )
-    INVOKE_5(jbool(*)(jref, jref, jlong, jlong, jlong), R, R, L, L, L, frame->pushi)
-    INVOKE_5(jbool(*)(jref, jref, jlong, jref, jref), R, R, L, R, R, frame->pushi)
-    INVOKE_5(jref(*)(jref, jref, jint, jint, jlong), R, R, I, I, L, frame->pushr)
-    INVOKE_5(jbool(*)(jref, jref, jlong, jint, jint), R, R, L, I, I, frame->pushi)
-
-    INVOKE_7(jref(*)(jref, jref, jref, jint, jint, jref, jref),
-             R, R, R, I, I, R, R, frame->pushr)
-    INVOKE_7(jint(*)(jref, jref, jref, jint, jref, jint, jref),
-             R, R, R, I, R, I, R, frame->pushi)
-
-    JVM_PANIC((frame->method->toString() + ", " + frame->method->native_method->type.name()).c_str());
-//    throw java_lang_VirtualMachineError(string("未实现的方法类型: ") + frame->method->toString());
+    // 跳板由本地函数的类型在编译期生成（见 native/trampoline.h），负责取出实参和压入返回值
+    frame->method->native_trampoline(frame->method->native_method->func, frame);
 }
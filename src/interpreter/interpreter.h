@@ -24,5 +24,8 @@ slot_t *execJavaFunc(Method *m, std::initializer_list<jref> args);
 // Object[] args;
 slot_t *execJavaFunc(Method *m, jref _this, Array *args);
 
+// 判断机器指令 @pc 是否位于解释器的代码中，见 runtime/signals.h
+bool isInterpreterCode(const void *pc);
+
 
 #endif //CABIN_INTERPRETER_H
@@ -0,0 +1,583 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include "intrinsics.h"
+#include "../exception.h"
+#include "../metadata/class.h"
+#include "../metadata/field.h"
+#include "../native/trampoline.h"
+#include "../objects/array.h"
+#include "../objects/class_loader.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INTRINSICS_X86 1
+#else
+#define INTRINSICS_X86 0
+#endif
+
+using namespace std;
+
+bool use_intrinsics = true;
+
+/* -------------------- 数组核心操作，各有标量、SSE2 和 AVX2 版本 -------------------- */
+
+/*
+ * mismatch:     返回 a, b 前 n 个字节中第一个不同的字节的下标，全部相同时返回 n
+ * index_of:     返回 p 前 n 个字节中第一个等于 c 的字节的下标，没有时返回 -1
+ * hash_int:     以 h 为初值，按 h = 31*h + e 计算 n 个 jint 的哈希值
+ * compress:     把 n 个不大于 0xFF 的 jchar 压缩到 dst，遇到大于 0xFF 的 jchar 时停止，返回已压缩的个数
+ * inflate:      把 n 个字节（视为无符号）扩展为 jchar
+ */
+struct Kernels {
+    size_t (*mismatch)(const u1 *a, const u1 *b, size_t n);
+    jint (*index_of)(const jbyte *p, jint n, jbyte c);
+    jint (*hash_int)(const jint *p, jint n, jint h);
+    jint (*compress)(const jchar *src, jbyte *dst, jint n);
+    void (*inflate)(const jbyte *src, jchar *dst, jint n);
+};
+
+static size_t mismatchScalar(const u1 *a, const u1 *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] != b[i])
+            return i;
+    }
+    return n;
+}
+
+static jint indexOfScalar(const jbyte *p, jint n, jbyte c)
+{
+    for (jint i = 0; i < n; i++) {
+        if (p[i] == c)
+            return i;
+    }
+    return -1;
+}
+
+static jint hashIntScalar(const jint *p, jint n, jint h)
+{
+    auto x = (u4) h; // 无符号运算，溢出时回绕
+    for (jint i = 0; i < n; i++) {
+        x = 31 * x + (u4) p[i];
+    }
+    return (jint) x;
+}
+
+static jint compressScalar(const jchar *src, jbyte *dst, jint n)
+{
+    for (jint i = 0; i < n; i++) {
+        if (src[i] > 0xFF)
+            return i;
+        dst[i] = (jbyte) src[i];
+    }
+    return n;
+}
+
+static void inflateScalar(const jbyte *src, jchar *dst, jint n)
+{
+    for (jint i = 0; i < n; i++) {
+        dst[i] = (jchar) (src[i] & 0xff);
+    }
+}
+
+#if INTRINSICS_X86
+
+static size_t mismatchSSE2(const u1 *a, const u1 *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *) (b + i));
+        unsigned mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xFFFFu;
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+    return i + mismatchScalar(a + i, b + i, n - i);
+}
+
+static jint indexOfSSE2(const jbyte *p, jint n, jbyte c)
+{
+    __m128i v = _mm_set1_epi8(c);
+    jint i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (p + i));
+        unsigned mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(x, v));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+    jint k = indexOfScalar(p + i, n - i, c);
+    return k < 0 ? -1 : i + k;
+}
+
+static jint compressSSE2(const jchar *src, jbyte *dst, jint n)
+{
+    const __m128i high = _mm_set1_epi16((short) 0xFF00);
+    jint i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (src + i));
+        __m128i y = _mm_loadu_si128((const __m128i *) (src + i + 8));
+        __m128i h = _mm_and_si128(_mm_or_si128(x, y), high);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(h, _mm_setzero_si128())) != 0xFFFF)
+            break; // 其中有大于 0xFF 的字符，交给标量版本确定位置
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_packus_epi16(x, y));
+    }
+    return i + compressScalar(src + i, dst + i, n - i);
+}
+
+static void inflateSSE2(const jbyte *src, jchar *dst, jint n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    jint i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (src + i));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_unpacklo_epi8(x, zero));
+        _mm_storeu_si128((__m128i *) (dst + i + 8), _mm_unpackhi_epi8(x, zero));
+    }
+    inflateScalar(src + i, dst + i, n - i);
+}
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static size_t mismatchAVX2(const u1 *a, const u1 *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+        auto mask = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+    return i + mismatchSSE2(a + i, b + i, n - i);
+}
+
+AVX2 static jint indexOfAVX2(const jbyte *p, jint n, jbyte c)
+{
+    __m256i v = _mm256_set1_epi8(c);
+    jint i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (p + i));
+        auto mask = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, v));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+    jint k = indexOfSSE2(p + i, n - i, c);
+    return k < 0 ? -1 : i + k;
+}
+
+/*
+ * 每个 lane 独立累积 acc = acc * 31^8 + e，最后按 lane 的位置乘以 31 的相应次幂合并：
+ * h' = h * 31^(8k) + sum(acc[i] * 31^(7-i))，k 是处理的块数。
+ */
+AVX2 static jint hashIntAVX2(const jint *p, jint n, jint h)
+{
+    jint blocks = n / 8;
+    if (blocks == 0)
+        return hashIntScalar(p, n, h);
+
+    u4 pow8 = 1;
+    for (int j = 0; j < 8; j++) pow8 *= 31;
+
+    __m256i acc = _mm256_setzero_si256();
+    const __m256i mul = _mm256_set1_epi32((int) pow8);
+    for (jint b = 0; b < blocks; b++) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (p + b * 8));
+        acc = _mm256_add_epi32(_mm256_mullo_epi32(acc, mul), x);
+    }
+
+    u4 lanes[8];
+    _mm256_storeu_si256((__m256i *) lanes, acc);
+    auto x = (u4) h;
+    for (jint b = 0; b < blocks; b++) x *= pow8;
+    u4 w = 1;
+    for (int j = 7; j >= 0; j--) {
+        x += lanes[j] * w;
+        w *= 31;
+    }
+    return hashIntScalar(p + blocks * 8, n - blocks * 8, (jint) x);
+}
+
+AVX2 static jint compressAVX2(const jchar *src, jbyte *dst, jint n)
+{
+    const __m256i high = _mm256_set1_epi16((short) 0xFF00);
+    jint i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *) (src + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *) (src + i + 16));
+        if (!_mm256_testz_si256(_mm256_or_si256(x, y), high))
+            break;
+        // packus 在每个 128 位的 lane 内交错，再把 64 位的块调整回原来的顺序
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(x, y), 0xD8);
+        _mm256_storeu_si256((__m256i *) (dst + i), packed);
+    }
+    return i + compressSSE2(src + i, dst + i, n - i);
+}
+
+AVX2 static void inflateAVX2(const jbyte *src, jchar *dst, jint n)
+{
+    jint i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (src + i));
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_cvtepu8_epi16(x));
+    }
+    inflateScalar(src + i, dst + i, n - i);
+}
+
+#undef AVX2
+
+#endif // INTRINSICS_X86
+
+static Kernels kernels = {
+    mismatchScalar, indexOfScalar, hashIntScalar, compressScalar, inflateScalar
+};
+
+static void selectKernels()
+{
+#if INTRINSICS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels = { mismatchAVX2, indexOfAVX2, hashIntAVX2, compressAVX2, inflateAVX2 };
+    } else if (__builtin_cpu_supports("sse2")) {
+        // SSE2 没有 32 位的乘法（pmulld 属于 SSE4.1），哈希用标量版本
+        kernels = { mismatchSSE2, indexOfSSE2, hashIntScalar, compressSSE2, inflateSSE2 };
+    }
+#endif
+}
+
+/* -------------------- 内建方法的实现 -------------------- */
+
+template <typename T>
+static T *elements(jref arr)
+{
+    return (T *) ((Array *) arr)->data;
+}
+
+static jint length(jref arr)
+{
+    return ((Array *) arr)->arr_len;
+}
+
+static void checkNotNull(jref o)
+{
+    if (o == jnull)
+        throw java_lang_NullPointerException();
+}
+
+// 检查 [off, off + len) 是否在长度为 @arr_len 的数组内
+static void checkRange(jint off, jint len, jint arr_len)
+{
+    if (off < 0 || len < 0 || off > arr_len - len)
+        throw java_lang_ArrayIndexOutOfBoundsException();
+}
+
+// java/lang/Math
+
+static jdouble mathSqrt(jdouble a) { return sqrt(a); }
+static jdouble mathFmaD(jdouble a, jdouble b, jdouble c) { return fma(a, b, c); }
+static jfloat mathFmaF(jfloat a, jfloat b, jfloat c) { return fmaf(a, b, c); }
+
+static jint mathAbsI(jint a) { return a < 0 ? (jint) (0u - (u4) a) : a; }
+static jlong mathAbsJ(jlong a) { return a < 0 ? (jlong) (0ull - (u8) a) : a; }
+static jfloat mathAbsF(jfloat a) { return fabsf(a); }
+static jdouble mathAbsD(jdouble a) { return fabs(a); }
+
+static jint mathMinI(jint a, jint b) { return a <= b ? a : b; }
+static jlong mathMinJ(jlong a, jlong b) { return a <= b ? a : b; }
+static jint mathMaxI(jint a, jint b) { return a >= b ? a : b; }
+static jlong mathMaxJ(jlong a, jlong b) { return a >= b ? a : b; }
+
+// 与 Math.min/max 一致：有 NaN 时返回 NaN，并且 -0.0 小于 0.0
+template <typename T>
+static T floatingMin(T a, T b)
+{
+    if (a != a)
+        return a;
+    if (a == 0 && b == 0 && signbit(b))
+        return b;
+    return a <= b ? a : b;
+}
+
+template <typename T>
+static T floatingMax(T a, T b)
+{
+    if (a != a)
+        return a;
+    if (a == 0 && b == 0 && signbit(a))
+        return b;
+    return a >= b ? a : b;
+}
+
+// java/lang/Integer
+
+static jint integerBitCount(jint i) { return __builtin_popcount((u4) i); }
+static jint integerNumberOfLeadingZeros(jint i) { return i == 0 ? 32 : __builtin_clz((u4) i); }
+
+// java/lang/Object
+
+// public final native Class<?> getClass();
+static jref objectGetClass(jref _this) { return _this->clazz->java_mirror; }
+
+// java/lang/String
+
+// public boolean equals(Object anObject);
+static jbool stringEquals(jref _this, jref o)
+{
+    if (_this == o)
+        return jtrue;
+    if (o == jnull || o->clazz != g_string_class)
+        return jfalse;
+
+    static const int value_id = g_string_class->lookupField(
+            S(value), IS_GDK9_PLUS ? S(array_B) : S(array_C))->id;
+    if (IS_GDK9_PLUS) {
+        static const int coder_id = g_string_class->lookupField(S(coder), "B")->id;
+        if (slot::getInt(_this->data + coder_id) != slot::getInt(o->data + coder_id))
+            return jfalse;
+    }
+
+    jref v1 = slot::getRef(_this->data + value_id);
+    jref v2 = slot::getRef(o->data + value_id);
+    if (length(v1) != length(v2))
+        return jfalse;
+    size_t n = (size_t) length(v1) * (IS_GDK9_PLUS ? sizeof(jbyte) : sizeof(jchar));
+    return kernels.mismatch(elements<u1>(v1), elements<u1>(v2), n) == n ? jtrue : jfalse;
+}
+
+// java/lang/StringLatin1
+
+// public static int hashCode(byte[] value);
+static jint latin1HashCode(jref value)
+{
+    checkNotNull(value);
+    jint n = length(value);
+    const jbyte *p = elements<jbyte>(value);
+    auto h = 0u;
+    jint i = 0;
+#if INTRINSICS_X86
+    // 每次把 256 个字节扩展成 jint 再交给 hash_int
+    jint buf[256];
+    for (; i + 256 <= n; i += 256) {
+        for (int j = 0; j < 256; j++) buf[j] = p[i + j] & 0xff;
+        h = (u4) kernels.hash_int(buf, 256, (jint) h);
+    }
+#endif
+    for (; i < n; i++) {
+        h = 31 * h + (p[i] & 0xff);
+    }
+    return (jint) h;
+}
+
+// public static int indexOf(byte[] value, int ch, int fromIndex);
+static jint latin1IndexOf(jref value, jint ch, jint from)
+{
+    checkNotNull(value);
+    if ((ch >> 8) != 0) // 不能用 Latin1 编码的字符
+        return -1;
+    jint max = length(value);
+    if (from < 0)
+        from = 0;
+    else if (from >= max)
+        return -1;
+    jint k = kernels.index_of(elements<jbyte>(value) + from, max - from, (jbyte) ch);
+    return k < 0 ? -1 : from + k;
+}
+
+// public static int compareTo(byte[] value, byte[] other);
+static jint latin1CompareTo(jref value, jref other)
+{
+    checkNotNull(value);
+    checkNotNull(other);
+    jint len1 = length(value);
+    jint len2 = length(other);
+    auto lim = (size_t) min(len1, len2);
+    const u1 *p1 = elements<u1>(value);
+    const u1 *p2 = elements<u1>(other);
+    size_t k = kernels.mismatch(p1, p2, lim);
+    return k < lim ? p1[k] - p2[k] : len1 - len2;
+}
+
+// java/lang/StringUTF16，UTF16 的 byte[] 按本机字节序存放 jchar（见 StringUTF16.isBigEndian）
+
+// public static int compress(char[] val, int off, byte[] dst, int dstOff, int len);
+static jint utf16CompressChars(jref val, jint off, jref dst, jint dst_off, jint len)
+{
+    checkNotNull(val);
+    checkNotNull(dst);
+    if (len <= 0)
+        return len;
+    checkRange(off, len, length(val));
+    checkRange(dst_off, len, length(dst));
+    jint n = kernels.compress(elements<jchar>(val) + off, elements<jbyte>(dst) + dst_off, len);
+    return n == len ? len : 0;
+}
+
+// public static int compress(byte[] val, int off, byte[] dst, int dstOff, int len);
+static jint utf16CompressBytes(jref val, jint off, jref dst, jint dst_off, jint len)
+{
+    checkNotNull(val);
+    checkNotNull(dst);
+    if (len <= 0)
+        return len;
+    checkRange(off, len, length(val) / 2);
+    checkRange(dst_off, len, length(dst));
+    jint n = kernels.compress(elements<jchar>(val) + off, elements<jbyte>(dst) + dst_off, len);
+    return n == len ? len : 0;
+}
+
+// public static void inflate(byte[] src, int srcOff, char[] dst, int dstOff, int len);
+static void latin1InflateChars(jref src, jint src_off, jref dst, jint dst_off, jint len)
+{
+    checkNotNull(src);
+    checkNotNull(dst);
+    if (len <= 0)
+        return;
+    checkRange(src_off, len, length(src));
+    checkRange(dst_off, len, length(dst));
+    kernels.inflate(elements<jbyte>(src) + src_off, elements<jchar>(dst) + dst_off, len);
+}
+
+// public static void inflate(byte[] src, int srcOff, byte[] dst, int dstOff, int len);
+static void latin1InflateBytes(jref src, jint src_off, jref dst, jint dst_off, jint len)
+{
+    checkNotNull(src);
+    checkNotNull(dst);
+    if (len <= 0)
+        return;
+    checkRange(src_off, len, length(src));
+    checkRange(dst_off, len, length(dst) / 2);
+    kernels.inflate(elements<jbyte>(src) + src_off, elements<jchar>(dst) + dst_off, len);
+}
+
+// java/util/Arrays
+
+// public static boolean equals(T[] a, T[] a2)，T 是整数类型（浮点数按 floatToIntBits 比较，不在此列）
+template <typename T>
+static jbool arraysEquals(jref a, jref a2)
+{
+    if (a == a2)
+        return jtrue;
+    if (a == jnull || a2 == jnull || length(a) != length(a2))
+        return jfalse;
+    size_t n = (size_t) length(a) * sizeof(T);
+    return kernels.mismatch(elements<u1>(a), elements<u1>(a2), n) == n ? jtrue : jfalse;
+}
+
+// public static void fill(T[] a, T val)
+template <typename T>
+static void arraysFill(jref a, T val)
+{
+    checkNotNull(a);
+    fill_n(elements<T>(a), length(a), val);
+}
+
+// public static int hashCode(T[] a)
+template <typename T>
+static jint arraysHashCode(jref a)
+{
+    if (a == jnull)
+        return 0;
+    jint n = length(a);
+    const T *p = elements<T>(a);
+    if constexpr (is_same_v<T, jint>) {
+        return kernels.hash_int(p, n, 1);
+    } else {
+        auto h = 1u;
+        for (jint i = 0; i < n; i++) {
+            h = 31 * h + (u4) (jint) p[i];
+        }
+        return (jint) h;
+    }
+}
+
+/* -------------------- 内建方法表 -------------------- */
+
+#define I(class_name, name, descriptor, func) \
+    { class_name, name, descriptor, (void *) func, trampoline::Trampoline<decltype(func)>::call }
+
+static Intrinsic intrinsics[] = {
+    I("java/lang/Math", "sqrt", "(D)D", &mathSqrt),
+    I("java/lang/Math", "fma", "(DDD)D", &mathFmaD),
+    I("java/lang/Math", "fma", "(FFF)F", &mathFmaF),
+    I("java/lang/Math", "abs", "(I)I", &mathAbsI),
+    I("java/lang/Math", "abs", "(J)J", &mathAbsJ),
+    I("java/lang/Math", "abs", "(F)F", &mathAbsF),
+    I("java/lang/Math", "abs", "(D)D", &mathAbsD),
+    I("java/lang/Math", "min", "(II)I", &mathMinI),
+    I("java/lang/Math", "min", "(JJ)J", &mathMinJ),
+    I("java/lang/Math", "min", "(FF)F", &floatingMin<jfloat>),
+    I("java/lang/Math", "min", "(DD)D", &floatingMin<jdouble>),
+    I("java/lang/Math", "max", "(II)I", &mathMaxI),
+    I("java/lang/Math", "max", "(JJ)J", &mathMaxJ),
+    I("java/lang/Math", "max", "(FF)F", &floatingMax<jfloat>),
+    I("java/lang/Math", "max", "(DD)D", &floatingMax<jdouble>),
+
+    I("java/lang/Integer", "bitCount", "(I)I", &integerBitCount),
+    I("java/lang/Integer", "numberOfLeadingZeros", "(I)I", &integerNumberOfLeadingZeros),
+
+    I("java/lang/Object", "getClass", "()Ljava/lang/Class;", &objectGetClass),
+
+    I("java/lang/String", "equals", "(Ljava/lang/Object;)Z", &stringEquals),
+
+    I("java/lang/StringLatin1", "hashCode", "([B)I", &latin1HashCode),
+    I("java/lang/StringLatin1", "indexOf", "([BII)I", &latin1IndexOf),
+    I("java/lang/StringLatin1", "compareTo", "([B[B)I", &latin1CompareTo),
+    I("java/lang/StringLatin1", "inflate", "([BI[CII)V", &latin1InflateChars),
+    I("java/lang/StringLatin1", "inflate", "([BI[BII)V", &latin1InflateBytes),
+
+    I("java/lang/StringUTF16", "compress", "([CI[BII)I", &utf16CompressChars),
+    I("java/lang/StringUTF16", "compress", "([BI[BII)I", &utf16CompressBytes),
+
+    I("java/util/Arrays", "equals", "([B[B)Z", &arraysEquals<jbyte>),
+    I("java/util/Arrays", "equals", "([Z[Z)Z", &arraysEquals<jbool>),
+    I("java/util/Arrays", "equals", "([C[C)Z", &arraysEquals<jchar>),
+    I("java/util/Arrays", "equals", "([S[S)Z", &arraysEquals<jshort>),
+    I("java/util/Arrays", "equals", "([I[I)Z", &arraysEquals<jint>),
+    I("java/util/Arrays", "equals", "([J[J)Z", &arraysEquals<jlong>),
+    I("java/util/Arrays", "fill", "([BB)V", &arraysFill<jbyte>),
+    I("java/util/Arrays", "fill", "([ZZ)V", &arraysFill<jbool>),
+    I("java/util/Arrays", "fill", "([CC)V", &arraysFill<jchar>),
+    I("java/util/Arrays", "fill", "([SS)V", &arraysFill<jshort>),
+    I("java/util/Arrays", "fill", "([II)V", &arraysFill<jint>),
+    I("java/util/Arrays", "fill", "([JJ)V", &arraysFill<jlong>),
+    I("java/util/Arrays", "fill", "([FF)V", &arraysFill<jfloat>),
+    I("java/util/Arrays", "fill", "([DD)V", &arraysFill<jdouble>),
+    I("java/util/Arrays", "hashCode", "([B)I", &arraysHashCode<jbyte>),
+    I("java/util/Arrays", "hashCode", "([C)I", &arraysHashCode<jchar>),
+    I("java/util/Arrays", "hashCode", "([S)I", &arraysHashCode<jshort>),
+    I("java/util/Arrays", "hashCode", "([I)I", &arraysHashCode<jint>),
+};
+
+#undef I
+
+// 类名 -> 该类的内建方法，键是 utf8 池中的字符串
+static unordered_map<const utf8_t *, vector<const Intrinsic *>> intrinsics_by_class;
+
+void initIntrinsics()
+{
+    selectKernels();
+    if (!use_intrinsics)
+        return;
+
+    for (Intrinsic &i : intrinsics) {
+        i.class_name = utf8::save(i.class_name);
+        i.name = utf8::save(i.name);
+        i.descriptor = utf8::save(i.descriptor);
+        intrinsics_by_class[i.class_name].push_back(&i);
+    }
+}
+
+const Intrinsic *findIntrinsic(const utf8_t *class_name, const utf8_t *name, const utf8_t *descriptor)
+{
+    auto iter = intrinsics_by_class.find(class_name);
+    if (iter == intrinsics_by_class.end())
+        return nullptr;
+
+    for (const Intrinsic *i : iter->second) {
+        if (i->name == name && i->descriptor == descriptor)
+            return i;
+    }
+    return nullptr;
+}
@@ -0,0 +1,36 @@
+#ifndef CABIN_INTRINSICS_H
+#define CABIN_INTRINSICS_H
+
+#include "../cabin.h"
+#include "../slot.h"
+
+/*
+ * 内建方法（intrinsic）：用 C++ 实现替换一些热点的 JDK 方法（Math, String, Arrays 等）。
+ * 方法链接时（见 Method 的构造函数）查表，命中的方法在被调用时直接在调用者的操作数栈上执行，
+ * 不创建 frame，也不解释字节码。
+ *
+ * 数组和字符串的实现按启动时 cpuid 检测到的指令集选用 AVX2、SSE2 或标量版本。
+ */
+struct Intrinsic {
+    const char *class_name;
+    const char *name;
+    const char *descriptor;
+
+    void *func;
+
+    // 从 args 开始的 slot 中取出实参调用 func，返回值写入 ret，返回写完后的下一个 slot。见 native/trampoline.h
+    slot_t *(*call)(void *func, const slot_t *args, slot_t *ret);
+};
+
+extern bool use_intrinsics; // -XX:-UseIntrinsics 关闭
+
+// 选择与 CPU 匹配的实现，并建立查找表。须在加载类之前调用
+void initIntrinsics();
+
+/*
+ * 查找方法对应的内建实现，没有时返回 nullptr。
+ * 三个参数都须是 utf8 池中的字符串（见 utf8::save），只比较指针。
+ */
+const Intrinsic *findIntrinsic(const utf8_t *class_name, const utf8_t *name, const utf8_t *descriptor);
+
+#endif //CABIN_INTRINSICS_H
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include "method_profile.h"
+#include "../classfile/bytecode_reader.h"
+#include "../classfile/constants.h"
+#include "../metadata/class.h"
+#include "../metadata/method.h"
+#include "../objects/class_loader.h"
+
+using namespace std;
+
+void TypeProfile::record(Class *c)
+{
+    for (int i = 0; i < TYPE_PROFILE_WIDTH; i++) {
+        Class *t = types[i].load(memory_order_acquire);
+        if (t == nullptr) {
+            // 空位，尝试占用。失败时其他线程已占用，再比较一次
+            if (types[i].compare_exchange_strong(t, c, memory_order_acq_rel) || t == c) {
+                counts[i]++;
+                return;
+            }
+        } else if (t == c) {
+            counts[i]++;
+            return;
+        }
+    }
+    other++;
+}
+
+bool TypeProfile::monomorphic(Class *&c) const
+{
+    Class *t = types[0].load(memory_order_acquire);
+    if (t == nullptr || other > 0)
+        return false;
+    for (int i = 1; i < TYPE_PROFILE_WIDTH; i++) {
+        if (types[i].load(memory_order_acquire) != nullptr)
+            return false;
+    }
+    c = t;
+    return true;
+}
+
+MethodProfile::MethodProfile(Method *m): method(m), index(m->code_len, -1)
+{
+    size_t types_count = 0;
+    BytecodeReader r(m->code, m->code_len);
+    while (r.hasMore()) {
+        size_t pc = r.pc;
+        u1 opcode = r.readu1();
+        switch (opcode) {
+            case JVM_OPC_ifeq: case JVM_OPC_ifne: case JVM_OPC_iflt:
+            case JVM_OPC_ifge: case JVM_OPC_ifgt: case JVM_OPC_ifle:
+            case JVM_OPC_if_icmpeq: case JVM_OPC_if_icmpne: case JVM_OPC_if_icmplt:
+            case JVM_OPC_if_icmpge: case JVM_OPC_if_icmpgt: case JVM_OPC_if_icmple:
+            case JVM_OPC_if_acmpeq: case JVM_OPC_if_acmpne:
+            case JVM_OPC_ifnull: case JVM_OPC_ifnonnull:
+                index[pc] = (int) branches.size();
+                branches.emplace_back();
+                r.pc = pc + 3;
+                break;
+            case JVM_OPC_invokevirtual: case JVM_OPC_invokeinterface:
+            case JVM_OPC_checkcast: case JVM_OPC_instanceof:
+                index[pc] = (int) types_count++;
+                r.pc = pc + (opcode == JVM_OPC_invokeinterface ? 5 : 3);
+                break;
+            case JVM_OPC_tableswitch: {
+                r.align4();
+                r.reads4(); // default
+                s4 low = r.reads4();
+                s4 high = r.reads4();
+                r.pc += (size_t) (high - low + 1) * 4;
+                break;
+            }
+            case JVM_OPC_lookupswitch: {
+                r.align4();
+                r.reads4(); // default
+                s4 npairs = r.reads4();
+                r.pc += (size_t) npairs * 8;
+                break;
+            }
+            case JVM_OPC_wide:
+                r.pc = pc + (r.readu1() == JVM_OPC_iinc ? 6 : 4);
+                break;
+            default: {
+                static const u1 opcode_length[JVM_OPC_MAX + 1] = JVM_OPCODE_LENGTH_INITIALIZER;
+                r.pc = pc + max<u1>(opcode_length[opcode], 1);
+                break;
+            }
+        }
+    }
+
+    // TypeProfile 含有原子变量，不能移动，一次创建好
+    types = vector<TypeProfile>(types_count);
+}
+
+MethodProfile *MethodProfile::of(Method *m)
+{
+    assert(m != nullptr);
+
+    MethodProfile *p = m->profile.load(memory_order_acquire);
+    if (p != nullptr || m->code == nullptr)
+        return p;
+
+    auto t = new MethodProfile(m);
+    if (m->profile.compare_exchange_strong(p, t, memory_order_acq_rel))
+        return t;
+    delete t; // 其他线程已经创建了
+    return p;
+}
+
+const BranchProfile *MethodProfile::branchAt(size_t pc) const
+{
+    assert(pc < index.size());
+    u1 opcode = method->code[pc];
+    bool is_branch = (JVM_OPC_ifeq <= opcode && opcode <= JVM_OPC_if_acmpne)
+                     || opcode == JVM_OPC_ifnull || opcode == JVM_OPC_ifnonnull;
+    return is_branch && index[pc] >= 0 ? &branches[index[pc]] : nullptr;
+}
+
+const TypeProfile *MethodProfile::typeAt(size_t pc) const
+{
+    assert(pc < index.size());
+    u1 opcode = method->code[pc];
+    bool is_type = opcode == JVM_OPC_invokevirtual || opcode == JVM_OPC_invokeinterface
+                   || opcode == JVM_OPC_checkcast || opcode == JVM_OPC_instanceof;
+    return is_type && index[pc] >= 0 ? &types[index[pc]] : nullptr;
+}
+
+u8 MethodProfile::hotness() const
+{
+    return (u8) method->invocation_count + method->backedge_count;
+}
+
+void MethodProfile::print() const
+{
+    printf("%s: %u invocations, %u backedges\n",
+           method->toString().c_str(), method->invocation_count, method->backedge_count);
+
+    for (size_t pc = 0; pc < index.size(); pc++) {
+        if (const BranchProfile *b = branchAt(pc); b != nullptr) {
+            if (b->taken + b->not_taken > 0)
+                printf("  %5zu: branch taken %u, not taken %u\n", pc, b->taken, b->not_taken);
+        } else if (const TypeProfile *t = typeAt(pc); t != nullptr) {
+            if (t->types[0].load(memory_order_acquire) == nullptr)
+                continue;
+            printf("  %5zu: types", pc);
+            for (int i = 0; i < TYPE_PROFILE_WIDTH; i++) {
+                Class *c = t->types[i].load(memory_order_acquire);
+                if (c != nullptr)
+                    printf(" %s (%u)", c->class_name, t->counts[i]);
+            }
+            if (t->other > 0)
+                printf(" other (%u)", t->other);
+            printf("\n");
+        }
+    }
+}
+
+static void collectProfiles(vector<MethodProfile *> &profiles, const Class *c)
+{
+    for (Method *m : c->methods) {
+        MethodProfile *p = m->profile.load(memory_order_acquire);
+        if (p != nullptr)
+            profiles.push_back(p);
+    }
+}
+
+void printMethodProfiles()
+{
+    vector<MethodProfile *> profiles;
+
+    for (auto &iter : *getAllBootClasses()) {
+        collectProfiles(profiles, iter.second);
+    }
+
+    for (const Object *loader : getAllClassLoaders()) {
+        if (loader == BOOT_CLASS_LOADER || loader->classes == nullptr)
+            continue;
+        for (auto &iter : *loader->classes) {
+            collectProfiles(profiles, iter.second);
+        }
+    }
+
+    sort(profiles.begin(), profiles.end(), [](const MethodProfile *x, const MethodProfile *y) {
+        return x->hotness() > y->hotness();
+    });
+
+    printf("method profiles: %zu methods\n", profiles.size());
+    for (const MethodProfile *p : profiles) {
+        p->print();
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef CABIN_METHOD_PROFILE_H
+#define CABIN_METHOD_PROFILE_H
+
+#include <atomic>
+#include <vector>
+#include "../cabin.h"
+
+class Class;
+class Method;
+
+// 调用次数与回边次数之和达到此值后开始收集方法的 profile，冷的代码不付出代价
+#define PROFILE_THRESHOLD 200
+
+// 每个类型 profile 记录的接收者类型的数量，更多的类型计入 TypeProfile::other
+#define TYPE_PROFILE_WIDTH 2
+
+// 条件跳转指令被执行时跳转与不跳转的次数
+struct BranchProfile {
+    u4 taken = 0;
+    u4 not_taken = 0;
+};
+
+/*
+ * invokevirtual, invokeinterface 的接收者类型，或者 checkcast, instanceof 的对象类型的直方图。
+ * 类型只追加不修改，与 InlineCache 一样用 CAS 占位。
+ */
+struct TypeProfile {
+    std::atomic<Class *> types[TYPE_PROFILE_WIDTH]{};
+    u4 counts[TYPE_PROFILE_WIDTH]{};
+    u4 other = 0; // 不在 types 中的类型出现的次数
+
+    void record(Class *c);
+
+    // 只出现过一种类型时返回 true，类型写在 @c 中
+    bool monomorphic(Class *&c) const;
+};
+
+/*
+ * 方法的执行 profile，方法变热（见 PROFILE_THRESHOLD）后由解释器按需创建并填充，
+ * 供优化编译器（内联、去虚化）参考，也可以用 -XX:+PrintMethodProfiles 在退出时打印出来。
+ *
+ * 调用次数和回边次数就是 Method::invocation_count 和 Method::backedge_count。
+ * 计数不要求精确，多线程下不加锁。
+ */
+class MethodProfile {
+    Method *method;
+
+    // 字节码的 pc 到 branches 或 types 下标的映射，不被 profile 的 pc 为 -1
+    std::vector<int> index;
+    std::vector<BranchProfile> branches;
+    std::vector<TypeProfile> types;
+
+    explicit MethodProfile(Method *m);
+
+public:
+    // 返回方法 @m 的 profile，不存在则创建
+    static MethodProfile *of(Method *m);
+
+    void recordBranch(size_t pc, bool taken)
+    {
+        int i = index[pc];
+        if (i >= 0) {
+            BranchProfile &b = branches[i];
+            taken ? b.taken++ : b.not_taken++;
+        }
+    }
+
+    void recordType(size_t pc, Class *c)
+    {
+        int i = index[pc];
+        if (i >= 0)
+            types[i].record(c);
+    }
+
+    // 返回 @pc 处的条件跳转指令的 profile，没有时返回 nullptr
+    [[nodiscard]] const BranchProfile *branchAt(size_t pc) const;
+
+    // 返回 @pc 处的调用或类型检查指令的 profile，没有时返回 nullptr
+    [[nodiscard]] const TypeProfile *typeAt(size_t pc) const;
+
+    // 调用次数与回边次数之和
+    [[nodiscard]] u8 hotness() const;
+
+    void print() const;
+};
+
+// 打印所有方法的 profile，按调用次数与回边次数之和从大到小排列
+void printMethodProfiles();
+
+#endif //CABIN_METHOD_PROFILE_H
@@ -0,0 +1,102 @@
+#include "superinstructions.h"
+
+#if PROFILE_BYTECODE_SEQUENCES
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#endif
+
+using namespace std;
+
+u1 canonicalOpcode(u1 opcode)
+{
+    if (JVM_OPC_iload_0 <= opcode && opcode <= JVM_OPC_aload_3)
+        return JVM_OPC_iload + (opcode - JVM_OPC_iload_0) / 4;
+    if (JVM_OPC_istore_0 <= opcode && opcode <= JVM_OPC_astore_3)
+        return JVM_OPC_istore + (opcode - JVM_OPC_istore_0) / 4;
+    if ((JVM_OPC_iconst_m1 <= opcode && opcode <= JVM_OPC_iconst_5) || opcode == JVM_OPC_sipush)
+        return JVM_OPC_bipush;
+    return opcode;
+}
+
+#if PROFILE_BYTECODE_SEQUENCES
+
+extern const char *const instruction_names[];
+
+static mutex profile_mutex;
+static unordered_map<u4, u8> pairs;   // key: op1 << 8 | op2
+static unordered_map<u4, u8> triples; // key: op1 << 16 | op2 << 8 | op3
+
+// 当前线程上一次执行的指令
+static thread_local struct {
+    Method *method = nullptr;
+    size_t pc = 0;
+    int count = 0;  // 连续执行（顺序流过，中间没有跳转和调用）的指令数，最多记 2 条
+    u1 opcodes[2]{};
+} last;
+
+void profileBytecodeSequence(Method *m, const Cell *ip)
+{
+    ThreadedCode *tc = m->threaded_code.load(memory_order_acquire);
+    size_t i = ip - tc->code;
+    size_t pc = tc->pc_map[i];
+
+    u1 opcode = m->code[pc];
+    if (opcode == JVM_OPC_wide)
+        opcode = m->code[pc + 1];
+    opcode = canonicalOpcode(opcode);
+
+    // 只有顺序流到本指令的才算连续执行，这样的序列才能合并为超级指令
+    bool sequential = last.method == m && i > 0 && last.pc == tc->pc_map[i - 1] && last.pc != pc;
+    if (!sequential)
+        last.count = 0;
+
+    if (last.count > 0) {
+        lock_guard<mutex> lock(profile_mutex);
+        pairs[(u4) last.opcodes[1] << 8 | opcode]++;
+        if (last.count > 1)
+            triples[(u4) last.opcodes[0] << 16 | (u4) last.opcodes[1] << 8 | opcode]++;
+    }
+
+    last.method = m;
+    last.pc = pc;
+    last.opcodes[0] = last.opcodes[1];
+    last.opcodes[1] = opcode;
+    last.count = min(last.count + 1, 2);
+}
+
+static void printSequences(const unordered_map<u4, u8> &sequences, int len, size_t limit)
+{
+    vector<pair<u4, u8>> sorted(sequences.begin(), sequences.end());
+    sort(sorted.begin(), sorted.end(), [](auto &x, auto &y) { return x.second > y.second; });
+
+    for (size_t i = 0; i < sorted.size() && i < limit; i++) {
+        u1 ops[3];
+        for (int k = 0; k < len; k++)
+            ops[k] = (u1) (sorted[i].first >> (8 * (len - 1 - k)));
+
+        printf("    { 0, %d, {", len);
+        for (int k = 0; k < len; k++)
+            printf(" JVM_OPC_%s%s", instruction_names[ops[k]], k < len - 1 ? "," : "");
+        printf(" } }, // %llu\n", (unsigned long long) sorted[i].second);
+    }
+}
+
+void printBytecodeSequences()
+{
+    lock_guard<mutex> lock(profile_mutex);
+
+    u8 total = 0;
+    for (auto &p: pairs)
+        total += p.second;
+
+    printf("// superinstruction candidates, %llu sequential pairs executed.\n", (unsigned long long) total);
+    printf("// { opcode, len, { sequence } }, // count\n");
+    printf("static const Superinstruction superinstruction_candidates[] = {\n");
+    printSequences(triples, 3, 32);
+    printSequences(pairs, 2, 32);
+    printf("};\n");
+}
+
+#endif
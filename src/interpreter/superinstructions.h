@@ -0,0 +1,57 @@
+#ifndef CABIN_SUPERINSTRUCTIONS_H
+#define CABIN_SUPERINSTRUCTIONS_H
+
+#include "../cabin.h"
+#include "../classfile/constants.h"
+#include "../debug.h"
+#include "threaded_code.h"
+
+/*
+ * 超级指令（superinstructions）
+ *
+ * 将频繁连续执行的指令序列合并成一条指令，一次分派执行整个序列。
+ * 翻译线索化代码时，匹配到的序列只改写第一条指令的 handler，
+ * 序列中各条指令的 cell 保持不变，所以跳转到序列中间的指令仍然正确。
+ *
+ * 匹配前指令先规范化（见 canonicalOpcode），
+ * 例如 iload_1 和 iload 1 都匹配 iload，iconst_2 和 sipush 都匹配 bipush。
+ * 序列中被规范化的指令在指令流中也按规范化后的形式生成（带上操作数）。
+ *
+ * 下面的序列来自 PROFILE_BYTECODE_SEQUENCES 打印的候选表（见 debug.h）。
+ */
+struct Superinstruction {
+    u1 opcode;      // 超级指令的 opcode
+    u1 len;         // 序列的长度
+    u1 sequence[4]; // 规范化之后的指令序列
+};
+
+// 按序列长度从长到短排列，优先匹配长的序列
+static const Superinstruction superinstructions[] = {
+    { JVM_OPC_iload_iconst_iadd_istore, 4, { JVM_OPC_iload, JVM_OPC_bipush, JVM_OPC_iadd, JVM_OPC_istore } },
+    { JVM_OPC_iload_iload_if_icmpeq, 3, { JVM_OPC_iload, JVM_OPC_iload, JVM_OPC_if_icmpeq } },
+    { JVM_OPC_iload_iload_if_icmpne, 3, { JVM_OPC_iload, JVM_OPC_iload, JVM_OPC_if_icmpne } },
+    { JVM_OPC_iload_iload_if_icmplt, 3, { JVM_OPC_iload, JVM_OPC_iload, JVM_OPC_if_icmplt } },
+    { JVM_OPC_iload_iload_if_icmpge, 3, { JVM_OPC_iload, JVM_OPC_iload, JVM_OPC_if_icmpge } },
+    { JVM_OPC_iload_iload_if_icmpgt, 3, { JVM_OPC_iload, JVM_OPC_iload, JVM_OPC_if_icmpgt } },
+    { JVM_OPC_iload_iload_if_icmple, 3, { JVM_OPC_iload, JVM_OPC_iload, JVM_OPC_if_icmple } },
+    { JVM_OPC_aload_iload_iaload, 3, { JVM_OPC_aload, JVM_OPC_iload, JVM_OPC_iaload } },
+    { JVM_OPC_aload_getfield, 2, { JVM_OPC_aload, JVM_OPC_getfield } },
+    { JVM_OPC_dup_getfield, 2, { JVM_OPC_dup, JVM_OPC_getfield } },
+};
+
+/*
+ * 规范化 opcode：
+ * xload_<n> -> xload, xstore_<n> -> xstore, iconst_<n> 和 sipush -> bipush，
+ * 其他指令不变。
+ */
+u1 canonicalOpcode(u1 opcode);
+
+#if PROFILE_BYTECODE_SEQUENCES
+// 记录即将执行的指令（ip 指向其 handler）
+void profileBytecodeSequence(Method *m, const Cell *ip);
+
+// 打印执行次数最多的指令对和三元组，格式同 superinstructions[]
+void printBytecodeSequences();
+#endif
+
+#endif //CABIN_SUPERINSTRUCTIONS_H
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <vector>
+#include "threaded_code.h"
+#include "superinstructions.h"
+#include "../classfile/bytecode_reader.h"
+#include "../classfile/constants.h"
+#include "../exception.h"
+#include "../heap/ref_map.h"
+
+using namespace std;
+
+namespace {
+
+// 解码后的一条指令
+struct Instruction {
+    size_t pc;
+    u1 opcode; // 要执行的处理程序的 opcode，wide 指令为其所修饰指令的 opcode
+    vector<intptr_t> operands;
+    vector<bool> is_branch; // 对应的操作数是否是跳转目标（字节码中的绝对 pc）
+
+    void add(intptr_t operand, bool branch = false)
+    {
+        operands.push_back(operand);
+        is_branch.push_back(branch);
+    }
+
+    [[nodiscard]] size_t cellsCount() const { return 1 + operands.size(); }
+};
+
+Instruction decode(BytecodeReader &r)
+{
+    Instruction inst;
+    inst.pc = r.pc;
+    inst.opcode = r.readu1();
+
+    switch (inst.opcode) {
+        case JVM_OPC_bipush:
+            inst.add(r.reads1());
+            break;
+        case JVM_OPC_sipush:
+            inst.add(r.reads2());
+            break;
+        case JVM_OPC_ldc:
+        case JVM_OPC_iload: case JVM_OPC_lload: case JVM_OPC_fload: case JVM_OPC_dload: case JVM_OPC_aload:
+        case JVM_OPC_istore: case JVM_OPC_lstore: case JVM_OPC_fstore: case JVM_OPC_dstore: case JVM_OPC_astore:
+        case JVM_OPC_ret:
+        case JVM_OPC_newarray:
+            inst.add(r.readu1());
+            break;
+        case JVM_OPC_iinc:
+            inst.add(r.readu1());
+            inst.add(r.reads1());
+            break;
+        case JVM_OPC_ifeq: case JVM_OPC_ifne: case JVM_OPC_iflt:
+        case JVM_OPC_ifge: case JVM_OPC_ifgt: case JVM_OPC_ifle:
+        case JVM_OPC_if_icmpeq: case JVM_OPC_if_icmpne: case JVM_OPC_if_icmplt:
+        case JVM_OPC_if_icmpge: case JVM_OPC_if_icmpgt: case JVM_OPC_if_icmple:
+        case JVM_OPC_if_acmpeq: case JVM_OPC_if_acmpne:
+        case JVM_OPC_goto: case JVM_OPC_jsr:
+        case JVM_OPC_ifnull: case JVM_OPC_ifnonnull:
+            inst.add(inst.pc + r.reads2(), true);
+            break;
+        case JVM_OPC_goto_w:
+        case JVM_OPC_jsr_w:
+            inst.add(inst.pc + r.reads4(), true);
+            break;
+        case JVM_OPC_tableswitch: {
+            // [low][high][default][jump targets...]
+            r.align4();
+            s4 default_offset = r.reads4();
+            s4 low = r.reads4();
+            s4 high = r.reads4();
+            if (low > high) // The value low must be less than or equal to high.
+                throw java_lang_ClassFormatError("tableswitch: low(" + to_string(low)
+                                                + ") > high(" + to_string(high) + ")");
+
+            inst.add(low);
+            inst.add(high);
+            inst.add(inst.pc + default_offset, true);
+            // high 可能是 INT_MAX，按个数循环，不能用 i <= high
+            for (int64_t n = (int64_t) high - low + 1; n > 0; n--) {
+                inst.add(inst.pc + r.reads4(), true);
+            }
+            break;
+        }
+        case JVM_OPC_lookupswitch: {
+            // [npairs][default][keys...][targets...]
+            // keys 连续存放并按升序排列，执行时二分查找
+            r.align4();
+            s4 default_offset = r.reads4();
+            s4 npairs = r.reads4();
+            if (npairs < 0) // The npairs must be greater than or equal to 0.
+                throw java_lang_ClassFormatError("lookupswitch: npairs is " + to_string(npairs));
+
+            vector<pair<s4, s4>> pairs(npairs);
+            for (auto &p : pairs) {
+                p.first = r.reads4();
+                p.second = r.reads4();
+            }
+            // class 文件要求 match 已经有序，这里再排一次，不依赖于 class 文件是否校验过
+            sort(pairs.begin(), pairs.end());
+
+            inst.add(npairs);
+            inst.add(inst.pc + default_offset, true);
+            for (auto &p : pairs) {
+                inst.add(p.first);
+            }
+            for (auto &p : pairs) {
+                inst.add(inst.pc + p.second, true);
+            }
+            break;
+        }
+        case JVM_OPC_ldc_w:
+        case JVM_OPC_ldc2_w:
+        case JVM_OPC_getstatic: case JVM_OPC_putstatic:
+        case JVM_OPC_getfield: case JVM_OPC_putfield:
+        case JVM_OPC_invokespecial: case JVM_OPC_invokestatic:
+        case JVM_OPC_new: case JVM_OPC_anewarray:
+        case JVM_OPC_checkcast: case JVM_OPC_instanceof:
+            inst.add(r.readu2());
+            break;
+        case JVM_OPC_invokevirtual:
+            // [index][pc]，pc 用于查找调用点的内联缓存
+            inst.add(r.readu2());
+            inst.add(inst.pc);
+            break;
+        case JVM_OPC_invokeinterface:
+            // [index][pc]，略去 count 和 0 两个字节
+            inst.add(r.readu2());
+            r.skip(2);
+            inst.add(inst.pc);
+            break;
+        case JVM_OPC_invokedynamic:
+            // [index][call site]，call site 在链接后填入，见 InvokeDynamicCallSite
+            inst.add(r.readu2());
+            r.skip(2); // two bytes must always be zero.
+            inst.add(0);
+            break;
+        case JVM_OPC_multianewarray:
+            inst.add(r.readu2());
+            inst.add(r.readu1());
+            break;
+        case JVM_OPC_wide:
+            // 将 wide 合并到它所修饰的指令中，操作数的宽度在指令流中没有区别
+            inst.opcode = r.readu1();
+            switch (inst.opcode) {
+                case JVM_OPC_iload: case JVM_OPC_lload: case JVM_OPC_fload: case JVM_OPC_dload: case JVM_OPC_aload:
+                case JVM_OPC_istore: case JVM_OPC_lstore: case JVM_OPC_fstore: case JVM_OPC_dstore: case JVM_OPC_astore:
+                case JVM_OPC_ret:
+                    inst.add(r.readu2());
+                    break;
+                case JVM_OPC_iinc:
+                    inst.add(r.readu2());
+                    inst.add(r.reads2());
+                    break;
+                default:
+                    throw java_lang_ClassFormatError("wide: invalid instruction " + to_string(inst.opcode));
+            }
+            break;
+        default:
+            // 其他的指令没有操作数，或者是未使用的指令
+            break;
+    }
+
+    return inst;
+}
+
+// 将指令改写为规范化的形式，见 canonicalOpcode
+void canonicalize(Instruction &inst)
+{
+    u1 opcode = canonicalOpcode(inst.opcode);
+    if (opcode == inst.opcode)
+        return;
+
+    if (opcode == JVM_OPC_bipush) {
+        if (inst.opcode != JVM_OPC_sipush) // sipush 的操作数不变
+            inst.add(inst.opcode - JVM_OPC_iconst_0);
+    } else if (inst.opcode <= JVM_OPC_aload_3) {
+        inst.add((inst.opcode - JVM_OPC_iload_0) % 4);
+    } else {
+        inst.add((inst.opcode - JVM_OPC_istore_0) % 4);
+    }
+    inst.opcode = opcode;
+}
+
+const Superinstruction *match(const vector<Instruction> &instructions, size_t i)
+{
+    for (auto &s : superinstructions) {
+        if (i + s.len > instructions.size())
+            continue;
+        int k = 0;
+        while (k < s.len && canonicalOpcode(instructions[i + k].opcode) == s.sequence[k])
+            k++;
+        if (k == s.len)
+            return &s;
+    }
+    return nullptr;
+}
+
+/*
+ * 将匹配的指令序列合并为超级指令：
+ * 序列中的指令规范化后，第一条指令的 handler 换成超级指令的，其他 cell 不变。
+ */
+void fuse(vector<Instruction> &instructions)
+{
+    size_t i = 0;
+    while (i < instructions.size()) {
+        const Superinstruction *s = match(instructions, i);
+        if (s == nullptr) {
+            i++;
+            continue;
+        }
+        for (int k = 0; k < s->len; k++) {
+            canonicalize(instructions[i + k]);
+        }
+        instructions[i].opcode = s->opcode;
+        i += s->len;
+    }
+}
+
+} // namespace
+
+ThreadedCode *translate(Method *m, const void *const handlers[])
+{
+    assert(m != nullptr && handlers != nullptr);
+    assert(m->code != nullptr);
+
+    ThreadedCode *tc = m->threaded_code.load(memory_order_acquire);
+    if (tc != nullptr)
+        return tc; // 已经翻译过了
+
+    // 第一遍：解码所有指令，确定每条指令在指令流中的位置
+    vector<Instruction> instructions;
+    auto cell_map = new s4[m->code_len];
+    fill(cell_map, cell_map + m->code_len, -1);
+
+    BytecodeReader r(m->code, m->code_len);
+    while (r.hasMore()) {
+        instructions.push_back(decode(r));
+    }
+
+#if !PROFILE_BYTECODE_SEQUENCES
+    fuse(instructions);
+#endif
+
+    size_t cells_count = 0;
+    for (auto &inst : instructions) {
+        cell_map[inst.pc] = (s4) cells_count;
+        cells_count += inst.cellsCount();
+    }
+
+    tc = new ThreadedCode;
+    tc->code = new Cell[cells_count];
+    tc->len = cells_count;
+    tc->pc_map = new u4[cells_count];
+    tc->cell_map = cell_map;
+    tc->code_len = m->code_len;
+
+    // 第二遍：生成指令流
+    Cell *cell = tc->code;
+    for (auto &inst : instructions) {
+        for (size_t i = 0; i < inst.cellsCount(); i++) {
+            tc->pc_map[cell - tc->code + i] = (u4) inst.pc;
+        }
+
+        (cell++)->handler = handlers[inst.opcode];
+        for (size_t i = 0; i < inst.operands.size(); i++) {
+            if (inst.is_branch[i]) {
+                auto target = (size_t) inst.operands[i];
+                if (target >= m->code_len || cell_map[target] < 0) {
+                    delete tc;
+                    throw java_lang_ClassFormatError("Illegal target of jump or branch: "
+                                                + m->toString() + ", pc = " + to_string(inst.pc));
+                }
+                (cell++)->target = tc->code + cell_map[target];
+            } else {
+                (cell++)->operand = inst.operands[i];
+            }
+        }
+    }
+    assert(cell == tc->code + tc->len);
+
+    // 同时准备好 GC 扫描此方法的 frame 时用的引用映射，GC 时不再分析字节码
+    RefMap::of(m);
+
+    // 其他线程可能同时翻译了此方法，只保留先完成的
+    ThreadedCode *expected = nullptr;
+    if (!m->threaded_code.compare_exchange_strong(expected, tc, memory_order_acq_rel)) {
+        delete tc;
+        return expected;
+    }
+
+    return tc;
+}
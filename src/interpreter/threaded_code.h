@@ -0,0 +1,69 @@
+#ifndef CABIN_THREADED_CODE_H
+#define CABIN_THREADED_CODE_H
+
+#include <atomic>
+#include <cassert>
+#include "../cabin.h"
+#include "../metadata/method.h"
+
+/*
+ * 预解码的直接线索化代码（direct-threaded code）
+ *
+ * 方法第一次被调用时，其字节码被翻译为由 Cell 组成的指令流：
+ * 每条指令以其处理程序（exec() 中 handler 的地址）开头，后面跟着它的操作数。
+ * 操作数已经转为本机字节序的整数，跳转指令的目标是指令流中的绝对地址，
+ * wide 指令被合并进它所修饰的指令中。
+ * 解释器执行时直接 goto 到 handler，不再解码字节码。
+ *
+ * 指令流中的每个 Cell 都可以映射回字节码的 pc，用于异常处理、行号和栈轨迹。
+ */
+union Cell {
+    const void *handler;
+    intptr_t operand;
+    Cell *target;
+};
+
+struct ThreadedCode {
+    Cell *code = nullptr;
+    size_t len = 0; // count of cells
+
+    // 每个 cell 所属的指令在字节码中的 pc
+    u4 *pc_map = nullptr;
+
+    // 字节码 pc 到 cell 下标的映射，不是指令开头的 pc 为 -1
+    s4 *cell_map = nullptr;
+    size_t code_len = 0;
+
+    ~ThreadedCode()
+    {
+        delete[] code;
+        delete[] pc_map;
+        delete[] cell_map;
+    }
+
+    [[nodiscard]] size_t pcOf(const Cell *ip) const
+    {
+        assert(code <= ip && ip < code + len);
+        return pc_map[ip - code];
+    }
+
+    [[nodiscard]] Cell *cellOf(size_t pc) const
+    {
+        assert(pc < code_len && cell_map[pc] >= 0);
+        return code + cell_map[pc];
+    }
+};
+
+/*
+ * 将方法 @m 的字节码翻译为直接线索化代码，线程安全。
+ * @handlers: exec() 中各指令的处理程序，以 opcode 为下标。
+ */
+ThreadedCode *translate(Method *m, const void *const handlers[]);
+
+static inline ThreadedCode *getThreadedCode(Method *m, const void *const handlers[])
+{
+    ThreadedCode *tc = m->threaded_code.load(std::memory_order_acquire);
+    return tc != nullptr ? tc : translate(m, handlers);
+}
+
+#endif //CABIN_THREADED_CODE_H
@@ -0,0 +1,154 @@
+#ifndef CABIN_ASSEMBLER_H
+#define CABIN_ASSEMBLER_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+#include "../cabin.h"
+
+/*
+ * x86-64 机器码的生成，供 JIT 使用。
+ * 只实现了 JIT 用到的指令，内存操作数一律使用 [base + disp32] 或 [base + index*scale + disp32] 的形式。
+ */
+
+enum Reg: u1 {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+// 条件跳转指令（0F 8x rel32）的条件码
+enum Condition: u1 {
+    CC_EQ = 0x84, CC_NE = 0x85, CC_AE = 0x83, CC_LT = 0x8C, CC_GE = 0x8D, CC_LE = 0x8E, CC_GT = 0x8F,
+};
+
+class Assembler {
+    std::vector<u1> buf;
+
+    // REX 前缀，不需要时不生成
+    void rex(bool w, int reg, int index, int base)
+    {
+        u1 r = 0x40 | (w << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+        if (r != 0x40)
+            buf.push_back(r);
+    }
+
+public:
+    void emit(std::initializer_list<u1> bytes) { buf.insert(buf.end(), bytes); }
+
+    void emit4(s4 v)
+    {
+        for (int i = 0; i < 4; i++)
+            buf.push_back((u1) ((u4) v >> (8*i)));
+    }
+
+    void emit8(u8 v)
+    {
+        for (int i = 0; i < 8; i++)
+            buf.push_back((u1) (v >> (8*i)));
+    }
+
+    [[nodiscard]] size_t pos() const { return buf.size(); }
+
+    // 把 @at 处的 rel32 改为跳转到 @target
+    void patch4(size_t at, size_t target)
+    {
+        auto rel = (s4) ((ptrdiff_t) target - (ptrdiff_t) (at + 4));
+        memcpy(&buf[at], &rel, 4);
+    }
+
+    // 向前的短跳转（rel8），返回待回填的位置，用 bind8 绑定到当前位置
+    size_t jump8(u1 opcode)
+    {
+        emit({ opcode, 0 });
+        return pos();
+    }
+
+    void bind8(size_t from)
+    {
+        size_t rel = pos() - from;
+        assert(rel <= INT8_MAX);
+        buf[from - 1] = (u1) rel;
+    }
+
+    // 条件跳转（0F cc rel32），返回 rel32 的位置，由调用者回填
+    size_t jcc32(Condition cc)
+    {
+        emit({ 0x0F, cc });
+        size_t at = pos();
+        emit4(0);
+        return at;
+    }
+
+    size_t jmp32()
+    {
+        emit({ 0xE9 });
+        size_t at = pos();
+        emit4(0);
+        return at;
+    }
+
+    // op reg, rm（寄存器形式），@w: 64位操作数
+    void opRR(bool w, std::initializer_list<u1> opcode, int reg, int rm)
+    {
+        rex(w, reg, 0, rm);
+        emit(opcode);
+        buf.push_back(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    // op reg, [base + disp32]
+    void opRM(bool w, std::initializer_list<u1> opcode, int reg, int base, s4 disp)
+    {
+        rex(w, reg, 0, base);
+        emit(opcode);
+        buf.push_back(0x80 | ((reg & 7) << 3) | (base & 7));
+        if ((base & 7) == RSP)
+            buf.push_back(0x24); // SIB: [rsp/r12 + disp32]
+        emit4(disp);
+    }
+
+    // op reg, [base + index*scale + disp32]
+    void opRMI(bool w, std::initializer_list<u1> opcode, int reg, int base, int index, int scale, s4 disp)
+    {
+        assert(index != RSP);
+        u1 ss = scale == 1 ? 0 : scale == 2 ? 1 : scale == 4 ? 2 : 3;
+        rex(w, reg, index, base);
+        emit(opcode);
+        buf.push_back(0x84 | ((reg & 7) << 3));
+        buf.push_back((ss << 6) | ((index & 7) << 3) | (base & 7));
+        emit4(disp);
+    }
+
+    void mov(int dst, int src)
+    {
+        if (dst != src)
+            opRR(true, { 0x8B }, dst, src);
+    }
+
+    void load(int dst, int base, s4 disp)  { opRM(true, { 0x8B }, dst, base, disp); }
+    void store(int base, s4 disp, int src) { opRM(true, { 0x89 }, src, base, disp); }
+
+    // dst = imm，选最短的编码
+    void movImm(int dst, jlong v)
+    {
+        if (v == 0) {
+            opRR(false, { 0x33 }, dst, dst);           // xor r32, r32
+        } else if (0 < v && v <= UINT32_MAX) {
+            rex(false, 0, 0, dst);
+            buf.push_back(0xB8 | (dst & 7));           // mov r32, imm32（高32位清零）
+            emit4((s4) (u4) v);
+        } else if (INT32_MIN <= v && v <= INT32_MAX) {
+            opRR(true, { 0xC7 }, 0, dst);              // mov r64, imm32（符号扩展）
+            emit4((s4) v);
+        } else {
+            rex(true, 0, 0, dst);
+            buf.push_back(0xB8 | (dst & 7));           // mov r64, imm64
+            emit8((u8) v);
+        }
+    }
+
+    [[nodiscard]] const u1 *data() const { return buf.data(); }
+};
+
+#endif //CABIN_ASSEMBLER_H
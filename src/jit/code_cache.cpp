@@ -0,0 +1,70 @@
+#include <cassert>
+#include <cstring>
+#include <mutex>
+#include "code_cache.h"
+#include "jit.h"
+
+#if JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#if JIT_SUPPORTED
+
+static mutex cache_mutex;
+static u1 *cache_begin = nullptr;
+static size_t cache_used = 0;
+
+void *installCode(const void *code, size_t len)
+{
+    assert(code != nullptr && len > 0);
+
+    static const size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t size = (len + page_size - 1) / page_size * page_size;
+
+    lock_guard<mutex> lock(cache_mutex);
+
+    if (cache_begin == nullptr) {
+        // 只预留地址空间，用到时才分配物理内存
+        void *p = mmap(nullptr, CODE_CACHE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED)
+            return nullptr;
+        cache_begin = (u1 *) p;
+    }
+
+    if (cache_used + size > CODE_CACHE_SIZE)
+        return nullptr; // 代码缓存已满
+
+    u1 *entry = cache_begin + cache_used;
+    if (mprotect(entry, size, PROT_READ | PROT_WRITE) != 0)
+        return nullptr;
+    memcpy(entry, code, len);
+    if (mprotect(entry, size, PROT_READ | PROT_EXEC) != 0)
+        return nullptr;
+    __builtin___clear_cache((char *) entry, (char *) entry + len);
+
+    cache_used += size;
+    return entry;
+}
+
+size_t codeCacheUsed()
+{
+    lock_guard<mutex> lock(cache_mutex);
+    return cache_used;
+}
+
+#else
+
+void *installCode(const void *code, size_t len)
+{
+    return nullptr;
+}
+
+size_t codeCacheUsed()
+{
+    return 0;
+}
+
+#endif
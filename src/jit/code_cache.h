@@ -0,0 +1,28 @@
+#ifndef CABIN_CODE_CACHE_H
+#define CABIN_CODE_CACHE_H
+
+#include <cstddef>
+#include "../cabin.h"
+
+// 代码缓存的大小
+#define CODE_CACHE_SIZE (32*1024*1024) // 32 MB
+
+/*
+ * JIT 生成的机器码存放在代码缓存中。
+ *
+ * 代码缓存是一块预留的虚拟内存，按页分配，分配出去的页不会再与其他代码共享，
+ * 写入时把这几页设为可写不可执行，写完再设为可执行不可写（W^X），
+ * 其他线程正在执行的代码所在的页不会被改变权限。
+ * 编译好的代码一直保留到虚拟机退出。
+ */
+
+/*
+ * 把长度为 @len 的机器码 @code 复制到代码缓存中，返回其入口地址。
+ * 代码缓存已满或者平台不支持时返回 nullptr。线程安全。
+ */
+void *installCode(const void *code, size_t len);
+
+// 代码缓存已经使用的字节数（按页计）
+size_t codeCacheUsed();
+
+#endif //CABIN_CODE_CACHE_H
@@ -0,0 +1,65 @@
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "opt_compiler.h"
+#include "../metadata/cha.h"
+
+using namespace std;
+
+/*
+ * 优化编译在一个后台线程中进行，解释器（或模板 JIT 的代码）在编译期间继续执行方法。
+ * 编译线程在第一次请求编译时启动，之后一直存在。
+ */
+
+// 编译线程一直运行到进程退出，所以队列不能是静态对象：
+// 退出时析构 queue_cond 会一直等待在其上等待的编译线程，析构 queue 后编译线程还可能访问它。
+static mutex &queue_mutex = *new mutex;
+static condition_variable &queue_cond = *new condition_variable;
+static deque<Method *> &queue = *new deque<Method *>;
+static bool compiler_thread_started = false;
+
+static void compilerThreadLoop()
+{
+    while (true) {
+        Method *m;
+        {
+            unique_lock<mutex> lock(queue_mutex);
+            queue_cond.wait(lock, [] { return !queue.empty(); });
+            m = queue.front();
+            queue.pop_front();
+        }
+
+        vector<Method *> assumed;
+        JitCode code = optCompile(m, assumed);
+        if (code == nullptr) {
+            m->opt_state.store(OPT_NOT_COMPILABLE, memory_order_relaxed);
+            continue;
+        }
+
+        if (!installOptCode(m, (void *) code, assumed)) {
+            // 编译期间加载的类使内联时的假设失效，以后按新的类层次重新编译
+            m->opt_state.store(OPT_NOT_COMPILED, memory_order_relaxed);
+            continue;
+        }
+        if (print_compilation) {
+            printf("jit: optimized %s (%zu bytes of bytecode)\n", m->toString().c_str(), m->code_len);
+        }
+    }
+}
+
+void requestOptCompile(Method *m)
+{
+    int expected = OPT_NOT_COMPILED;
+    if (!m->opt_state.compare_exchange_strong(expected, OPT_QUEUED))
+        return; // 已经在队列中，或者已经编译过了
+
+    lock_guard<mutex> lock(queue_mutex);
+    if (!compiler_thread_started) {
+        thread(compilerThreadLoop).detach();
+        compiler_thread_started = true;
+    }
+    queue.push_back(m);
+    queue_cond.notify_one();
+}
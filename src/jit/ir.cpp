@@ -0,0 +1,727 @@
+#include <algorithm>
+#include <functional>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include "ir.h"
+#include "assembler.h"
+#include "../metadata/class.h"
+#include "../metadata/field.h"
+#include "../metadata/method.h"
+
+using namespace std;
+
+void Graph::computeRPO()
+{
+    for (auto &b : blocks) {
+        b->rpo = -1;
+    }
+
+    vector<Block *> post;
+    vector<pair<Block *, size_t>> stack;
+    vector<bool> visited(blocks.size(), false);
+    stack.emplace_back(entry, 0);
+    visited[entry->id] = true;
+    while (!stack.empty()) {
+        auto &[b, i] = stack.back();
+        if (i < b->succs.size()) {
+            Block *s = b->succs[i++];
+            if (!visited[s->id]) {
+                visited[s->id] = true;
+                stack.emplace_back(s, 0);
+            }
+        } else {
+            post.push_back(b);
+            stack.pop_back();
+        }
+    }
+
+    rpo.assign(post.rbegin(), post.rend());
+    for (size_t i = 0; i < rpo.size(); i++) {
+        rpo[i]->rpo = (int) i;
+    }
+
+    // 删除从不可达的块出发的边，同时删除 phi 中对应的输入
+    for (Block *b : rpo) {
+        for (size_t i = b->preds.size(); i-- > 0;) {
+            if (b->preds[i]->rpo < 0) {
+                b->preds.erase(b->preds.begin() + i);
+                for (Inst *phi : b->phis) {
+                    phi->inputs.erase(phi->inputs.begin() + i);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * 计算支配树。
+ * 参考 Cooper, Harvey, Kennedy. A Simple, Fast Dominance Algorithm.
+ */
+void Graph::computeDominators()
+{
+    computeRPO();
+    for (Block *b : rpo) {
+        b->idom = nullptr;
+        b->dom_children.clear();
+    }
+
+    auto intersect = [](Block *x, Block *y) {
+        while (x != y) {
+            while (x->rpo > y->rpo)
+                x = x->idom;
+            while (y->rpo > x->rpo)
+                y = y->idom;
+        }
+        return x;
+    };
+
+    entry->idom = entry;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); i++) {
+            Block *b = rpo[i];
+            Block *new_idom = nullptr;
+            for (Block *p : b->preds) {
+                if (p->idom == nullptr)
+                    continue;
+                new_idom = new_idom == nullptr ? p : intersect(p, new_idom);
+            }
+            if (b->idom != new_idom) {
+                b->idom = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    entry->idom = nullptr;
+    for (size_t i = 1; i < rpo.size(); i++) {
+        rpo[i]->idom->dom_children.push_back(rpo[i]);
+    }
+}
+
+void Graph::splitCriticalEdges()
+{
+    size_t n = blocks.size();
+    for (size_t i = 0; i < n; i++) {
+        Block *from = blocks[i].get();
+        if (from->rpo < 0 || from->succs.size() < 2)
+            continue;
+        for (Block *&to : from->succs) {
+            if (to->preds.size() < 2)
+                continue;
+            Block *mid = newBlock();
+            Inst *jump = newInst(IR_GOTO, T_VOID);
+            jump->block = mid;
+            mid->insts.push_back(jump);
+            replace(to->preds.begin(), to->preds.end(), from, mid);
+            mid->preds.push_back(from);
+            mid->succs.push_back(to);
+            to = mid;
+        }
+    }
+    computeDominators();
+}
+
+void Graph::resolveReplacements()
+{
+    auto fix = [](vector<Inst *> &values) {
+        for (Inst *&v : values)
+            v = resolve(v);
+    };
+
+    for (auto &inst : insts) {
+        fix(inst->inputs);
+    }
+    for (auto &state : states) {
+        fix(state->locals);
+        fix(state->stack);
+        // 被删除的值（无效的 phi）对应的 slot 不用写回
+        for (Inst *&v : state->locals)
+            if (v != nullptr && v->removed) v = nullptr;
+        for (Inst *&v : state->stack)
+            if (v != nullptr && v->removed) v = nullptr;
+    }
+    for (auto &b : blocks) {
+        auto is_replaced = [](Inst *i) { return i->replacement != nullptr || i->removed; };
+        b->phis.erase(remove_if(b->phis.begin(), b->phis.end(), is_replaced), b->phis.end());
+        b->insts.erase(remove_if(b->insts.begin(), b->insts.end(), is_replaced), b->insts.end());
+    }
+}
+
+string Graph::toString() const
+{
+    static const char *op_names[] = {
+        "const", "param", "phi",
+        "add", "sub", "mul", "div", "rem", "neg",
+        "and", "or", "xor", "shl", "shr", "ushr",
+        "i2l", "l2i", "i2b", "i2c", "i2s",
+        "lcmp",
+        "array_length", "array_load", "array_store",
+        "get_field", "put_field", "get_static", "put_static",
+        "null_check", "bounds_check", "zero_check", "class_check", "cha_check",
+        "safepoint",
+        "if", "goto", "return",
+    };
+    static const char type_chars[] = { 'V', 'I', 'J', 'L' };
+
+    ostringstream oss;
+    oss << method->toString() << "\n";
+    auto print = [&](Inst *i) {
+        oss << "  v" << i->id << ":" << type_chars[i->type] << " = " << op_names[i->op];
+        if (i->op == IR_CONST || i->op == IR_PARAM)
+            oss << " " << i->constant;
+        for (Inst *in : i->inputs)
+            oss << " v" << in->id;
+        if (i->field != nullptr)
+            oss << " " << i->field->name;
+        if (i->method != nullptr)
+            oss << " " << i->method->name;
+        if (i->state != nullptr)
+            oss << " @" << i->state->pc;
+        if (i->location >= 0)
+            oss << " [" << i->location << "]";
+        oss << "\n";
+    };
+    for (Block *b : rpo) {
+        oss << "B" << b->id << " <-";
+        for (Block *p : b->preds)
+            oss << " B" << p->id;
+        oss << "\n";
+        for (Inst *i : b->phis)
+            print(i);
+        for (Inst *i : b->insts)
+            print(i);
+        if (!b->succs.empty()) {
+            oss << "  ->";
+            for (Block *s : b->succs)
+                oss << " B" << s->id;
+            oss << "\n";
+        }
+    }
+    return oss.str();
+}
+
+bool foldConstant(IROp op, IRType type, jlong x, jlong y, jlong &result)
+{
+    if (type == T_INT) {
+        auto a = (jint) x, b = (jint) y;
+        jint r;
+        switch (op) {
+            case IR_ADD: r = (jint) ((u4) a + (u4) b); break;
+            case IR_SUB: r = (jint) ((u4) a - (u4) b); break;
+            case IR_MUL: r = (jint) ((u4) a * (u4) b); break;
+            case IR_DIV:
+                if (b == 0) return false;
+                r = (a == INT32_MIN && b == -1) ? a : a / b;
+                break;
+            case IR_REM:
+                if (b == 0) return false;
+                r = (b == -1) ? 0 : a % b;
+                break;
+            case IR_NEG:  r = (jint) (0 - (u4) a); break;
+            case IR_AND:  r = a & b; break;
+            case IR_OR:   r = a | b; break;
+            case IR_XOR:  r = a ^ b; break;
+            case IR_SHL:  r = (jint) ((u4) a << (b & 0x1f)); break;
+            case IR_SHR:  r = a >> (b & 0x1f); break;
+            case IR_USHR: r = (jint) ((u4) a >> (b & 0x1f)); break;
+            case IR_L2I:  r = (jint) x; break;
+            case IR_I2B:  r = (jbyte) a; break;
+            case IR_I2C:  r = (jchar) a; break;
+            case IR_I2S:  r = (jshort) a; break;
+            case IR_LCMP: r = x < y ? -1 : (x > y ? 1 : 0); break;
+            default: return false;
+        }
+        result = r;
+        return true;
+    }
+
+    if (type == T_LONG) {
+        switch (op) {
+            case IR_ADD: result = (jlong) ((u8) x + (u8) y); break;
+            case IR_SUB: result = (jlong) ((u8) x - (u8) y); break;
+            case IR_MUL: result = (jlong) ((u8) x * (u8) y); break;
+            case IR_DIV:
+                if (y == 0) return false;
+                result = (x == INT64_MIN && y == -1) ? x : x / y;
+                break;
+            case IR_REM:
+                if (y == 0) return false;
+                result = (y == -1) ? 0 : x % y;
+                break;
+            case IR_NEG:  result = (jlong) (0 - (u8) x); break;
+            case IR_AND:  result = x & y; break;
+            case IR_OR:   result = x | y; break;
+            case IR_XOR:  result = x ^ y; break;
+            case IR_SHL:  result = (jlong) ((u8) x << (y & 0x3f)); break;
+            case IR_SHR:  result = x >> (y & 0x3f); break;
+            case IR_USHR: result = (jlong) ((u8) x >> (y & 0x3f)); break;
+            case IR_I2L:  result = (jint) x; break;
+            default: return false;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+namespace {
+
+// 把 @i 替换为 @by
+void replaceWith(Inst *i, Inst *by)
+{
+    assert(i != by);
+    i->replacement = by;
+}
+
+/*
+ * phi 化简：输入除了自身以外都是同一个值的 phi 就是这个值。
+ * 反复进行直到不再变化，循环中的 phi 化简后，依赖它的 phi 可能也可以化简。
+ */
+void simplifyPhis(Graph *g)
+{
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (Block *b : g->rpo) {
+            for (Inst *phi : b->phis) {
+                if (phi->replacement != nullptr)
+                    continue;
+                Inst *same = nullptr;
+                bool trivial = true;
+                for (Inst *in : phi->inputs) {
+                    in = resolve(in);
+                    if (in == phi || in == same)
+                        continue;
+                    if (same != nullptr) {
+                        trivial = false;
+                        break;
+                    }
+                    same = in;
+                }
+                if (trivial && same != nullptr) {
+                    replaceWith(phi, same);
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+// 常量折叠，以及输入是常量的 IF 的化简
+void foldConstants(Graph *g)
+{
+    for (Block *b : g->rpo) {
+        for (Inst *i : b->insts) {
+            if (!(IR_ADD <= i->op && i->op <= IR_LCMP))
+                continue;
+            Inst *x = resolve(i->inputs[0]);
+            Inst *y = i->inputs.size() > 1 ? resolve(i->inputs[1]) : nullptr;
+            jlong r;
+            if (x->isConst() && (y == nullptr || y->isConst())
+                        && foldConstant(i->op, i->type, x->constant, y != nullptr ? y->constant : 0, r)) {
+                // 直接把指令改为常量，不改变它的位置
+                i->op = IR_CONST;
+                i->constant = r;
+                i->inputs.clear();
+            }
+        }
+
+        Inst *t = b->terminator();
+        if (t->op == IR_IF) {
+            Inst *x = resolve(t->inputs[0]), *y = resolve(t->inputs[1]);
+            if (!x->isConst() || !y->isConst())
+                continue;
+            bool taken;
+            switch (t->aux) {
+                case CC_EQ: taken = x->constant == y->constant; break;
+                case CC_NE: taken = x->constant != y->constant; break;
+                case CC_LT: taken = x->constant <  y->constant; break;
+                case CC_GE: taken = x->constant >= y->constant; break;
+                case CC_GT: taken = x->constant >  y->constant; break;
+                case CC_LE: taken = x->constant <= y->constant; break;
+                default: continue;
+            }
+            // 删掉不走的那条边
+            Block *dead = b->succs[taken ? 1 : 0];
+            auto it = find(dead->preds.begin(), dead->preds.end(), b);
+            size_t k = it - dead->preds.begin();
+            dead->preds.erase(it);
+            for (Inst *phi : dead->phis)
+                phi->inputs.erase(phi->inputs.begin() + k);
+            b->succs.erase(b->succs.begin() + (taken ? 1 : 0));
+            t->op = IR_GOTO;
+            t->inputs.clear();
+        }
+    }
+}
+
+struct ValueKey {
+    IROp op;
+    IRType type;
+    int aux;
+    Inst *x, *y;
+    Field *field;
+
+    bool operator==(const ValueKey &o) const
+    {
+        return op == o.op && type == o.type && aux == o.aux && x == o.x && y == o.y && field == o.field;
+    }
+};
+
+struct ValueKeyHash {
+    size_t operator()(const ValueKey &k) const
+    {
+        size_t h = std::hash<void *>()(k.x) * 31 + std::hash<void *>()(k.y);
+        return h * 31 + ((size_t) k.op << 16 | (size_t) k.type << 8 | (size_t) k.aux);
+    }
+};
+
+bool isCommutative(IROp op)
+{
+    return op == IR_ADD || op == IR_MUL || op == IR_AND || op == IR_OR || op == IR_XOR;
+}
+
+ValueKey keyOf(Inst *i)
+{
+    ValueKey k{ i->op, i->type, i->aux, nullptr, nullptr, i->field };
+    if (i->op == IR_CONST) {
+        k.x = reinterpret_cast<Inst *>(i->constant); // 常量以值为键
+        return k;
+    }
+    if (!i->inputs.empty())
+        k.x = resolve(i->inputs[0]);
+    if (i->inputs.size() > 1)
+        k.y = resolve(i->inputs[1]);
+    if (isCommutative(i->op) && k.x > k.y)
+        swap(k.x, k.y);
+    return k;
+}
+
+/*
+ * 全局值编号（GVN）：沿支配树遍历，被支配的块中与支配块中相同的纯运算被替换掉。
+ * 字段和数组元素的读取只在基本块内编号，遇到写操作时清空。
+ */
+void numberValues(Graph *g)
+{
+    unordered_map<ValueKey, Inst *, ValueKeyHash> table;
+
+    function<void(Block *)> walk = [&](Block *b) {
+        vector<ValueKey> added;
+        unordered_map<ValueKey, Inst *, ValueKeyHash> loads;
+
+        for (Inst *i : b->insts) {
+            if (i->replacement != nullptr)
+                continue;
+            if (i->isPure()) {
+                ValueKey k = keyOf(i);
+                auto it = table.find(k);
+                if (it != table.end()) {
+                    replaceWith(i, it->second);
+                } else {
+                    table.emplace(k, i);
+                    added.push_back(k);
+                }
+            } else if (i->op == IR_GET_FIELD || i->op == IR_GET_STATIC || i->op == IR_ARRAY_LOAD) {
+                ValueKey k = keyOf(i);
+                auto it = loads.find(k);
+                if (it != loads.end())
+                    replaceWith(i, it->second);
+                else
+                    loads.emplace(k, i);
+            } else if (i->op == IR_PUT_FIELD || i->op == IR_PUT_STATIC || i->op == IR_ARRAY_STORE) {
+                loads.clear();
+            }
+        }
+
+        for (Block *c : b->dom_children)
+            walk(c);
+        for (auto &k : added)
+            table.erase(k);
+    };
+    walk(g->entry);
+}
+
+// 沿支配树记录已知的事实
+struct Facts {
+    unordered_set<Inst *> non_null;                  // 已知不为 null 的值
+    unordered_set<Inst *> non_zero;                  // 已知不为0的值
+    unordered_map<Inst *, Class *> exact_class;      // 已检查过类型的值
+    unordered_set<Inst *> non_negative;              // 已知 >= 0 的 int
+    vector<pair<Inst *, Inst *>> less_than;          // (i, len)：已知 i < len
+    vector<pair<Inst *, Inst *>> checked_bounds;     // (array, index)：已检查过的数组下标
+};
+
+/*
+ * 判断 int 值 @v 是否非负。
+ * 除了常量、数组长度和已知的事实以外，还识别形如 i = phi(init, i + 1) 的循环归纳变量：
+ * init 非负，并且 i + 1 不会溢出（见 CheckEliminator::no_overflow）。
+ */
+bool nonNegative(const Facts &f, const unordered_set<Inst *> &no_overflow, Inst *v)
+{
+    if (v->isConst())
+        return (jint) v->constant >= 0;
+    if (v->op == IR_ARRAY_LENGTH || v->op == IR_I2C || f.non_negative.count(v) > 0)
+        return true;
+    if (v->op == IR_AND && v->inputs[1]->isConst() && (jint) v->inputs[1]->constant >= 0)
+        return true;
+    if (v->op == IR_USHR && v->inputs[1]->isConst() && (v->inputs[1]->constant & 0x1f) != 0)
+        return true;
+
+    if (v->op == IR_PHI && v->type == T_INT) {
+        for (Inst *in : v->inputs) {
+            if (in == v)
+                continue;
+            if (in->op == IR_ADD && in->inputs[0] == v && no_overflow.count(in) > 0)
+                continue;
+            if (in->op == IR_PHI || !nonNegative(f, no_overflow, in))
+                return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+/*
+ * 检查消除：沿支配树遍历，支配当前块的块中已经做过的检查不必重做，
+ * 条件分支的结果也提供事实：if (x != null)、if (i < a.length)、if (i >= 0) 等。
+ */
+class CheckEliminator {
+    Graph *g;
+    Facts facts;
+
+    // 不会溢出的 i + 1：所在处已知 i < X。由第一遍遍历收集，第二遍遍历才消除检查
+    unordered_set<Inst *> no_overflow;
+    bool collecting = true;
+
+    // 基本块 @b 唯一的前驱是 IF 时，从 IF 的条件得到的事实
+    void addBranchFacts(Block *b, Facts &f)
+    {
+        if (b->preds.size() != 1)
+            return;
+        Block *p = b->preds[0];
+        Inst *t = p->terminator();
+        if (t->op != IR_IF || p->succs.size() != 2 || p->succs[0] == p->succs[1])
+            return;
+
+        auto cc = (Condition) t->aux;
+        if (b == p->succs[1]) {
+            // 条件不成立的分支
+            switch (cc) {
+                case CC_EQ: cc = CC_NE; break;
+                case CC_NE: cc = CC_EQ; break;
+                case CC_LT: cc = CC_GE; break;
+                case CC_GE: cc = CC_LT; break;
+                case CC_GT: cc = CC_LE; break;
+                case CC_LE: cc = CC_GT; break;
+                default: return;
+            }
+        }
+
+        Inst *x = t->inputs[0], *y = t->inputs[1];
+        if (x->type == T_REF) {
+            if (cc == CC_NE && y->isConst() && y->constant == 0)
+                f.non_null.insert(x);
+            return;
+        }
+        if (x->type != T_INT)
+            return;
+        if (cc == CC_NE && y->isConst() && y->constant == 0)
+            f.non_zero.insert(x);
+        // 规范化为 a < b 或 a >= b 的形式
+        if (cc == CC_GT) {
+            swap(x, y);
+            cc = CC_LT;
+        } else if (cc == CC_LE) {
+            swap(x, y);
+            cc = CC_GE;
+        }
+        if (cc == CC_LT)
+            f.less_than.emplace_back(x, y);
+        if (cc == CC_GE && y->isConst() && (jint) y->constant >= 0)
+            f.non_negative.insert(x);
+    }
+
+    void walk(Block *b)
+    {
+        Facts saved = facts;
+        addBranchFacts(b, facts);
+
+        for (Inst *i : b->insts) {
+            if (i->op == IR_ADD && i->type == T_INT && i->inputs[1]->isConst() && i->inputs[1]->constant == 1) {
+                for (auto &fact : facts.less_than) {
+                    if (fact.first == i->inputs[0]) {
+                        no_overflow.insert(i);
+                        break;
+                    }
+                }
+            }
+            if (!i->isCheck())
+                continue;
+            Inst *x = i->inputs[0];
+            bool redundant = false;
+            switch (i->op) {
+                case IR_NULL_CHECK:
+                    redundant = (x->op == IR_PARAM && x->constant == 0 && !g->method->isStatic())
+                                || facts.non_null.count(x) > 0;
+                    facts.non_null.insert(x);
+                    break;
+                case IR_ZERO_CHECK:
+                    redundant = (x->isConst() && x->constant != 0) || facts.non_zero.count(x) > 0;
+                    facts.non_zero.insert(x);
+                    break;
+                case IR_CLASS_CHECK: {
+                    auto it = facts.exact_class.find(x);
+                    redundant = it != facts.exact_class.end() && it->second == i->klass;
+                    facts.exact_class[x] = i->klass;
+                    break;
+                }
+                case IR_BOUNDS_CHECK: {
+                    Inst *index = i->inputs[1];
+                    auto key = make_pair(x, index);
+                    if (find(facts.checked_bounds.begin(), facts.checked_bounds.end(), key)
+                                != facts.checked_bounds.end()) {
+                        redundant = true;
+                    } else {
+                        // 范围检查消除：0 <= index < x.length
+                        for (auto &[v, len] : facts.less_than) {
+                            if (v == index && len->op == IR_ARRAY_LENGTH && len->inputs[0] == x) {
+                                redundant = nonNegative(facts, no_overflow, index);
+                                break;
+                            }
+                        }
+                        if (!redundant && index->isConst() && (jint) index->constant >= 0) {
+                            // 常量下标：a[k] 已检查过且 k' <= k
+                            for (auto &[arr, k] : facts.checked_bounds) {
+                                if (arr == x && k->isConst() && (jint) k->constant >= (jint) index->constant) {
+                                    redundant = true;
+                                    break;
+                                }
+                            }
+                        }
+                        facts.checked_bounds.push_back(key);
+                    }
+                    // 检查之后 0 <= index < x.length
+                    facts.less_than.emplace_back(index, x);
+                    facts.non_negative.insert(index);
+                    break;
+                }
+                default:
+                    break;
+            }
+            if (redundant && !collecting)
+                i->removed = true;
+        }
+
+        for (Block *c : b->dom_children)
+            walk(c);
+        facts = move(saved);
+    }
+
+public:
+    explicit CheckEliminator(Graph *g): g(g) { }
+
+    void run()
+    {
+        walk(g->entry);
+        collecting = false;
+        walk(g->entry);
+    }
+};
+
+// 删除没有被使用的纯运算（包括 FrameState 中的使用）
+void eliminateDeadCode(Graph *g)
+{
+    unordered_set<Inst *> live;
+    vector<Inst *> work;
+    auto mark = [&](Inst *v) {
+        v = resolve(v);
+        if (v != nullptr && live.insert(v).second)
+            work.push_back(v);
+    };
+
+    for (Block *b : g->rpo) {
+        for (Inst *i : b->insts) {
+            if (i->removed || i->replacement != nullptr)
+                continue;
+            if (!i->isPure() && i->op != IR_PARAM)
+                mark(i);
+        }
+    }
+    while (!work.empty()) {
+        Inst *i = work.back();
+        work.pop_back();
+        for (Inst *in : i->inputs)
+            mark(in);
+        if (i->state != nullptr) {
+            for (Inst *v : i->state->locals)
+                mark(v);
+            for (Inst *v : i->state->stack)
+                mark(v);
+        }
+    }
+
+    for (Block *b : g->rpo) {
+        for (Inst *i : b->phis) {
+            if (live.count(i) == 0)
+                i->removed = true;
+        }
+        for (Inst *i : b->insts) {
+            if ((i->isPure() || i->op == IR_PARAM) && live.count(i) == 0)
+                i->removed = true;
+        }
+    }
+}
+
+} // namespace
+
+void optimizeGraph(Graph *g)
+{
+    g->computeDominators();
+
+    /*
+     * 无效的 phi（输入中有未定义的值）以及以它为输入的 phi 只可能出现在 FrameState 中，
+     * 对应的 slot 在解释器中也是未定义的，不用写回，直接删掉。
+     */
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (Block *b : g->rpo) {
+            for (Inst *phi : b->phis) {
+                if (phi->invalid)
+                    continue;
+                for (Inst *in : phi->inputs) {
+                    if (in->op == IR_PHI && in->invalid) {
+                        phi->invalid = changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    for (Block *b : g->rpo) {
+        for (Inst *phi : b->phis) {
+            if (phi->invalid)
+                phi->removed = true;
+        }
+    }
+    g->resolveReplacements();
+
+    simplifyPhis(g);
+    g->resolveReplacements();
+
+    foldConstants(g);
+    g->computeDominators(); // 化简 IF 之后控制流可能改变了
+    simplifyPhis(g);
+    g->resolveReplacements();
+
+    numberValues(g);
+    g->resolveReplacements();
+    simplifyPhis(g);
+    g->resolveReplacements();
+
+    CheckEliminator(g).run();
+    g->resolveReplacements();
+
+    eliminateDeadCode(g);
+    g->resolveReplacements();
+}
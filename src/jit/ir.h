@@ -0,0 +1,220 @@
+#ifndef CABIN_IR_H
+#define CABIN_IR_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "../cabin.h"
+
+class Method;
+class Class;
+class Field;
+struct Block;
+
+/*
+ * 优化编译器的中间表示（IR）
+ *
+ * 字节码被翻译为 SSA 形式的控制流图：每个值（Inst）只定义一次，
+ * 操作数栈和局部变量在翻译时被消除，控制流汇合处的值用 phi 合并。
+ *
+ * 可能失败的操作（空指针、数组越界、除零、内联时的类型守卫）被拆成单独的检查指令，
+ * 检查失败时不在编译后的代码中抛出异常，而是去优化（deoptimize）：
+ * 把检查指令所在位置的局部变量和操作数栈（FrameState）写回解释器的 frame，
+ * 从该字节码处开始解释执行，由解释器重新执行这条指令并抛出异常。
+ * 所以检查指令之间的优化不需要考虑异常的语义。
+ */
+
+enum IRType: u1 {
+    T_VOID, T_INT, T_LONG, T_REF,
+};
+
+enum IROp: u1 {
+    IR_CONST,          // constant
+    IR_PARAM,          // 方法入口处的局部变量，constant 为其下标
+    IR_PHI,
+
+    // 算术运算，类型由 Inst::type 决定（int 或 long）
+    IR_ADD, IR_SUB, IR_MUL, IR_DIV, IR_REM, IR_NEG,
+    IR_AND, IR_OR, IR_XOR, IR_SHL, IR_SHR, IR_USHR,
+    IR_I2L, IR_L2I, IR_I2B, IR_I2C, IR_I2S,
+    IR_LCMP,
+
+    IR_ARRAY_LENGTH,   // (array)
+    IR_ARRAY_LOAD,     // (array, index)，aux 为元素的类型（ArrayElement）
+    IR_ARRAY_STORE,    // (array, index, value)
+    IR_GET_FIELD,      // (object)，field
+    IR_PUT_FIELD,      // (object, value)
+    IR_GET_STATIC,     // field
+    IR_PUT_STATIC,     // (value)
+
+    // 检查失败时去优化，state 为去优化时的状态
+    IR_NULL_CHECK,     // (object)
+    IR_BOUNDS_CHECK,   // (array, index)，array 已检查过不为 null
+    IR_ZERO_CHECK,     // (divisor)
+    IR_CLASS_CHECK,    // (object)，object 的类型必须是 klass，object 已检查过不为 null
+    IR_CHA_CHECK,      // (object)，method 仍只有一个实现（见 metadata/cha.h），object 是以此内联的调用的接收者
+
+    IR_SAFEPOINT,      // 回边上的安全点轮询（见 runtime/safepoint.h），有停顿请求时按 state 退出到解释器
+
+    // 基本块的结尾
+    IR_IF,             // (x, y)，aux 为比较的条件（Condition），succs[0] 为条件成立时的后继
+    IR_GOTO,
+    IR_RETURN,         // (value) 或者 ()
+};
+
+// 数组元素的类型
+enum ArrayElement: u1 {
+    ELE_BYTE, ELE_CHAR, ELE_SHORT, ELE_INT, ELE_LONG, ELE_REF,
+};
+
+struct Inst;
+
+// 去优化时解释器的状态，值为 nullptr 的 slot 不需要写回
+struct FrameState {
+    u4 pc;
+    std::vector<Inst *> locals;
+    std::vector<Inst *> stack;
+};
+
+struct Inst {
+    IROp op;
+    IRType type;
+    int id;
+    Block *block = nullptr;
+    std::vector<Inst *> inputs;
+
+    jlong constant = 0;
+    int aux = 0;
+    Field *field = nullptr;
+    Class *klass = nullptr;
+    Method *method = nullptr;
+    FrameState *state = nullptr;
+
+    // phi 是否无效：汇合的值有未定义或者类型不同的，verifier 保证这样的值不会被使用
+    bool invalid = false;
+
+    // 被替换后的值（phi 化简、常量折叠、GVN），见 resolve()
+    Inst *replacement = nullptr;
+    bool removed = false;
+
+    // 寄存器分配的结果，见 linear_scan.cpp
+    int location = -1;
+
+    Inst(IROp op, IRType type, int id): op(op), type(type), id(id) { }
+
+    [[nodiscard]] bool isConst() const { return op == IR_CONST; }
+    [[nodiscard]] bool isCheck() const { return IR_NULL_CHECK <= op && op <= IR_CHA_CHECK; }
+    [[nodiscard]] bool isTerminator() const { return op >= IR_IF; }
+
+    // 没有副作用，结果只取决于输入，可以被删除或合并
+    [[nodiscard]] bool isPure() const
+    {
+        return (IR_ADD <= op && op <= IR_LCMP) || op == IR_ARRAY_LENGTH || op == IR_CONST;
+    }
+};
+
+static inline Inst *resolve(Inst *v)
+{
+    while (v != nullptr && v->replacement != nullptr)
+        v = v->replacement;
+    return v;
+}
+
+struct Block {
+    int id;
+    std::vector<Inst *> phis;  // phi 的 inputs 与 preds 一一对应
+    std::vector<Inst *> insts; // 最后一条是 IR_IF, IR_GOTO 或 IR_RETURN
+    std::vector<Block *> preds;
+    std::vector<Block *> succs;
+
+    // 见 Graph::computeDominators()
+    int rpo = -1;
+    Block *idom = nullptr;
+    std::vector<Block *> dom_children;
+
+    // 生成代码时的位置
+    size_t label = 0;
+
+    explicit Block(int id): id(id) { }
+
+    [[nodiscard]] Inst *terminator() const
+    {
+        return insts.empty() || !insts.back()->isTerminator() ? nullptr : insts.back();
+    }
+
+    [[nodiscard]] bool dominatedBy(const Block *b) const
+    {
+        for (const Block *x = this; x != nullptr; x = x->idom) {
+            if (x == b)
+                return true;
+        }
+        return false;
+    }
+};
+
+struct Graph {
+    Method *method;
+    Block *entry = nullptr;
+    std::vector<std::unique_ptr<Block>> blocks;
+    std::vector<std::unique_ptr<Inst>> insts;
+    std::vector<std::unique_ptr<FrameState>> states;
+
+    std::vector<Block *> rpo; // 可达的基本块，按逆后序排列
+
+    // 内联时假定只有一个实现的方法，编译的代码依赖于这些假设。见 metadata/cha.h
+    std::vector<Method *> cha_dependencies;
+
+    explicit Graph(Method *m): method(m) { }
+
+    Block *newBlock()
+    {
+        blocks.push_back(std::make_unique<Block>((int) blocks.size()));
+        return blocks.back().get();
+    }
+
+    Inst *newInst(IROp op, IRType type)
+    {
+        insts.push_back(std::make_unique<Inst>(op, type, (int) insts.size()));
+        return insts.back().get();
+    }
+
+    FrameState *newState()
+    {
+        states.push_back(std::make_unique<FrameState>());
+        return states.back().get();
+    }
+
+    static void link(Block *from, Block *to)
+    {
+        from->succs.push_back(to);
+        to->preds.push_back(from);
+    }
+
+    void computeRPO();
+    void computeDominators();
+
+    // 拆分关键边（从有多个后继的块到有多个前驱的块的边），phi 的 move 放在拆出的块中
+    void splitCriticalEdges();
+
+    // 把所有 inputs 和 FrameState 中被替换了的值换成替换后的值
+    void resolveReplacements();
+
+    [[nodiscard]] std::string toString() const;
+};
+
+/*
+ * 把方法 @m 的字节码翻译为 SSA 形式的 IR，同时内联被调用的小方法。
+ * 方法中有不支持的指令时返回 nullptr。
+ */
+std::unique_ptr<Graph> buildGraph(Method *m);
+
+/*
+ * 计算常量运算 @op 的结果，@type 为运算结果的类型。
+ * 不能在编译时计算（比如除数为0）时返回 false。
+ */
+bool foldConstant(IROp op, IRType type, jlong x, jlong y, jlong &result);
+
+// 在 IR 上做优化：phi 化简、常量折叠、GVN、空指针检查和数组边界检查的消除、死代码删除
+void optimizeGraph(Graph *g);
+
+#endif //CABIN_IR_H
@@ -0,0 +1,1036 @@
+#include <algorithm>
+#include "ir.h"
+#include "assembler.h"
+#include "../classfile/bytecode_reader.h"
+#include "../classfile/constants.h"
+#include "../interpreter/inline_cache.h"
+#include "../interpreter/method_profile.h"
+#include "../metadata/class.h"
+#include "../metadata/field.h"
+#include "../metadata/method.h"
+
+using namespace std;
+
+// 被内联的方法的字节码的最大长度
+#define MAX_INLINE_SIZE 35
+
+// 最大的内联深度
+#define MAX_INLINE_DEPTH 3
+
+namespace {
+
+// 遇到不支持的指令，放弃编译
+struct Bailout { };
+
+[[noreturn]] void bailout()
+{
+    throw Bailout();
+}
+
+const u1 opcode_length[JVM_OPC_MAX + 1] = JVM_OPCODE_LENGTH_INITIALIZER;
+
+// 描述符中的类型，float 和 double 不支持
+IRType typeOf(char descriptor)
+{
+    switch (descriptor) {
+        case 'V': return T_VOID;
+        case 'J': return T_LONG;
+        case 'L': case '[': return T_REF;
+        case 'F': case 'D': bailout();
+        default: return T_INT;
+    }
+}
+
+// 解析方法描述符，返回参数的类型（不含 this）和返回值的类型
+IRType parseDescriptor(const char *descriptor, vector<IRType> &args)
+{
+    const char *p = descriptor;
+    assert(*p == '(');
+    p++;
+    while (*p != ')') {
+        args.push_back(typeOf(*p));
+        while (*p == '[')
+            p++;
+        if (*p == 'L') {
+            while (*p != ';')
+                p++;
+        }
+        p++;
+    }
+    return typeOf(p[1]);
+}
+
+struct State {
+    vector<Inst *> locals;
+    vector<Inst *> stack; // long 占两个 slot，第二个 slot 为 nullptr
+};
+
+/*
+ * 把一个方法（被编译的方法或者被内联的方法）的字节码翻译为 IR。
+ *
+ * 先把字节码划分为基本块，按逆后序逐块抽象解释：
+ * 局部变量和操作数栈中保存的是 IR 的值，指令从中取出输入，把结果放回去。
+ * 基本块入口处的状态由前驱的出口状态合并而成，值不同的 slot 用 phi 合并。
+ * 循环头在其回边的前驱还没有翻译时就要确定入口状态，所以为每个 slot 都先建一个 phi，
+ * 回边翻译完后补上 phi 的输入，多余的 phi 在优化时化简掉。
+ */
+class Parser {
+    Graph *g;
+    Method *m;
+    ConstantPool &cp;
+    Parser *caller;
+    int depth;
+
+    // 被内联的实例方法的接收者，调用者已经检查过它不为 null
+    Inst *receiver;
+
+    struct BCBlock {
+        size_t start = 0, end = 0; // [start, end)
+        vector<int> succs;
+        Block *entry = nullptr;    // 对应的 IR 基本块
+        int rpo = -1;
+        bool is_loop_header = false;
+        bool processed = false;
+        vector<State> incoming;    // 与 entry->preds 一一对应
+        vector<Inst *> phis;       // 循环头中各 slot 的 phi，下标同 State 的 slot（先 locals 后 stack）
+    };
+    vector<BCBlock> bbs;
+    vector<int> bb_at; // 字节码的 pc 到 bbs 下标的映射，不是基本块开头的 pc 为 -1
+
+    Block *cur = nullptr;
+    State st;
+    size_t pc = 0;
+
+public:
+    // 被内联的方法中各个返回点的基本块和返回值
+    vector<pair<Block *, Inst *>> returns;
+
+    Parser(Graph *g, Method *m, Parser *caller, int depth, Inst *receiver)
+            : g(g), m(m), cp(m->clazz->cp), caller(caller), depth(depth), receiver(receiver) { }
+
+    // 从基本块 @pred 进入本方法，入口处的局部变量为 @entry
+    void parse(Block *pred, const State &entry);
+
+private:
+    void findBlocks();
+    void computeOrder();
+    void startBlock(BCBlock &bb);
+    void jumpTo(size_t target_pc);
+    void parseInstruction(BytecodeReader &r);
+
+    [[nodiscard]] bool isRoot() const { return caller == nullptr; }
+
+    Inst *emit(IROp op, IRType type, initializer_list<Inst *> inputs = {})
+    {
+        Inst *i = g->newInst(op, type);
+        i->inputs = inputs;
+        i->block = cur;
+        cur->insts.push_back(i);
+        return i;
+    }
+
+    Inst *constant(IRType type, jlong v)
+    {
+        Inst *i = emit(IR_CONST, type);
+        i->constant = type == T_INT ? (jint) v : v;
+        return i;
+    }
+
+    Inst *arith(IROp op, IRType type, Inst *x, Inst *y = nullptr)
+    {
+        jlong r;
+        if (x->isConst() && (y == nullptr || y->isConst())
+                    && foldConstant(op, type, x->constant, y != nullptr ? y->constant : 0, r)) {
+            return constant(type, r);
+        }
+        return y != nullptr ? emit(op, type, { x, y }) : emit(op, type, { x });
+    }
+
+    void push(Inst *v)
+    {
+        st.stack.push_back(v);
+        if (v->type == T_LONG)
+            st.stack.push_back(nullptr);
+    }
+
+    Inst *pop(IRType type)
+    {
+        if (type == T_LONG) {
+            if (st.stack.size() < 2 || st.stack.back() != nullptr)
+                bailout();
+            st.stack.pop_back();
+        }
+        if (st.stack.empty())
+            bailout();
+        Inst *v = st.stack.back();
+        st.stack.pop_back();
+        if (v == nullptr || v->type != type)
+            bailout();
+        return v;
+    }
+
+    // 操作数栈上从栈顶数第 @n 个 slot 中的值（n 从 0 开始）
+    Inst *peek(size_t n)
+    {
+        if (n >= st.stack.size())
+            bailout();
+        return st.stack[st.stack.size() - 1 - n];
+    }
+
+    Inst *popSlot()
+    {
+        if (st.stack.empty())
+            bailout();
+        Inst *v = st.stack.back();
+        st.stack.pop_back();
+        return v;
+    }
+
+    void load(size_t index, IRType type)
+    {
+        if (index >= st.locals.size())
+            bailout();
+        Inst *v = st.locals[index];
+        if (v == nullptr || v->type != type)
+            bailout();
+        push(v);
+    }
+
+    void store(size_t index, IRType type)
+    {
+        Inst *v = pop(type);
+        size_t n = type == T_LONG ? 2 : 1;
+        if (index + n > st.locals.size())
+            bailout();
+        // 覆盖了某个 long 的第二个 slot，这个 long 就不再有效了
+        if (index > 0 && st.locals[index - 1] != nullptr && st.locals[index - 1]->type == T_LONG)
+            st.locals[index - 1] = nullptr;
+        st.locals[index] = v;
+        if (n == 2)
+            st.locals[index + 1] = nullptr;
+    }
+
+    FrameState *snapshot()
+    {
+        FrameState *s = g->newState();
+        s->pc = (u4) pc;
+        s->locals = st.locals;
+        s->stack = st.stack;
+        return s;
+    }
+
+    /*
+     * 生成检查指令，状态为执行当前指令之前的状态。
+     * 被内联的方法中不能去优化（解释器中没有它的 frame），只能省去可以证明不会失败的检查。
+     */
+    Inst *check(IROp op, Inst *x, Inst *y = nullptr, Class *klass = nullptr)
+    {
+        if (!isRoot()) {
+            if (op == IR_NULL_CHECK && x == receiver)
+                return nullptr;
+            bailout();
+        }
+        Inst *c = y != nullptr ? emit(op, T_VOID, { x, y }) : emit(op, T_VOID, { x });
+        c->klass = klass;
+        c->state = snapshot();
+        return c;
+    }
+
+    Field *resolvedField(u2 index, bool is_static)
+    {
+        if (cp.getType(index) != JVM_CONSTANT_ResolvedField)
+            bailout();
+        auto field = cp.resolved<Field *>(index);
+        if (field->isStatic() != is_static || field->isVolatile())
+            bailout();
+        if (is_static && !field->clazz->inited)
+            bailout();
+        return field;
+    }
+
+    void arrayLoad(ArrayElement e, IRType type)
+    {
+        Inst *index = peek(0), *arr = peek(1);
+        check(IR_NULL_CHECK, arr);
+        check(IR_BOUNDS_CHECK, arr, index);
+        pop(T_INT);
+        pop(T_REF);
+        Inst *v = emit(IR_ARRAY_LOAD, type, { arr, index });
+        v->aux = e;
+        push(v);
+    }
+
+    void arrayStore(ArrayElement e, IRType type)
+    {
+        size_t n = type == T_LONG ? 2 : 1;
+        Inst *index = peek(n), *arr = peek(n + 1);
+        check(IR_NULL_CHECK, arr);
+        check(IR_BOUNDS_CHECK, arr, index);
+        Inst *value = pop(type);
+        pop(T_INT);
+        pop(T_REF);
+        emit(IR_ARRAY_STORE, T_VOID, { arr, index, value })->aux = e;
+    }
+
+    void divide(IROp op, IRType type)
+    {
+        Inst *y = peek(type == T_LONG ? 1 : 0);
+        if (!y->isConst() || y->constant == 0)
+            check(IR_ZERO_CHECK, y);
+        y = pop(type);
+        Inst *x = pop(type);
+        push(arith(op, type, x, y));
+    }
+
+    /*
+     * 在回边（向后的跳转指令）之前轮询安全点，状态为执行跳转指令之前的状态。
+     * 被内联的方法中不能退出到解释器，含有循环的方法不内联。
+     */
+    void safepointPoll(size_t target)
+    {
+        if (target > pc)
+            return;
+        if (!isRoot())
+            bailout();
+        emit(IR_SAFEPOINT, T_VOID)->state = snapshot();
+    }
+
+    void branch(Condition cc, Inst *x, Inst *y, size_t target)
+    {
+        emit(IR_IF, T_VOID, { x, y })->aux = cc;
+        jumpTo(target);
+        jumpTo(pc + 3); // 条件分支的指令长度都是3
+    }
+
+    void invoke(u1 opcode, u2 index);
+};
+
+void Parser::findBlocks()
+{
+    bb_at.assign(m->code_len, -1);
+    vector<bool> leader(m->code_len + 1, false);
+    leader[0] = true;
+
+    BytecodeReader r(m->code, m->code_len);
+    while (r.hasMore()) {
+        size_t p = r.pc;
+        u1 opcode = r.readu1();
+        size_t len = opcode_length[opcode];
+        switch (opcode) {
+            case JVM_OPC_ifeq: case JVM_OPC_ifne: case JVM_OPC_iflt:
+            case JVM_OPC_ifge: case JVM_OPC_ifgt: case JVM_OPC_ifle:
+            case JVM_OPC_if_icmpeq: case JVM_OPC_if_icmpne: case JVM_OPC_if_icmplt:
+            case JVM_OPC_if_icmpge: case JVM_OPC_if_icmpgt: case JVM_OPC_if_icmple:
+            case JVM_OPC_if_acmpeq: case JVM_OPC_if_acmpne:
+            case JVM_OPC_ifnull: case JVM_OPC_ifnonnull:
+            case JVM_OPC_goto: {
+                size_t target = p + r.reads2();
+                if (target >= m->code_len)
+                    bailout();
+                leader[target] = true;
+                leader[p + len] = true;
+                continue;
+            }
+            case JVM_OPC_goto_w: {
+                size_t target = p + r.reads4();
+                if (target >= m->code_len)
+                    bailout();
+                leader[target] = true;
+                leader[p + len] = true;
+                continue;
+            }
+            case JVM_OPC_ireturn: case JVM_OPC_lreturn: case JVM_OPC_areturn: case JVM_OPC_return:
+                leader[p + len] = true;
+                break;
+            case JVM_OPC_wide:
+                len = r.readu1() == JVM_OPC_iinc ? 6 : 4;
+                break;
+            case JVM_OPC_tableswitch: case JVM_OPC_lookupswitch:
+            case JVM_OPC_jsr: case JVM_OPC_jsr_w: case JVM_OPC_ret:
+                bailout();
+            default:
+                if (len == 0)
+                    bailout();
+                break;
+        }
+        r.pc = p + len;
+    }
+
+    for (size_t p = 0; p < m->code_len; p++) {
+        if (leader[p]) {
+            bb_at[p] = (int) bbs.size();
+            bbs.emplace_back();
+            bbs.back().start = p;
+        }
+    }
+    for (size_t i = 0; i < bbs.size(); i++) {
+        bbs[i].end = i + 1 < bbs.size() ? bbs[i + 1].start : m->code_len;
+    }
+}
+
+// 计算字节码基本块之间的边和逆后序，找出循环头
+void Parser::computeOrder()
+{
+    for (auto &bb : bbs) {
+        // 找到块中最后一条指令
+        BytecodeReader r(m->code, m->code_len);
+        r.pc = bb.start;
+        size_t last = bb.start;
+        while (r.pc < bb.end) {
+            last = r.pc;
+            u1 opcode = r.readu1();
+            r.pc = opcode == JVM_OPC_wide ? last + (r.readu1() == JVM_OPC_iinc ? 6 : 4) : last + opcode_length[opcode];
+        }
+
+        r.pc = last;
+        u1 opcode = r.readu1();
+        if ((JVM_OPC_ifeq <= opcode && opcode <= JVM_OPC_if_acmpne)
+                    || opcode == JVM_OPC_ifnull || opcode == JVM_OPC_ifnonnull) {
+            bb.succs.push_back(bb_at[last + r.reads2()]);
+            if (bb.end < m->code_len)
+                bb.succs.push_back(bb_at[bb.end]);
+        } else if (opcode == JVM_OPC_goto) {
+            bb.succs.push_back(bb_at[last + r.reads2()]);
+        } else if (opcode == JVM_OPC_goto_w) {
+            bb.succs.push_back(bb_at[last + r.reads4()]);
+        } else if (JVM_OPC_ireturn <= opcode && opcode <= JVM_OPC_return) {
+            // no successors
+        } else if (bb.end < m->code_len) {
+            bb.succs.push_back(bb_at[bb.end]);
+        }
+        for (int s : bb.succs) {
+            if (s < 0)
+                bailout(); // 跳转到了指令的中间
+        }
+    }
+
+    // 深度优先遍历求后序
+    vector<int> post;
+    vector<int> visit(bbs.size(), 0); // 0: 未访问，1: 在栈中，2: 已完成
+    vector<pair<int, size_t>> stack;
+    stack.emplace_back(0, 0);
+    visit[0] = 1;
+    while (!stack.empty()) {
+        auto &[b, i] = stack.back();
+        if (i < bbs[b].succs.size()) {
+            int s = bbs[b].succs[i++];
+            if (visit[s] == 0) {
+                visit[s] = 1;
+                stack.emplace_back(s, 0);
+            }
+        } else {
+            visit[b] = 2;
+            post.push_back(b);
+            stack.pop_back();
+        }
+    }
+
+    int n = (int) post.size();
+    for (int i = 0; i < n; i++) {
+        bbs[post[i]].rpo = n - 1 - i;
+    }
+    for (auto &bb : bbs) {
+        if (bb.rpo < 0)
+            continue;
+        for (int s : bb.succs) {
+            if (bbs[s].rpo <= bb.rpo)
+                bbs[s].is_loop_header = true;
+        }
+    }
+}
+
+void Parser::parse(Block *pred, const State &entry)
+{
+    findBlocks();
+    computeOrder();
+
+    vector<BCBlock *> order;
+    for (auto &bb : bbs) {
+        if (bb.rpo >= 0) {
+            bb.entry = g->newBlock();
+            order.push_back(&bb);
+        }
+    }
+    sort(order.begin(), order.end(), [](BCBlock *x, BCBlock *y) { return x->rpo < y->rpo; });
+
+    cur = pred;
+    st = entry;
+    emit(IR_GOTO, T_VOID);
+    jumpTo(0);
+
+    for (BCBlock *bb : order) {
+        startBlock(*bb);
+        BytecodeReader r(m->code, m->code_len);
+        r.pc = bb->start;
+        while (r.pc < bb->end && cur->terminator() == nullptr) {
+            parseInstruction(r);
+        }
+        if (cur->terminator() == nullptr) {
+            // 顺序执行到下一个基本块
+            if (bb->end >= m->code_len)
+                bailout();
+            emit(IR_GOTO, T_VOID);
+            jumpTo(bb->end);
+        }
+    }
+}
+
+// 合并前驱的出口状态，得到基本块入口处的状态
+void Parser::startBlock(BCBlock &bb)
+{
+    assert(!bb.incoming.empty());
+    cur = bb.entry;
+    bb.processed = true;
+
+    const State &first = bb.incoming[0];
+    for (auto &s : bb.incoming) {
+        if (s.stack.size() != first.stack.size() || s.locals.size() != first.locals.size())
+            bailout();
+    }
+
+    size_t nlocals = first.locals.size();
+    size_t nslots = nlocals + first.stack.size();
+    auto slot = [&](const State &s, size_t i) { return i < nlocals ? s.locals[i] : s.stack[i - nlocals]; };
+
+    State merged = first;
+    bb.phis.assign(nslots, nullptr);
+    for (size_t i = 0; i < nslots; i++) {
+        Inst *v = slot(first, i);
+        if (v == nullptr)
+            continue;
+
+        bool same = true, valid = true;
+        for (auto &s : bb.incoming) {
+            Inst *w = slot(s, i);
+            same = same && w == v;
+            valid = valid && w != nullptr && w->type == v->type;
+        }
+
+        Inst *result = v;
+        if (bb.is_loop_header || !same) {
+            if (!bb.is_loop_header && !valid) {
+                result = nullptr;
+            } else {
+                Inst *phi = g->newInst(IR_PHI, v->type);
+                phi->block = cur;
+                cur->phis.push_back(phi);
+                for (auto &s : bb.incoming) {
+                    Inst *w = slot(s, i);
+                    if (w == nullptr || w->type != v->type) {
+                        phi->invalid = true;
+                        w = phi;
+                    }
+                    phi->inputs.push_back(w);
+                }
+                result = phi;
+                bb.phis[i] = phi;
+            }
+        }
+
+        if (i < nlocals)
+            merged.locals[i] = result;
+        else
+            merged.stack[i - nlocals] = result;
+    }
+    st = merged;
+}
+
+// 当前基本块跳转到 @target_pc 处的基本块
+void Parser::jumpTo(size_t target_pc)
+{
+    assert(target_pc < m->code_len && bb_at[target_pc] >= 0);
+    BCBlock &bb = bbs[bb_at[target_pc]];
+    Graph::link(cur, bb.entry);
+
+    if (!bb.processed) {
+        bb.incoming.push_back(st);
+        return;
+    }
+
+    // 回边，补上循环头中 phi 的输入
+    assert(bb.is_loop_header);
+    const State &first = bb.incoming[0];
+    if (st.stack.size() != first.stack.size())
+        bailout();
+    size_t nlocals = st.locals.size();
+    for (size_t i = 0; i < bb.phis.size(); i++) {
+        Inst *phi = bb.phis[i];
+        if (phi == nullptr)
+            continue;
+        Inst *w = i < nlocals ? st.locals[i] : st.stack[i - nlocals];
+        if (w == nullptr || w->type != phi->type) {
+            phi->invalid = true;
+            w = phi;
+        }
+        phi->inputs.push_back(w);
+    }
+    bb.incoming.push_back(st); // 保持与 preds 的对应
+}
+
+void Parser::invoke(u1 opcode, u2 index)
+{
+    if (depth >= MAX_INLINE_DEPTH)
+        bailout();
+    u1 type = cp.getType(index);
+    if (type != JVM_CONSTANT_ResolvedMethod && type != JVM_CONSTANT_ResolvedInterfaceMethod)
+        bailout(); // 还没有解析过，说明还没有执行过
+    auto resolved = cp.resolved<Method *>(index);
+
+    Method *target = nullptr;
+    Class *guard = nullptr; // 根据接收者类型的记录内联时，守卫的类型
+    Method *assumed = nullptr; // 根据类层次分析内联时，假定只有一个实现的方法
+    switch (opcode) {
+        case JVM_OPC_invokestatic:
+            if (!resolved->isStatic() || !resolved->clazz->inited)
+                bailout();
+            target = resolved;
+            break;
+        case JVM_OPC_invokespecial:
+            if (!resolved->isPrivate() || resolved->isStatic() || resolved->isObjectInit())
+                bailout();
+            target = resolved;
+            break;
+        case JVM_OPC_invokevirtual:
+            if (resolved->isStatic())
+                bailout();
+            if (resolved->isPrivate() || resolved->isFinal() || resolved->clazz->isFinal()) {
+                target = resolved;
+                break;
+            }
+            [[fallthrough]];
+        case JVM_OPC_invokeinterface: {
+            // 已加载的类中只有一个实现时，不论接收者的类型是什么都调用它，不需要类型守卫
+            if (!resolved->polymorphic.load(memory_order_acquire)
+                        && (target = resolved->unique_impl.load(memory_order_acquire)) != nullptr) {
+                assumed = resolved;
+                break;
+            }
+            InlineCache *ic = InlineCache::peek(m, pc);
+            if (ic != nullptr && ic->monomorphic(guard, target))
+                break;
+            // 经由 vtable 分派的调用点没有内联缓存，参考解释器记录的接收者类型
+            MethodProfile *profile = m->profile.load(memory_order_acquire);
+            const TypeProfile *tp = profile != nullptr ? profile->typeAt(pc) : nullptr;
+            if (tp == nullptr || !tp->monomorphic(guard))
+                bailout();
+            target = guard->dispatch(resolved);
+            if (target == nullptr)
+                bailout();
+            break;
+        }
+        default:
+            bailout();
+    }
+
+    if (target->isNative() || target->isAbstract() || target->isSynchronized()
+                || target->code == nullptr || target->code_len > MAX_INLINE_SIZE)
+        bailout();
+    for (Parser *p = this; p != nullptr; p = p->caller) {
+        if (p->m == target)
+            bailout(); // 递归
+    }
+
+    vector<IRType> args;
+    IRType ret_type = parseDescriptor(target->descriptor, args);
+
+    size_t argc = target->arg_slot_count;
+    if (argc > st.stack.size() || target->max_locals < argc)
+        bailout();
+
+    Inst *recv = nullptr;
+    if (!target->isStatic()) {
+        recv = peek(argc - 1);
+        if (recv == nullptr || recv->type != T_REF)
+            bailout();
+        check(IR_NULL_CHECK, recv);
+        if (guard != nullptr)
+            check(IR_CLASS_CHECK, recv, nullptr, guard);
+        if (assumed != nullptr) {
+            // 编译的代码执行期间可能加载了新的实现，每次执行到这里都检查假设是否仍然成立
+            check(IR_CHA_CHECK, recv)->method = assumed;
+            g->cha_dependencies.push_back(assumed);
+        }
+    }
+
+    // 实参成为被调用方法的局部变量
+    State callee_state;
+    callee_state.locals.assign(target->max_locals, nullptr);
+    copy(st.stack.end() - argc, st.stack.end(), callee_state.locals.begin());
+    st.stack.resize(st.stack.size() - argc);
+
+    Parser callee(g, target, this, depth + 1, recv);
+    callee.parse(cur, callee_state);
+    if (callee.returns.empty())
+        bailout();
+
+    Block *cont = g->newBlock();
+    for (auto &rv : callee.returns) {
+        Graph::link(rv.first, cont);
+        if (ret_type != T_VOID && (rv.second == nullptr || rv.second->type != ret_type))
+            bailout();
+    }
+    cur = cont;
+    if (ret_type != T_VOID) {
+        // 各返回点的返回值不同时用 phi 合并
+        Inst *result = callee.returns[0].second;
+        for (auto &rv : callee.returns) {
+            if (rv.second != result) {
+                result = g->newInst(IR_PHI, ret_type);
+                result->block = cont;
+                cont->phis.push_back(result);
+                for (auto &rv2 : callee.returns)
+                    result->inputs.push_back(rv2.second);
+                break;
+            }
+        }
+        push(result);
+    }
+}
+
+void Parser::parseInstruction(BytecodeReader &r)
+{
+    pc = r.pc;
+    u1 opcode = r.readu1();
+    switch (opcode) {
+        case JVM_OPC_nop:
+            break;
+        case JVM_OPC_aconst_null:
+            push(constant(T_REF, 0));
+            break;
+        case JVM_OPC_iconst_m1: case JVM_OPC_iconst_0: case JVM_OPC_iconst_1: case JVM_OPC_iconst_2:
+        case JVM_OPC_iconst_3: case JVM_OPC_iconst_4: case JVM_OPC_iconst_5:
+            push(constant(T_INT, opcode - JVM_OPC_iconst_0));
+            break;
+        case JVM_OPC_lconst_0: case JVM_OPC_lconst_1:
+            push(constant(T_LONG, opcode - JVM_OPC_lconst_0));
+            break;
+        case JVM_OPC_bipush:
+            push(constant(T_INT, r.reads1()));
+            break;
+        case JVM_OPC_sipush:
+            push(constant(T_INT, r.reads2()));
+            break;
+        case JVM_OPC_ldc:
+        case JVM_OPC_ldc_w: {
+            u2 index = opcode == JVM_OPC_ldc ? r.readu1() : r.readu2();
+            if (cp.getType(index) != JVM_CONSTANT_Integer)
+                bailout();
+            push(constant(T_INT, cp.getInt(index)));
+            break;
+        }
+        case JVM_OPC_ldc2_w: {
+            u2 index = r.readu2();
+            if (cp.getType(index) != JVM_CONSTANT_Long)
+                bailout();
+            push(constant(T_LONG, cp.getLong(index)));
+            break;
+        }
+
+        case JVM_OPC_iload: load(r.readu1(), T_INT); break;
+        case JVM_OPC_lload: load(r.readu1(), T_LONG); break;
+        case JVM_OPC_aload: load(r.readu1(), T_REF); break;
+        case JVM_OPC_iload_0: case JVM_OPC_iload_1: case JVM_OPC_iload_2: case JVM_OPC_iload_3:
+            load(opcode - JVM_OPC_iload_0, T_INT);
+            break;
+        case JVM_OPC_lload_0: case JVM_OPC_lload_1: case JVM_OPC_lload_2: case JVM_OPC_lload_3:
+            load(opcode - JVM_OPC_lload_0, T_LONG);
+            break;
+        case JVM_OPC_aload_0: case JVM_OPC_aload_1: case JVM_OPC_aload_2: case JVM_OPC_aload_3:
+            load(opcode - JVM_OPC_aload_0, T_REF);
+            break;
+        case JVM_OPC_istore: store(r.readu1(), T_INT); break;
+        case JVM_OPC_lstore: store(r.readu1(), T_LONG); break;
+        case JVM_OPC_astore: store(r.readu1(), T_REF); break;
+        case JVM_OPC_istore_0: case JVM_OPC_istore_1: case JVM_OPC_istore_2: case JVM_OPC_istore_3:
+            store(opcode - JVM_OPC_istore_0, T_INT);
+            break;
+        case JVM_OPC_lstore_0: case JVM_OPC_lstore_1: case JVM_OPC_lstore_2: case JVM_OPC_lstore_3:
+            store(opcode - JVM_OPC_lstore_0, T_LONG);
+            break;
+        case JVM_OPC_astore_0: case JVM_OPC_astore_1: case JVM_OPC_astore_2: case JVM_OPC_astore_3:
+            store(opcode - JVM_OPC_astore_0, T_REF);
+            break;
+
+        case JVM_OPC_iaload: arrayLoad(ELE_INT, T_INT); break;
+        case JVM_OPC_laload: arrayLoad(ELE_LONG, T_LONG); break;
+        case JVM_OPC_aaload: arrayLoad(ELE_REF, T_REF); break;
+        case JVM_OPC_baload: arrayLoad(ELE_BYTE, T_INT); break;
+        case JVM_OPC_caload: arrayLoad(ELE_CHAR, T_INT); break;
+        case JVM_OPC_saload: arrayLoad(ELE_SHORT, T_INT); break;
+        case JVM_OPC_iastore: arrayStore(ELE_INT, T_INT); break;
+        case JVM_OPC_lastore: arrayStore(ELE_LONG, T_LONG); break;
+        case JVM_OPC_castore: arrayStore(ELE_CHAR, T_INT); break;
+        case JVM_OPC_sastore: arrayStore(ELE_SHORT, T_INT); break;
+        case JVM_OPC_arraylength: {
+            check(IR_NULL_CHECK, peek(0));
+            Inst *arr = pop(T_REF);
+            push(emit(IR_ARRAY_LENGTH, T_INT, { arr }));
+            break;
+        }
+
+        case JVM_OPC_pop:
+            popSlot();
+            break;
+        case JVM_OPC_pop2:
+            popSlot();
+            popSlot();
+            break;
+        case JVM_OPC_dup:
+            st.stack.push_back(peek(0));
+            break;
+        case JVM_OPC_dup_x1: {
+            Inst *v1 = popSlot(), *v2 = popSlot();
+            st.stack.insert(st.stack.end(), { v1, v2, v1 });
+            break;
+        }
+        case JVM_OPC_dup_x2: {
+            Inst *v1 = popSlot(), *v2 = popSlot(), *v3 = popSlot();
+            st.stack.insert(st.stack.end(), { v1, v3, v2, v1 });
+            break;
+        }
+        case JVM_OPC_dup2: {
+            Inst *v1 = peek(0), *v2 = peek(1);
+            st.stack.insert(st.stack.end(), { v2, v1 });
+            break;
+        }
+        case JVM_OPC_dup2_x1: {
+            Inst *v1 = popSlot(), *v2 = popSlot(), *v3 = popSlot();
+            st.stack.insert(st.stack.end(), { v2, v1, v3, v2, v1 });
+            break;
+        }
+        case JVM_OPC_dup2_x2: {
+            Inst *v1 = popSlot(), *v2 = popSlot(), *v3 = popSlot(), *v4 = popSlot();
+            st.stack.insert(st.stack.end(), { v2, v1, v4, v3, v2, v1 });
+            break;
+        }
+        case JVM_OPC_swap: {
+            Inst *v1 = popSlot(), *v2 = popSlot();
+            st.stack.insert(st.stack.end(), { v1, v2 });
+            break;
+        }
+
+        case JVM_OPC_iadd: case JVM_OPC_isub: case JVM_OPC_imul: {
+            static const IROp ops[] = { IR_ADD, IR_SUB, IR_MUL };
+            Inst *y = pop(T_INT), *x = pop(T_INT);
+            push(arith(ops[(opcode - JVM_OPC_iadd) / 4], T_INT, x, y));
+            break;
+        }
+        case JVM_OPC_ladd: case JVM_OPC_lsub: case JVM_OPC_lmul: {
+            static const IROp ops[] = { IR_ADD, IR_SUB, IR_MUL };
+            Inst *y = pop(T_LONG), *x = pop(T_LONG);
+            push(arith(ops[(opcode - JVM_OPC_ladd) / 4], T_LONG, x, y));
+            break;
+        }
+        case JVM_OPC_idiv: divide(IR_DIV, T_INT); break;
+        case JVM_OPC_ldiv: divide(IR_DIV, T_LONG); break;
+        case JVM_OPC_irem: divide(IR_REM, T_INT); break;
+        case JVM_OPC_lrem: divide(IR_REM, T_LONG); break;
+        case JVM_OPC_ineg: push(arith(IR_NEG, T_INT, pop(T_INT))); break;
+        case JVM_OPC_lneg: push(arith(IR_NEG, T_LONG, pop(T_LONG))); break;
+        case JVM_OPC_ishl: case JVM_OPC_ishr: case JVM_OPC_iushr: {
+            static const IROp ops[] = { IR_SHL, IR_SHR, IR_USHR };
+            Inst *y = pop(T_INT), *x = pop(T_INT);
+            push(arith(ops[(opcode - JVM_OPC_ishl) / 2], T_INT, x, y));
+            break;
+        }
+        case JVM_OPC_lshl: case JVM_OPC_lshr: case JVM_OPC_lushr: {
+            static const IROp ops[] = { IR_SHL, IR_SHR, IR_USHR };
+            Inst *y = pop(T_INT), *x = pop(T_LONG);
+            push(arith(ops[(opcode - JVM_OPC_lshl) / 2], T_LONG, x, y));
+            break;
+        }
+        case JVM_OPC_iand: case JVM_OPC_ior: case JVM_OPC_ixor: {
+            static const IROp ops[] = { IR_AND, IR_OR, IR_XOR };
+            Inst *y = pop(T_INT), *x = pop(T_INT);
+            push(arith(ops[(opcode - JVM_OPC_iand) / 2], T_INT, x, y));
+            break;
+        }
+        case JVM_OPC_land: case JVM_OPC_lor: case JVM_OPC_lxor: {
+            static const IROp ops[] = { IR_AND, IR_OR, IR_XOR };
+            Inst *y = pop(T_LONG), *x = pop(T_LONG);
+            push(arith(ops[(opcode - JVM_OPC_land) / 2], T_LONG, x, y));
+            break;
+        }
+        case JVM_OPC_iinc:
+        case JVM_OPC_wide: {
+            size_t index;
+            jint c;
+            if (opcode == JVM_OPC_wide) {
+                opcode = r.readu1();
+                index = r.readu2();
+                if (opcode == JVM_OPC_iinc) {
+                    c = r.reads2();
+                } else {
+                    // wide xload/xstore
+                    switch (opcode) {
+                        case JVM_OPC_iload: load(index, T_INT); break;
+                        case JVM_OPC_lload: load(index, T_LONG); break;
+                        case JVM_OPC_aload: load(index, T_REF); break;
+                        case JVM_OPC_istore: store(index, T_INT); break;
+                        case JVM_OPC_lstore: store(index, T_LONG); break;
+                        case JVM_OPC_astore: store(index, T_REF); break;
+                        default: bailout();
+                    }
+                    break;
+                }
+            } else {
+                index = r.readu1();
+                c = r.reads1();
+            }
+            if (index >= st.locals.size() || st.locals[index] == nullptr || st.locals[index]->type != T_INT)
+                bailout();
+            st.locals[index] = arith(IR_ADD, T_INT, st.locals[index], constant(T_INT, c));
+            break;
+        }
+
+        case JVM_OPC_i2l: push(arith(IR_I2L, T_LONG, pop(T_INT))); break;
+        case JVM_OPC_l2i: push(arith(IR_L2I, T_INT, pop(T_LONG))); break;
+        case JVM_OPC_i2b: push(arith(IR_I2B, T_INT, pop(T_INT))); break;
+        case JVM_OPC_i2c: push(arith(IR_I2C, T_INT, pop(T_INT))); break;
+        case JVM_OPC_i2s: push(arith(IR_I2S, T_INT, pop(T_INT))); break;
+        case JVM_OPC_lcmp: {
+            Inst *y = pop(T_LONG), *x = pop(T_LONG);
+            push(arith(IR_LCMP, T_INT, x, y));
+            break;
+        }
+
+        case JVM_OPC_ifeq: case JVM_OPC_ifne: case JVM_OPC_iflt:
+        case JVM_OPC_ifge: case JVM_OPC_ifgt: case JVM_OPC_ifle: {
+            static const Condition conds[] = { CC_EQ, CC_NE, CC_LT, CC_GE, CC_GT, CC_LE };
+            size_t target = pc + r.reads2();
+            safepointPoll(target);
+            Inst *x = pop(T_INT);
+            branch(conds[opcode - JVM_OPC_ifeq], x, constant(T_INT, 0), target);
+            break;
+        }
+        case JVM_OPC_if_icmpeq: case JVM_OPC_if_icmpne: case JVM_OPC_if_icmplt:
+        case JVM_OPC_if_icmpge: case JVM_OPC_if_icmpgt: case JVM_OPC_if_icmple: {
+            static const Condition conds[] = { CC_EQ, CC_NE, CC_LT, CC_GE, CC_GT, CC_LE };
+            size_t target = pc + r.reads2();
+            safepointPoll(target);
+            Inst *y = pop(T_INT), *x = pop(T_INT);
+            branch(conds[opcode - JVM_OPC_if_icmpeq], x, y, target);
+            break;
+        }
+        case JVM_OPC_if_acmpeq: case JVM_OPC_if_acmpne: {
+            size_t target = pc + r.reads2();
+            safepointPoll(target);
+            Inst *y = pop(T_REF), *x = pop(T_REF);
+            branch(opcode == JVM_OPC_if_acmpeq ? CC_EQ : CC_NE, x, y, target);
+            break;
+        }
+        case JVM_OPC_ifnull: case JVM_OPC_ifnonnull: {
+            size_t target = pc + r.reads2();
+            safepointPoll(target);
+            Inst *x = pop(T_REF);
+            branch(opcode == JVM_OPC_ifnull ? CC_EQ : CC_NE, x, constant(T_REF, 0), target);
+            break;
+        }
+        case JVM_OPC_goto:
+        case JVM_OPC_goto_w: {
+            size_t target = pc + (opcode == JVM_OPC_goto ? r.reads2() : r.reads4());
+            safepointPoll(target);
+            emit(IR_GOTO, T_VOID);
+            jumpTo(target);
+            break;
+        }
+
+        case JVM_OPC_ireturn: case JVM_OPC_lreturn: case JVM_OPC_areturn: case JVM_OPC_return: {
+            vector<IRType> args;
+            IRType type = parseDescriptor(m->descriptor, args);
+            Inst *v = type == T_VOID ? nullptr : pop(type);
+            if (isRoot()) {
+                Inst *ret = emit(IR_RETURN, T_VOID);
+                if (v != nullptr)
+                    ret->inputs.push_back(v);
+            } else {
+                emit(IR_GOTO, T_VOID);
+                returns.emplace_back(cur, v);
+            }
+            break;
+        }
+
+        case JVM_OPC_getstatic: {
+            Field *f = resolvedField(r.readu2(), true);
+            Inst *v = emit(IR_GET_STATIC, typeOf(f->descriptor[0]));
+            v->field = f;
+            push(v);
+            break;
+        }
+        case JVM_OPC_putstatic: {
+            Field *f = resolvedField(r.readu2(), true);
+            Inst *v = pop(typeOf(f->descriptor[0]));
+            emit(IR_PUT_STATIC, T_VOID, { v })->field = f;
+            break;
+        }
+        case JVM_OPC_getfield: {
+            Field *f = resolvedField(r.readu2(), false);
+            check(IR_NULL_CHECK, peek(0));
+            Inst *obj = pop(T_REF);
+            Inst *v = emit(IR_GET_FIELD, typeOf(f->descriptor[0]), { obj });
+            v->field = f;
+            push(v);
+            break;
+        }
+        case JVM_OPC_putfield: {
+            Field *f = resolvedField(r.readu2(), false);
+            IRType type = typeOf(f->descriptor[0]);
+            check(IR_NULL_CHECK, peek(type == T_LONG ? 2 : 1));
+            Inst *v = pop(type);
+            Inst *obj = pop(T_REF);
+            emit(IR_PUT_FIELD, T_VOID, { obj, v })->field = f;
+            break;
+        }
+
+        case JVM_OPC_invokevirtual: case JVM_OPC_invokespecial:
+        case JVM_OPC_invokestatic: case JVM_OPC_invokeinterface: {
+            u2 index = r.readu2();
+            if (opcode == JVM_OPC_invokeinterface)
+                r.skip(2);
+            invoke(opcode, index);
+            break;
+        }
+
+        default:
+            // float, double, 对象分配, switch, 同步, 类型检查, athrow 等
+            bailout();
+    }
+}
+
+} // namespace
+
+unique_ptr<Graph> buildGraph(Method *m)
+{
+    assert(m != nullptr && m->code != nullptr);
+
+    auto g = make_unique<Graph>(m);
+    try {
+        Block *entry = g->entry = g->newBlock();
+
+        vector<IRType> args;
+        parseDescriptor(m->descriptor, args);
+        if (!m->isStatic())
+            args.insert(args.begin(), T_REF);
+
+        State st;
+        st.locals.assign(m->max_locals, nullptr);
+        size_t slot = 0;
+        for (IRType t : args) {
+            if (slot >= st.locals.size())
+                bailout();
+            Inst *p = g->newInst(IR_PARAM, t);
+            p->constant = (jlong) slot;
+            p->block = entry;
+            entry->insts.push_back(p);
+            st.locals[slot] = p;
+            slot += t == T_LONG ? 2 : 1;
+        }
+
+        Parser parser(g.get(), m, nullptr, 0, nullptr);
+        parser.parse(entry, st);
+    } catch (Bailout &) {
+        return nullptr;
+    }
+
+    return g;
+}
@@ -0,0 +1,158 @@
+#ifndef CABIN_JIT_H
+#define CABIN_JIT_H
+
+#include <atomic>
+#include <vector>
+#include "../cabin.h"
+#include "../slot.h"
+#include "../metadata/method.h"
+
+/*
+ * 基线模板 JIT（baseline template JIT）
+ *
+ * 热方法（调用次数加上循环回边次数达到 JIT_COMPILE_THRESHOLD）被逐条指令地翻译为 x86-64 机器码，
+ * 每条字节码对应一段固定的机器码模板，不做寄存器分配和优化。
+ *
+ * 编译后的代码与解释器使用同一个 Frame：
+ * 局部变量表和操作数栈都在内存中，布局与解释器完全相同，
+ * 所以编译后的代码可以随时把执行交还给解释器（例如抛出异常时）。
+ *
+ * 只编译叶子方法：不含方法调用（invoke*）、对象和数组的分配、switch、同步、athrow、
+ * checkcast/instanceof 等需要进入虚拟机的指令，方法中有任何不支持的指令，整个方法就留在解释器中执行。
+ * 见 template_jit.cpp 中支持的指令。
+ *
+ * 所以编译后的代码既不调用别的方法，也不被别的编译后的代码调用，
+ * 方法之间的调用总是经过解释器（见 _invoke_method），由它进入被调用方法编译后的代码。
+ * 调用了其他方法的热方法（热循环常常就在这样的方法中）得不到模板 JIT 的加速，
+ * 要等达到 OPT_COMPILE_THRESHOLD 后再次被调用时，由优化编译器把其中的调用内联后才被编译。
+ * 优化编译的代码没有 OSR 入口，所以只调用一次的方法（比如 main）中这样的循环，
+ * 以及有不能内联的调用（递归、本地方法、过大的方法、多态的调用点等）的方法，一直解释执行。
+ *
+ * 叶子方法中仍然可以有循环，编译后的代码在循环的回边上轮询安全点（见 runtime/safepoint.h），
+ * 有停顿请求时退出到解释器（JIT_EXIT_SAFEPOINT），由解释器停下。
+ *
+ * 更热的方法（达到 OPT_COMPILE_THRESHOLD）再由优化编译器在后台编译，见 opt_compiler.h。
+ */
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+    #define JIT_SUPPORTED 1
+#else
+    #define JIT_SUPPORTED 0
+#endif
+
+// 调用次数与回边次数之和达到此值时编译方法
+#define JIT_COMPILE_THRESHOLD 1000
+
+// 调用次数与回边次数之和达到此值时用优化编译器重新编译方法
+#define OPT_COMPILE_THRESHOLD 10000
+
+// 回边次数每增加这么多次，解释器检查一次能否在循环头处进行栈上替换（OSR），必须是2的幂
+#define OSR_CHECK_INTERVAL 1024
+
+// 优化编译的代码去优化的次数达到此值时，放弃优化编译的代码
+#define DEOPT_LIMIT 100
+
+// 编译后的代码通过 JitExit 告诉解释器在哪条指令抛出了什么异常
+enum JitExitKind {
+    JIT_EXIT_ARITHMETIC = 1,  // 整数除零
+    JIT_EXIT_NULL_POINTER,
+    JIT_EXIT_ARRAY_INDEX,     // 数组越界，越界的下标见 JitExit::index
+    JIT_EXIT_DEOPT,           // 去优化，frame 已写回，从 JitExit::pc 处继续解释执行
+    JIT_EXIT_SAFEPOINT,       // 回边上有停顿请求，frame 已写回，从 JitExit::pc 处（跳转指令）继续解释执行
+};
+
+struct JitExit {
+    u4 pc;   // 抛出异常（或去优化）的指令的 pc
+    u4 kind; // JitExitKind
+    jint index;
+    u4 sp;   // 去优化（或在安全点退出）时操作数栈的栈顶，为距进入时的 @ostack 的 slot 数
+};
+
+/*
+ * 编译后的代码的入口。
+ * @lvars: 局部变量表
+ * @ostack: 操作数栈的栈顶
+ * 正常返回时返回操作数栈的栈顶（返回值在其下面），
+ * 抛出异常时返回 nullptr，异常的信息写在 @exit 中。
+ */
+typedef slot_t *(*JitCode)(slot_t *lvars, slot_t *ostack, JitExit *exit);
+
+/*
+ * 栈上替换（on-stack replacement）的入口。
+ * 一直在循环中的方法（比如 main）调用次数不会增加，只能在循环中途转入编译后的代码。
+ * 模板 JIT 的代码与解释器使用同一个 frame，所以转换时不需要搬移 frame 中的数据，
+ * 只需从循环头对应的机器码处开始执行，见 getOsrCode()。
+ */
+struct OsrEntry {
+    u4 pc;        // 循环头的 pc
+    JitCode code; // 调用约定与 JitCode 相同，@ostack 为解释器当前的栈顶
+};
+
+struct OsrTable {
+    std::vector<OsrEntry> entries;
+
+    [[nodiscard]] JitCode lookup(size_t pc) const;
+};
+
+// Method::jit_state
+enum JitState {
+    JIT_NOT_COMPILED = 0,
+    JIT_COMPILING,
+    JIT_COMPILED,
+    JIT_NOT_COMPILABLE, // 有不支持的指令，或者代码缓存已满
+};
+
+// Method::opt_state
+enum OptState {
+    OPT_NOT_COMPILED = 0,
+    OPT_QUEUED,         // 在编译队列中或者正在编译
+    OPT_COMPILED,
+    OPT_NOT_COMPILABLE, // 有不支持的指令，或者去优化的次数过多
+};
+
+extern bool jit_enabled;       // -Xint 关闭 JIT
+extern bool print_compilation; // -XX:+PrintCompilation
+
+/*
+ * 编译方法 @m，线程安全。
+ * 返回编译后的代码，不能编译或者其他线程正在编译时返回 nullptr。
+ */
+JitCode jitCompile(Method *m);
+
+/*
+ * 解释器在循环回边处调用，返回从循环头 @pc 处进入方法 @m 编译后的代码的入口，
+ * 回边次数达到编译阈值时先编译方法。不能栈上替换时返回 nullptr。
+ */
+JitCode getOsrCode(Method *m, size_t pc);
+
+// 见 opt_compiler.h
+void requestOptCompile(Method *m);
+
+/*
+ * 返回方法 @m 编译后的代码（优先返回优化编译的代码），还没有编译时返回 nullptr。
+ * 调用次数由解释器统计（见 _invoke_method），达到编译阈值时编译方法：
+ * 模板 JIT 在当前线程中编译，优化编译器在后台编译，完成前继续使用模板 JIT 的代码。
+ */
+static inline JitCode getJitCode(Method *m)
+{
+    if (!jit_enabled)
+        return nullptr;
+
+    auto opt_code = (JitCode) m->opt_code.load(std::memory_order_acquire);
+    if (opt_code != nullptr)
+        return opt_code;
+
+    auto code = (JitCode) m->jit_code.load(std::memory_order_acquire);
+    if (m->opt_state.load(std::memory_order_relaxed) != OPT_NOT_COMPILED)
+        return code;
+
+    u4 count = m->invocation_count + m->backedge_count;
+    if (code == nullptr && count >= JIT_COMPILE_THRESHOLD
+                && m->jit_state.load(std::memory_order_relaxed) == JIT_NOT_COMPILED)
+        code = jitCompile(m);
+    if (count >= OPT_COMPILE_THRESHOLD)
+        requestOptCompile(m);
+    return code;
+}
+
+#endif //CABIN_JIT_H
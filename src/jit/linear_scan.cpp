@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <unordered_set>
+#include "ir.h"
+#include "assembler.h"
+#include "opt_compiler.h"
+
+using namespace std;
+
+/*
+ * 线性扫描寄存器分配
+ * 参考 Poletto, Sarkar. Linear Scan Register Allocation.
+ *
+ * 基本块按逆后序排成一列，指令依次编号。
+ * 每个值的生存期近似为一个区间 [start, end]，覆盖它所有的定义、使用和跨越的基本块，
+ * 在循环中活跃的值的区间覆盖整个循环。
+ * FrameState 中的值也算作使用（去优化时要写回解释器），
+ * phi 在其所在块的开头定义，phi 的输入在对应的前驱的末尾使用。
+ *
+ * 区间按开始位置排序后依次分配寄存器，没有空闲的寄存器时，
+ * 把结束得最晚的区间 spill 到栈上。
+ *
+ * 常量不分配位置，使用时直接生成立即数。
+ */
+
+namespace {
+
+// 可分配的寄存器。rdi, rsi, r11 保存参数，rax, rcx, rdx 是生成代码时的临时寄存器
+const Reg allocatable[] = { RBX, RBP, R8, R9, R10, R12, R13, R14, R15 };
+
+struct Interval {
+    Inst *value;
+    int start, end;
+};
+
+bool needsLocation(const Inst *v)
+{
+    return v->type != T_VOID && !v->isConst();
+}
+
+} // namespace
+
+int allocateRegisters(Graph *g)
+{
+    size_t nblocks = g->blocks.size();
+    vector<int> block_from(nblocks), block_to(nblocks);
+
+    // 编号：块的开头占一个位置（phi 在此定义），每条指令占一个位置，块的末尾占一个位置
+    vector<int> pos(g->insts.size(), -1);
+    int n = 0;
+    for (Block *b : g->rpo) {
+        block_from[b->id] = n;
+        n += 2;
+        for (Inst *phi : b->phis)
+            pos[phi->id] = block_from[b->id];
+        for (Inst *i : b->insts) {
+            pos[i->id] = n;
+            n += 2;
+        }
+        block_to[b->id] = n - 1;
+    }
+
+    // 活跃变量分析
+    vector<unordered_set<Inst *>> live_in(nblocks);
+    auto addUses = [](Inst *i, unordered_set<Inst *> &live) {
+        for (Inst *in : i->inputs) {
+            if (needsLocation(in))
+                live.insert(in);
+        }
+        if (i->state != nullptr) {
+            for (Inst *v : i->state->locals)
+                if (v != nullptr && needsLocation(v)) live.insert(v);
+            for (Inst *v : i->state->stack)
+                if (v != nullptr && needsLocation(v)) live.insert(v);
+        }
+    };
+    auto liveOut = [&](Block *b) {
+        unordered_set<Inst *> live;
+        for (Block *s : b->succs) {
+            for (Inst *v : live_in[s->id])
+                live.insert(v);
+            size_t k = find(s->preds.begin(), s->preds.end(), b) - s->preds.begin();
+            for (Inst *phi : s->phis) {
+                Inst *in = phi->inputs[k];
+                if (needsLocation(in))
+                    live.insert(in);
+            }
+        }
+        return live;
+    };
+
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (auto it = g->rpo.rbegin(); it != g->rpo.rend(); ++it) {
+            Block *b = *it;
+            unordered_set<Inst *> live = liveOut(b);
+            for (auto i = b->insts.rbegin(); i != b->insts.rend(); ++i) {
+                live.erase(*i);
+                addUses(*i, live);
+            }
+            for (Inst *phi : b->phis)
+                live.erase(phi); // phi 的输入属于前驱
+            if (live.size() != live_in[b->id].size()) {
+                live_in[b->id] = move(live);
+                changed = true;
+            }
+        }
+    }
+
+    // 求每个值的区间
+    vector<Interval> intervals;
+    vector<int> index_of(g->insts.size(), -1);
+    auto cover = [&](Inst *v, int p) {
+        if (index_of[v->id] < 0) {
+            index_of[v->id] = (int) intervals.size();
+            intervals.push_back({ v, p, p });
+        }
+        Interval &r = intervals[index_of[v->id]];
+        r.start = min(r.start, p);
+        r.end = max(r.end, p);
+    };
+
+    for (Block *b : g->rpo) {
+        for (Inst *v : live_in[b->id])
+            cover(v, block_from[b->id]);
+        for (Inst *v : liveOut(b))
+            cover(v, block_to[b->id]);
+        for (Inst *phi : b->phis)
+            cover(phi, block_from[b->id]);
+        for (Inst *i : b->insts) {
+            if (needsLocation(i))
+                cover(i, pos[i->id]);
+            unordered_set<Inst *> uses;
+            addUses(i, uses);
+            for (Inst *v : uses)
+                cover(v, pos[i->id]);
+        }
+    }
+
+    sort(intervals.begin(), intervals.end(), [](const Interval &x, const Interval &y) {
+        return x.start < y.start || (x.start == y.start && x.value->id < y.value->id);
+    });
+
+    // 分配
+    vector<Interval *> active; // 按结束位置排序
+    vector<Reg> free_regs(begin(allocatable), end(allocatable));
+    int spill_slots = 0;
+
+    auto spill = [&](Inst *v) { v->location = LOC_STACK + spill_slots++; };
+
+    for (Interval &cur : intervals) {
+        // 释放已经结束的区间的寄存器
+        while (!active.empty() && active.front()->end < cur.start) {
+            free_regs.push_back((Reg) active.front()->value->location);
+            active.erase(active.begin());
+        }
+
+        if (!free_regs.empty()) {
+            cur.value->location = free_regs.back();
+            free_regs.pop_back();
+        } else {
+            Interval *last = active.back();
+            if (last->end > cur.end) {
+                cur.value->location = last->value->location;
+                spill(last->value);
+                active.pop_back();
+            } else {
+                spill(cur.value);
+                continue;
+            }
+        }
+
+        auto at = upper_bound(active.begin(), active.end(), &cur,
+                              [](const Interval *x, const Interval *y) { return x->end < y->end; });
+        active.insert(at, &cur);
+    }
+
+    return spill_slots;
+}
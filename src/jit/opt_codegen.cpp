@@ -0,0 +1,495 @@
+#include <algorithm>
+#include <cstddef>
+#include "opt_compiler.h"
+#include "ir.h"
+#include "assembler.h"
+#include "code_cache.h"
+#include "../metadata/class.h"
+#include "../metadata/field.h"
+#include "../objects/array.h"
+#include "../heap/barrier.h"
+#include "../runtime/safepoint.h"
+
+using namespace std;
+
+#if JIT_SUPPORTED
+
+/*
+ * 优化编译器的代码生成
+ *
+ * 寄存器：rdi 为局部变量表，rsi 为操作数栈的栈底，r11 为 JitExit，
+ * rax, rcx, rdx 为临时寄存器，其余的由 allocateRegisters() 分配。
+ * 每条指令先把输入取到临时寄存器中，运算后把结果存到分配给它的位置，
+ * 常量直接作为立即数。
+ *
+ * 栈帧：先保存用到的 callee-saved 寄存器，再留出 spill slot，[rsp + 8k] 为第 k 个。
+ *
+ * 检查失败时跳到去优化的桩代码：按检查指令的 FrameState
+ * 把局部变量写到 [rdi + 8k]，操作数栈写到 [rsi + 8k]，再返回 nullptr。
+ * 回边上的安全点轮询发现有停顿请求时也这样退出到解释器，但不计入去优化的次数。
+ */
+
+namespace {
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+const s4 OBJECT_DATA_OFFSET = (s4) offsetof(Object, data);
+const s4 OBJECT_CLASS_OFFSET = (s4) offsetof(Object, clazz);
+const s4 ARRAY_LENGTH_OFFSET = (s4) offsetof(Array, arr_len);
+#pragma GCC diagnostic pop
+
+const Reg saved_regs[] = { RBX, RBP, R12, R13, R14, R15 };
+
+class OptCodeGen {
+    Graph *g;
+    int spill_slots;
+    Assembler a;
+
+    struct Jump {
+        size_t at;
+        Block *target;
+    };
+    vector<Jump> jumps;
+
+    struct Stub {
+        size_t at;
+        FrameState *state;
+        JitExitKind kind;
+    };
+    vector<Stub> stubs;
+
+    Block *next_block = nullptr; // 布局上紧跟在当前块后面的块
+
+    static bool inReg(int loc) { return 0 <= loc && loc < LOC_STACK; }
+    static s4 spillDisp(int loc) { return 8 * (loc - LOC_STACK); }
+
+    static bool isWide(const Inst *v) { return v->type == T_LONG || v->type == T_REF; }
+
+    void loadTo(Reg r, Inst *v)
+    {
+        if (v->isConst()) {
+            a.movImm(r, v->constant);
+        } else if (inReg(v->location)) {
+            a.mov(r, v->location);
+        } else {
+            assert(v->location >= LOC_STACK);
+            a.load(r, RSP, spillDisp(v->location));
+        }
+    }
+
+    void storeFrom(Inst *v, Reg r)
+    {
+        if (v->location < 0)
+            return;
+        if (inReg(v->location))
+            a.mov(v->location, r);
+        else
+            a.store(RSP, spillDisp(v->location), r);
+    }
+
+    void jumpTo(Block *target)
+    {
+        if (target != next_block)
+            jumps.push_back({ a.jmp32(), target });
+    }
+
+    void deoptIf(Condition cc, Inst *check, JitExitKind kind = JIT_EXIT_DEOPT)
+    {
+        stubs.push_back({ a.jcc32(cc), check->state, kind });
+    }
+
+    void epilogue()
+    {
+        if (spill_slots > 0) {
+            a.opRR(true, { 0x81 }, 0, RSP); a.emit4(8 * spill_slots); // add rsp, imm32
+        }
+        for (int i = (int) size(saved_regs) - 1; i >= 0; i--) {
+            if (saved_regs[i] >= R8)
+                a.emit({ 0x41 });
+            a.emit({ (u1) (0x58 + (saved_regs[i] & 7)) });          // pop reg
+        }
+        a.emit({ 0xC3 });                                           // ret
+    }
+
+    void phiMoves(Block *from, Block *to);
+    void compileInst(Inst *i);
+    void compileArrayAccess(Inst *i);
+
+public:
+    OptCodeGen(Graph *g, int spill_slots): g(g), spill_slots(spill_slots) { }
+
+    JitCode generate();
+};
+
+/*
+ * 从 @from 跳到 @to 时，把 phi 的输入移到 phi 的位置。
+ * 这些 move 是并行的（phi 同时定义），有循环依赖时用 rdx 打破。
+ */
+void OptCodeGen::phiMoves(Block *from, Block *to)
+{
+    struct Move {
+        int dst;
+        Inst *src; // 常量，或者在 src_loc 中的值
+        int src_loc;
+    };
+    vector<Move> moves;
+
+    size_t k = find(to->preds.begin(), to->preds.end(), from) - to->preds.begin();
+    for (Inst *phi : to->phis) {
+        Inst *in = phi->inputs[k];
+        if (phi->location < 0 || (!in->isConst() && in->location == phi->location))
+            continue;
+        moves.push_back({ phi->location, in, in->isConst() ? -1 : in->location });
+    }
+
+    auto emitMove = [&](int dst, const Move &mv) {
+        Reg r = inReg(dst) ? (Reg) dst : RAX;
+        if (mv.src_loc < 0)
+            a.movImm(r, mv.src->constant);
+        else if (inReg(mv.src_loc))
+            a.mov(r, mv.src_loc);
+        else
+            a.load(r, RSP, spillDisp(mv.src_loc));
+        if (!inReg(dst))
+            a.store(RSP, spillDisp(dst), RAX);
+    };
+
+    while (!moves.empty()) {
+        bool progress = false;
+        for (size_t i = 0; i < moves.size(); i++) {
+            bool blocked = false;
+            for (size_t j = 0; j < moves.size(); j++) {
+                if (j != i && moves[j].src_loc == moves[i].dst) {
+                    blocked = true;
+                    break;
+                }
+            }
+            if (!blocked) {
+                emitMove(moves[i].dst, moves[i]);
+                moves.erase(moves.begin() + i);
+                progress = true;
+                break;
+            }
+        }
+        if (!progress) {
+            // 剩下的都在环中：把一个目标位置原来的值移到 rdx，读它的 move 改为读 rdx
+            int d = moves[0].dst;
+            emitMove(RDX, { RDX, nullptr, d });
+            for (auto &mv : moves) {
+                if (mv.src_loc == d)
+                    mv.src_loc = RDX;
+            }
+        }
+    }
+}
+
+// rax = 数组的数据，ecx = 下标
+void OptCodeGen::compileArrayAccess(Inst *i)
+{
+    loadTo(RAX, i->inputs[0]);
+    loadTo(RCX, i->inputs[1]);
+    a.opRR(false, { 0x8B }, RCX, RCX);                          // mov ecx, ecx
+    a.opRM(true, { 0x8B }, RAX, RAX, OBJECT_DATA_OFFSET);       // mov rax, [rax + data]
+
+    if (i->op == IR_ARRAY_LOAD) {
+        switch (i->aux) {
+            case ELE_BYTE:  a.opRMI(false, { 0x0F, 0xBE }, RAX, RAX, RCX, 1, 0); break; // movsx eax, byte
+            case ELE_CHAR:  a.opRMI(false, { 0x0F, 0xB7 }, RAX, RAX, RCX, 2, 0); break; // movzx eax, word
+            case ELE_SHORT: a.opRMI(false, { 0x0F, 0xBF }, RAX, RAX, RCX, 2, 0); break; // movsx eax, word
+            case ELE_INT:   a.opRMI(false, { 0x8B }, RAX, RAX, RCX, 4, 0); break;
+            default:        a.opRMI(true, { 0x8B }, RAX, RAX, RCX, 8, 0); break;
+        }
+        storeFrom(i, RAX);
+        return;
+    }
+
+    loadTo(RDX, i->inputs[2]);
+    switch (i->aux) {
+        case ELE_BYTE:  a.opRMI(false, { 0x88 }, RDX, RAX, RCX, 1, 0); break;    // mov byte [..], dl
+        case ELE_CHAR:
+        case ELE_SHORT: a.emit({ 0x66 }); a.opRMI(false, { 0x89 }, RDX, RAX, RCX, 2, 0); break;
+        case ELE_INT:   a.opRMI(false, { 0x89 }, RDX, RAX, RCX, 4, 0); break;
+        default:        a.opRMI(true, { 0x89 }, RDX, RAX, RCX, 8, 0); break;
+    }
+}
+
+void OptCodeGen::compileInst(Inst *i)
+{
+    bool w = isWide(i);
+    Inst *x = i->inputs.empty() ? nullptr : i->inputs[0];
+    Inst *y = i->inputs.size() > 1 ? i->inputs[1] : nullptr;
+
+    switch (i->op) {
+        case IR_CONST:
+            break;
+        case IR_PARAM:
+            if (i->location >= 0) {
+                a.opRM(w, { 0x8B }, RAX, RDI, (s4) (8 * i->constant));
+                storeFrom(i, RAX);
+            }
+            break;
+
+        case IR_ADD: case IR_SUB: case IR_MUL:
+        case IR_AND: case IR_OR: case IR_XOR: {
+            loadTo(RAX, x);
+            loadTo(RCX, y);
+            switch (i->op) {
+                case IR_ADD: a.opRR(w, { 0x03 }, RAX, RCX); break;
+                case IR_SUB: a.opRR(w, { 0x2B }, RAX, RCX); break;
+                case IR_MUL: a.opRR(w, { 0x0F, 0xAF }, RAX, RCX); break;
+                case IR_AND: a.opRR(w, { 0x23 }, RAX, RCX); break;
+                case IR_OR:  a.opRR(w, { 0x0B }, RAX, RCX); break;
+                default:     a.opRR(w, { 0x33 }, RAX, RCX); break;
+            }
+            storeFrom(i, RAX);
+            break;
+        }
+        case IR_DIV: case IR_REM: {
+            // 除数为 -1 时单独处理，避免 MIN_VALUE / -1 溢出（idiv 会产生 #DE）
+            loadTo(RAX, x);
+            loadTo(RCX, y);
+            a.opRR(w, { 0x83 }, 7, RCX); a.emit({ 0xFF });        // cmp rcx, -1
+            size_t normal = a.jump8(0x75);                        // jne normal
+            if (i->op == IR_DIV)
+                a.opRR(w, { 0xF7 }, 3, RAX);                      // neg rax
+            else
+                a.opRR(false, { 0x33 }, RAX, RAX);                // xor eax, eax
+            size_t done = a.jump8(0xEB);                          // jmp done
+            a.bind8(normal);
+            if (w)
+                a.emit({ 0x48 });
+            a.emit({ 0x99 });                                     // cdq / cqo
+            a.opRR(w, { 0xF7 }, 7, RCX);                          // idiv rcx
+            if (i->op == IR_REM)
+                a.mov(RAX, RDX);
+            a.bind8(done);
+            storeFrom(i, RAX);
+            break;
+        }
+        case IR_NEG:
+            loadTo(RAX, x);
+            a.opRR(w, { 0xF7 }, 3, RAX);                          // neg rax
+            storeFrom(i, RAX);
+            break;
+        case IR_SHL: case IR_SHR: case IR_USHR:
+            // 移位的位数在 cl 中，处理器只取低5位（64位时低6位），与 Java 的语义相同
+            loadTo(RCX, y);
+            loadTo(RAX, x);
+            a.opRR(w, { 0xD3 }, i->op == IR_SHL ? 4 : (i->op == IR_SHR ? 7 : 5), RAX);
+            storeFrom(i, RAX);
+            break;
+        case IR_I2L:
+            loadTo(RAX, x);
+            a.opRR(true, { 0x63 }, RAX, RAX);                     // movsxd rax, eax
+            storeFrom(i, RAX);
+            break;
+        case IR_L2I:
+            loadTo(RAX, x);
+            a.opRR(false, { 0x8B }, RAX, RAX);                    // mov eax, eax
+            storeFrom(i, RAX);
+            break;
+        case IR_I2B: case IR_I2C: case IR_I2S:
+            loadTo(RAX, x);
+            a.opRR(false, { 0x0F, (u1) (i->op == IR_I2B ? 0xBE : (i->op == IR_I2C ? 0xB7 : 0xBF)) }, RAX, RAX);
+            storeFrom(i, RAX);
+            break;
+        case IR_LCMP:
+            loadTo(RAX, x);
+            loadTo(RCX, y);
+            a.opRR(true, { 0x3B }, RAX, RCX);                     // cmp rax, rcx
+            a.emit({ 0x0F, 0x9F, 0xC0 });                         // setg al
+            a.emit({ 0x0F, 0x9C, 0xC1 });                         // setl cl
+            a.emit({ 0x2A, 0xC1 });                               // sub al, cl
+            a.emit({ 0x0F, 0xBE, 0xC0 });                         // movsx eax, al
+            storeFrom(i, RAX);
+            break;
+
+        case IR_ARRAY_LENGTH:
+            loadTo(RAX, x);
+            a.opRM(false, { 0x8B }, RAX, RAX, ARRAY_LENGTH_OFFSET); // mov eax, [rax + arr_len]
+            storeFrom(i, RAX);
+            break;
+        case IR_ARRAY_LOAD:
+        case IR_ARRAY_STORE:
+            compileArrayAccess(i);
+            break;
+        case IR_GET_FIELD:
+            loadTo(RAX, x);
+            a.opRM(true, { 0x8B }, RAX, RAX, OBJECT_DATA_OFFSET);  // mov rax, [rax + data]
+            a.opRM(w, { 0x8B }, RAX, RAX, 8 * i->field->id);
+            storeFrom(i, RAX);
+            break;
+        case IR_PUT_FIELD:
+            loadTo(RAX, x);
+            loadTo(RCX, y);
+            a.opRM(true, { 0x8B }, RAX, RAX, OBJECT_DATA_OFFSET);
+            a.store(RAX, 8 * i->field->id, RCX);
+            if (i->field->isReference()) {
+                // 写屏障，见 heap/barrier.h
+                a.opRM(true, { 0x8D }, RAX, RAX, 8 * i->field->id);    // lea rax, [rax + disp]
+                a.emit({ 0x48, 0xC1, 0xE8, CARD_SHIFT });             // shr rax, CARD_SHIFT
+                a.movImm(RCX, (jlong) g_card_table_base);
+                a.emit({ 0xC6, 0x04, 0x08, CARD_DIRTY });             // mov byte [rax + rcx], CARD_DIRTY
+            }
+            break;
+        case IR_GET_STATIC:
+            a.movImm(RAX, (jlong) i->field->static_value.data);
+            a.opRM(w, { 0x8B }, RAX, RAX, 0);
+            storeFrom(i, RAX);
+            break;
+        case IR_PUT_STATIC:
+            a.movImm(RAX, (jlong) i->field->static_value.data);
+            loadTo(RCX, x);
+            a.store(RAX, 0, RCX);
+            break;
+
+        case IR_NULL_CHECK:
+        case IR_ZERO_CHECK:
+            loadTo(RAX, x);
+            a.opRR(isWide(x), { 0x85 }, RAX, RAX);                // test rax, rax
+            deoptIf(CC_EQ, i);
+            break;
+        case IR_BOUNDS_CHECK:
+            loadTo(RAX, x);
+            loadTo(RCX, y);
+            a.opRM(false, { 0x3B }, RCX, RAX, ARRAY_LENGTH_OFFSET); // cmp ecx, [rax + arr_len]
+            deoptIf(CC_AE, i);                                    // 无符号比较，负的下标也越界
+            break;
+        case IR_CLASS_CHECK:
+            loadTo(RAX, x);
+            a.opRM(true, { 0x8B }, RAX, RAX, OBJECT_CLASS_OFFSET); // mov rax, [rax + clazz]
+            a.movImm(RCX, (jlong) i->klass);
+            a.opRR(true, { 0x3B }, RAX, RCX);
+            deoptIf(CC_NE, i);
+            break;
+        case IR_CHA_CHECK:
+            a.movImm(RAX, (jlong) &i->method->polymorphic);
+            a.opRM(false, { 0x0F, 0xB6 }, RAX, RAX, 0);             // movzx eax, byte [rax]
+            a.opRR(false, { 0x85 }, RAX, RAX);                    // test eax, eax
+            deoptIf(CC_NE, i);
+            break;
+        case IR_SAFEPOINT:
+            a.movImm(RAX, (jlong) &g_safepoint_requested);
+            a.opRM(false, { 0x0F, 0xB6 }, RAX, RAX, 0);             // movzx eax, byte [rax]
+            a.opRR(false, { 0x85 }, RAX, RAX);                    // test eax, eax
+            deoptIf(CC_NE, i, JIT_EXIT_SAFEPOINT);
+            break;
+
+        case IR_IF: {
+            Block *b = i->block;
+            w = isWide(x);
+            loadTo(RAX, x);
+            if (y->isConst() && INT32_MIN <= y->constant && y->constant <= INT32_MAX) {
+                a.opRR(w, { 0x81 }, 7, RAX); a.emit4((s4) y->constant); // cmp rax, imm32
+            } else {
+                loadTo(RCX, y);
+                a.opRR(w, { 0x3B }, RAX, RCX);                    // cmp rax, rcx
+            }
+            jumps.push_back({ a.jcc32((Condition) i->aux), b->succs[0] });
+            jumpTo(b->succs[1]);
+            break;
+        }
+        case IR_GOTO: {
+            Block *b = i->block;
+            phiMoves(b, b->succs[0]);
+            jumpTo(b->succs[0]);
+            break;
+        }
+        case IR_RETURN: {
+            int slots = 0;
+            if (x != nullptr) {
+                loadTo(RAX, x);
+                a.store(RSI, 0, RAX);                             // mov [rsi], rax
+                slots = x->type == T_LONG ? 2 : 1;
+            }
+            a.opRM(true, { 0x8D }, RAX, RSI, 8 * slots);          // lea rax, [rsi + 8*slots]
+            epilogue();
+            break;
+        }
+        default:
+            assert(false);
+            break;
+    }
+}
+
+JitCode OptCodeGen::generate()
+{
+    a.emit({ 0x49, 0x89, 0xD3 });                                 // mov r11, rdx
+    for (Reg r : saved_regs) {
+        if (r >= R8)
+            a.emit({ 0x41 });
+        a.emit({ (u1) (0x50 + (r & 7)) });                        // push reg
+    }
+    if (spill_slots > 0) {
+        a.opRR(true, { 0x81 }, 5, RSP); a.emit4(8 * spill_slots); // sub rsp, imm32
+    }
+
+    for (size_t k = 0; k < g->rpo.size(); k++) {
+        Block *b = g->rpo[k];
+        next_block = k + 1 < g->rpo.size() ? g->rpo[k + 1] : nullptr;
+        b->label = a.pos();
+        if (Inst *t = b->terminator(); t->op == IR_IF) {
+            // 关键边已经拆分，条件分支的后继只有一个前驱，没有 phi
+            if (!b->succs[0]->phis.empty() || !b->succs[1]->phis.empty())
+                return nullptr;
+        }
+        for (Inst *i : b->insts) {
+            compileInst(i);
+        }
+    }
+
+    for (auto &j : jumps) {
+        a.patch4(j.at, j.target->label);
+    }
+
+    // 去优化（和在安全点退出）的桩代码
+    for (auto &s : stubs) {
+        a.patch4(s.at, a.pos());
+        FrameState *st = s.state;
+        for (size_t k = 0; k < st->locals.size(); k++) {
+            if (st->locals[k] != nullptr) {
+                loadTo(RAX, st->locals[k]);
+                a.store(RDI, (s4) (8 * k), RAX);
+            }
+        }
+        for (size_t k = 0; k < st->stack.size(); k++) {
+            if (st->stack[k] != nullptr) {
+                loadTo(RAX, st->stack[k]);
+                a.store(RSI, (s4) (8 * k), RAX);
+            }
+        }
+        a.opRM(false, { 0xC7 }, 0, R11, offsetof(JitExit, pc)); a.emit4((s4) st->pc);
+        a.opRM(false, { 0xC7 }, 0, R11, offsetof(JitExit, kind)); a.emit4(s.kind);
+        a.opRM(false, { 0xC7 }, 0, R11, offsetof(JitExit, sp)); a.emit4((s4) st->stack.size());
+        a.opRR(false, { 0x33 }, RAX, RAX);                        // xor eax, eax
+        epilogue();
+    }
+
+    return (JitCode) installCode(a.data(), a.pos());
+}
+
+} // namespace
+
+JitCode optCompile(Method *m, vector<Method *> &assumed)
+{
+    if (m->isSynchronized() || m->isNative() || m->code == nullptr)
+        return nullptr;
+
+    unique_ptr<Graph> g = buildGraph(m);
+    if (g == nullptr)
+        return nullptr;
+    optimizeGraph(g.get());
+    g->splitCriticalEdges();
+    int spill_slots = allocateRegisters(g.get());
+    assumed = g->cha_dependencies;
+    return OptCodeGen(g.get(), spill_slots).generate();
+}
+
+#else
+
+JitCode optCompile(Method *m, vector<Method *> &assumed)
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef CABIN_OPT_COMPILER_H
+#define CABIN_OPT_COMPILER_H
+
+#include <vector>
+#include "jit.h"
+
+struct Graph;
+
+/*
+ * 优化编译器（第二层编译）
+ *
+ * 调用次数和回边次数达到 OPT_COMPILE_THRESHOLD 的方法，在后台的编译线程中
+ * 被翻译为 SSA 形式的 IR（见 ir.h），经过内联、GVN、检查消除等优化，
+ * 用线性扫描分配寄存器后生成机器码，替换掉模板 JIT 生成的代码。
+ *
+ * 编译后的代码与模板 JIT 的代码调用约定相同（见 JitCode），
+ * 检查失败时去优化：把局部变量和操作数栈写回解释器的 frame，
+ * 返回 nullptr，JitExit::kind 为 JIT_EXIT_DEOPT，由解释器从 JitExit::pc 处继续执行。
+ */
+
+/*
+ * 线性扫描寄存器分配。
+ * 结果写在各个值的 Inst::location 中，返回需要的栈上 spill slot 的数量。
+ */
+int allocateRegisters(Graph *g);
+
+// Inst::location 的编码：小于 LOC_STACK 的是寄存器（Reg），否则是栈上的 spill slot
+#define LOC_STACK 16
+
+/*
+ * 同步地编译方法 @m，不能编译时返回 nullptr。
+ * @assumed: 返回编译的代码假定只有一个实现的方法，发布代码时登记这些依赖（见 installOptCode）
+ */
+JitCode optCompile(Method *m, std::vector<Method *> &assumed);
+
+/*
+ * 请求在后台编译方法 @m，立即返回。
+ * 编译完成后新的代码被写到 Method::jit_code，之后的调用就进入新的代码。
+ */
+void requestOptCompile(Method *m);
+
+#endif //CABIN_OPT_COMPILER_H
@@ -0,0 +1,958 @@
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "jit.h"
+#include "assembler.h"
+#include "code_cache.h"
+#include "../classfile/bytecode_reader.h"
+#include "../classfile/constants.h"
+#include "../metadata/class.h"
+#include "../metadata/field.h"
+#include "../objects/array.h"
+#include "../heap/barrier.h"
+#include "../runtime/safepoint.h"
+
+using namespace std;
+
+bool jit_enabled = JIT_SUPPORTED;
+bool print_compilation = false;
+
+#if JIT_SUPPORTED
+
+/*
+ * 编译后的代码使用的寄存器（System V AMD64 调用约定）：
+ *   rdi: lvars，局部变量表
+ *   rsi: ostack，操作数栈的栈顶（指向下一个空闲的 slot）
+ *   r11: JitExit *，由入口处的 rdx 复制而来（idiv 会改写 rdx）
+ *   r10: 进入时的 ostack，在安全点退出时据此计算 JitExit::sp
+ *   rax, rcx, rdx, r8, xmm0: 模板内部使用的临时寄存器
+ * 所有的值都保存在内存中，模板之间不通过寄存器传递值。
+ */
+
+// Object 和 Array 不是 standard-layout 的类型，这里只在 x86-64 上用 offsetof 取字段的偏移
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+static const s4 OBJECT_DATA_OFFSET = (s4) offsetof(Object, data);
+static const s4 ARRAY_LENGTH_OFFSET = (s4) offsetof(Array, arr_len);
+#pragma GCC diagnostic pop
+
+namespace {
+
+class TemplateCompiler {
+    Method *m;
+    Assembler a;
+    size_t pc = 0; // 正在编译的指令的 pc
+
+    // 字节码的 pc 到机器码偏移的映射，不是指令开头的 pc 为 -1
+    vector<s4> offsets;
+
+    struct Branch {
+        size_t at; // rel32 的位置
+        size_t target_pc;
+    };
+    vector<Branch> branches;
+
+    struct Stub {
+        size_t at; // rel32 的位置
+        u4 pc;
+        JitExitKind kind;
+    };
+    vector<Stub> stubs;
+
+    static s4 lvar(int index) { return (s4) (index * sizeof(slot_t)); }
+
+    void push(int slots)
+    {
+        a.emit({ 0x48, 0x83, 0xC6, (u1) (slots * sizeof(slot_t)) }); // add rsi, 8*slots
+    }
+
+    void pop(int slots)
+    {
+        a.emit({ 0x48, 0x83, 0xEE, (u1) (slots * sizeof(slot_t)) }); // sub rsi, 8*slots
+    }
+
+    void pushImm32(s4 v)
+    {
+        a.emit({ 0x48, 0xC7, 0x06 }); a.emit4(v); // mov qword [rsi], imm32（符号扩展）
+        push(1);
+    }
+
+    void pushImm64(u8 v)
+    {
+        a.emit({ 0x48, 0xB8 }); a.emit8(v); // mov rax, imm64
+        a.emit({ 0x48, 0x89, 0x06 });       // mov [rsi], rax
+        push(2);
+    }
+
+    void load(int index, int slots)
+    {
+        for (int k = 0; k < slots; k++) {
+            a.emit({ 0x48, 0x8B, 0x87 }); a.emit4(lvar(index + k)); // mov rax, [rdi + lvar]
+            a.emit({ 0x48, 0x89, 0x46, (u1) (k * 8) });            // mov [rsi + 8k], rax
+        }
+        push(slots);
+    }
+
+    void store(int index, int slots)
+    {
+        pop(slots);
+        for (int k = 0; k < slots; k++) {
+            a.emit({ 0x48, 0x8B, 0x46, (u1) (k * 8) });            // mov rax, [rsi + 8k]
+            a.emit({ 0x48, 0x89, 0x87 }); a.emit4(lvar(index + k)); // mov [rdi + lvar], rax
+        }
+    }
+
+    void jcc(Condition cc, size_t target_pc)
+    {
+        a.emit({ 0x0F, cc });
+        branches.push_back({ a.pos(), target_pc });
+        a.emit4(0);
+    }
+
+    void jmp(size_t target_pc)
+    {
+        a.emit({ 0xE9 });
+        branches.push_back({ a.pos(), target_pc });
+        a.emit4(0);
+    }
+
+    // 条件成立时退出到解释器，抛出 @kind 表示的异常（或者在安全点停下）
+    void exitIf(Condition cc, JitExitKind kind)
+    {
+        a.emit({ 0x0F, cc });
+        stubs.push_back({ a.pos(), (u4) pc, kind });
+        a.emit4(0);
+    }
+
+    // rax 中的对象为 null 时抛出 NullPointerException
+    void nullCheckRax()
+    {
+        a.emit({ 0x48, 0x85, 0xC0 }); // test rax, rax
+        exitIf(CC_EQ, JIT_EXIT_NULL_POINTER);
+    }
+
+    /*
+     * 数组指令的公共部分：rsi 已指向数组引用，[rsi + 8] 为下标。
+     * 检查之后 rax 为数组的数据，ecx 为下标。
+     */
+    void arrayCheck()
+    {
+        a.emit({ 0x48, 0x8B, 0x06 });       // mov rax, [rsi]
+        nullCheckRax();
+        a.emit({ 0x8B, 0x4E, 0x08 });       // mov ecx, [rsi + 8]
+        a.emit({ 0x3B, 0x88 }); a.emit4(ARRAY_LENGTH_OFFSET); // cmp ecx, [rax + arr_len]
+        exitIf(CC_AE, JIT_EXIT_ARRAY_INDEX); // 无符号比较，负的下标也越界
+        a.emit({ 0x48, 0x8B, 0x80 }); a.emit4(OBJECT_DATA_OFFSET); // mov rax, [rax + data]
+    }
+
+    void arrayLoad(u1 opcode)
+    {
+        pop(2);
+        arrayCheck();
+        int slots = 1;
+        switch (opcode) {
+            case JVM_OPC_iaload:
+            case JVM_OPC_faload:
+                a.emit({ 0x8B, 0x0C, 0x88 });       // mov ecx, [rax + rcx*4]
+                break;
+            case JVM_OPC_baload:
+                a.emit({ 0x0F, 0xBE, 0x0C, 0x08 }); // movsx ecx, byte [rax + rcx]
+                break;
+            case JVM_OPC_caload:
+                a.emit({ 0x0F, 0xB7, 0x0C, 0x48 }); // movzx ecx, word [rax + rcx*2]
+                break;
+            case JVM_OPC_saload:
+                a.emit({ 0x0F, 0xBF, 0x0C, 0x48 }); // movsx ecx, word [rax + rcx*2]
+                break;
+            case JVM_OPC_laload:
+            case JVM_OPC_daload:
+                slots = 2;
+                [[fallthrough]];
+            case JVM_OPC_aaload:
+                a.emit({ 0x48, 0x8B, 0x0C, 0xC8 }); // mov rcx, [rax + rcx*8]
+                break;
+            default:
+                assert(false);
+        }
+        a.emit({ 0x48, 0x89, 0x0E }); // mov [rsi], rcx
+        push(slots);
+    }
+
+    void arrayStore(u1 opcode)
+    {
+        bool category_two = (opcode == JVM_OPC_lastore || opcode == JVM_OPC_dastore);
+        pop(category_two ? 4 : 3);
+        arrayCheck();
+        a.emit({ 0x4C, 0x8B, 0x46, 0x10 }); // mov r8, [rsi + 16]
+        switch (opcode) {
+            case JVM_OPC_iastore:
+            case JVM_OPC_fastore:
+                a.emit({ 0x44, 0x89, 0x04, 0x88 });       // mov [rax + rcx*4], r8d
+                break;
+            case JVM_OPC_castore:
+            case JVM_OPC_sastore:
+                a.emit({ 0x66, 0x44, 0x89, 0x04, 0x48 }); // mov [rax + rcx*2], r8w
+                break;
+            case JVM_OPC_lastore:
+            case JVM_OPC_dastore:
+                a.emit({ 0x4C, 0x89, 0x04, 0xC8 });       // mov [rax + rcx*8], r8
+                break;
+            default:
+                assert(false);
+        }
+    }
+
+    // 已解析的字段，未解析或者类型不符时返回 nullptr
+    Field *resolvedField(u2 index, bool is_static)
+    {
+        ConstantPool &cp = m->clazz->cp;
+        if (cp.getType(index) != JVM_CONSTANT_ResolvedField)
+            return nullptr;
+        auto field = cp.resolved<Field *>(index);
+        if (field->isStatic() != is_static || field->isVolatile())
+            return nullptr;
+        if (is_static && !field->clazz->inited)
+            return nullptr; // 访问静态字段之前要初始化类，留给解释器
+        return field;
+    }
+
+    bool getfield(u2 index)
+    {
+        Field *field = resolvedField(index, false);
+        if (field == nullptr)
+            return false;
+        s4 disp = lvar(field->id);
+        a.emit({ 0x48, 0x8B, 0x46, 0xF8 });             // mov rax, [rsi - 8]
+        nullCheckRax();
+        a.emit({ 0x48, 0x8B, 0x80 }); a.emit4(OBJECT_DATA_OFFSET); // mov rax, [rax + data]
+        a.emit({ 0x48, 0x8B, 0x88 }); a.emit4(disp);    // mov rcx, [rax + disp]
+        a.emit({ 0x48, 0x89, 0x4E, 0xF8 });             // mov [rsi - 8], rcx
+        if (field->category_two) {
+            a.emit({ 0x48, 0x8B, 0x88 }); a.emit4(disp + 8); // mov rcx, [rax + disp + 8]
+            a.emit({ 0x48, 0x89, 0x0E });                    // mov [rsi], rcx
+            push(1);
+        }
+        return true;
+    }
+
+    bool putfield(u2 index)
+    {
+        Field *field = resolvedField(index, false);
+        if (field == nullptr)
+            return false;
+        s4 disp = lvar(field->id);
+        pop(field->category_two ? 3 : 2);
+        a.emit({ 0x48, 0x8B, 0x06 });                   // mov rax, [rsi]
+        nullCheckRax();
+        a.emit({ 0x48, 0x8B, 0x80 }); a.emit4(OBJECT_DATA_OFFSET); // mov rax, [rax + data]
+        a.emit({ 0x48, 0x8B, 0x4E, 0x08 });             // mov rcx, [rsi + 8]
+        a.emit({ 0x48, 0x89, 0x88 }); a.emit4(disp);    // mov [rax + disp], rcx
+        if (field->category_two) {
+            a.emit({ 0x48, 0x8B, 0x4E, 0x10 });              // mov rcx, [rsi + 16]
+            a.emit({ 0x48, 0x89, 0x88 }); a.emit4(disp + 8); // mov [rax + disp + 8], rcx
+        } else if (field->isReference()) {
+            // 写屏障，见 heap/barrier.h
+            a.emit({ 0x48, 0x8D, 0x80 }); a.emit4(disp);    // lea rax, [rax + disp]
+            a.emit({ 0x48, 0xC1, 0xE8, CARD_SHIFT });       // shr rax, CARD_SHIFT
+            a.emit({ 0x48, 0xB9 }); a.emit8((u8) g_card_table_base); // mov rcx, g_card_table_base
+            a.emit({ 0xC6, 0x04, 0x08, CARD_DIRTY });       // mov byte [rax + rcx], CARD_DIRTY
+        }
+        return true;
+    }
+
+    bool getstatic(u2 index)
+    {
+        Field *field = resolvedField(index, true);
+        if (field == nullptr)
+            return false;
+        a.emit({ 0x48, 0xB8 }); a.emit8((u8) field->static_value.data); // mov rax, &static_value
+        a.emit({ 0x48, 0x8B, 0x08 });             // mov rcx, [rax]
+        a.emit({ 0x48, 0x89, 0x0E });             // mov [rsi], rcx
+        if (field->category_two) {
+            a.emit({ 0x48, 0x8B, 0x48, 0x08 });   // mov rcx, [rax + 8]
+            a.emit({ 0x48, 0x89, 0x4E, 0x08 });   // mov [rsi + 8], rcx
+        }
+        push(field->category_two ? 2 : 1);
+        return true;
+    }
+
+    bool putstatic(u2 index)
+    {
+        Field *field = resolvedField(index, true);
+        if (field == nullptr)
+            return false;
+        pop(field->category_two ? 2 : 1);
+        a.emit({ 0x48, 0xB8 }); a.emit8((u8) field->static_value.data); // mov rax, &static_value
+        a.emit({ 0x48, 0x8B, 0x0E });             // mov rcx, [rsi]
+        a.emit({ 0x48, 0x89, 0x08 });             // mov [rax], rcx
+        if (field->category_two) {
+            a.emit({ 0x48, 0x8B, 0x4E, 0x08 });   // mov rcx, [rsi + 8]
+            a.emit({ 0x48, 0x89, 0x48, 0x08 });   // mov [rax + 8], rcx
+        }
+        return true;
+    }
+
+    // ldc, ldc_w：只支持 int 和 float 常量
+    bool ldc(u2 index)
+    {
+        ConstantPool &cp = m->clazz->cp;
+        u1 type = cp.getType(index);
+        if (type == JVM_CONSTANT_Integer) {
+            pushImm32(cp.getInt(index));
+            return true;
+        }
+        if (type == JVM_CONSTANT_Float) {
+            jfloat f = cp.getFloat(index);
+            s4 bits;
+            memcpy(&bits, &f, 4);
+            a.emit({ 0xC7, 0x06 }); a.emit4(bits); // mov dword [rsi], imm32
+            push(1);
+            return true;
+        }
+        return false; // String, Class 等引用类型的常量留给解释器
+    }
+
+    bool ldc2_w(u2 index)
+    {
+        ConstantPool &cp = m->clazz->cp;
+        u1 type = cp.getType(index);
+        u8 bits;
+        if (type == JVM_CONSTANT_Long) {
+            jlong l = cp.getLong(index);
+            memcpy(&bits, &l, 8);
+        } else if (type == JVM_CONSTANT_Double) {
+            jdouble d = cp.getDouble(index);
+            memcpy(&bits, &d, 8);
+        } else {
+            return false;
+        }
+        pushImm64(bits);
+        return true;
+    }
+
+    // idiv, irem, ldiv, lrem
+    void divide(bool is_long, bool is_rem)
+    {
+        u1 w = is_long ? 0x48 : 0x40; // REX.W，int 时为空的 REX 前缀
+        u1 a_disp = is_long ? 0xF0 : 0xF8;
+        pop(is_long ? 2 : 1);
+        a.emit({ w, 0x8B, 0x0E });              // mov rcx, [rsi]
+        a.emit({ w, 0x85, 0xC9 });              // test rcx, rcx
+        exitIf(CC_EQ, JIT_EXIT_ARITHMETIC);
+        a.emit({ w, 0x8B, 0x46, a_disp });      // mov rax, [dividend]
+        // 除数为 -1 时单独处理，MIN_VALUE / -1 会使 idiv 产生 #DE
+        a.emit({ w, 0x83, 0xF9, 0xFF });        // cmp rcx, -1
+        size_t not_minus_one = a.jump8(0x75);   // jne
+        if (is_rem)
+            a.emit({ 0x31, 0xC0 });             // xor eax, eax
+        else
+            a.emit({ w, 0xF7, 0xD8 });          // neg rax
+        size_t done = a.jump8(0xEB);            // jmp
+        a.bind8(not_minus_one);
+        a.emit({ w, 0x99 });                    // cdq/cqo
+        a.emit({ w, 0xF7, 0xF9 });              // idiv rcx
+        if (is_rem)
+            a.emit({ w, 0x89, 0xD0 });          // mov rax, rdx
+        a.bind8(done);
+        a.emit({ w, 0x89, 0x46, a_disp });      // mov [dividend], rax
+    }
+
+    // fcmpl, fcmpg, dcmpl, dcmpg，@nan_value: 有 NaN 时的结果
+    void floatCompare(bool is_double, s4 nan_value)
+    {
+        if (is_double) {
+            pop(4);
+            a.emit({ 0xF2, 0x0F, 0x10, 0x06 });       // movsd xmm0, [rsi]
+            a.emit({ 0x66, 0x0F, 0x2E, 0x46, 0x10 }); // ucomisd xmm0, [rsi + 16]
+        } else {
+            pop(2);
+            a.emit({ 0xF3, 0x0F, 0x10, 0x06 });       // movss xmm0, [rsi]
+            a.emit({ 0x0F, 0x2E, 0x46, 0x08 });       // ucomiss xmm0, [rsi + 8]
+        }
+        a.emit({ 0xB9 }); a.emit4(nan_value);         // mov ecx, nan_value
+        size_t unordered = a.jump8(0x7A);             // jp
+        a.emit({ 0x0F, 0x97, 0xC0 });                 // seta al
+        a.emit({ 0x0F, 0x92, 0xC1 });                 // setb cl
+        a.emit({ 0x28, 0xC8 });                       // sub al, cl
+        a.emit({ 0x0F, 0xBE, 0xC8 });                 // movsx ecx, al
+        a.bind8(unordered);
+        a.emit({ 0x89, 0x0E });                       // mov [rsi], ecx
+        push(1);
+    }
+
+    // fadd, fsub, fmul, fdiv, dadd, dsub, dmul, ddiv，@op: SSE 指令的操作码
+    void floatArith(bool is_double, u1 op)
+    {
+        u1 prefix = is_double ? 0xF2 : 0xF3;
+        u1 disp = is_double ? 0xF0 : 0xF8;
+        pop(is_double ? 2 : 1);
+        a.emit({ prefix, 0x0F, 0x10, 0x46, disp }); // movss/movsd xmm0, [rsi - disp]
+        a.emit({ prefix, 0x0F, op, 0x06 });         // op xmm0, [rsi]
+        a.emit({ prefix, 0x0F, 0x11, 0x46, disp }); // movss/movsd [rsi - disp], xmm0
+    }
+
+    /*
+     * 在回边（向后的跳转指令）之前轮询安全点：有停顿请求时不执行跳转，退出到解释器，
+     * 由解释器重新执行这条跳转指令并在回边上停下。轮询在弹出操作数之前，frame 与解释器执行到这里时相同。
+     */
+    void safepointPoll()
+    {
+        a.emit({ 0x48, 0xB8 }); a.emit8((u8) &g_safepoint_requested); // mov rax, &g_safepoint_requested
+        a.emit({ 0x80, 0x38, 0x00 });                                // cmp byte [rax], 0
+        exitIf(CC_NE, JIT_EXIT_SAFEPOINT);
+    }
+
+    /*
+     * 循环的回边（goto 和 javac 在循环末尾生成的 if*）计入方法的回边次数，
+     * 用于决定是否用优化编译器重新编译。条件跳转不论是否跳转都计数。
+     */
+    void countBackedge()
+    {
+        a.emit({ 0x48, 0xB8 }); a.emit8((u8) &m->backedge_count); // mov rax, &backedge_count
+        a.emit({ 0xFF, 0x00 });                                  // inc dword [rax]
+    }
+
+    bool compileInstruction(BytecodeReader &r);
+
+public:
+    explicit TemplateCompiler(Method *m): m(m), offsets(m->code_len, -1) { }
+
+    // 编译方法，@osr 中返回各个循环头的栈上替换入口
+    JitCode compile(OsrTable *&osr);
+};
+
+// 编译一条指令，不支持的指令返回 false
+bool TemplateCompiler::compileInstruction(BytecodeReader &r)
+{
+    u1 opcode = r.readu1();
+    switch (opcode) {
+        case JVM_OPC_nop:
+            break;
+        case JVM_OPC_aconst_null:
+            pushImm32(0);
+            break;
+        case JVM_OPC_iconst_m1: case JVM_OPC_iconst_0: case JVM_OPC_iconst_1: case JVM_OPC_iconst_2:
+        case JVM_OPC_iconst_3: case JVM_OPC_iconst_4: case JVM_OPC_iconst_5:
+            pushImm32(opcode - JVM_OPC_iconst_0);
+            break;
+        case JVM_OPC_lconst_0: case JVM_OPC_lconst_1: {
+            jlong l = opcode - JVM_OPC_lconst_0;
+            pushImm64((u8) l);
+            break;
+        }
+        case JVM_OPC_fconst_0: case JVM_OPC_fconst_1: case JVM_OPC_fconst_2: {
+            jfloat f = (jfloat) (opcode - JVM_OPC_fconst_0);
+            s4 bits;
+            memcpy(&bits, &f, 4);
+            pushImm32(bits);
+            break;
+        }
+        case JVM_OPC_dconst_0: case JVM_OPC_dconst_1: {
+            jdouble d = opcode - JVM_OPC_dconst_0;
+            u8 bits;
+            memcpy(&bits, &d, 8);
+            pushImm64(bits);
+            break;
+        }
+        case JVM_OPC_bipush:
+            pushImm32(r.reads1());
+            break;
+        case JVM_OPC_sipush:
+            pushImm32(r.reads2());
+            break;
+        case JVM_OPC_ldc:
+            return ldc(r.readu1());
+        case JVM_OPC_ldc_w:
+            return ldc(r.readu2());
+        case JVM_OPC_ldc2_w:
+            return ldc2_w(r.readu2());
+
+        case JVM_OPC_iload: case JVM_OPC_fload: case JVM_OPC_aload:
+            load(r.readu1(), 1);
+            break;
+        case JVM_OPC_lload: case JVM_OPC_dload:
+            load(r.readu1(), 2);
+            break;
+        case JVM_OPC_iload_0: case JVM_OPC_iload_1: case JVM_OPC_iload_2: case JVM_OPC_iload_3:
+            load(opcode - JVM_OPC_iload_0, 1);
+            break;
+        case JVM_OPC_fload_0: case JVM_OPC_fload_1: case JVM_OPC_fload_2: case JVM_OPC_fload_3:
+            load(opcode - JVM_OPC_fload_0, 1);
+            break;
+        case JVM_OPC_aload_0: case JVM_OPC_aload_1: case JVM_OPC_aload_2: case JVM_OPC_aload_3:
+            load(opcode - JVM_OPC_aload_0, 1);
+            break;
+        case JVM_OPC_lload_0: case JVM_OPC_lload_1: case JVM_OPC_lload_2: case JVM_OPC_lload_3:
+            load(opcode - JVM_OPC_lload_0, 2);
+            break;
+        case JVM_OPC_dload_0: case JVM_OPC_dload_1: case JVM_OPC_dload_2: case JVM_OPC_dload_3:
+            load(opcode - JVM_OPC_dload_0, 2);
+            break;
+
+        case JVM_OPC_istore: case JVM_OPC_fstore: case JVM_OPC_astore:
+            store(r.readu1(), 1);
+            break;
+        case JVM_OPC_lstore: case JVM_OPC_dstore:
+            store(r.readu1(), 2);
+            break;
+        case JVM_OPC_istore_0: case JVM_OPC_istore_1: case JVM_OPC_istore_2: case JVM_OPC_istore_3:
+            store(opcode - JVM_OPC_istore_0, 1);
+            break;
+        case JVM_OPC_fstore_0: case JVM_OPC_fstore_1: case JVM_OPC_fstore_2: case JVM_OPC_fstore_3:
+            store(opcode - JVM_OPC_fstore_0, 1);
+            break;
+        case JVM_OPC_astore_0: case JVM_OPC_astore_1: case JVM_OPC_astore_2: case JVM_OPC_astore_3:
+            store(opcode - JVM_OPC_astore_0, 1);
+            break;
+        case JVM_OPC_lstore_0: case JVM_OPC_lstore_1: case JVM_OPC_lstore_2: case JVM_OPC_lstore_3:
+            store(opcode - JVM_OPC_lstore_0, 2);
+            break;
+        case JVM_OPC_dstore_0: case JVM_OPC_dstore_1: case JVM_OPC_dstore_2: case JVM_OPC_dstore_3:
+            store(opcode - JVM_OPC_dstore_0, 2);
+            break;
+
+        case JVM_OPC_iaload: case JVM_OPC_laload: case JVM_OPC_faload: case JVM_OPC_daload:
+        case JVM_OPC_aaload: case JVM_OPC_baload: case JVM_OPC_caload: case JVM_OPC_saload:
+            arrayLoad(opcode);
+            break;
+        case JVM_OPC_iastore: case JVM_OPC_lastore: case JVM_OPC_fastore: case JVM_OPC_dastore:
+        case JVM_OPC_castore: case JVM_OPC_sastore:
+            // aastore 要检查元素类型，bastore 要区分 byte[] 和 boolean[]，留给解释器
+            arrayStore(opcode);
+            break;
+        case JVM_OPC_arraylength:
+            a.emit({ 0x48, 0x8B, 0x46, 0xF8 });             // mov rax, [rsi - 8]
+            nullCheckRax();
+            a.emit({ 0x8B, 0x80 }); a.emit4(ARRAY_LENGTH_OFFSET); // mov eax, [rax + arr_len]
+            a.emit({ 0x89, 0x46, 0xF8 });                   // mov [rsi - 8], eax
+            break;
+
+        case JVM_OPC_pop:
+            pop(1);
+            break;
+        case JVM_OPC_pop2:
+            pop(2);
+            break;
+        case JVM_OPC_dup:
+            a.emit({ 0x48, 0x8B, 0x46, 0xF8 }); // mov rax, [rsi - 8]
+            a.emit({ 0x48, 0x89, 0x06 });       // mov [rsi], rax
+            push(1);
+            break;
+        case JVM_OPC_dup_x1:
+            a.emit({ 0x48, 0x8B, 0x46, 0xF0 }); // mov rax, [rsi - 16]
+            a.emit({ 0x48, 0x8B, 0x4E, 0xF8 }); // mov rcx, [rsi - 8]
+            a.emit({ 0x48, 0x89, 0x4E, 0xF0 }); // mov [rsi - 16], rcx
+            a.emit({ 0x48, 0x89, 0x46, 0xF8 }); // mov [rsi - 8], rax
+            a.emit({ 0x48, 0x89, 0x0E });       // mov [rsi], rcx
+            push(1);
+            break;
+        case JVM_OPC_dup2:
+            a.emit({ 0x48, 0x8B, 0x46, 0xF0 }); // mov rax, [rsi - 16]
+            a.emit({ 0x48, 0x8B, 0x4E, 0xF8 }); // mov rcx, [rsi - 8]
+            a.emit({ 0x48, 0x89, 0x06 });       // mov [rsi], rax
+            a.emit({ 0x48, 0x89, 0x4E, 0x08 }); // mov [rsi + 8], rcx
+            push(2);
+            break;
+        case JVM_OPC_swap:
+            a.emit({ 0x48, 0x8B, 0x46, 0xF8 }); // mov rax, [rsi - 8]
+            a.emit({ 0x48, 0x8B, 0x4E, 0xF0 }); // mov rcx, [rsi - 16]
+            a.emit({ 0x48, 0x89, 0x46, 0xF0 }); // mov [rsi - 16], rax
+            a.emit({ 0x48, 0x89, 0x4E, 0xF8 }); // mov [rsi - 8], rcx
+            break;
+
+        case JVM_OPC_iadd: case JVM_OPC_isub: case JVM_OPC_iand: case JVM_OPC_ior: case JVM_OPC_ixor: {
+            u1 op = opcode == JVM_OPC_iadd ? 0x01 : opcode == JVM_OPC_isub ? 0x29
+                  : opcode == JVM_OPC_iand ? 0x21 : opcode == JVM_OPC_ior ? 0x09 : 0x31;
+            pop(1);
+            a.emit({ 0x8B, 0x06 });             // mov eax, [rsi]
+            a.emit({ op, 0x46, 0xF8 });         // op [rsi - 8], eax
+            break;
+        }
+        case JVM_OPC_ladd: case JVM_OPC_lsub: case JVM_OPC_land: case JVM_OPC_lor: case JVM_OPC_lxor: {
+            u1 op = opcode == JVM_OPC_ladd ? 0x01 : opcode == JVM_OPC_lsub ? 0x29
+                  : opcode == JVM_OPC_land ? 0x21 : opcode == JVM_OPC_lor ? 0x09 : 0x31;
+            pop(2);
+            a.emit({ 0x48, 0x8B, 0x06 });       // mov rax, [rsi]
+            a.emit({ 0x48, op, 0x46, 0xF0 });   // op [rsi - 16], rax
+            break;
+        }
+        case JVM_OPC_imul:
+            pop(1);
+            a.emit({ 0x8B, 0x46, 0xF8 });       // mov eax, [rsi - 8]
+            a.emit({ 0x0F, 0xAF, 0x06 });       // imul eax, [rsi]
+            a.emit({ 0x89, 0x46, 0xF8 });       // mov [rsi - 8], eax
+            break;
+        case JVM_OPC_lmul:
+            pop(2);
+            a.emit({ 0x48, 0x8B, 0x46, 0xF0 }); // mov rax, [rsi - 16]
+            a.emit({ 0x48, 0x0F, 0xAF, 0x06 }); // imul rax, [rsi]
+            a.emit({ 0x48, 0x89, 0x46, 0xF0 }); // mov [rsi - 16], rax
+            break;
+        case JVM_OPC_idiv:
+            divide(false, false);
+            break;
+        case JVM_OPC_irem:
+            divide(false, true);
+            break;
+        case JVM_OPC_ldiv:
+            divide(true, false);
+            break;
+        case JVM_OPC_lrem:
+            divide(true, true);
+            break;
+        case JVM_OPC_ineg:
+            a.emit({ 0xF7, 0x5E, 0xF8 });       // neg dword [rsi - 8]
+            break;
+        case JVM_OPC_lneg:
+            a.emit({ 0x48, 0xF7, 0x5E, 0xF0 }); // neg qword [rsi - 16]
+            break;
+        case JVM_OPC_ishl: case JVM_OPC_ishr: case JVM_OPC_iushr: {
+            // x86 的移位指令只取 cl 的低5位，与 Java 的语义相同
+            u1 modrm = opcode == JVM_OPC_ishl ? 0x66 : opcode == JVM_OPC_iushr ? 0x6E : 0x7E;
+            pop(1);
+            a.emit({ 0x8B, 0x0E });             // mov ecx, [rsi]
+            a.emit({ 0xD3, modrm, 0xF8 });      // shl/shr/sar dword [rsi - 8], cl
+            break;
+        }
+        case JVM_OPC_lshl: case JVM_OPC_lshr: case JVM_OPC_lushr: {
+            u1 modrm = opcode == JVM_OPC_lshl ? 0x66 : opcode == JVM_OPC_lushr ? 0x6E : 0x7E;
+            pop(1);
+            a.emit({ 0x8B, 0x0E });             // mov ecx, [rsi]
+            a.emit({ 0x48, 0xD3, modrm, 0xF0 });// shl/shr/sar qword [rsi - 16], cl
+            break;
+        }
+        case JVM_OPC_iinc: {
+            u1 index = r.readu1();
+            s1 c = r.reads1();
+            a.emit({ 0x81, 0x87 }); a.emit4(lvar(index)); a.emit4(c); // add dword [rdi + lvar], c
+            break;
+        }
+
+        case JVM_OPC_fadd: floatArith(false, 0x58); break;
+        case JVM_OPC_fsub: floatArith(false, 0x5C); break;
+        case JVM_OPC_fmul: floatArith(false, 0x59); break;
+        case JVM_OPC_fdiv: floatArith(false, 0x5E); break;
+        case JVM_OPC_dadd: floatArith(true, 0x58); break;
+        case JVM_OPC_dsub: floatArith(true, 0x5C); break;
+        case JVM_OPC_dmul: floatArith(true, 0x59); break;
+        case JVM_OPC_ddiv: floatArith(true, 0x5E); break;
+        case JVM_OPC_fneg:
+            a.emit({ 0x81, 0x76, 0xF8 }); a.emit4(INT32_MIN); // xor dword [rsi - 8], 0x80000000
+            break;
+        case JVM_OPC_dneg:
+            a.emit({ 0x81, 0x76, 0xF4 }); a.emit4(INT32_MIN); // xor dword [rsi - 12], 0x80000000
+            break;
+
+        case JVM_OPC_i2l:
+            a.emit({ 0x48, 0x63, 0x46, 0xF8 });       // movsxd rax, dword [rsi - 8]
+            a.emit({ 0x48, 0x89, 0x46, 0xF8 });       // mov [rsi - 8], rax
+            push(1);
+            break;
+        case JVM_OPC_l2i:
+            pop(1); // 小端序，long 的低32位就是 int
+            break;
+        case JVM_OPC_i2f:
+            a.emit({ 0xF3, 0x0F, 0x2A, 0x46, 0xF8 });       // cvtsi2ss xmm0, dword [rsi - 8]
+            a.emit({ 0xF3, 0x0F, 0x11, 0x46, 0xF8 });       // movss [rsi - 8], xmm0
+            break;
+        case JVM_OPC_i2d:
+            a.emit({ 0xF2, 0x0F, 0x2A, 0x46, 0xF8 });       // cvtsi2sd xmm0, dword [rsi - 8]
+            a.emit({ 0xF2, 0x0F, 0x11, 0x46, 0xF8 });       // movsd [rsi - 8], xmm0
+            push(1);
+            break;
+        case JVM_OPC_l2f:
+            a.emit({ 0xF3, 0x48, 0x0F, 0x2A, 0x46, 0xF0 }); // cvtsi2ss xmm0, qword [rsi - 16]
+            a.emit({ 0xF3, 0x0F, 0x11, 0x46, 0xF0 });       // movss [rsi - 16], xmm0
+            pop(1);
+            break;
+        case JVM_OPC_l2d:
+            a.emit({ 0xF2, 0x48, 0x0F, 0x2A, 0x46, 0xF0 }); // cvtsi2sd xmm0, qword [rsi - 16]
+            a.emit({ 0xF2, 0x0F, 0x11, 0x46, 0xF0 });       // movsd [rsi - 16], xmm0
+            break;
+        case JVM_OPC_f2d:
+            a.emit({ 0xF3, 0x0F, 0x5A, 0x46, 0xF8 });       // cvtss2sd xmm0, [rsi - 8]
+            a.emit({ 0xF2, 0x0F, 0x11, 0x46, 0xF8 });       // movsd [rsi - 8], xmm0
+            push(1);
+            break;
+        case JVM_OPC_d2f:
+            a.emit({ 0xF2, 0x0F, 0x5A, 0x46, 0xF0 });       // cvtsd2ss xmm0, [rsi - 16]
+            a.emit({ 0xF3, 0x0F, 0x11, 0x46, 0xF0 });       // movss [rsi - 16], xmm0
+            pop(1);
+            break;
+        case JVM_OPC_i2b:
+            a.emit({ 0x0F, 0xBE, 0x46, 0xF8 });             // movsx eax, byte [rsi - 8]
+            a.emit({ 0x89, 0x46, 0xF8 });                   // mov [rsi - 8], eax
+            break;
+        case JVM_OPC_i2c:
+            a.emit({ 0x0F, 0xB7, 0x46, 0xF8 });             // movzx eax, word [rsi - 8]
+            a.emit({ 0x89, 0x46, 0xF8 });                   // mov [rsi - 8], eax
+            break;
+        case JVM_OPC_i2s:
+            a.emit({ 0x0F, 0xBF, 0x46, 0xF8 });             // movsx eax, word [rsi - 8]
+            a.emit({ 0x89, 0x46, 0xF8 });                   // mov [rsi - 8], eax
+            break;
+        // f2i, f2l, d2i, d2l 对 NaN 和溢出的处理与 x86 的 cvtt 指令不同，留给解释器
+
+        case JVM_OPC_lcmp:
+            pop(4);
+            a.emit({ 0x48, 0x8B, 0x06 });       // mov rax, [rsi]
+            a.emit({ 0x48, 0x3B, 0x46, 0x10 }); // cmp rax, [rsi + 16]
+            a.emit({ 0x0F, 0x9F, 0xC0 });       // setg al
+            a.emit({ 0x0F, 0x9C, 0xC1 });       // setl cl
+            a.emit({ 0x28, 0xC8 });             // sub al, cl
+            a.emit({ 0x0F, 0xBE, 0xC0 });       // movsx eax, al
+            a.emit({ 0x89, 0x06 });             // mov [rsi], eax
+            push(1);
+            break;
+        case JVM_OPC_fcmpl: floatCompare(false, -1); break;
+        case JVM_OPC_fcmpg: floatCompare(false, 1); break;
+        case JVM_OPC_dcmpl: floatCompare(true, -1); break;
+        case JVM_OPC_dcmpg: floatCompare(true, 1); break;
+
+        case JVM_OPC_ifeq: case JVM_OPC_ifne: case JVM_OPC_iflt:
+        case JVM_OPC_ifge: case JVM_OPC_ifgt: case JVM_OPC_ifle: {
+            static const Condition conds[] = { CC_EQ, CC_NE, CC_LT, CC_GE, CC_GT, CC_LE };
+            size_t target = pc + r.reads2();
+            pop(1);
+            a.emit({ 0x83, 0x3E, 0x00 });       // cmp dword [rsi], 0
+            jcc(conds[opcode - JVM_OPC_ifeq], target);
+            break;
+        }
+        case JVM_OPC_if_icmpeq: case JVM_OPC_if_icmpne: case JVM_OPC_if_icmplt:
+        case JVM_OPC_if_icmpge: case JVM_OPC_if_icmpgt: case JVM_OPC_if_icmple: {
+            static const Condition conds[] = { CC_EQ, CC_NE, CC_LT, CC_GE, CC_GT, CC_LE };
+            size_t target = pc + r.reads2();
+            pop(2);
+            a.emit({ 0x8B, 0x06 });             // mov eax, [rsi]
+            a.emit({ 0x3B, 0x46, 0x08 });       // cmp eax, [rsi + 8]
+            jcc(conds[opcode - JVM_OPC_if_icmpeq], target);
+            break;
+        }
+        case JVM_OPC_if_acmpeq: case JVM_OPC_if_acmpne: {
+            size_t target = pc + r.reads2();
+            pop(2);
+            a.emit({ 0x48, 0x8B, 0x06 });       // mov rax, [rsi]
+            a.emit({ 0x48, 0x3B, 0x46, 0x08 }); // cmp rax, [rsi + 8]
+            jcc(opcode == JVM_OPC_if_acmpeq ? CC_EQ : CC_NE, target);
+            break;
+        }
+        case JVM_OPC_ifnull: case JVM_OPC_ifnonnull: {
+            size_t target = pc + r.reads2();
+            pop(1);
+            a.emit({ 0x48, 0x83, 0x3E, 0x00 }); // cmp qword [rsi], 0
+            jcc(opcode == JVM_OPC_ifnull ? CC_EQ : CC_NE, target);
+            break;
+        }
+        case JVM_OPC_goto:
+            jmp(pc + r.reads2());
+            break;
+        case JVM_OPC_goto_w:
+            jmp(pc + r.reads4());
+            break;
+
+        case JVM_OPC_ireturn: case JVM_OPC_lreturn: case JVM_OPC_freturn:
+        case JVM_OPC_dreturn: case JVM_OPC_areturn: case JVM_OPC_return:
+            // 返回值留在操作数栈上，由解释器复制到调用者的栈中
+            a.emit({ 0x48, 0x89, 0xF0 });       // mov rax, rsi
+            a.emit({ 0xC3 });                   // ret
+            break;
+
+        case JVM_OPC_getstatic:
+            return getstatic(r.readu2());
+        case JVM_OPC_putstatic:
+            return putstatic(r.readu2());
+        case JVM_OPC_getfield:
+            return getfield(r.readu2());
+        case JVM_OPC_putfield:
+            return putfield(r.readu2());
+
+        case JVM_OPC_wide: {
+            opcode = r.readu1();
+            u2 index = r.readu2();
+            switch (opcode) {
+                case JVM_OPC_iload: case JVM_OPC_fload: case JVM_OPC_aload:
+                    load(index, 1);
+                    break;
+                case JVM_OPC_lload: case JVM_OPC_dload:
+                    load(index, 2);
+                    break;
+                case JVM_OPC_istore: case JVM_OPC_fstore: case JVM_OPC_astore:
+                    store(index, 1);
+                    break;
+                case JVM_OPC_lstore: case JVM_OPC_dstore:
+                    store(index, 2);
+                    break;
+                case JVM_OPC_iinc: {
+                    s2 c = r.reads2();
+                    a.emit({ 0x81, 0x87 }); a.emit4(lvar(index)); a.emit4(c); // add dword [rdi + lvar], c
+                    break;
+                }
+                default:
+                    return false;
+            }
+            break;
+        }
+
+        default:
+            // 调用、对象分配、类型检查、switch、同步、浮点数转整数等，留给解释器
+            return false;
+    }
+    return true;
+}
+
+// @pc 处的指令是否为向后的跳转
+static bool isBackwardBranch(const u1 *code, size_t pc)
+{
+    u1 opcode = code[pc];
+    s4 offset;
+    if ((JVM_OPC_ifeq <= opcode && opcode <= JVM_OPC_goto)
+                || opcode == JVM_OPC_ifnull || opcode == JVM_OPC_ifnonnull) {
+        offset = (s2) ((code[pc + 1] << 8) | code[pc + 2]);
+    } else if (opcode == JVM_OPC_goto_w) {
+        offset = (s4) (((u4) code[pc + 1] << 24) | ((u4) code[pc + 2] << 16)
+                                | ((u4) code[pc + 3] << 8) | code[pc + 4]);
+    } else {
+        return false;
+    }
+    return offset <= 0;
+}
+
+JitCode TemplateCompiler::compile(OsrTable *&osr)
+{
+    a.emit({ 0x49, 0x89, 0xD3 }); // mov r11, rdx
+    a.emit({ 0x49, 0x89, 0xF2 }); // mov r10, rsi
+
+    BytecodeReader r(m->code, m->code_len);
+    while (r.hasMore()) {
+        pc = r.pc;
+        offsets[pc] = (s4) a.pos();
+        if (isBackwardBranch(m->code, pc)) {
+            safepointPoll();
+            countBackedge();
+        }
+        if (!compileInstruction(r))
+            return nullptr;
+    }
+
+    for (auto &b : branches) {
+        if (b.target_pc >= m->code_len || offsets[b.target_pc] < 0)
+            return nullptr; // 非法的跳转目标，让解释器报告错误
+        a.patch4(b.at, (size_t) offsets[b.target_pc]);
+    }
+
+    /*
+     * 栈上替换的入口：向后跳转的目标是循环头，解释器在循环头处可以转入编译后的代码。
+     * 编译后的代码与解释器使用同一个 frame，rsi 就是解释器当前的栈顶，入口只需设置 r11。
+     */
+    vector<pair<u4, size_t>> osr_entries;
+    for (auto &b : branches) {
+        size_t target = (size_t) offsets[b.target_pc];
+        if (target > b.at)
+            continue; // 向前的跳转
+        bool found = false;
+        for (auto &e : osr_entries)
+            found = found || e.first == b.target_pc;
+        if (found)
+            continue;
+        osr_entries.emplace_back((u4) b.target_pc, a.pos());
+        a.emit({ 0x49, 0x89, 0xD3 });      // mov r11, rdx
+        a.emit({ 0x49, 0x89, 0xF2 });      // mov r10, rsi
+        a.patch4(a.jmp32(), target);      // jmp loop_header
+    }
+
+    // 异常出口和安全点出口：记录退出的位置，返回 nullptr
+    for (auto &s : stubs) {
+        a.patch4(s.at, a.pos());
+        a.emit({ 0x41, 0xC7, 0x03 }); a.emit4((s4) s.pc);             // mov dword [r11], pc
+        a.emit({ 0x41, 0xC7, 0x43, 0x04 }); a.emit4((s4) s.kind);     // mov dword [r11 + 4], kind
+        if (s.kind == JIT_EXIT_ARRAY_INDEX)
+            a.emit({ 0x41, 0x89, 0x4B, 0x08 });                      // mov [r11 + 8], ecx
+        if (s.kind == JIT_EXIT_SAFEPOINT) {
+            // frame 与解释器共用，只需告诉解释器栈顶的位置
+            a.emit({ 0x48, 0x89, 0xF0 });                            // mov rax, rsi
+            a.emit({ 0x4C, 0x29, 0xD0 });                            // sub rax, r10
+            a.emit({ 0x48, 0xC1, 0xE8, 0x03 });                      // shr rax, 3
+            a.emit({ 0x41, 0x89, 0x43, 0x0C });                      // mov [r11 + 12], eax
+        }
+        a.emit({ 0x31, 0xC0 });                                      // xor eax, eax
+        a.emit({ 0xC3 });                                            // ret
+    }
+
+    auto code = (u1 *) installCode(a.data(), a.pos());
+    if (code != nullptr && !osr_entries.empty()) {
+        osr = new OsrTable;
+        for (auto &[entry_pc, offset] : osr_entries)
+            osr->entries.push_back({ entry_pc, (JitCode) (code + offset) });
+    }
+    return (JitCode) code;
+}
+
+} // namespace
+
+JitCode jitCompile(Method *m)
+{
+    assert(m != nullptr);
+
+    int expected = JIT_NOT_COMPILED;
+    if (!m->jit_state.compare_exchange_strong(expected, JIT_COMPILING))
+        return (JitCode) m->jit_code.load(memory_order_acquire); // 其他线程已经在编译了
+
+    JitCode code = nullptr;
+    OsrTable *osr = nullptr;
+    if (!m->isNative() && !m->isSynchronized() && m->code != nullptr) {
+        code = TemplateCompiler(m).compile(osr);
+    }
+
+    if (code == nullptr) {
+        m->jit_state.store(JIT_NOT_COMPILABLE);
+        return nullptr;
+    }
+
+    m->osr_table.store(osr, memory_order_release);
+    m->jit_code.store((void *) code, memory_order_release);
+    m->jit_state.store(JIT_COMPILED);
+    if (print_compilation) {
+        printf("jit: compiled %s (%zu bytes of bytecode)\n", m->toString().c_str(), m->code_len);
+    }
+    return code;
+}
+
+JitCode OsrTable::lookup(size_t pc) const
+{
+    for (auto &e : entries) {
+        if (e.pc == pc)
+            return e.code;
+    }
+    return nullptr;
+}
+
+JitCode getOsrCode(Method *m, size_t pc)
+{
+    if (!jit_enabled)
+        return nullptr;
+
+    if (m->jit_state.load(memory_order_relaxed) == JIT_NOT_COMPILED) {
+        if (m->invocation_count + m->backedge_count < JIT_COMPILE_THRESHOLD)
+            return nullptr;
+        jitCompile(m);
+    }
+
+    OsrTable *osr = m->osr_table.load(memory_order_acquire);
+    return osr != nullptr ? osr->lookup(pc) : nullptr;
+}
+
+#else
+
+JitCode getOsrCode(Method *m, size_t pc)
+{
+    return nullptr;
+}
+
+JitCode jitCompile(Method *m)
+{
+    // 不支持的平台上只用解释器执行
+    m->jit_state.store(JIT_NOT_COMPILABLE);
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include "cha.h"
+#include "class.h"
+#include "method.h"
+#include "../interpreter/threaded_code.h"
+#include "../jit/jit.h"
+
+using namespace std;
+
+// 依赖于某个方法只有一个实现的代码
+struct Dependents {
+    vector<pair<Cell *, const void *>> call_sites; // 已绑定的调用点，以及撤销时恢复的 handler
+    vector<Method *> opt_methods; // 优化编译的代码依赖于此的方法
+};
+
+// 类层次的更新、调用点的绑定和撤销都在此锁下进行
+static mutex cha_mutex;
+static unordered_map<Method *, Dependents> dependents;
+
+// 撤销依赖于 @m 只有一个实现的代码
+static void invalidate(Method *m)
+{
+    auto iter = dependents.find(m);
+    if (iter == dependents.end())
+        return;
+
+    atomic_thread_fence(memory_order_release);
+    for (auto &[cell, handler] : iter->second.call_sites) {
+        // 只改 handler，操作数不变，之后执行到此调用点时按原来的快速指令分派
+        cell->handler = handler;
+    }
+
+    for (Method *c : iter->second.opt_methods) {
+        // 已被其他依赖撤销过，或者去优化过多不再编译的，不用处理
+        if (c->opt_state.load(memory_order_relaxed) != OPT_COMPILED)
+            continue;
+        c->opt_code.store(nullptr, memory_order_release);
+        c->deopt_count = 0;
+        c->opt_state.store(OPT_NOT_COMPILED, memory_order_relaxed); // 按新的类层次重新编译
+    }
+
+    dependents.erase(iter);
+}
+
+// 接收者是新加载的类的对象时，调用 @m 执行的是 @impl
+static void addImplementation(Method *m, Method *impl)
+{
+    if (m->polymorphic.load(memory_order_relaxed))
+        return;
+
+    Method *u = m->unique_impl.load(memory_order_relaxed);
+    if (u == impl)
+        return;
+
+    // 接口方法的实现不是 public 的，调用时要抛出 IllegalAccessError，不能绑定
+    bool usable = impl != nullptr && !impl->isAbstract()
+                  && (!m->clazz->isInterface() || impl->isPublic());
+    if (u == nullptr && usable) {
+        m->unique_impl.store(impl, memory_order_release);
+        return;
+    }
+
+    // 第二个实现，或者没有可用的实现。
+    // unique_impl 保持不变：与撤销并发执行的已绑定调用点仍可以使用它，见 opc_invokedirect_quick
+    m->polymorphic.store(true, memory_order_release);
+    invalidate(m);
+}
+
+void recordClassHierarchy(Class *c)
+{
+    assert(c != nullptr);
+
+    // 接口和抽象类没有实例，不会成为接收者
+    if (c->isInterface() || c->isAbstract())
+        return;
+
+    lock_guard<mutex> lock(cha_mutex);
+
+    for (Class *s = c; s != nullptr; s = s->super_class) {
+        for (Method *m : s->methods) {
+            if (m->isVirtual() && m->vtable_index >= 0)
+                addImplementation(m, c->vtable[m->vtable_index]);
+        }
+    }
+
+    for (auto &[ifc, offset] : c->itable.interfaces) {
+        for (Method *m : ifc->methods) {
+            if (m->itable_index >= 0)
+                addImplementation(m, c->itable.methods[offset + m->itable_index]);
+        }
+    }
+}
+
+Method *bindCallSite(Method *m, Cell *cell, const void *bound_handler, const void *revert_handler)
+{
+    assert(m != nullptr && cell != nullptr);
+
+    lock_guard<mutex> lock(cha_mutex);
+
+    Method *impl = m->unique_impl.load(memory_order_relaxed);
+    if (impl == nullptr || m->polymorphic.load(memory_order_relaxed))
+        return nullptr;
+
+    dependents[m].call_sites.emplace_back(cell, revert_handler);
+    atomic_thread_fence(memory_order_release);
+    cell->handler = bound_handler;
+    return impl;
+}
+
+bool installOptCode(Method *m, void *code, const vector<Method *> &assumed)
+{
+    assert(m != nullptr && code != nullptr);
+
+    lock_guard<mutex> lock(cha_mutex);
+
+    for (Method *a : assumed) {
+        if (a->polymorphic.load(memory_order_relaxed))
+            return false;
+    }
+
+    for (Method *a : assumed) {
+        vector<Method *> &v = dependents[a].opt_methods;
+        if (find(v.begin(), v.end(), m) == v.end())
+            v.push_back(m);
+    }
+
+    m->opt_code.store(code, memory_order_release);
+    m->opt_state.store(OPT_COMPILED, memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef CABIN_CHA_H
+#define CABIN_CHA_H
+
+#include <vector>
+#include "../cabin.h"
+
+class Class;
+class Method;
+union Cell;
+
+/*
+ * 类层次分析（class hierarchy analysis, CHA）
+ *
+ * 对每个参与分派的方法 m（见 Method::isVirtual），记录它在所有已加载的、可以实例化的子类型中的实现：
+ * 只有一个实现时 m->unique_impl 就是它，调用 m 的 invokevirtual 和 invokeinterface 调用点
+ * 可以直接绑定到这个实现，不再查 vtable、itable 或内联缓存。
+ * 新加载的类带来第二个实现后，m->polymorphic 被置位，之后不再改变（类不会被卸载）。
+ *
+ * 依赖于“m 只有一个实现”的代码在这里登记，m 变为多态时撤销：
+ *   解释器中已绑定的调用点，handler 改回原来的快速指令（见 bindCallSite）；
+ *   优化编译的代码被撤下，之后重新编译（见 installOptCode），
+ *   正在执行的编译代码在绑定处检查 m->polymorphic，失败时去优化回到解释器（见 IR_CHA_CHECK）。
+ *
+ * 撤销在新类的构造函数中完成，新类加载完成前不会有它的实例，
+ * 所以即使有 frame 正在执行已绑定的调用点，也不会把新类的对象分派到错误的方法。
+ */
+
+// 记录新加载的类 @c 中方法的实现，在 c 的 vtable 和 itable 创建之后调用
+void recordClassHierarchy(Class *c);
+
+/*
+ * 把调用点 @cell（调用指令开头的 cell）绑定到 @m 唯一的实现，handler 改为 @bound_handler，
+ * m 变为多态时改回 @revert_handler。两个 handler 的操作数须相同。
+ * 返回 m 唯一的实现，没有时不绑定，返回 nullptr。
+ */
+Method *bindCallSite(Method *m, Cell *cell, const void *bound_handler, const void *revert_handler);
+
+/*
+ * 发布方法 @m 优化编译后的代码 @code，它假定 @assumed 中的方法都只有一个实现。
+ * 有方法已经变为多态时不发布，返回 false。
+ */
+bool installOptCode(Method *m, void *code, const std::vector<Method *> &assumed);
+
+#endif //CABIN_CHA_H
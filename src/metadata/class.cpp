@@ -4,9 +4,14 @@
 #include <cassert>
 #include <iostream>
 #include "../runtime/vm_thread.h"
+#include "../runtime/safepoint.h"
+#include "../debug.h"
 #include "class.h"
 #include "method.h"
+#include "cha.h"
 #include "../objects/array.h"
+#include "../objects/class_loader.h"
+#include "../heap/heap.h"
 #include "../interpreter/interpreter.h"
 #include "../objects/prims.h"
 #include "../objects/mh.h"
@@ -23,13 +28,18 @@ void Class::calcFieldsId()
     int ins_id = 0;
     if (super_class != nullptr) {
         ins_id = super_class->inst_fields_count; // todo 父类的私有变量是不是也算在了里面，不过问题不大，浪费点空间吧了
+        inst_ref_slots = super_class->inst_ref_slots;
     }
 
     for (Field *f: fields) {
         if (!f->isStatic()) {
+            if (!f->isPrim())
+                inst_ref_slots.push_back(ins_id);
             f->id = ins_id++;
             if (f->category_two)
                 ins_id++;
+        } else if (!f->isPrim()) {
+            static_ref_fields.push_back(f);
         }
     }
 
@@ -126,34 +136,40 @@ void Class::createVtable()
 {
     assert(vtable.empty());
 
-    if (super_class == nullptr) {
-        int i = 0;
-        for (auto &m : methods) {
-            if (m->isVirtual()) {
-                vtable.push_back(m);
-                m->vtable_index = i++;
-            }
-        }
-        return;
+    // 将父类的vtable复制过来
+    if (super_class != nullptr) {
+        vtable.assign(super_class->vtable.begin(), super_class->vtable.end());
     }
 
-    // 将父类的vtable复制过来
-    vtable.assign(super_class->vtable.begin(), super_class->vtable.end());
+    // 接口中的方法通过 itable 分派，不进入 vtable
+    if (isInterface())
+        return;
 
     for (auto m : methods) {
-        if (m->isVirtual()) {
-            auto iter = find_if(vtable.begin(), vtable.end(), [=](Method *m0){
-                return utf8::equals(m->name, m0->name) && utf8::equals(m->descriptor, m0->descriptor); });
-            if (iter != vtable.end()) {
+        if (!m->isVirtual())
+            continue;
+
+        // 一个方法可能同时重写多个 vtable 项，
+        // 比如父类中有一个包私有方法，和一个与之签名相同的、由其他包中的类定义的 public 方法。
+        bool overridden = false;
+        for (size_t i = 0; i < vtable.size(); i++) {
+            Method *m0 = vtable[i];
+            if (utf8::equals(m->name, m0->name) && utf8::equals(m->descriptor, m0->descriptor)
+                        && m->canOverride(m0)) {
                 // 重写了父类的方法，更新
-                m->vtable_index = (*iter)->vtable_index;
-                *iter = m;
-            } else {
-                // 子类定义了要给新方法，加到 vtable 后面
-                vtable.push_back(m);
-                m->vtable_index = vtable.size() - 1;
+                vtable[i] = m;
+                if (!overridden) {
+                    m->vtable_index = i;
+                    overridden = true;
+                }
             }
         }
+
+        if (!overridden) {
+            // 子类定义了一个新方法，加到 vtable 后面
+            vtable.push_back(m);
+            m->vtable_index = vtable.size() - 1;
+        }
     }
 }
 
@@ -170,28 +186,80 @@ Class::ITable& Class::ITable::operator=(const Class::ITable &itable)
     return *this;
 }
 
-void Class::ITable::add(const ITable &itable)
+Method *Class::findFromITable(Class *interface_class, int itable_index)
 {
-    for (auto ifc: itable.interfaces) {
-        interfaces.emplace_back(ifc.first, methods.size());  
-        for (auto m: itable.methods) 
-            methods.push_back(m);
+    assert(interface_class != nullptr && interface_class->isInterface());
+    assert(itable_index >= 0);
+
+    // 先检查上次查找到的接口，同一个类上的接口调用往往集中在同一个接口上
+    size_t n = itable.interfaces.size();
+    size_t last = itable.last_hit.load(memory_order_relaxed);
+    if (last >= n || itable.interfaces[last].first != interface_class) {
+        for (last = 0; last < n; last++) {
+            if (itable.interfaces[last].first == interface_class)
+                break;
+        }
+        if (last == n)
+            return nullptr; // 本类没有实现此接口
+        itable.last_hit.store(last, memory_order_relaxed);
     }
+
+    size_t offset = itable.interfaces[last].second;
+    assert(offset + itable_index < itable.methods.size());
+    return itable.methods[offset + itable_index];
 }
 
-Method *Class::findFromITable(Class *interface_class, int itable_index)
+Method *Class::dispatch(Method *resolved)
 {
-    assert(interface_class != nullptr && interface_class->isInterface());
+    assert(resolved != nullptr);
+
+    Method *m;
+    if (resolved->isPrivate()) {
+        // 私有方法不参与分派（比如 invokeinterface 调用接口的私有方法）
+        m = resolved;
+    } else if (resolved->clazz->isInterface()) {
+        m = findFromITable(resolved->clazz, resolved->itable_index);
+    } else {
+        assert(0 <= resolved->vtable_index && resolved->vtable_index < (int) vtable.size());
+        m = vtable[resolved->vtable_index];
+    }
 
-    for (auto interface: itable.interfaces) {
-        if (interface.first->equals(interface_class)) {
-            size_t offset = interface.second;
-            assert(offset + itable_index < itable.methods.size());
-            return itable.methods[offset + itable_index];
-        }
+#if CHECK_DISPATCH
+    Method *m0 = lookupMethod(resolved->name, resolved->descriptor);
+    if (m != m0) {
+        // 两者对包私有方法和 default 方法的处理不同，不一致不一定是错误，只打印出来。
+        printvm("dispatch mismatch: %s, table: %s, lookup: %s\n", class_name,
+                m != nullptr ? m->toString().c_str() : "null", m0 != nullptr ? m0->toString().c_str() : "null");
     }
+#endif
 
-    return nullptr;
+    return m;
+}
+
+Method *Class::selectInterfaceMethod(Method *im, const vector<Class *> &all_interfaces)
+{
+    assert(im != nullptr && im->clazz->isInterface());
+    assert(!isInterface());
+
+    // 在本类及父类中查找（JVMS 5.4.6）
+    for (Class *c = this; c != nullptr; c = c->super_class) {
+        Method *m = c->getDeclaredMethod(im->name, im->descriptor, false);
+        if (m != nullptr && !m->isStatic() && !m->isPrivate())
+            return m;
+    }
+
+    // 在所有实现的接口中查找最具体的（maximally-specific）方法，
+    // 没有找到或者找到的是抽象方法，就返回 im 本身（abstract，调用时抛出 AbstractMethodError）。
+    Method *selected = nullptr;
+    for (Class *ifc : all_interfaces) {
+        Method *m = ifc->getDeclaredMethod(im->name, im->descriptor, false);
+        if (m == nullptr || m->isStatic() || m->isPrivate())
+            continue;
+        if (selected == nullptr || ifc->isSubclassOf(selected->clazz))
+            selected = m;
+    }
+
+    return (selected != nullptr && !selected->isAbstract()) ? selected : im;
 }
 
 /*
@@ -203,64 +271,50 @@ Method *Class::findFromITable(Class *interface_class, int itable_index)
  */
 void Class::createItable()
 {
+    assert(itable.interfaces.empty());
+
     if (isInterface()) {
         // 接口间的继承虽然用 extends 关键字（可以同时继承多个接口），但被继承的接口不是子接口的 super_class，
-        // 而是在子接口的 interfaces 里面。所以接口的 super_class 就是 java/lang/Object 
+        // 而是在子接口的 interfaces 里面。所以接口的 super_class 就是 java/lang/Object
 
-        for (Class *super_interface: interfaces) {
-            itable.add(super_interface->itable);
-        }
-
-        itable.interfaces.emplace_back(this, itable.methods.size());
+        // 接口中可以被 invokeinterface 分派的方法（包括 default 方法）按声明顺序编号，
+        // 编号是相对于本接口在实现类 itable 中的 offset 的。
         int index = 0;
         for (Method *m : methods) {
-            // todo default 方法怎么处理？进不进 itable？
-            // todo 调用 default 方法 生成什么调用指令？
-            m->itable_index = index++;
-            itable.methods.push_back(m);
+            if (!m->isStatic() && !m->isPrivate()) {
+                m->itable_index = index++;
+            }
         }
-        
-        return;
     }
 
-    /* parse non interface class */
+    // 收集实现的所有接口，包括父类实现的接口、父接口，以及接口本身。每个接口只出现一次。
+    vector<Class *> all_interfaces;
+    auto add_interface = [&](Class *ifc) {
+        if (find(all_interfaces.begin(), all_interfaces.end(), ifc) == all_interfaces.end())
+            all_interfaces.push_back(ifc);
+    };
 
     if (super_class != nullptr) {
-        itable = super_class->itable;
+        for (auto &p : super_class->itable.interfaces)
+            add_interface(p.first);
+    }
+    for (Class *ifc : interfaces) {
+        // ifc 的 itable.interfaces 中包含了它的所有父接口和它自己
+        for (auto &p : ifc->itable.interfaces)
+            add_interface(p.first);
+    }
+    if (isInterface()) {
+        add_interface(this);
     }
 
-    for (auto ifc : interfaces) {
-        for (auto tmp : itable.interfaces) {
-            if (ifc->equals(tmp.first)) {
-                // 此接口已经在 itable.interfaces 中了
-                goto next;
-            }
-        }
-
-        // 发现一个新实现的接口
+    for (Class *ifc : all_interfaces) {
         itable.interfaces.emplace_back(ifc, itable.methods.size());
-        // 检查新实现接口的方法是不是已经被重写了
-        for (auto m: ifc->methods) {
-            for (auto m0: itable.methods) {
-                if (utf8::equals(m->name, m0->name) && utf8::equals(m->descriptor, m0->descriptor)) {
-                    m = m0; // 重写了接口方法，更新
-                    break;
-                }
-            }
-            itable.methods.push_back(m);
-        }
-next:;
-    }
-    
-    // 遍历 itable.methods，检查有没有接口函数在本类中被重写了。
-    for (size_t i = 0; i < itable.methods.size(); i++) {
-        auto m = itable.methods[i];
-        for (auto m0 : methods) {
-            if (utf8::equals(m->name, m0->name) && utf8::equals(m->descriptor, m0->descriptor)) {
-                //m0->itable_index = m->itable_index;
-                itable.methods[i] = m0; // 重写了接口方法，更新
-                break;
-            }
+        for (Method *m : ifc->methods) {
+            if (m->itable_index < 0)
+                continue;
+            assert(itable.methods.size() == itable.interfaces.back().second + m->itable_index);
+            // 接口的 itable 只用来记录其父接口，接口方法不需要选择实现
+            itable.methods.push_back(isInterface() ? m : selectInterfaceMethod(m, all_interfaces));
         }
     }
 }
@@ -465,6 +519,7 @@ Class::Class(Object *loader, u1 *bytecode, size_t len): loader(loader), bytecode
     createVtable(); // todo 接口有没有必要创建 vtable
     createItable();
     generateIndepInterfaces();
+    recordClassHierarchy(this);
 
     if (g_class_class != nullptr) {
         generateClassObject();
@@ -528,6 +583,7 @@ Class::Class(Object *loader, const char *class_name)
     createVtable();
     createItable();
     generateIndepInterfaces();
+    recordClassHierarchy(this);
 
     if (g_class_class != nullptr) {
         generateClassObject();
@@ -537,10 +593,24 @@ Class::Class(Object *loader, const char *class_name)
 }
 
 
+Class::Registration::Registration(Class *c): c(c)
+{
+    registerClass(c);
+}
+
+Class::Registration::~Registration()
+{
+    unregisterClass(c);
+}
+
 Class::~Class()
 {
     delete[] bytecode;
 
+    for (auto &p : indy_call_sites) {
+        delete p.second;
+    }
+
     // todo something else
 }
 
@@ -550,7 +620,8 @@ void Class::clinit()
         return;
     }
 
-    scoped_lock lock(clinit_mutex);
+    // <clinit> 中可能发生 GC，等待其他线程初始化完成时不能阻止 GC
+    SafeLockGuard<mutex> lock(clinit_mutex);
     if (inited) { // 需要再次判断 inited，有可能被其他线程置为 true
         return;
     }
@@ -615,8 +686,8 @@ void Class::generateClassObject()
         assert(g_class_class != nullptr);
         static size_t size = sizeof(ClsObj) + g_class_class->inst_fields_count * sizeof(slot_t);
 
-        // Class Object不在堆上分配，因为此对象无需gc。
-        java_mirror = new(calloc(1, size)) Object(g_class_class);
+        // 类对象和类一样长期存在，直接分配在老年代中，不在年轻代中来回复制
+        java_mirror = new(g_heap->allocOld(size)) Object(g_class_class);
         java_mirror->jvm_mirror = this;
 
         // private final ClassLoader classLoader;
@@ -742,6 +813,8 @@ void Class::injectInstField(const utf8_t *name, const utf8_t *descriptor)
     fields.push_back(f);
 
     f->id = inst_fields_count;
+    if (!f->isPrim())
+        inst_ref_slots.push_back(f->id);
 
     inst_fields_count++;
     if (f->category_two)
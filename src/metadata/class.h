@@ -6,7 +6,9 @@
 #include <cassert>
 #include <cstring>
 #include <unordered_set>
+#include <unordered_map>
 #include <mutex>
+#include <atomic>
 #include "../cabin.h"
 #include "constant_pool.h"
 #include "../objects/class_loader.h"
@@ -19,6 +21,16 @@
 class Method;
 class Field;
 
+/*
+ * 已链接的 invokedynamic 调用点
+ */
+struct InvokeDynamicCallSite {
+    Object *call_site;    // java/lang/invoke/CallSite, bootstrap method 的返回值
+    Object *invoker;      // call_site.dynamicInvoker()
+    Method *invoke_exact; // invoker 的 invokeExact 方法
+    int args_slots_count; // 调用点的参数占用的 slot 数
+};
+
 /*
  * The metadata of a class.
  */
@@ -91,21 +103,43 @@ public:
     // 类型二统计为两个数量
     int inst_fields_count = 0;
 
+    /*
+     * 字段的引用映射，GC 扫描对象和类时使用，在 calcFieldsId 中计算：
+     * inst_ref_slots: 实例中保存引用的 slot 在 Object::data 中的下标，包括继承来的字段；
+     * static_ref_fields: 本类中引用类型的静态字段。
+     */
+    std::vector<int> inst_ref_slots;
+    std::vector<Field *> static_ref_fields;
+
     // vtable 只保存虚方法。
-    // 该类所有函数自有函数（除了private, static, final, abstract）和 父类的函数虚拟表。
+    // 该类所有函数自有函数（除了private, static, <init>）和 父类的函数虚拟表。
+    // 接口的 vtable 和 java/lang/Object 的相同，接口中的方法只在 itable 中。
     std::vector<Method *> vtable;
 
+    /*
+     * 本类实现的每个接口（包括父类实现的和父接口）在 methods 中占据一段，
+     * 接口方法 m 的实现位于 methods[offset + m->itable_index]。
+     * 没有实现的接口方法（miranda 方法）保存的是接口方法本身。
+     */
     struct ITable {
         std::vector<std::pair<Class *, size_t /* offset */>> interfaces;
         std::vector<Method *> methods;
+        std::atomic<size_t> last_hit{0}; // 上次查找到的接口在 interfaces 中的位置
 
         ITable() = default;
         ITable(const ITable &itable);
         ITable& operator=(const ITable &itable);
-        void add(const ITable &itable);
     } itable;
     Method *findFromITable(Class *interface_class, int index);
 
+    /*
+     * 虚方法分派：返回已解析的方法 @resolved 在本类（接收者的实际类型）中的实现。
+     * 由 invokevirtual 和 invokeinterface 使用。
+     * 类中声明的方法通过 vtable 分派，接口中声明的方法（包括 default 和 miranda 方法）通过 itable 分派。
+     * 本类没有实现 @resolved 所在的接口时返回 nullptr。
+     */
+    Method *dispatch(Method *resolved);
+
     struct {
         Class *clazz = nullptr;       // the immediately enclosing class
         Object *name = nullptr;       // the immediately enclosing method or constructor's name (can be null).
@@ -120,6 +154,13 @@ public:
 
     std::vector<BootstrapMethod> bootstrap_methods;
 
+    /*
+     * 已链接的 invokedynamic 调用点，key 为常量池中 InvokeDynamic 常量的索引。
+     * 每个调用点只链接一次，并发链接时只保留先完成的，见 linkInvokeDynamic。
+     */
+    std::unordered_map<u2, InvokeDynamicCallSite *> indy_call_sites;
+    std::mutex indy_mutex;
+
     std::vector<Annotation> rt_visi_annos;   // runtime visible annotations
     std::vector<Annotation> rt_invisi_annos; // runtime invisible annotations
 
@@ -150,10 +191,24 @@ private:
     void createItable();
     void generateIndepInterfaces();
 
+    // 为接口方法 @im 选择本类中的实现，@all_interfaces: 本类实现的所有接口。
+    Method *selectInterfaceMethod(Method *im, const std::vector<Class *> &all_interfaces);
+
     u1 *bytecode = nullptr;
 
     std::mutex clinit_mutex;
 
+    /*
+     * 构造开始时就登记到所有的类中（见 getAllClasses），析构或者构造失败时注销。
+     * 构造中会分配对象（类对象、enclosing 的名字等）、加载其他的类，可能发生 GC，
+     * GC 要能更新构造中的类引用的对象。
+     */
+    struct Registration {
+        Class *c;
+        explicit Registration(Class *c);
+        ~Registration();
+    } registration{this};
+
     Class(Object *loader, u1 *bytecode, size_t len);
 
     // 创建数组或 primitive class，这两种类型的类由虚拟机直接生成。
@@ -332,6 +387,19 @@ private:
     std::recursive_mutex str_pool_mutex;
 public:
     void buildStrPool();
+
+    /*
+     * GC 遍历字符串池，此时其他线程都停在安全点，不加锁。
+     * @visit 可以更新字符串的地址：池按字符串的内容散列，地址变了不用重新散列。
+     */
+    template <typename Visitor>
+    void forEachInternedString(Visitor visit)
+    {
+        if (str_pool != nullptr) {
+            for (Object *const &so : *str_pool)
+                visit(const_cast<Object **>(&so));
+        }
+    }
     jstrref intern(const utf8_t *str);
     jstrref intern(jstrref so);
 
@@ -2,6 +2,7 @@
 #include "constant_pool.h"
 #include "class.h"
 #include "method.h"
+#include "field.h"
 #include "../objects/mh.h"
 #include "../interpreter/interpreter.h"
 
@@ -11,7 +12,7 @@ using namespace method_handles;
 
 Class *ConstantPool::resolveClass(u2 i)
 {
-    lock_guard<recursive_mutex> lock(mutex);
+    SafeLockGuard<recursive_mutex> lock(mutex);
     assert(0 < i && i < size);
     assert(type[i] == JVM_CONSTANT_Class or type[i] == JVM_CONSTANT_ResolvedClass);
 
@@ -28,7 +29,7 @@ Class *ConstantPool::resolveClass(u2 i)
 
 Method *ConstantPool::resolveMethod(u2 i)
 {
-    lock_guard<recursive_mutex> lock(mutex);
+    SafeLockGuard<recursive_mutex> lock(mutex);
     assert(0 < i && i < size);
     assert(type[i] == JVM_CONSTANT_Methodref || type[i] == JVM_CONSTANT_ResolvedMethod);
 
@@ -50,7 +51,7 @@ Method *ConstantPool::resolveMethod(u2 i)
 
 Method* ConstantPool::resolveInterfaceMethod(u2 i)
 {
-    lock_guard<recursive_mutex> lock(mutex);
+    SafeLockGuard<recursive_mutex> lock(mutex);
     assert(0 < i && i < size);
     assert(type[i] == JVM_CONSTANT_InterfaceMethodref
            || type[i] == JVM_CONSTANT_ResolvedInterfaceMethod);
@@ -70,7 +71,7 @@ Method* ConstantPool::resolveInterfaceMethod(u2 i)
 
 Method *ConstantPool::resolveMethodOrInterfaceMethod(u2 i)
 {
-    lock_guard<recursive_mutex> lock(mutex);
+    SafeLockGuard<recursive_mutex> lock(mutex);
     assert(0 < i && i < size);
 
     if (type[i] == JVM_CONSTANT_Methodref || type[i] == JVM_CONSTANT_ResolvedMethod)
@@ -83,7 +84,7 @@ Method *ConstantPool::resolveMethodOrInterfaceMethod(u2 i)
 
 Field *ConstantPool::resolveField(u2 i)
 {
-    lock_guard<recursive_mutex> lock(mutex);
+    SafeLockGuard<recursive_mutex> lock(mutex);
     assert(0 < i && i < size);
     assert(type[i] == JVM_CONSTANT_Fieldref or type[i] == JVM_CONSTANT_ResolvedField);
 
@@ -100,9 +101,33 @@ Field *ConstantPool::resolveField(u2 i)
     return f;
 }
 
+const utf8_t *ConstantPool::memberDescriptor(u2 i)
+{
+    SafeLockGuard<recursive_mutex> lock(mutex);
+    assert(0 < i && i < size);
+
+    switch (type[i]) {
+        case JVM_CONSTANT_Fieldref:
+            return fieldType(i);
+        case JVM_CONSTANT_Methodref:
+            return methodType(i);
+        case JVM_CONSTANT_InterfaceMethodref:
+            return interfaceMethodType(i);
+        case JVM_CONSTANT_InvokeDynamic:
+            return invokeDynamicMethodType(i);
+        case JVM_CONSTANT_ResolvedField:
+            return ((Field *) info[i])->descriptor;
+        case JVM_CONSTANT_ResolvedMethod:
+        case JVM_CONSTANT_ResolvedInterfaceMethod:
+            return ((Method *) info[i])->descriptor;
+        default:
+            JVM_PANIC("not a member: %d\n", type[i]);
+    }
+}
+
 Object *ConstantPool::resolveString(u2 i)
 {
-    lock_guard<recursive_mutex> lock(mutex);
+    SafeLockGuard<recursive_mutex> lock(mutex);
     assert(0 < i && i < size);
     assert(type[i] == JVM_CONSTANT_String or type[i] == JVM_CONSTANT_ResolvedString);
 
@@ -120,7 +145,7 @@ Object *ConstantPool::resolveString(u2 i)
 
 Object *ConstantPool::resolveMethodType(u2 i)
 {
-    lock_guard<recursive_mutex> lock(mutex);
+    SafeLockGuard<recursive_mutex> lock(mutex);
     assert(0 < i && i < size);
     assert(type[i] == JVM_CONSTANT_MethodType);
     return findMethodType(methodTypeDescriptor(i), clazz->loader);
@@ -128,7 +153,7 @@ Object *ConstantPool::resolveMethodType(u2 i)
 
 Object *ConstantPool::resolveMethodHandle(u2 i)
 {
-    lock_guard<recursive_mutex> lock(mutex);
+    SafeLockGuard<recursive_mutex> lock(mutex);
     assert(0 < i && i < size);
     assert(type[i] == JVM_CONSTANT_MethodHandle);
 
@@ -6,6 +6,7 @@
 #include "../cabin.h"
 #include "../classfile/constants.h"
 #include "../slot.h"
+#include "../runtime/safepoint.h"
 
 class Class;
 class Method;
@@ -48,28 +49,50 @@ public:
 
     u1 getType(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         return type[i];
     }
 
     void setType(u2 i, u1 new_type)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         type[i] = new_type;
     }
 
     void setInfo(u2 i, slot_t new_info)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         info[i] = new_info;
     }
 
+    /*
+     * 不加锁直接读取常量的内容，只供快速指令（_quick opcodes）使用。
+     * 快速指令只会由已经解析完成的指令改写而来，
+     * 而常量一旦解析完成就不会再改变，所以这里无需加锁。
+     */
+    template <typename T = slot_t>
+    T resolved(u2 i) const
+    {
+        assert(0 < i && i < size);
+        return (T) info[i];
+    }
+
+    // GC 遍历已解析的字符串常量，此时其他线程都停在安全点，不加锁。@visit 可以更新字符串的地址
+    template <typename Visitor>
+    void forEachResolvedString(Visitor visit)
+    {
+        for (u2 i = 1; i < size; i++) {
+            if (type[i] == JVM_CONSTANT_ResolvedString)
+                visit((Object **) &info[i]);
+        }
+    }
+
     utf8_t *utf8(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Utf8);
         return (utf8_t *)(info[i]);
@@ -77,7 +100,7 @@ public:
 
     utf8_t *string(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_String);
         return utf8((u2)info[i]);
@@ -85,7 +108,7 @@ public:
 
     utf8_t *className(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Class);
         return utf8((u2)info[i]);
@@ -93,7 +116,7 @@ public:
 
     utf8_t *moduleName(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Module);
         return utf8((u2)info[i]);
@@ -101,7 +124,7 @@ public:
 
     utf8_t *packageName(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Package);
         return utf8((u2)info[i]);
@@ -109,7 +132,7 @@ public:
 
     utf8_t *nameOfNameAndType(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_NameAndType);
         return utf8((u2)info[i]);
@@ -117,7 +140,7 @@ public:
 
     utf8_t *typeOfNameAndType(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_NameAndType);
         return utf8((u2) (info[i] >> 16));
@@ -125,7 +148,7 @@ public:
 
     u2 fieldClassIndex(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Fieldref);
         return (u2)info[i];
@@ -133,7 +156,7 @@ public:
 
     utf8_t *fieldClassName(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Fieldref);
         return className((u2)info[i]);
@@ -141,7 +164,7 @@ public:
 
     utf8_t *fieldName(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Fieldref);
         return nameOfNameAndType((u2) (info[i] >> 16));
@@ -149,7 +172,7 @@ public:
 
     utf8_t *fieldType(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Fieldref);
         return typeOfNameAndType((u2) (info[i] >> 16));
@@ -157,7 +180,7 @@ public:
 
     u2 methodClassIndex(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Methodref);
         return (u2)info[i];
@@ -165,7 +188,7 @@ public:
 
     utf8_t *methodClassName(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Methodref);
         return className((u2)info[i]);
@@ -173,7 +196,7 @@ public:
 
     utf8_t *methodName(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Methodref);
         return nameOfNameAndType((u2) (info[i] >> 16));
@@ -181,7 +204,7 @@ public:
 
     utf8_t *methodType(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Methodref);
         return typeOfNameAndType((u2) (info[i] >> 16));
@@ -189,7 +212,7 @@ public:
 
     u2 interfaceMethodClassIndex(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_InterfaceMethodref);
         return (u2)info[i];
@@ -197,7 +220,7 @@ public:
 
     utf8_t *interfaceMethodClassName(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_InterfaceMethodref);
         return className((u2)info[i]);
@@ -205,7 +228,7 @@ public:
 
     utf8_t *interfaceMethodName(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_InterfaceMethodref);
         return nameOfNameAndType((u2) (info[i] >> 16));
@@ -213,7 +236,7 @@ public:
 
     utf8_t *interfaceMethodType(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_InterfaceMethodref);
         return typeOfNameAndType((u2) (info[i] >> 16));
@@ -221,7 +244,7 @@ public:
 
     utf8_t *methodTypeDescriptor(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_MethodType);
         return utf8((u2)info[i]);
@@ -229,7 +252,7 @@ public:
 
     u2 methodHandleReferenceKind(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_MethodHandle);
         return (u2) info[i];
@@ -237,7 +260,7 @@ public:
 
     u2 methodHandleReferenceIndex(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_MethodHandle);
         return (u2) (info[i] >> 16);
@@ -245,7 +268,7 @@ public:
 
     u2 invokeDynamicBootstrapMethodIndex(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_InvokeDynamic);
         return (u2) info[i];
@@ -253,7 +276,7 @@ public:
 
     utf8_t *invokeDynamicMethodName(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_InvokeDynamic);
         return nameOfNameAndType((u2) (info[i] >> 16));
@@ -261,7 +284,7 @@ public:
 
     utf8_t *invokeDynamicMethodType(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_InvokeDynamic);
         return typeOfNameAndType((u2) (info[i] >> 16));
@@ -269,7 +292,7 @@ public:
 
     jint getInt(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Integer);
         return slot::getInt(info + i);
@@ -277,7 +300,7 @@ public:
 
     void setInt(u2 i, jint new_int)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Integer);
         slot::setInt(info + i, new_int);
@@ -285,7 +308,7 @@ public:
 
     jfloat getFloat(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Float);
         return slot::getFloat(info + i);
@@ -293,7 +316,7 @@ public:
 
     void setFloat(u2 i, jfloat new_float)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Float);
         slot::setFloat(info + i, new_float);
@@ -301,7 +324,7 @@ public:
 
     jlong getLong(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Long);
         return slot::getLong(info + i);
@@ -309,7 +332,7 @@ public:
 
     void setLong(u2 i, jlong new_long)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Long);
         slot::setLong(info + i, new_long);
@@ -317,7 +340,7 @@ public:
 
     jdouble getDouble(u2 i)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Double);
         return slot::getDouble(info + i);
@@ -325,7 +348,7 @@ public:
 
     void setDouble(u2 i, jdouble new_double)
     {
-        std::lock_guard<std::recursive_mutex> lock(mutex);
+        SafeLockGuard<std::recursive_mutex> lock(mutex);
         assert(0 < i && i < size);
         assert(type[i] == JVM_CONSTANT_Double);
         slot::setDouble(info + i, new_double);
@@ -340,6 +363,12 @@ public:
     Object *resolveMethodType(u2 i);
     Object *resolveMethodHandle(u2 i);
 
+    /*
+     * Fieldref, Methodref, InterfaceMethodref 或 InvokeDynamic 的描述符，
+     * 已解析的取解析得到的 Field 或 Method 的描述符。
+     */
+    const utf8_t *memberDescriptor(u2 i);
+
     friend class Class;
 };
 
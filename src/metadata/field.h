@@ -23,6 +23,9 @@ private:
     // like, int k; the type of k is int.class
     ClsObj *type = nullptr;
 public:
+    // 已经创建的 type，没有时为 nullptr，供 GC 扫描和更新
+    ClsObj *&cachedType() { return type; }
+
     bool category_two;
 
     union {
@@ -72,6 +75,12 @@ public:
 
     [[nodiscard]] bool isPrim() const;
 
+    // 引用类型（对象或数组）的字段，写入时要经过写屏障（见 heap/barrier.h）
+    [[nodiscard]] bool isReference() const
+    {
+        return descriptor[0] == 'L' || descriptor[0] == '[';
+    }
+
     [[nodiscard]] std::string toString() const;
     friend std::ostream &operator <<(std::ostream &os, const Field &field);
 
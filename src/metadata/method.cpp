@@ -2,6 +2,10 @@
 #include "class.h"
 #include "../objects/array.h"
 #include "descriptor.h"
+#include "../interpreter/inline_cache.h"
+#include "../interpreter/threaded_code.h"
+#include "../interpreter/intrinsics.h"
+#include "../heap/ref_map.h"
 
 using namespace std;
 using namespace utf8;
@@ -284,6 +288,47 @@ Method::Method(Class *c, BytecodeReader &r)
         }
 
         native_method = findNativeMethod(clazz->class_name, name, descriptor);
+        if (native_method != nullptr)
+            native_trampoline = native_method->trampoline;
+    }
+
+    intrinsic = findIntrinsic(clazz->class_name, name, descriptor);
+    classifyAccessor();
+}
+
+void Method::classifyAccessor()
+{
+    if (code == nullptr || isNative() || isAbstract() || isSynchronized())
+        return;
+
+    if (code_len == 1 && code[0] == JVM_OPC_return) {
+        accessor_kind = ACCESSOR_EMPTY;
+        return;
+    }
+
+    if (code_len == 5 && code[0] == JVM_OPC_aload_0 && code[1] == JVM_OPC_getfield) {
+        // 返回值的类型在字段解析后再与字段核对，见 interpreter.cpp 中的 invokeAccessor
+        u1 ret = code[4];
+        if ((ret == JVM_OPC_ireturn || ret == JVM_OPC_freturn || ret == JVM_OPC_areturn
+                || ret == JVM_OPC_lreturn || ret == JVM_OPC_dreturn) && arg_slot_count == 1) {
+            accessor_kind = ACCESSOR_GETTER;
+            accessor_index = (u2) (code[2] << 8 | code[3]);
+        }
+        return;
+    }
+
+    if (code_len == 6 && code[0] == JVM_OPC_aload_0 && code[2] == JVM_OPC_putfield
+                && code[5] == JVM_OPC_return) {
+        u1 load = code[1];
+        int value_slots = 0;
+        if (load == JVM_OPC_iload_1 || load == JVM_OPC_fload_1 || load == JVM_OPC_aload_1)
+            value_slots = 1;
+        else if (load == JVM_OPC_lload_1 || load == JVM_OPC_dload_1)
+            value_slots = 2;
+        if (value_slots > 0 && arg_slot_count == 1 + value_slots) {
+            accessor_kind = ACCESSOR_SETTER;
+            accessor_index = (u2) (code[3] << 8 | code[4]);
+        }
     }
 }
 
@@ -347,6 +392,19 @@ bool Method::isSignaturePolymorphic()
     return true;
 }
 
+bool Method::canOverride(const Method *m0) const
+{
+    assert(m0 != nullptr);
+
+    if (m0->isPrivate() || m0->isStatic())
+        return false;
+    if (m0->isPublic() || m0->isProtected())
+        return true;
+
+    // 包私有：属于同一个运行时包（包名相同且类加载器相同）
+    return clazz->loader == m0->clazz->loader && equals(clazz->pkg_name, m0->clazz->pkg_name);
+}
+
 string Method::toString() const
 {
     ostringstream oss;
@@ -356,3 +414,24 @@ string Method::toString() const
     oss << ": " << clazz->class_name << "~" << name << "~" << descriptor;
     return oss.str();
 }
+
+Method::~Method()
+{
+    if (isNative()) {
+        delete[] code;
+    }
+    for (auto &t : exception_tables) {
+        delete t.catch_type;
+    }
+
+    delete threaded_code.load();
+    delete ref_map.load();
+
+    auto ics = inline_caches.load();
+    if (ics != nullptr) {
+        for (size_t pc = 0; pc < code_len; pc++) {
+            delete ics[pc].load();
+        }
+        delete[] ics;
+    }
+}
@@ -2,6 +2,7 @@
 #define CABIN_METHOD_H
 
 #include <vector>
+#include <atomic>
 #include "../classfile/attributes.h"
 #include "../util/encoding.h"
 #include "../classfile/constants.h"
@@ -10,6 +11,13 @@
 class Object;
 class Array;
 class Class;
+class InlineCache;
+class MethodProfile;
+class Field;
+struct Intrinsic;
+struct ThreadedCode;
+struct OsrTable;
+class RefMap;
 
 class Method {
 //    Array *parameter_types = nullptr;  // [Ljava/lang/Class;
@@ -17,10 +25,23 @@ class Method {
     Array *exception_types = nullptr; // [Ljava/lang/Class;
 
 public:
+    // 已经创建的 exception_types，没有时为 nullptr，供 GC 扫描和更新
+    Array *&cachedExceptionTypes() { return exception_types; }
+
     enum RetType {
         RET_INVALID, RET_VOID, RET_BYTE, RET_BOOL, RET_CHAR,
         RET_SHORT, RET_INT, RET_FLOAT, RET_LONG, RET_DOUBLE, RET_REFERENCE
     };
+
+    /*
+     * 可以不创建 frame、直接在调用者的操作数栈上执行的简单方法，在构造时识别：
+     * ACCESSOR_EMPTY:  return
+     * ACCESSOR_GETTER: aload_0; getfield; <t>return
+     * ACCESSOR_SETTER: aload_0; <t>load_1; putfield; return
+     */
+    enum AccessorKind {
+        ACCESSOR_NONE, ACCESSOR_EMPTY, ACCESSOR_GETTER, ACCESSOR_SETTER
+    };
     
     Class *clazz = nullptr; // 定义此 Method 的类
     const utf8_t *name = nullptr;
@@ -42,6 +63,49 @@ public:
     size_t code_len = 0;
 
     JNINativeMethod *native_method = nullptr; // present only if native
+    NativeTrampoline native_trampoline = nullptr; // native_method 的调用跳板，链接时绑定
+
+    // 替代此方法的 C++ 实现，调用时不创建 frame。见 interpreter/intrinsics.h
+    const Intrinsic *intrinsic = nullptr;
+
+    // 访问器方法的种类，以及 getfield/putfield 的常量池索引和（常量解析后）字段
+    AccessorKind accessor_kind = ACCESSOR_NONE;
+    u2 accessor_index = 0;
+    std::atomic<Field *> accessor_field{nullptr};
+
+    // 预解码的指令流，方法第一次被调用时生成。见 translate()
+    std::atomic<ThreadedCode *> threaded_code{nullptr};
+
+    // 本方法中各调用点的内联缓存，以调用指令的 pc 为下标，按需创建。见 InlineCache::of
+    std::atomic<std::atomic<InlineCache *> *> inline_caches{nullptr};
+
+    // 调用次数和循环回边的次数，用于决定何时编译此方法。见 jit/jit.h
+    u4 invocation_count = 0;
+    u4 backedge_count = 0;
+
+    // 方法变热后创建的执行 profile。见 MethodProfile::of
+    std::atomic<MethodProfile *> profile{nullptr};
+
+    // 模板 JIT 编译后的代码（JitCode）和编译状态（JitState）
+    std::atomic<void *> jit_code{nullptr};
+    std::atomic<int> jit_state{0};
+
+    // 模板 JIT 生成的循环头处的栈上替换入口
+    std::atomic<OsrTable *> osr_table{nullptr};
+
+    // 优化编译器编译后的代码（JitCode）和编译状态（OptState），以及去优化的次数
+    std::atomic<void *> opt_code{nullptr};
+    std::atomic<int> opt_state{0};
+    u4 deopt_count = 0;
+
+    // 类层次分析的结果：已加载的类中此方法唯一的实现（polymorphic 为 false 时才有效），
+    // 以及是否已有多个实现。见 metadata/cha.h
+    std::atomic<Method *> unique_impl{nullptr};
+    std::atomic<bool> polymorphic{false};
+
+    // 各安全点处局部变量表和操作数栈中哪些 slot 保存引用，方法第一次被翻译时计算。见 heap/ref_map.h
+    std::atomic<RefMap *> ref_map{nullptr};
+
     RetType ret_type = RET_INVALID;
 
     std::vector<MethodParameter> parameters;
@@ -69,6 +133,7 @@ private:
 
     void calArgsSlotsCount();
     void parseCodeAttr(BytecodeReader &r);
+    void classifyAccessor();
 
 public:
     Method(Class *c, BytecodeReader &r);
@@ -85,6 +150,12 @@ public:
         return !isPrivate() && !isStatic() && !utf8::equals(name, S(object_init));
     }
 
+    /*
+     * 判断本方法能否重写（override）签名相同的方法 @m0（JVMS 5.4.5），
+     * 包私有的方法只能被同一运行时包中的类重写。
+     */
+    [[nodiscard]] bool canOverride(const Method *m0) const;
+
     // is <clinit>?
     [[nodiscard]] bool isClassInit() const
     {
@@ -163,15 +234,9 @@ private:
     std::vector<ExceptionTable> exception_tables;
 
 public:
-    ~Method()
-    {
-        if (isNative()) {
-            delete[] code;
-        }
-        for (auto &t : exception_tables) {
-            delete t.catch_type;
-        }
-    }
+    ~Method();
+
+    friend class RefMap;
 };
 
 #endif //CABIN_METHOD_H
@@ -522,14 +522,22 @@ static jobject getDeclaredMethods0(jclass _this, jboolean public_only)
      */
     Method *constructor = method_class->getConstructor(_CLS STR "[" CLS CLS "[" CLS "II" STR "[B[B[B)V");
 
-    vector<jref> methods;
+    // 创建的对象直接放入数组，不保存在 GC 看不到的 C++ 容器中
+    jint methods_count = 0;
     for (int i = 0; i < count; i++) {
+        Method *method = cls->methods[i];
+        if (!method->isClassInit() && !method->isObjectInit())
+            methods_count++;
+    }
+    Array *method_array = method_class->arrayClass()->allocArray(methods_count);
+
+    for (int i = 0, j = 0; i < count; i++) {
         Method *method = cls->methods[i];
         if (method->isClassInit() || method->isObjectInit()) {
             continue;
         }
         Object *o = method_class->allocObject();
-        methods.push_back(o);
+        method_array->setRef(j++, o);
 
         execJavaFunc(constructor, {
                 rslot(o),        /* this  */
@@ -548,11 +556,7 @@ static jobject getDeclaredMethods0(jclass _this, jboolean public_only)
                 rslot(jnull), /* annotation default  todo */
         });
     }
-        
-    Array *method_array = method_class->arrayClass()->allocArray(methods.size());
-    for (size_t i = 0; i < methods.size(); i++) {
-        method_array->setRef(i, methods[i]);
-    }
+
     return method_array;
 }
 
@@ -6,11 +6,11 @@
 // public native int hashCode();
 static jint hashCode(jobject _this)
 {
-    return (jint)(intptr_t)_this;
+    return _this->identityHash();
 }
 
 // protected native Object clone() throws CloneNotSupportedException;
-static jobject clone(jobject _this)
+static jobject clone0(jobject _this)
 {
     if (!_this->clazz->isSubclassOf(loadBootClass(S(java_lang_Cloneable)))) {
         throw java_lang_CloneNotSupportedException();
@@ -37,7 +37,7 @@ static void notify(jobject _this)
 }
 
 // public final native void wait(long timeout) throws InterruptedException;
-static void wait(jobject _this, jlong timeout)
+static void wait0(jobject _this, jlong timeout)
 {
     // todo
 }
@@ -46,10 +46,10 @@ static JNINativeMethod methods[] = {
         JNINativeMethod_registerNatives,
         { "hashCode", "()I", TA(hashCode) },
         { "getClass", __CLS, TA(getClass) },
-        { "clone", __OBJ, TA(clone) },
+        { "clone", __OBJ, TA(clone0) },
         { "notifyAll", "()V", TA(notifyAll) },
         { "notify", "()V", TA(notify) },
-        { "wait", "(J)V", TA(wait) },
+        { "wait", "(J)V", TA(wait0) },
 };
 
 void java_lang_Object_registerNatives()
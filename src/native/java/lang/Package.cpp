@@ -22,9 +22,9 @@ static jobject getSystemPackages0()
     auto size = packages.size();
 
     auto ao = newStringArray(size);
-    auto p = (Object **) ao->data;
+    int i = 0;
     for (auto pkg : packages) {
-        *p++ = newString(pkg);
+        ao->setRef(i++, newString(pkg));
     }
 
     return ao;
@@ -2,6 +2,7 @@
 #include "../../../cabin.h"
 #include "../../../config.h"
 #include "../../../heap/heap.h"
+#include "../../../heap/gc.h"
 #include "../../../platform/sysinfo.h"
 
 // public native int availableProcessors();
@@ -38,9 +39,9 @@ static jlong maxMemory(jobject _this)
 }
 
 // public native void gc();
-static void gc(jobject _this)
+static void gc0(jobject _this)
 {
-    JVM_PANIC("gc");
+    gc();
 }
 
 /* Wormhole for calling java.lang.ref.Finalizer.runFinalization */
@@ -68,7 +69,7 @@ static JNINativeMethod methods[] = {
         { "freeMemory", "()J", TA(freeMemory) },
         { "totalMemory", "()J", TA(totalMemory) },
         { "maxMemory", "()J", TA(maxMemory) },
-        { "gc", "()V", TA(gc) },
+        { "gc", "()V", TA(gc0) },
         { "runFinalization0", "()V", TA(runFinalization0) },
         { "traceInstructions", "(Z)V", TA(traceInstructions) },
         { "traceMethodCalls", "(Z)V", TA(traceMethodCalls) },
@@ -20,7 +20,7 @@ static void initStackTraceElements(jref elements0, jref x)
     auto backtrace = dynamic_cast<Array *>(backtrace0);
     auto elements = dynamic_cast<Array *>(elements0);
     assert(elements->arr_len <= backtrace->arr_len);
-    memcpy(elements->data, backtrace->data, elements->arr_len*sizeof(jref));
+    Array::copy(elements, 0, backtrace, 0, elements->arr_len);
 }
 
 /*
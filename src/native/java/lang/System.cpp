@@ -48,7 +48,7 @@ static void arraycopy(jobject src, jint src_pos, jobject dest, jint dest_pos, ji
 // public static native int identityHashCode(Object x);
 static jint identityHashCode(jobject x)
 {
-    return (jint) (intptr_t) x; // todo 实现错误。改成当前的时间如何。
+    return x != jnull ? x->identityHash() : 0;
 }
 
 // private static native Properties initProperties(Properties props);
@@ -1,9 +1,12 @@
+#include <mutex>
+#include <condition_variable>
 #include "../../jni_internal.h"
 #include "../../../symbol.h"
 #include "../../../objects/object.h"
 #include "../../../objects/array.h"
 #include "../../../runtime/vm_thread.h"
 #include "../../../runtime/frame.h"
+#include "../../../runtime/safepoint.h"
 #include "../../../interpreter/interpreter.h"
 #include "../../../exception.h"
 
@@ -35,7 +38,8 @@ static void sleep(jlong millis)
     if (millis == 0)
         return;
 
-    this_thread::sleep_for(chrono::microseconds(millis));
+    // 睡眠期间不阻止 GC
+    inSafeRegion([millis] { this_thread::sleep_for(chrono::microseconds(millis)); });
 
     // todo 怎么处理 InterruptedException 
 }
@@ -114,13 +118,56 @@ static void start0(jobject _this)
     static Method *runMethod 
                 = loadBootClass(S(java_lang_Thread))->lookupInstMethod(S(run), S(___V));
 
-    static auto _start = [](Object *_this) {
-        new Thread(_this);
-        return (void *) execJavaFunc(runMethod, {_this});
+    // 线程结束时注销线程并归还虚拟机栈，以异常结束时也是如此
+    struct ThreadExit {
+        Thread *thread;
+        ~ThreadExit()
+        {
+            thread->clearVMStack(); // 异常离开时栈上可能还留有 frame
+            unregisterThread(thread);
+            thread->releaseVMStack();
+        }
     };
 
-    std::thread t(_start, _this);
+    /*
+     * 新线程注册（见 Thread 的构造函数）之前，GC 看不到它的参数，
+     * 这期间 _this 只靠父线程本地栈上的 args 保持存活：父线程在安全区域内等待，
+     * 它的本地栈被保守扫描，_this 原地固定，不会被 minor GC 移动。
+     * 注册之后 GC 要等新线程停在安全点，而 thread->tobj 是它的根。
+     */
+    struct StartArgs {
+        Object *tobj;
+        bool registered = false;
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    static auto _start = [](StartArgs *args) {
+        auto thread = new Thread(args->tobj);
+        {
+            std::lock_guard<std::mutex> lock(args->mutex);
+            args->registered = true;
+            args->cv.notify_one();
+        } // 此后 args 随时可能失效
+
+        ThreadExit guard{thread};
+        try {
+            return (void *) execJavaFunc(runMethod, {thread->tobj});
+        } catch (JavaException &e) {
+            // 还没有进入 run() 就抛出的异常（比如为它分配 frame 时栈溢出），线程结束
+            printStackTrace(e.getExcep());
+            return (void *) nullptr;
+        }
+    };
+
+    StartArgs args{_this};
+    std::thread t(_start, &args);
     t.detach();
+
+    inSafeRegion([&args] {
+        std::unique_lock<std::mutex> lock(args.mutex);
+        args.cv.wait(lock, [&args] { return args.registered; });
+    });
 }
 
 // public native int countStackFrames();
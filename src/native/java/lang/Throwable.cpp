@@ -47,13 +47,12 @@ static jobject fillInStackTrace(jobject _this, jint dummy)
     }
 
     auto backtrace = newObjectArray(num);
-    auto trace = (Object **) backtrace->data;
 
     Class *c = loadBootClass(S(java_lang_StackTraceElement));
     for (int i = 0; f != nullptr; f = f->prev) {
         Object *o = c->allocObject();
         assert(i < num);
-        trace[i++] = o;
+        backtrace->setRef(i++, o);
 
         // public StackTraceElement(String declaringClass, String methodName, String fileName, int lineNumber)
         // may be should call <init>, but 直接赋值 is also ok. todo
@@ -63,7 +62,7 @@ static jobject fillInStackTrace(jobject _this, jint dummy)
                         : nullptr;
         auto className = newString(f->method->clazz->class_name);
         auto methodName = newString(f->method->name);
-        auto lineNumber = f->method->getLineNumber(f->reader.pc - 1); // todo why 减1？ 减去opcode的长度
+        auto lineNumber = f->method->getLineNumber(f->pc());
 
         o->setRefField("fileName", "Ljava/lang/String;", fileName);
         o->setRefField("declaringClass", "Ljava/lang/String;", className);
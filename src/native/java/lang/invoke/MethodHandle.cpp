@@ -37,7 +37,7 @@ static jobject invokeExact(const slot_t *args)
 ;
     jref form = _this->getRefField(S(form), "Ljava/lang/invoke/LambdaForm;");
     jref entry = form->getRefField(S(vmentry), "Ljava/lang/invoke/MemberName;");
-    auto target = (Method *) (void *) entry->getRefField(S(vmtarget), S(sig_java_lang_Object));
+    auto target = (Method *) (intptr_t) entry->getLongField(S(vmtarget), S(J));
 
     slot_t *slot = execJavaFunc(target, args);
     return getRef(slot);
@@ -88,7 +88,7 @@ static jobject invoke(const slot_t *args)
 
     jref form = _this->getRefField(S(form), "Ljava/lang/invoke/LambdaForm;");
     jref entry = form->getRefField(S(vmentry), "Ljava/lang/invoke/MemberName;");
-    auto target = (Method *) (void *) entry->getRefField(S(vmtarget), S(sig_java_lang_Object));
+    auto target = (Method *) (intptr_t) entry->getLongField(S(vmtarget), S(J));
 
     slot_t *slot = execJavaFunc(target, args);
     return getRef(slot);
@@ -189,7 +189,7 @@ static jobject invokeBasic(const slot_t *args)
 
     jref form = _this->getRefField(S(form), "Ljava/lang/invoke/LambdaForm;");
     jref entry = form->getRefField(S(vmentry), "Ljava/lang/invoke/MemberName;");
-    auto target = (Method *) (void *) entry->getRefField(S(vmtarget), S(sig_java_lang_Object));
+    auto target = (Method *) (intptr_t) entry->getLongField(S(vmtarget), S(J));
 
     slot_t *slot = execJavaFunc(target, args);
     return getRef(slot);
@@ -219,7 +219,7 @@ static jobject linkToVirtual(u2 args_slots_count, const slot_t *args)
 static jobject linkToStatic(u2 args_slots_count, const slot_t *args)
 {
     Object *member_name = getRef(args + args_slots_count - 1);
-    auto target = (Method *) (void *) member_name->getRefField(S(vmtarget), S(sig_java_lang_Object));
+    auto target = (Method *) (intptr_t) member_name->getLongField(S(vmtarget), S(J));
     assert(target != nullptr);
 
     slot_t *slot = execJavaFunc(target, args);
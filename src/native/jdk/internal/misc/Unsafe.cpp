@@ -93,6 +93,8 @@ static jboolean compareAndSwapObject(jobject _this, jobject o, jlong offset, job
     }
 
     bool b = __sync_bool_compare_and_swap(old, expected, x);
+    if (b)
+        postWriteBarrier(old);
     return b ? jtrue : jfalse;
 }
 
@@ -311,10 +313,17 @@ static jobject obj_getObject(jobject _this, jobject o, jlong offset)
     OBJECT_GET(o, offset, jref, r, slot::getRef);
 }
 
+// 写入实例的引用类型字段，经过写屏障（见 heap/barrier.h）
+static void setRefSlot(slot_t *slot, jobject x)
+{
+    slot::setRef(slot, x);
+    postWriteBarrier(slot);
+}
+
 // public native void putObject(Object o, long offset, Object x);
 static void obj_putObject(jobject _this, jobject o, jlong offset, jobject x)
 {
-    OBJECT_PUT(o, offset, x, setRef, r, slot::setRef);
+    OBJECT_PUT(o, offset, x, setRef, r, setRefSlot);
 }
 
 #undef OBJECT_GET
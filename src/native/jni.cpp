@@ -1,111 +1,160 @@
-#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include "jni_internal.h"
 #include "../runtime/vm_thread.h"
 
 using namespace std;
 using namespace utf8;
 
-void initJNI()
-{
-#ifdef R
-#undef R
-#endif
-
-#define R(method_name) void method_name(); /* declare */ method_name() /* invoke */
-
-    // register all native methods // todo 不要一次全注册，需要时再注册
-    R(java_lang_Class_registerNatives);
-    R(java_lang_Float_registerNatives);
-    R(java_lang_System_registerNatives);
-    R(java_lang_Double_registerNatives);
-    R(java_lang_Object_registerNatives);
-    R(java_lang_String_registerNatives);
-    R(java_lang_StringUTF16_registerNatives);
-    R(java_lang_Package_registerNatives);
-    R(java_lang_Throwable_registerNatives);
-    R(java_lang_Thread_registerNatives);
-    R(java_lang_Runtime_registerNatives);
-    R(java_lang_Shutdown_registerNatives);
-    R(java_lang_Module_registerNatives);
-    R(java_lang_StackTraceElement_registerNatives);
-    R(java_lang_NullPointerException_registerNatives);
-    R(java_lang_ClassLoader_registerNatives);
-    R(java_lang_ClassLoader$NativeLibrary_registerNatives);
-
-    R(java_lang_reflect_Field_registerNatives);
-    R(java_lang_reflect_Executable_registerNatives);
-    R(java_lang_reflect_Array_registerNatives);
-    R(java_lang_reflect_Proxy_registerNatives);
-
-    R(java_lang_invoke_MethodHandle_registerNatives);
-    R(java_lang_invoke_MethodHandleNatives_registerNatives);
-
-    R(java_io_FileDescriptor_registerNatives);
-    R(java_io_FileInputStream_registerNatives);
-    R(java_io_FileOutputStream_registerNatives);
-    R(java_io_WinNTFileSystem_registerNatives);
-    R(java_io_RandomAccessFile_registerNatives);
-
-    R(java_nio_Bits_registerNatives);
-
-    R(java_net_InetAddress_registerNatives);
-    R(java_net_Inet4Address_registerNatives);
-    R(java_net_Inet6Address_registerNatives);
-    R(java_net_AbstractPlainSocketImpl_registerNatives);
-    R(java_net_AbstractPlainDatagramSocketImpl_registerNatives);
-    R(java_net_NetworkInterface_registerNatives);
-    R(java_net_PlainSocketImpl_registerNatives);
-    R(java_net_InetAddressImplFactory_registerNatives);
-
-    R(sun_misc_VM_registerNatives);
-    R(sun_misc_Unsafe_registerNatives);
-    R(sun_misc_Signal_registerNatives);
-    R(sun_misc_Version_registerNatives);
-    R(sun_misc_URLClassPath_registerNatives);
-    R(sun_misc_Perf_registerNatives);
-
-    R(sun_io_Win32ErrorMode_registerNatives);
-
-    R(sun_reflect_Reflection_registerNatives);
-    R(sun_reflect_NativeConstructorAccessorImpl_registerNatives);
-    R(sun_reflect_NativeMethodAccessorImpl_registerNatives);
-    R(sun_reflect_ConstantPool_registerNatives);
-
-    R(sun_management_VMManagementImpl_registerNatives);
-    R(sun_management_ThreadImpl_registerNatives);
-
-    R(java_security_AccessController_registerNatives);
+/*
+ * 本地方法按类延迟注册：类的本地方法第一次被链接时（见 Method 的构造函数），
+ * 才调用注册该类的 *_registerNatives 函数。启动时只建立类名到注册函数的映射。
+ *
+ * 有的注册函数按 classfile 的版本注册不同的类（比如 sun/misc/Unsafe 和 jdk/internal/misc/Unsafe），
+ * 这些类都映射到同一个注册函数。
+ */
+#define NATIVE_REGISTRARS(R) \
+    R("java/lang/Class", java_lang_Class_registerNatives) \
+    R("java/lang/Float", java_lang_Float_registerNatives) \
+    R("java/lang/System", java_lang_System_registerNatives) \
+    R("java/lang/Double", java_lang_Double_registerNatives) \
+    R("java/lang/Object", java_lang_Object_registerNatives) \
+    R("java/lang/String", java_lang_String_registerNatives) \
+    R("java/lang/StringUTF16", java_lang_StringUTF16_registerNatives) \
+    R("java/lang/Package", java_lang_Package_registerNatives) \
+    R("java/lang/Throwable", java_lang_Throwable_registerNatives) \
+    R("java/lang/Thread", java_lang_Thread_registerNatives) \
+    R("java/lang/Runtime", java_lang_Runtime_registerNatives) \
+    R("java/lang/Shutdown", java_lang_Shutdown_registerNatives) \
+    R("java/lang/Module", java_lang_Module_registerNatives) \
+    R("java/lang/StackTraceElement", java_lang_StackTraceElement_registerNatives) \
+    R("java/lang/NullPointerException", java_lang_NullPointerException_registerNatives) \
+    R("java/lang/ClassLoader", java_lang_ClassLoader_registerNatives) \
+    R("java/lang/ClassLoader$NativeLibrary", java_lang_ClassLoader$NativeLibrary_registerNatives) \
+    \
+    R("java/lang/reflect/Field", java_lang_reflect_Field_registerNatives) \
+    R("java/lang/reflect/Executable", java_lang_reflect_Executable_registerNatives) \
+    R("java/lang/reflect/Array", java_lang_reflect_Array_registerNatives) \
+    R("java/lang/reflect/Proxy", java_lang_reflect_Proxy_registerNatives) \
+    \
+    R("java/lang/invoke/MethodHandle", java_lang_invoke_MethodHandle_registerNatives) \
+    R("java/lang/invoke/MethodHandleNatives", java_lang_invoke_MethodHandleNatives_registerNatives) \
+    \
+    R("java/io/FileDescriptor", java_io_FileDescriptor_registerNatives) \
+    R("java/io/FileInputStream", java_io_FileInputStream_registerNatives) \
+    R("java/io/FileOutputStream", java_io_FileOutputStream_registerNatives) \
+    R("java/io/WinNTFileSystem", java_io_WinNTFileSystem_registerNatives) \
+    R("java/io/RandomAccessFile", java_io_RandomAccessFile_registerNatives) \
+    \
+    R("java/nio/Bits", java_nio_Bits_registerNatives) \
+    \
+    R("java/net/InetAddress", java_net_InetAddress_registerNatives) \
+    R("java/net/Inet4Address", java_net_Inet4Address_registerNatives) \
+    R("java/net/Inet6Address", java_net_Inet6Address_registerNatives) \
+    R("java/net/AbstractPlainSocketImpl", java_net_AbstractPlainSocketImpl_registerNatives) \
+    R("java/net/AbstractPlainDatagramSocketImpl", java_net_AbstractPlainDatagramSocketImpl_registerNatives) \
+    R("java/net/NetworkInterface", java_net_NetworkInterface_registerNatives) \
+    R("java/net/PlainSocketImpl", java_net_PlainSocketImpl_registerNatives) \
+    R("java/net/InetAddressImplFactory", java_net_InetAddressImplFactory_registerNatives) \
+    \
+    R("jdk/internal/misc/VM", sun_misc_VM_registerNatives) \
+    R("sun/misc/VM", sun_misc_VM_registerNatives) \
+    R("jdk/internal/misc/Unsafe", sun_misc_Unsafe_registerNatives) \
+    R("sun/misc/Unsafe", sun_misc_Unsafe_registerNatives) \
+    R("jdk/internal/misc/Signal", sun_misc_Signal_registerNatives) \
+    R("sun/misc/Signal", sun_misc_Signal_registerNatives) \
+    R("sun/misc/Version", sun_misc_Version_registerNatives) \
+    R("sun/misc/URLClassPath", sun_misc_URLClassPath_registerNatives) \
+    R("sun/misc/Perf", sun_misc_Perf_registerNatives) \
+    \
+    R("sun/io/Win32ErrorMode", sun_io_Win32ErrorMode_registerNatives) \
+    \
+    R("jdk/internal/reflect/Reflection", sun_reflect_Reflection_registerNatives) \
+    R("sun/reflect/Reflection", sun_reflect_Reflection_registerNatives) \
+    R("sun/reflect/NativeConstructorAccessorImpl", sun_reflect_NativeConstructorAccessorImpl_registerNatives) \
+    R("sun/reflect/NativeMethodAccessorImpl", sun_reflect_NativeMethodAccessorImpl_registerNatives) \
+    R("sun/reflect/ConstantPool", sun_reflect_ConstantPool_registerNatives) \
+    \
+    R("sun/management/VMManagementImpl", sun_management_VMManagementImpl_registerNatives) \
+    R("sun/management/ThreadImpl", sun_management_ThreadImpl_registerNatives) \
+    \
+    R("java/security/AccessController", java_security_AccessController_registerNatives) \
+    \
+    R("java/util/TimeZone", java_util_TimeZone_registerNatives) \
+    R("java/util/concurrent/atomic/AtomicLong", java_util_concurrent_atomic_AtomicLong_registerNatives) \
+    R("java/util/zip/ZipFile", java_util_zip_ZipFile_registerNatives) \
+    \
+    R("jdk/internal/util/SystemProps$Raw", jdk_internal_util_SystemProps$Raw_registerNatives)
+
+#define DECLARE_REGISTRAR(class_name, registrar) void registrar();
+NATIVE_REGISTRARS(DECLARE_REGISTRAR)
+#undef DECLARE_REGISTRAR
+
+// 类名 -> 注册函数
+static unordered_map<const utf8_t *, void (*)(), utf8::Hash, utf8::Comparator> registrars;
+// 已经调用过的注册函数
+static unordered_set<void (*)()> called_registrars;
+
+/*
+ * 本地方法以 (类名, 方法名, 描述符) 为键，三者都是 utf8 池中的字符串（见 utf8::save），
+ * 比较和哈希只需用指针。
+ */
+struct NativeKey {
+    const utf8_t *class_name;
+    const utf8_t *name;
+    const utf8_t *descriptor;
+
+    bool operator==(const NativeKey &k) const
+    {
+        return class_name == k.class_name && name == k.name && descriptor == k.descriptor;
+    }
+};
+
+struct NativeKeyHash {
+    size_t operator()(const NativeKey &k) const
+    {
+        size_t h = std::hash<const void *>()(k.class_name);
+        h = h * 31 + std::hash<const void *>()(k.name);
+        return h * 31 + std::hash<const void *>()(k.descriptor);
+    }
+};
 
-    R(java_util_TimeZone_registerNatives);
-    R(java_util_concurrent_atomic_AtomicLong_registerNatives);
-    R(java_util_zip_ZipFile_registerNatives);
+static unordered_map<NativeKey, JNINativeMethod *, NativeKeyHash> native_methods;
+static mutex native_methods_mutex;
 
-    R(jdk_internal_util_SystemProps$Raw_registerNatives);
-#undef R
+void initJNI()
+{
+#define ADD_REGISTRAR(class_name, registrar) registrars.emplace(class_name, registrar);
+    NATIVE_REGISTRARS(ADD_REGISTRAR)
+#undef ADD_REGISTRAR
 }
 
-static vector<tuple<const char * /* class name */, JNINativeMethod *, int /* methods count */>> native_methods;
-
+// 只由注册函数调用，调用者已持有 native_methods_mutex
 void registerNatives(const char *class_name, JNINativeMethod *methods, int methods_count)
 {
     assert(class_name != nullptr && methods != nullptr && methods_count > 0);
-    native_methods.emplace_back(class_name, methods, methods_count);
+
+    class_name = utf8::save(class_name);
+    for (int i = 0; i < methods_count; i++) {
+        NativeKey key{ class_name, utf8::save(methods[i].name), utf8::save(methods[i].descriptor) };
+        native_methods.emplace(key, methods + i); // 重复注册的无效
+    }
 }
 
 JNINativeMethod *findNativeMethod(const char *class_name, const char *method_name, const char *method_descriptor)
 {
-    assert(class_name != nullptr && method_name != nullptr);
+    assert(class_name != nullptr && method_name != nullptr && method_descriptor != nullptr);
+    assert(utf8::find(class_name) == class_name && utf8::find(method_name) == method_name
+           && utf8::find(method_descriptor) == method_descriptor);
 
-    for (auto &t: native_methods) {
-        if (equals(get<0>(t), class_name)) {
-            JNINativeMethod *methods = get<1>(t);
-            for (int i = 0; i < get<2>(t); i++) {
-                if (equals(methods[i].name, method_name) && equals(methods[i].descriptor, method_descriptor)) {
-                    return methods + i;
-                }
-            }
-            return nullptr; // not find
-        }
+    lock_guard<mutex> lock(native_methods_mutex);
+
+    auto r = registrars.find(class_name);
+    if (r != registrars.end() && called_registrars.insert(r->second).second) {
+        r->second(); // 第一次链接此类的本地方法，注册它们
     }
-    return nullptr; // not find
+
+    auto iter = native_methods.find(NativeKey{ class_name, method_name, method_descriptor });
+    return iter != native_methods.end() ? iter->second : nullptr;
 }
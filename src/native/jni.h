@@ -1,12 +1,17 @@
 #ifndef CABIN_JNI_H
 #define CABIN_JNI_H
 
+class Frame;
+
+// 调用本地函数 func 的跳板，实参取自 frame 的局部变量表，返回值压入 frame 的操作数栈。见 trampoline.h
+typedef void (*NativeTrampoline)(void *func, Frame *frame);
+
 struct JNINativeMethod {
     const char *name;
     const char *descriptor;
 
-    const std::type_info &type;
     void *func;
+    NativeTrampoline trampoline;
 };
 
 void initJNI();
@@ -3,6 +3,7 @@
 
 #include "../cabin.h"
 #include "jni.h"
+#include "trampoline.h"
 
 typedef Object* jobject;
 typedef Object* jclass;
@@ -28,11 +29,13 @@ typedef jobject jstring;
 
 #define ARRAY_LENGTH(arr) (sizeof(arr)/sizeof(*arr))
 
-#define JNINativeMethod_registerNatives { "registerNatives", "()V", typeid(void(*)()), (void *) (void(*)()) [](){} }
+#define JNINativeMethod_registerNatives \
+    { "registerNatives", "()V", (void *) (void(*)()) [](){}, trampoline::Trampoline<void(*)()>::invoke }
 
-// Type and Address
+// Address and Trampoline
 #undef TA
-#define TA(method_name) typeid(&method_name), (void *) method_name
+#define TA(method_name) \
+    (void *) method_name, trampoline::Trampoline<decltype(&method_name)>::invoke
 
 /*
  * 要保证每个 class name 只会注册一次，
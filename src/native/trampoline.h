@@ -0,0 +1,117 @@
+#ifndef CABIN_TRAMPOLINE_H
+#define CABIN_TRAMPOLINE_H
+
+#include <utility>
+#include "../slot.h"
+#include "../runtime/frame.h"
+
+/*
+ * 本地方法的调用跳板。
+ *
+ * 注册本地方法时（见 jni_internal.h 中的 TA），由 C++ 函数的参数类型列表在编译期生成一个跳板：
+ * 它从 frame 的局部变量表中按参数类型取出实参，调用本地函数，再把返回值压入 frame 的操作数栈。
+ * 解释器调用本地方法时只需一次间接调用，不再逐个比较函数类型，
+ * 新的函数签名也不需要修改解释器。
+ */
+
+namespace trampoline {
+
+// 参数类型 T 占用的 slot 数和从 slot 中取值的方法
+template <typename T> struct Arg;
+
+#define ARG(type, getter, slots_count) \
+template <> struct Arg<type> { \
+    static constexpr int slots = slots_count; \
+    static type get(const slot_t *s) { return slot::getter(s); } \
+};
+
+ARG(jbyte, getByte, 1) // jbool 与 jbyte 是同一类型
+ARG(jchar, getChar, 1)
+ARG(jshort, getShort, 1)
+ARG(jint, getInt, 1)
+ARG(jfloat, getFloat, 1)
+ARG(jref, getRef, 1)
+ARG(jlong, getLong, 2)
+ARG(jdouble, getDouble, 2)
+
+#undef ARG
+
+// 返回值写入 @ret，返回写完后的下一个 slot
+inline slot_t *put(slot_t *ret, jbyte v)   { slot::setInt(ret, v); return ret + 1; }
+inline slot_t *put(slot_t *ret, jchar v)   { slot::setInt(ret, v); return ret + 1; }
+inline slot_t *put(slot_t *ret, jshort v)  { slot::setInt(ret, v); return ret + 1; }
+inline slot_t *put(slot_t *ret, jint v)    { slot::setInt(ret, v); return ret + 1; }
+inline slot_t *put(slot_t *ret, jfloat v)  { slot::setFloat(ret, v); return ret + 1; }
+inline slot_t *put(slot_t *ret, jref v)    { slot::setRef(ret, v); return ret + 1; }
+inline slot_t *put(slot_t *ret, jlong v)   { slot::setLong(ret, v); return ret + 2; }
+inline slot_t *put(slot_t *ret, jdouble v) { slot::setDouble(ret, v); return ret + 2; }
+
+// 第 I 个参数相对于第一个参数的偏移，即前 I 个参数占用的 slot 数之和
+template <typename... Args, size_t... I>
+constexpr int offset(size_t n, std::index_sequence<I...>)
+{
+    return ((I < n ? Arg<Args>::slots : 0) + ... + 0);
+}
+
+template <typename Func> struct Trampoline;
+
+template <typename Ret, typename... Args>
+struct Trampoline<Ret(*)(Args...)> {
+    static void invoke(void *func, Frame *frame)
+    {
+        frame->ostack = call(func, frame->lvars, frame->ostack);
+    }
+
+    /*
+     * 从 @args 开始的 slot 中取出实参调用 @func，返回值写入 @ret，返回写完后的下一个 slot。
+     * @ret 可以与 @args 相同（见 intrinsics.h）。
+     */
+    static slot_t *call(void *func, const slot_t *args, slot_t *ret)
+    {
+        return call(func, args, ret, std::index_sequence_for<Args...>{});
+    }
+
+private:
+    template <size_t... I>
+    static slot_t *call(void *func, const slot_t *args, slot_t *ret, std::index_sequence<I...> seq)
+    {
+        auto f = (Ret(*)(Args...)) func;
+        if constexpr (std::is_void_v<Ret>) {
+            f(Arg<Args>::get(args + offset<Args...>(I, seq))...);
+            return ret;
+        } else {
+            return put(ret, f(Arg<Args>::get(args + offset<Args...>(I, seq))...));
+        }
+    }
+};
+
+/*
+ * 应对 java/lang/invoke/MethodHandle.java 中的 invoke* native methods，实参就是整个局部变量表。
+ * 比如：
+ * public final native @PolymorphicSignature Object invoke(Object... args) throws Throwable;
+ */
+template <>
+struct Trampoline<jref(*)(const slot_t *)> {
+    static void invoke(void *func, Frame *frame)
+    {
+        frame->pushr(((jref(*)(const slot_t *)) func)(frame->lvars));
+    }
+};
+
+/*
+ * 应对 java/lang/invoke/MethodHandle.java 中的 linkTo* native methods.
+ * 比如：
+ * static native @PolymorphicSignature Object linkToStatic(Object... args) throws Throwable;
+ */
+template <>
+struct Trampoline<jref(*)(u2, const slot_t *)> {
+    static void invoke(void *func, Frame *frame)
+    {
+        auto f = (jref(*)(u2, const slot_t *)) func;
+        frame->pushr(f(frame->method->arg_slot_count, frame->lvars));
+    }
+};
+
+} // namespace trampoline
+
+#endif //CABIN_TRAMPOLINE_H
@@ -61,6 +61,7 @@ void Array::setRef(int i, jref value)
             *++data = *++unbox;
     } else {
         *data = (slot_t) value;
+        postWriteBarrier(data);
     }
 }
 
@@ -93,7 +94,10 @@ void Array::copy(Array *dst, jint dst_pos, const Array *src, jint src_pos, jint
         throw java_lang_ArrayIndexOutOfBoundsException();
     }
 
-    memcpy(dst->index(dst_pos), src->index(src_pos), src->clazz->getEleSize() * len);
+    size_t bytes = src->clazz->getEleSize() * len;
+    memcpy(dst->index(dst_pos), src->index(src_pos), bytes);
+    if (dst->clazz->isRefArrayClass())
+        postWriteBarrier(dst->index(dst_pos), bytes);
 }
 
 size_t Array::size() const
@@ -112,6 +116,10 @@ Array *Array::clone() const
 
     auto clone = (Array *) p;
     clone->data = (slot_t *) (clone + 1);
+    clone->hash_code = 0;
+    clone->gc_age = 0;
+    if (clazz->isRefArrayClass())
+        postWriteBarrier(clone->data, s - sizeof(Array));
     return clone;
 }
 
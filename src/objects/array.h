@@ -16,9 +16,14 @@ public:
     [[nodiscard]] bool isArrayObject() const override { return true; }
     [[nodiscard]] bool isPrimArray() const;
 
-    bool checkBounds(jint index)
+    /*
+     * 负的下标转为无符号数后大于任何长度，一次比较检查两端。
+     * 总是读取 arr_len，arr 为 null 时在这里出错（见 runtime/signals.h 中的隐式空指针检查）。
+     * 出错的指令必须位于 exec() 中，所以不论优化级别都要内联。
+     */
+    __attribute__((always_inline)) bool checkBounds(jint index) const
     {
-        return 0 <= index && index < arr_len;
+        return (u4) index < (u4) arr_len;
     }
 
     void *index(jint index0) const;
@@ -44,7 +49,7 @@ public:
     void setRef(int i, jref value);
 
     template <typename T>
-    T get(jint index0) const
+    __attribute__((always_inline)) T get(jint index0) const
     {
         return *(T *) index(index0);
     }
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <optional>
 #include <unordered_set>
@@ -30,6 +31,10 @@ static unordered_map<const utf8_t *, Class *, utf8::Hash, utf8::Comparator> boot
 // vm中所有存在的 class loaders，include "boot class loader".
 static unordered_set<const Object *> loaders;
 
+// 所有的类，见 getAllClasses
+static unordered_set<Class *> all_classes;
+static mutex all_classes_mutex;
+
 static void addClassToClassLoader(Object *class_loader, Class *c)
 {
     assert(c != nullptr);
@@ -199,8 +204,11 @@ Class *defineClass(jref class_loader, u1 *bytecode, size_t len)
 Class *defineClass(jref class_loader, jref name,
                    Array *bytecode, jint off, jint len, jref protection_domain, jref source)
 {
-    auto data = (u1 *) bytecode->data;
-    Class *c = defineClass(class_loader, data + off, len);
+    // Class 持有并最终 delete[] 它的字节码，而且解释器会把指令原地改写为快速指令，
+    // 所以这里要拷贝一份，不能直接使用 java 数组的内存。
+    auto data = new u1[len];
+    memcpy(data, (u1 *) bytecode->data + off, len);
+    Class *c = defineClass(class_loader, data, len);
     // c->class_name和name是否相同 todo
 //    printvm("class_name: %s\n", c->class_name);
     return c;
@@ -283,6 +291,23 @@ const unordered_set<const Object *> &getAllClassLoaders()
     return loaders;
 }
 
+void registerClass(Class *c)
+{
+    lock_guard<mutex> lock(all_classes_mutex);
+    all_classes.insert(c);
+}
+
+void unregisterClass(Class *c)
+{
+    lock_guard<mutex> lock(all_classes_mutex);
+    all_classes.erase(c);
+}
+
+const unordered_set<Class *> &getAllClasses()
+{
+    return all_classes;
+}
+
 void printBootLoadedClasses()
 {
     cout << "boot class loader." << endl;
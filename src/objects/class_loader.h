@@ -93,6 +93,11 @@ static inline bool isDotName(const utf8_t *class_name)
 std::unordered_map<const utf8_t *, Class *, utf8::Hash, utf8::Comparator> *getAllBootClasses();
 const std::unordered_set<const Object *> &getAllClassLoaders();
 
+// 虚拟机中所有的类，包括正在构造的。GC 把它们的类元数据作为根（见 heap/gc.cpp）
+void registerClass(Class *c);
+void unregisterClass(Class *c);
+const std::unordered_set<Class *> &getAllClasses();
+
 void printBootLoadedClasses();
 void printClassLoader(Object *class_loader);
 
@@ -11,7 +11,8 @@ void checkInjectedFields(Class *c)
     if (equals(c->class_name, S(java_lang_invoke_MemberName))) {
         try {
             c->injectInstField("vmindex", S(I));
-            c->injectInstField("vmtarget", S(sig_java_lang_Object));
+            // vmtarget 保存的是 Method 或 Field 的指针，不是引用，按 long 注入，GC 不会扫描它
+            c->injectInstField("vmtarget", S(J));
         } catch (runtime_error &e) {
             JVM_PANIC(e.what()); // todo
         }
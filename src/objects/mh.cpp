@@ -42,7 +42,7 @@ void initMethodHandle()
     // private int flags;
     mn_flags_field = c->getDeclaredField(S(flags), S(I));
     // private int flags;
-    mn_vmtarget_field = c->getDeclaredField("vmtarget", S(sig_java_lang_Object));
+    mn_vmtarget_field = c->getDeclaredField("vmtarget", S(J));
     // public String getSignature();
     mn_getSignature_method = c->getDeclaredInstMethod("getSignature", S(___java_lang_String));
 
@@ -249,7 +249,7 @@ void initMemberName(jref member_name, jref target)
 
         member_name->setRefField(mn_clazz_field, decl_class->java_mirror);
         member_name->setIntField(mn_flags_field, flags);
-        member_name->setRefField(mn_vmtarget_field, (jref) (void *) m);
+        member_name->setLongField(mn_vmtarget_field, (jlong) (intptr_t) m);
         return;
 
 //        int slot = INST_DATA(target, int, mthd_slot_offset);
@@ -410,7 +410,7 @@ Object *resolveMemberName(jref member_name, Class *caller)
             auto bb = name;
             auto cc = sig;
 
-            member_name->setRefField(mn_vmtarget_field, (jref) (void *) m);
+            member_name->setLongField(mn_vmtarget_field, (jlong) (intptr_t) m);
             return member_name;
         }
         case IS_CONSTRUCTOR: {
@@ -423,7 +423,7 @@ Object *resolveMemberName(jref member_name, Class *caller)
 
             flags |= methodFlags(m);
             member_name->setIntField(mn_flags_field, flags);
-            member_name->setRefField(mn_vmtarget_field, (jref) (void *) m);
+            member_name->setLongField(mn_vmtarget_field, (jlong) (intptr_t) m);
             return member_name;
         }
         case IS_FIELD: {
@@ -437,7 +437,7 @@ Object *resolveMemberName(jref member_name, Class *caller)
 
             flags |= f->access_flags;
             member_name->setIntField(mn_flags_field, flags);
-            member_name->setRefField(mn_vmtarget_field, (jref) (void *) f);
+            member_name->setLongField(mn_vmtarget_field, (jlong) (intptr_t) f);
             return member_name;
         }
         default:
@@ -38,9 +38,22 @@ Object *Object::clone() const
 
     Object *clone = (Object *) p;
     clone->data = (slot_t *) (clone + 1);
+    clone->hash_code = 0;
+    clone->gc_age = 0;
+    postWriteBarrier(clone->data, s - sizeof(Object));
     return clone;
 }
 
+jint Object::identityHash()
+{
+    if (hash_code == 0) {
+        // 对象按 8 字节对齐，去掉总是为 0 的低位
+        auto h = (jint) ((uintptr_t) this >> 3);
+        hash_code = h != 0 ? h : 1;
+    }
+    return hash_code;
+}
+
 void Object::setFieldValue(Field *f, const slot_t *value)
 {
     assert(f != nullptr && !f->isStatic() && value != nullptr);
@@ -48,6 +61,8 @@ void Object::setFieldValue(Field *f, const slot_t *value)
     data[f->id] = value[0];
     if (f->category_two) {
         data[f->id + 1] = value[1];
+    } else if (f->isReference()) {
+        postWriteBarrier(data + f->id);
     }
 }
 
@@ -63,7 +78,7 @@ void Object::setFieldValue(int id, jref value)
         if (f->category_two)
             data[id+1] = *++unbox;
     } else {
-        setRefField(f, jnull);
+        setRefField(f, value);
     }
 }
 
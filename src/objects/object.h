@@ -10,22 +10,12 @@
 #include "../cabin.h"
 #include "../slot.h"
 #include "../metadata/field.h"
+#include "../heap/barrier.h"
 
 class Field;
 class Class;
 
 class Object {
-public:
-    // 对象头，放在Object类的最开始处
-    union {
-        struct {
-            unsigned int accessible: 1; // gc时判断对象是否可达
-            unsigned int marked: 2;
-        };
-        uintptr_t all_flags; // 以指针的大小对齐 todo 这样对齐有什么用
-    };
-
-private:
     std::recursive_mutex mutex;
 public:
     void lock() { mutex.lock(); }
@@ -47,6 +37,20 @@ public:
 
     Class *jvm_mirror = nullptr; // present only if Object of java.lang.Class
 
+protected:
+    // identity hash code，0 表示还没有生成，见 identityHash
+    jint hash_code = 0;
+
+public:
+    // 对象熬过的 minor GC 的次数，见 heap/gc.cpp
+    u1 gc_age = 0;
+
+    /*
+     * 对象的 identity hash code。第一次调用时由地址生成并保存在对象头中，
+     * 之后对象被 GC 移动也不再改变。
+     */
+    jint identityHash();
+
     virtual size_t size() const;
 
     virtual bool isArrayObject() const;
@@ -75,9 +79,22 @@ public:
     setTField(Float, jfloat)
     setTField(Long, jlong)
     setTField(Double, jdouble)
-    setTField(Ref, jref)
 #undef setTField
 
+    // 引用类型的字段写入后要经过写屏障，见 heap/barrier.h
+    void setRefField(Field *f, jref v)
+    {
+        assert(f != nullptr);
+        slot::setRef(data + f->id, v);
+        postWriteBarrier(data + f->id);
+    }
+
+    void setRefField(const char *name, const char *descriptor, jref v)
+    {
+        assert(name != nullptr && descriptor != nullptr);
+        setRefField(lookupField(name, descriptor), v);
+    }
+
 
 //    void setFieldValue(Field *f, slot_t v); // only for category one field
     void setFieldValue(Field *f, const slot_t *value);
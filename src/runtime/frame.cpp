@@ -10,6 +10,15 @@ string Frame::toString() const
     if (method->isNative())
         oss << "(native)";
     oss << method->clazz->class_name << "~" << method->name << "~" << method->descriptor;
-    oss << ", pc = " << reader.pc;
+    oss << ", pc = " << pc();
     return oss.str();
 }
+
+size_t Frame::pc() const
+{
+    ThreadedCode *tc = method->threaded_code.load(memory_order_acquire);
+    if (ip == nullptr || tc == nullptr || ip == tc->code)
+        return 0;
+    // ip 已经越过了当前指令的 handler
+    return tc->pcOf(ip - 1);
+}
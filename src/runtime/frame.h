@@ -3,14 +3,20 @@
 
 #include "../metadata/class.h"
 #include "../metadata/method.h"
-#include "../classfile/bytecode_reader.h"
+#include "../interpreter/threaded_code.h"
 
 class Method;
 
 class Frame {
 public:
     Method *method;
-    BytecodeReader reader;
+
+    /*
+     * 在 method 的指令流（见 ThreadedCode）中的执行位置，
+     * 只在调用、返回和异常时由解释器保存，执行中的 frame 的 ip 可能是旧的。
+     * 为 nullptr 表示还没有开始执行。
+     */
+    Cell *ip = nullptr;
 
     /*
      * this frame 执行的函数是否由虚拟机调用
@@ -22,15 +28,23 @@ public:
     Frame *prev;
 
     slot_t *lvars;   // local variables
-    slot_t *ostack;  // operand stack
+    slot_t *ostack;  // operand stack，和 ip 一样，执行中的 frame 的 ostack 可能是旧的
+
+    /*
+     * 紧挨在操作数栈下面的一个 slot，必须是最后一个成员。
+     * 解释器把栈顶缓存在局部变量中（见 interpreter.cpp 中的 tos），
+     * 操作数栈为空时缓存的“栈顶”是它，写回时写到这里，不会覆盖 frame 的其他成员。
+     */
+    slot_t below_ostack = 0;
 
     Frame(Method *m, bool vm_invoke, slot_t *_lvars, slot_t *_ostack, Frame *prev)
-            : method(m), reader(m->code, m->code_len), vm_invoke(vm_invoke),
+            : method(m), vm_invoke(vm_invoke),
               prev(prev), lvars(_lvars), ostack(_ostack)
     {
         assert(m != nullptr);
         assert(_lvars != nullptr);
         assert(_ostack != nullptr);
+        assert(&below_ostack + 1 == (slot_t *) (this + 1));
     }
 
     // push to ostack.
@@ -59,6 +73,9 @@ public:
         ostack = (slot_t *)(this + 1);
     }
 
+    // 当前正在执行的指令（对于调用者 frame，即调用指令）在字节码中的 pc
+    [[nodiscard]] size_t pc() const;
+
     [[nodiscard]] virtual std::string toString() const;
 };
 
@@ -0,0 +1,133 @@
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <pthread.h>
+#include "safepoint.h"
+#include "vm_thread.h"
+#include "../cabin.h"
+
+using namespace std;
+
+atomic<bool> g_safepoint_requested{false};
+
+// 保护 g_all_threads 和各线程的安全点状态（Thread::at_safepoint 等）
+static mutex safepoint_mutex;
+static condition_variable safepoint_cond;
+
+static bool requested()
+{
+    return g_safepoint_requested.load(memory_order_relaxed);
+}
+
+/*
+ * 在安全区域内执行。
+ * 先把调用者放在寄存器中的值（可能是对象的引用）保存到本函数的 frame 中，
+ * 再以本函数中局部变量的地址作为本地栈的栈顶，GC 从这里向上扫描（见 heap/gc.cpp）。
+ * 所以本函数不能内联，并且在离开安全区域之前不能返回。
+ */
+__attribute__((noinline)) void runInSafeRegion(void (*fn)(void *), void *arg)
+{
+    assert(fn != nullptr);
+
+    Thread *t = getCurrentThread();
+    if (t == nullptr || t->at_safepoint) {
+        // 不是 Java 线程，或者已经在安全区域内
+        fn(arg);
+        return;
+    }
+
+    __builtin_unwind_init();
+    volatile char sp_marker = 0;
+
+    {
+        lock_guard<mutex> lock(safepoint_mutex);
+        t->native_sp = (void *) &sp_marker;
+        t->at_safepoint = true;
+        safepoint_cond.notify_all();
+    }
+
+    auto leave = [t] {
+        unique_lock<mutex> lock(safepoint_mutex);
+        safepoint_cond.wait(lock, [] { return !requested(); });
+        t->at_safepoint = false;
+        t->native_sp = nullptr;
+    };
+
+    try {
+        fn(arg);
+    } catch (...) {
+        leave();
+        throw;
+    }
+    leave();
+}
+
+void blockAtSafepoint()
+{
+    // 进入再离开安全区域，离开时等待 GC 结束
+    runInSafeRegion([](void *) { }, nullptr);
+}
+
+void registerThread(Thread *thread)
+{
+    assert(thread != nullptr);
+    void *stack_base = nativeStackBase();
+
+    unique_lock<mutex> lock(safepoint_mutex);
+    safepoint_cond.wait(lock, [] { return !requested(); });
+    thread->native_stack_base = stack_base;
+    g_all_threads.push_back(thread);
+}
+
+void unregisterThread(Thread *thread)
+{
+    assert(thread != nullptr);
+    assert(thread->getTopFrame() == nullptr);
+
+    lock_guard<mutex> lock(safepoint_mutex);
+    thread->terminated = true;
+    safepoint_cond.notify_all();
+}
+
+void stopTheWorld()
+{
+    Thread *self = getCurrentThread();
+
+    unique_lock<mutex> lock(safepoint_mutex);
+    assert(!requested());
+    g_safepoint_requested.store(true);
+
+    safepoint_cond.wait(lock, [self] {
+        for (Thread *t : g_all_threads) {
+            if (t != self && !t->terminated && !t->at_safepoint)
+                return false;
+        }
+        return true;
+    });
+}
+
+void resumeTheWorld()
+{
+    lock_guard<mutex> lock(safepoint_mutex);
+    assert(requested());
+    g_safepoint_requested.store(false);
+    safepoint_cond.notify_all();
+}
+
+void *nativeStackBase()
+{
+#ifdef __APPLE__
+    return pthread_get_stackaddr_np(pthread_self());
+#else
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+        JVM_PANIC("can't get the native stack of current thread\n");
+    }
+
+    void *addr;
+    size_t size;
+    pthread_attr_getstack(&attr, &addr, &size);
+    pthread_attr_destroy(&attr);
+    return (u1 *) addr + size;
+#endif
+}
@@ -0,0 +1,94 @@
+#ifndef CABIN_SAFEPOINT_H
+#define CABIN_SAFEPOINT_H
+
+#include <atomic>
+#include <type_traits>
+
+/*
+ * 安全点（safepoint）
+ *
+ * GC 时要停下所有的 Java 线程（stop-the-world），线程只在安全点停下，
+ * 此时它的每个 frame 都保存了执行位置，可以按引用映射精确地扫描（见 heap/ref_map.h）。
+ *
+ * 解释器在方法入口和循环的回边上轮询（见 safepointPoll），发现有停顿请求时停下，等待 GC 结束。
+ * 编译后的代码都是叶子方法（见 jit/jit.h），只在循环的回边上轮询 g_safepoint_requested，
+ * 有停顿请求时写回 frame，退出到解释器并停在这条跳转指令处；没有循环的代码很快就会返回解释器。
+ *
+ * 会长时间阻塞的操作（sleep、等待锁等）在安全区域（safe region）内执行，
+ * 线程进入安全区域即视为停在了安全点，GC 不用等它醒来；离开安全区域时如果 GC 还在进行，等它结束。
+ * 安全区域内不能读写对象的引用字段。
+ *
+ * 虚拟机自己的 C++ 代码中也持有对象的引用（局部变量和寄存器），GC 保守地扫描各线程的本地栈：
+ * 线程停下时记录本地栈的栈顶，并把寄存器保存在栈上。
+ */
+
+// 有线程请求停顿（GC 正在等待或者正在进行）
+extern std::atomic<bool> g_safepoint_requested;
+
+// 在安全点停下，直到 GC 结束。调用前须保存当前 frame 的执行位置
+void blockAtSafepoint();
+
+static inline void safepointPoll()
+{
+    if (g_safepoint_requested.load(std::memory_order_relaxed))
+        blockAtSafepoint();
+}
+
+// 在安全区域内执行 @fn(@arg)，见 inSafeRegion
+void runInSafeRegion(void (*fn)(void *), void *arg);
+
+/*
+ * 在安全区域内执行 @f，用于可能长时间阻塞的操作。
+ * 不属于任何 Java 线程的线程（比如后台的编译线程）直接执行 @f。
+ */
+template <typename F>
+void inSafeRegion(F &&f)
+{
+    runInSafeRegion([](void *arg) { (*(std::remove_reference_t<F> *) arg)(); }, (void *) &f);
+}
+
+/*
+ * 获取锁 @m，锁被占用时在安全区域内等待。
+ * 持有时可能停在安全点的锁（执行 Java 代码、分配对象时持有的锁）都要这样获取，
+ * 否则持有者触发的 GC 会一直等待阻塞在锁上的线程，而它们在等待 GC 结束。
+ */
+template <typename Mutex>
+void lockSafely(Mutex &m)
+{
+    if (!m.try_lock())
+        inSafeRegion([&m] { m.lock(); });
+}
+
+// 与 std::lock_guard 相同，用 lockSafely 获取锁
+template <typename Mutex>
+class SafeLockGuard {
+    Mutex &m;
+public:
+    explicit SafeLockGuard(Mutex &m): m(m) { lockSafely(m); }
+    ~SafeLockGuard() { m.unlock(); }
+
+    SafeLockGuard(const SafeLockGuard &) = delete;
+    SafeLockGuard &operator=(const SafeLockGuard &) = delete;
+};
+
+class Thread;
+
+// 线程开始执行 Java 代码前调用，加入 g_all_threads。GC 正在进行时等它结束
+void registerThread(Thread *thread);
+
+// 线程结束时调用，之后 GC 不再等待、也不再扫描它
+void unregisterThread(Thread *thread);
+
+/*
+ * 停下除当前线程以外的所有 Java 线程，返回时它们都停在了安全点或者位于安全区域内。
+ * 同时只能有一个线程请求停顿（由调用者保证，GC 时持有堆的锁）。
+ */
+void stopTheWorld();
+
+// 恢复 stopTheWorld 停下的线程
+void resumeTheWorld();
+
+// 返回当前线程本地栈的栈底（最高地址）
+void *nativeStackBase();
+
+#endif //CABIN_SAFEPOINT_H
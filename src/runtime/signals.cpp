@@ -0,0 +1,61 @@
+#include <csignal>
+#include <cstdint>
+#include <ucontext.h>
+#include "signals.h"
+#include "vm_thread.h"
+#include "../interpreter/interpreter.h"
+#include "../exception.h"
+
+static struct sigaction old_segv_action;
+static struct sigaction old_bus_action;
+
+// 交给安装本处理程序之前的处理程序
+static void chainSignal(int sig, siginfo_t *info, void *context)
+{
+    struct sigaction *old = sig == SIGSEGV ? &old_segv_action : &old_bus_action;
+    if (old->sa_flags & SA_SIGINFO) {
+        old->sa_sigaction(sig, info, context);
+    } else if (old->sa_handler == SIG_DFL || old->sa_handler == SIG_IGN) {
+        // 恢复默认的处理后返回，出错的指令再次执行时按默认的方式终止进程
+        signal(sig, SIG_DFL);
+    } else {
+        old->sa_handler(sig);
+    }
+}
+
+static void handleSignal(int sig, siginfo_t *info, void *context)
+{
+    auto addr = (uintptr_t) info->si_addr;
+
+#if IMPLICIT_NULL_CHECKS
+    auto uc = (ucontext_t *) context;
+    auto pc = (const void *) uc->uc_mcontext.gregs[REG_RIP];
+    if (addr < NULL_ACCESS_LIMIT && isInterpreterCode(pc)) {
+        /*
+         * 解释器中对 null 引用的访问。
+         * 异常从信号栈帧展开到出错的指令（处理程序以 SA_NODEFER 安装，展开后信号没有被屏蔽），
+         * 出错的线程停在解释器中已知的位置，不在 malloc 等函数内部，可以分配异常对象。
+         */
+        throw java_lang_NullPointerException();
+    }
+#endif
+
+    Thread *thread = getCurrentThread();
+    if (thread != nullptr && thread->inStackGuard((const void *) addr)) {
+        // frame 的分配都检查了栈的边界（见 Thread::allocFrame），越过边界的访问是虚拟机的错误
+        JVM_PANIC("access to the guard page of vm stack at %p\n", (void *) addr);
+    }
+
+    chainSignal(sig, info, context);
+}
+
+void initSignalHandlers()
+{
+    struct sigaction action{};
+    action.sa_sigaction = handleSignal;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+
+    sigaction(SIGSEGV, &action, &old_segv_action);
+    sigaction(SIGBUS, &action, &old_bus_action);
+}
@@ -0,0 +1,36 @@
+#ifndef CABIN_SIGNALS_H
+#define CABIN_SIGNALS_H
+
+/*
+ * 隐式空指针检查（implicit null checks）
+ *
+ * 解释器读写字段、数组元素和数组长度，以及分派虚方法时，不先比较引用是否为 null，
+ * 而是直接访问对象：null 引用加上成员的偏移落在第一页内，访问时产生 SIGSEGV。
+ * 信号处理程序确认出错的指令位于解释器中（见 isInterpreterCode）、访问的是低地址后，
+ * 在出错的线程中抛出 java_lang_NullPointerException。
+ * 解释器以 -fnon-call-exceptions 编译，访存指令也可以抛出 C++ 异常，
+ * exec() 捕获后保存执行位置，由 execJavaFunc 重新进入 exec()，按正常的路径查找异常处理代码。
+ *
+ * 信号是同步的，只在出错的线程中处理，多线程下不需要额外的同步。
+ * 不满足上面条件的段错误交给原来的处理程序（默认是终止进程）。
+ *
+ * 用 cmake -DIMPLICIT_NULL_CHECKS=ON 打开，只支持 x86-64 Linux。
+ *
+ * 无论是否打开隐式空指针检查，访问虚拟机栈保护页（见 Thread::inStackGuard）的段错误
+ * 都报告为虚拟机的内部错误，而不是不明原因的崩溃。
+ */
+#ifndef IMPLICIT_NULL_CHECKS
+    #define IMPLICIT_NULL_CHECKS 0
+#endif
+
+#if IMPLICIT_NULL_CHECKS && !(defined(__x86_64__) && defined(__linux__))
+    #error "implicit null checks are only supported on x86-64 Linux"
+#endif
+
+// null 引用加上偏移后访问的地址小于此值
+#define NULL_ACCESS_LIMIT 4096
+
+// 安装 SIGSEGV 和 SIGBUS 的处理程序，须在执行 Java 代码之前调用
+void initSignalHandlers();
+
+#endif //CABIN_SIGNALS_H
@@ -1,5 +1,7 @@
 #include <cassert>
 #include <thread>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "vm_thread.h"
 #include "../cabin.h"
 #include "../debug.h"
@@ -9,7 +11,9 @@
 #include "../metadata/field.h"
 #include "../objects/array.h"
 #include "../interpreter/interpreter.h"
+#include "../exception.h"
 #include "frame.h"
+#include "safepoint.h"
 
 #if TRACE_THREAD
 #define TRACE PRINT_TRACE
@@ -42,6 +46,14 @@ static Class *thread_class;
 
 Thread *g_main_thread;
 
+size_t vm_stack_size = VM_STACK_SIZE;
+
+static size_t pageSize()
+{
+    static const auto page_size = (size_t) sysconf(_SC_PAGESIZE);
+    return page_size;
+}
+
 Thread *initMainThread()
 {
     thread_class = loadBootClass(S(java_lang_Thread));
@@ -96,16 +108,27 @@ void createVMThread(void *(*start)(void *), const utf8_t *thread_name)
 //    t.detach();
 }
 
-static mutex new_thread_mutex;
-
 Thread::Thread(Object *tobj0, jint priority): tobj(tobj0)
 {
     assert(THREAD_MIN_PRIORITY <= priority && priority <= THREAD_MAX_PRIORITY);
 
-    scoped_lock lock(new_thread_mutex);
+    // 只保留地址空间，用到的页才占用物理内存。末尾多保留一页作为保护页
+    size_t page = pageSize();
+    size_t size = (vm_stack_size + page - 1) / page * page;
+    void *p = mmap(nullptr, size + page, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        JVM_PANIC("can't reserve vm stack of %zu bytes\n", size);
+    }
+    vm_stack = (u1 *) p;
+    vm_stack_end = vm_stack + size;
+    vm_stack_limit = vm_stack_end - VM_STACK_RESERVED_SIZE;
+    if (mprotect(vm_stack_end, page, PROT_NONE) != 0) {
+        JVM_PANIC("can't protect the guard page of vm stack\n");
+    }
 
     saveCurrentThread(this);
-    g_all_threads.push_back(this);
+    registerThread(this);
 
     // tid = pthread_self();
     tid = this_thread::get_id();
@@ -176,10 +199,8 @@ Frame *Thread::allocFrame(Method *m, bool vm_invoke)
 
     intptr_t mem = top_frame == nullptr ? (intptr_t) vm_stack : top_frame->end();
     auto size = sizeof(Frame) + (m->max_locals + m->max_stack) * sizeof(slot_t);
-    if (mem + size - (intptr_t) vm_stack > VM_STACK_SIZE) {
-//        thread_throw(new StackOverflowError);
-        // todo 栈已经溢出无法执行程序了。不要抛异常了，无法执行了。
-        JVM_PANIC("StackOverflowError");
+    if (mem + (intptr_t) size > (intptr_t) vm_stack_limit) {
+        throwStackOverflow(size);
     }
 
     auto lvars = (slot_t *)(mem);
@@ -193,6 +214,38 @@ void Thread::popFrame()
 {
     assert(top_frame != nullptr);
     top_frame = top_frame->prev;
+
+    if (vm_stack_limit == vm_stack_end) {
+        // 溢出后放开了保留区，栈退回到正常的范围内后收回，之后的溢出可以再次抛出 StackOverflowError
+        intptr_t top = top_frame == nullptr ? (intptr_t) vm_stack : top_frame->end();
+        if (top <= (intptr_t) (vm_stack_end - VM_STACK_RESERVED_SIZE))
+            vm_stack_limit = vm_stack_end - VM_STACK_RESERVED_SIZE;
+    }
+}
+
+void Thread::throwStackOverflow(size_t frame_size)
+{
+    if (vm_stack_limit == vm_stack_end) {
+        // 创建和抛出 StackOverflowError 的过程中又溢出了，保留区也不够用
+        JVM_PANIC("StackOverflowError: the reserved zone of vm stack is exhausted, "
+                  "can't allocate a frame of %zu bytes\n", frame_size);
+    }
+
+    // 放开保留区：创建异常对象要执行它的构造函数，找不到异常处理代码时还要打印栈轨迹
+    vm_stack_limit = vm_stack_end;
+    throw java_lang_StackOverflowError();
+}
+
+bool Thread::inStackGuard(const void *addr) const
+{
+    auto a = (const u1 *) addr;
+    return vm_stack_end <= a && a < vm_stack_end + pageSize();
+}
+
+void Thread::releaseVMStack()
+{
+    assert(top_frame == nullptr);
+    madvise(vm_stack, vm_stack_end - vm_stack, MADV_DONTNEED);
 }
 
 int Thread::countStackFrames()
@@ -257,7 +310,7 @@ Array *Thread::dump(int max_depth)
                                     rslot(newString(f->method->clazz->class_name)),
                                     rslot(newString(f->method->name)),
                                     rslot(newString(f->method->clazz->source_file_name)),
-                                    islot(f->method->getLineNumber(f->reader.pc)) }
+                                    islot(f->method->getLineNumber(f->pc())) }
         );
         arr->setRef(i, o);
     }
@@ -6,6 +6,7 @@
 #include "../config.h"
 #include "../cabin.h"
 #include "../util/encoding.h"
+#include "../heap/tlab.h"
 
 class Object;
 class ClassLoader;
@@ -73,16 +74,28 @@ class Array;
 
 class Monitor;
 
+// 虚拟机栈的大小，-Xss 设置
+extern size_t vm_stack_size;
+
 class Thread {
     /*
      * VM stack 中的 Frame 布局：
      * ------------------------------------------------------------------
      * |lvars|Frame|ostack|, |lvars|Frame|ostack|, |lvars|Frame|ostack| ...
      * ------------------------------------------------------------------
+     *
+     * 虚拟机栈（一个线程只有一个）用 mmap 保留地址空间，物理内存在第一次访问时才分配，
+     * 栈的末尾之后是一个不可访问的保护页。
+     * 最后的 VM_STACK_RESERVED_SIZE 字节平时不用，栈溢出后临时放开，
+     * 用来创建和抛出 StackOverflowError，栈退回到正常的范围内后收回。
      */
-    u1 vm_stack[VM_STACK_SIZE]; // 虚拟机栈，一个线程只有一个虚拟机栈
+    u1 *vm_stack = nullptr;
+    u1 *vm_stack_end = nullptr;   // 栈的末尾，之后是保护页
+    u1 *vm_stack_limit = nullptr; // 新的 frame 不能越过此处，正常时为 vm_stack_end - VM_STACK_RESERVED_SIZE
     Frame *top_frame = nullptr;
 
+    [[noreturn]] void throwStackOverflow(size_t frame_size);
+
     friend Thread *initMainThread();
     friend void createVMThread(void *(*start)(void *), const utf8_t *thread_name);
 
@@ -90,6 +103,17 @@ public:
     Object *tobj = nullptr; // 所关联的 Object of java.lang.Thread
     std::thread::id tid;    // 所关联的 local thread 对应的id
 
+    /*
+     * 安全点的状态，见 runtime/safepoint.h，由其中的锁保护。
+     * 线程停下时，GC 保守地扫描本地栈中 [native_sp, native_stack_base) 的部分。
+     */
+    bool at_safepoint = false; // 停在安全点或者位于安全区域内
+    bool terminated = false;
+    void *native_sp = nullptr;
+    void *native_stack_base = nullptr;
+
+    Tlab tlab; // 见 heap/tlab.h，只由本线程和 GC 访问
+
     explicit Thread(Object *jThread = nullptr, jint priority = THREAD_NORM_PRIORITY);
 
     jbool interrupted = jfalse;
@@ -107,6 +131,7 @@ public:
     void clearVMStack()
     {
         top_frame = nullptr;
+        vm_stack_limit = vm_stack_end - VM_STACK_RESERVED_SIZE;
     }
 
     Frame *getTopFrame()
@@ -114,9 +139,19 @@ public:
         return top_frame;
     }
 
+    /*
+     * 在虚拟机栈上为方法 @m 分配一个 frame。
+     * 栈的空间不够时抛出 java_lang_StackOverflowError。
+     */
     Frame *allocFrame(Method *m, bool vm_invoke);
     void popFrame();
 
+    // 判断地址 @addr 是否位于本线程虚拟机栈的保护页内
+    bool inStackGuard(const void *addr) const;
+
+    // 线程结束后归还虚拟机栈占用的物理内存，地址空间仍然保留
+    void releaseVMStack();
+
     int countStackFrames();
     std::vector<Frame *> getStackFrames();
 
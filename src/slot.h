@@ -19,36 +19,148 @@ static_assert(sizeof(slot_t) >= sizeof(jref));
 static_assert(2*sizeof(slot_t) >= sizeof(jlong));
 static_assert(2*sizeof(slot_t) >= sizeof(jdouble));
 
+#define ISLOT(slot_point) (* (jint *) (slot_point))
+#define FSLOT(slot_point) (* (jfloat *) (slot_point))
+#define LSLOT(slot_point) (* (jlong *) (slot_point))
+#define DSLOT(slot_point) (* (jdouble *) (slot_point))
+#define RSLOT(slot_point) (* (jref *) (slot_point))
+
+// 解释器的每次入栈出栈都要经过这些函数，定义为内联函数，才不会在每条指令中都有函数调用
 namespace slot {
-    /* build slot */
+    /* setter */
 
-    slot_t islot(jint v);
-    slot_t fslot(jfloat v);
-    slot_t rslot(jref v);
+    inline void setInt(slot_t *slots, jint v)
+    {
+        assert(slots != nullptr);
+        ISLOT(slots) = v;
+    }
 
-    /* setter */
+    inline void setByte(slot_t *slots, jbyte v)
+    {
+        assert(slots != nullptr);
+        setInt(slots, v);
+    }
+
+    inline void setBool(slot_t *slots, jbool v)
+    {
+        assert(slots != nullptr);
+        setInt(slots, v);
+    }
+
+    inline void setChar(slot_t *slots, jchar v)
+    {
+        assert(slots != nullptr);
+        setInt(slots, v);
+    }
 
-    void setInt(slot_t *slots, jint v);
-    void setByte(slot_t *slots, jbyte v);
-    void setBool(slot_t *slots, jbool v);
-    void setChar(slot_t *slots, jchar v);
-    void setShort(slot_t *slots, jshort v);
-    void setFloat(slot_t *slots, jfloat v);
-    void setLong(slot_t *slots, jlong v);
-    void setDouble(slot_t *slots, jdouble v);
-    void setRef(slot_t *slots, jref v);
+    inline void setShort(slot_t *slots, jshort v)
+    {
+        assert(slots != nullptr);
+        setInt(slots, v);
+    }
+
+    inline void setFloat(slot_t *slots, jfloat v)
+    {
+        assert(slots != nullptr);
+        FSLOT(slots) = v;
+    }
+
+    inline void setLong(slot_t *slots, jlong v)
+    {
+        assert(slots != nullptr);
+        LSLOT(slots) = v;
+    }
+
+    inline void setDouble(slot_t *slots, jdouble v)
+    {
+        assert(slots != nullptr);
+        DSLOT(slots) = v;
+    }
+
+    inline void setRef(slot_t *slots, jref v)
+    {
+        assert(slots != nullptr);
+        RSLOT(slots) = v;
+    }
 
     /* getter */
 
-    jint getInt(const slot_t *slots);
-    jbyte getByte(const slot_t *slots);
-    jbool getBool(const slot_t *slots);
-    jchar getChar(const slot_t *slots);
-    jshort getShort(const slot_t *slots);
-    jfloat getFloat(const slot_t *slots);
-    jlong getLong(const slot_t *slots);
-    jdouble getDouble(const slot_t *slots);
-    jref getRef(const slot_t *slots);
+    inline jint getInt(const slot_t *slots)
+    {
+        assert(slots != nullptr);
+        return ISLOT(slots);
+    }
+
+    inline jbyte getByte(const slot_t *slots)
+    {
+        assert(slots != nullptr);
+        return jint2jbyte(getInt(slots));
+    }
+
+    inline jbool getBool(const slot_t *slots)
+    {
+        assert(slots != nullptr);
+        return jint2jbool(getInt(slots));
+    }
+
+    inline jchar getChar(const slot_t *slots)
+    {
+        assert(slots != nullptr);
+        return jint2jchar(getInt(slots));
+    }
+
+    inline jshort getShort(const slot_t *slots)
+    {
+        assert(slots != nullptr);
+        return jint2jshort(getInt(slots));
+    }
+
+    inline jfloat getFloat(const slot_t *slots)
+    {
+        assert(slots != nullptr);
+        return FSLOT(slots);
+    }
+
+    inline jlong getLong(const slot_t *slots)
+    {
+        assert(slots != nullptr);
+        return LSLOT(slots);
+    }
+
+    inline jdouble getDouble(const slot_t *slots)
+    {
+        assert(slots != nullptr);
+        return DSLOT(slots);
+    }
+
+    inline jref getRef(const slot_t *slots)
+    {
+        assert(slots != nullptr);
+        return RSLOT(slots);
+    }
+
+    /* build slot */
+
+    inline slot_t islot(jint v)
+    {
+        slot_t s;
+        setInt(&s, v);
+        return s;
+    }
+
+    inline slot_t fslot(jfloat v)
+    {
+        slot_t s;
+        setFloat(&s, v);
+        return s;
+    }
+
+    inline slot_t rslot(jref v)
+    {
+        slot_t s;
+        setRef(&s, v);
+        return s;
+    }
 }
 
 #endif //CABIN_SLOT_H
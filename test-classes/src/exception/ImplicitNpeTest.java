@@ -0,0 +1,113 @@
+package exception;
+
+/**
+ * 测试用段错误实现的空指针检查（用 -DIMPLICIT_NULL_CHECKS=ON 构建虚拟机后运行，见 src/runtime/signals.h）。
+ * 覆盖省去了显式检查的指令：快速形式的 getfield/putfield、数组的读写、arraylength、
+ * invokevirtual/invokeinterface 的快速形式，以及 aload_getfield、dup_getfield、aload_iload_iaload 超级指令。
+ * 每个用例先用非 null 的引用执行，让指令被改写为快速形式，再用 null 执行。
+ * 每行输出都应为 true。不打开此选项时同样应该通过。
+ */
+public class ImplicitNpeTest {
+    private int i = 1;
+    private long l = 2;
+    private Object o = "o";
+
+    interface Task {
+        int run();
+    }
+
+    static class SimpleTask implements Task {
+        public int run() {
+            return 1;
+        }
+    }
+
+    int value() {
+        return i;
+    }
+
+    static int getInt(ImplicitNpeTest t) { return t.i; }
+    static long getLong(ImplicitNpeTest t) { return t.l; }
+    static Object getRef(ImplicitNpeTest t) { return t.o; }
+    static void putInt(ImplicitNpeTest t) { t.i = 3; }
+    static void putLong(ImplicitNpeTest t) { t.l = 4; }
+    static void putRef(ImplicitNpeTest t) { t.o = "p"; }
+    static int incInt(ImplicitNpeTest t) { return t.i++; } // dup_getfield
+
+    static int iaload(int[] a, int k) { return a[k]; }     // aload_iload_iaload
+    static long laload(long[] a) { return a[0]; }
+    static byte baload(byte[] a) { return a[0]; }
+    static char caload(char[] a) { return a[0]; }
+    static double daload(double[] a) { return a[0]; }
+    static Object aaload(Object[] a) { return a[0]; }
+    static void iastore(int[] a) { a[0] = 1; }
+    static void lastore(long[] a) { a[0] = 1; }
+    static void bastore(byte[] a) { a[0] = 1; }
+    static void castore(char[] a) { a[0] = 1; }
+    static void dastore(double[] a) { a[0] = 1; }
+    static void aastore(Object[] a) { a[0] = "x"; }
+    static int arraylength(int[] a) { return a.length; }
+
+    static int invokevirtual(ImplicitNpeTest t) { return t.value(); }
+    static int invokeinterface(Task t) { return t.run(); }
+
+    interface Action {
+        void run() throws Exception;
+    }
+
+    static boolean throwsNpe(Action a) {
+        try {
+            a.run();
+            return false;
+        } catch (NullPointerException e) {
+            return true;
+        } catch (Exception e) {
+            return false;
+        }
+    }
+
+    public static void main(String[] args) throws Exception {
+        ImplicitNpeTest t = new ImplicitNpeTest();
+        int[] ia = { 7 };
+        Object[] oa = { "a" };
+
+        // 先执行一遍，指令被改写为快速形式
+        for (int k = 0; k < 2; k++) {
+            getInt(t); getLong(t); getRef(t); putInt(t); putLong(t); putRef(t); incInt(t);
+            iaload(ia, 0); laload(new long[1]); baload(new byte[1]); caload(new char[1]);
+            daload(new double[1]); aaload(oa);
+            iastore(ia); lastore(new long[1]); bastore(new byte[1]); castore(new char[1]);
+            dastore(new double[1]); aastore(oa); arraylength(ia);
+            invokevirtual(t); invokeinterface(new SimpleTask());
+        }
+
+        System.out.println(throwsNpe(() -> getInt(null)));
+        System.out.println(throwsNpe(() -> getLong(null)));
+        System.out.println(throwsNpe(() -> getRef(null)));
+        System.out.println(throwsNpe(() -> putInt(null)));
+        System.out.println(throwsNpe(() -> putLong(null)));
+        System.out.println(throwsNpe(() -> putRef(null)));
+        System.out.println(throwsNpe(() -> incInt(null)));
+
+        System.out.println(throwsNpe(() -> iaload(null, 0)));
+        System.out.println(throwsNpe(() -> iaload(null, -1))); // 下标为负时仍然是 NullPointerException
+        System.out.println(throwsNpe(() -> laload(null)));
+        System.out.println(throwsNpe(() -> baload(null)));
+        System.out.println(throwsNpe(() -> caload(null)));
+        System.out.println(throwsNpe(() -> daload(null)));
+        System.out.println(throwsNpe(() -> aaload(null)));
+        System.out.println(throwsNpe(() -> iastore(null)));
+        System.out.println(throwsNpe(() -> lastore(null)));
+        System.out.println(throwsNpe(() -> bastore(null)));
+        System.out.println(throwsNpe(() -> castore(null)));
+        System.out.println(throwsNpe(() -> dastore(null)));
+        System.out.println(throwsNpe(() -> aastore(null)));
+        System.out.println(throwsNpe(() -> arraylength(null)));
+
+        System.out.println(throwsNpe(() -> invokevirtual(null)));
+        System.out.println(throwsNpe(() -> invokeinterface(null)));
+
+        // 抛出过 NullPointerException 之后解释器仍然正常执行
+        System.out.println(getInt(t) == 4 && iaload(ia, 0) == 1);
+    }
+}
@@ -0,0 +1,49 @@
+package exception;
+
+/**
+ * 测试虚拟机栈溢出时抛出可以捕获的 StackOverflowError（见 src/runtime/vm_thread.h）。
+ * 第一次溢出放开了栈的保留区，栈退回后保留区要重新收回，第二次溢出才能再次抛出 StackOverflowError。
+ *
+ * 分别用默认的栈大小和 -Xss 指定的大小运行，比如 -Xss256k 和 -Xss4m，
+ * 栈越大能递归的深度越大。每行输出都应为 true。
+ */
+public class StackOverflowTest {
+    private static int depth;
+
+    private static void recurse(long a, long b) {
+        depth++;
+        recurse(a + 1, b + 1);
+    }
+
+    // 溢出后返回能达到的递归深度，没有捕获到 StackOverflowError 时返回 -1
+    private static int overflow() {
+        depth = 0;
+        try {
+            recurse(0, 0);
+        } catch (StackOverflowError e) {
+            return depth;
+        }
+        return -1;
+    }
+
+    public static void main(String[] args) {
+        int first = overflow();
+        System.out.println(first > 0);
+
+        // 栈已退回，再次递归仍然抛出 StackOverflowError，深度大致相同
+        int second = overflow();
+        System.out.println(second > 0);
+        System.out.println(second > first / 2);
+
+        // 在更深的位置开始递归，栈溢出时离保留区更近
+        System.out.println(overflowAt(100) > 0);
+
+        // 溢出之后正常地调用方法
+        System.out.println(overflow() > 0);
+        System.out.println("ok".equals(String.valueOf("ok")));
+    }
+
+    private static int overflowAt(int n) {
+        return n == 0 ? overflow() : overflowAt(n - 1);
+    }
+}
@@ -0,0 +1,80 @@
+package gc;
+
+/**
+ * 测试老年代的空闲链表（见 src/heap/free_list.h）分割和合并空闲块。
+ * 不小于 1Mb 的数组直接在老年代中分配（见 PRETENURE_SIZE_THRESHOLD）。
+ *
+ *   1. 用 3Mb 的数组填满老年代，释放其中一半，GC 后留下许多 3Mb 的空隙；
+ *   2. 在空隙中分配 1Mb 的数组，一个空隙能放两个，说明空闲块被分割后剩下的部分仍然可用；
+ *   3. 释放大部分数组，GC 后分配 40Mb 的数组，只有相邻的空隙合并后才放得下。
+ *
+ * 每个数组的首尾字节记录它的编号，检查存活的数组没有被覆盖。
+ * 本地栈是保守扫描的，个别已释放的数组可能被当作存活，所以只检查数量的下限。
+ * 每行输出都应为 true。
+ */
+public class FreeListTest {
+    static byte[] block(int len, int tag) {
+        byte[] b = new byte[len];
+        b[0] = (byte) tag;
+        b[len - 1] = (byte) tag;
+        return b;
+    }
+
+    // 一直分配 @len 字节的数组直到 OutOfMemoryError，返回分配的个数
+    static int fill(byte[][] blocks, int len) {
+        int n = 0;
+        try {
+            while (n < blocks.length) {
+                blocks[n] = block(len, n);
+                n++;
+            }
+        } catch (OutOfMemoryError e) {
+            // 老年代满了
+        }
+        return n;
+    }
+
+    // 除了下标是 @keep 的倍数的，释放 @blocks 中的数组
+    static void drop(byte[][] blocks, int keep) {
+        for (int i = 0; i < blocks.length; i++) {
+            if (i % keep != 0)
+                blocks[i] = null;
+        }
+    }
+
+    static boolean intact(byte[][] blocks) {
+        for (int i = 0; i < blocks.length; i++) {
+            byte[] b = blocks[i];
+            if (b != null && (b[0] != (byte) i || b[b.length - 1] != (byte) i))
+                return false;
+        }
+        return true;
+    }
+
+    public static void main(String[] args) {
+        byte[][] big = new byte[4096][];
+        int n = fill(big, 3 << 20);
+        System.out.println(n > 64);
+
+        drop(big, 2);
+        System.gc();
+
+        // 没有分割时每个空隙只能放一个
+        byte[][] small = new byte[8192][];
+        int m = fill(small, 1 << 20);
+        System.out.println(m > n / 2);
+        System.out.println(intact(big));
+        System.out.println(intact(small));
+
+        // 只留下每 16 个 3Mb 的数组中的一个，相邻的 15 个空隙合并后有 45Mb
+        small = null;
+        drop(big, 16);
+        System.gc();
+
+        byte[][] huge = new byte[16][];
+        int h = fill(huge, 40 << 20);
+        System.out.println(h > 0);
+        System.out.println(intact(big));
+        System.out.println(intact(huge));
+    }
+}
@@ -0,0 +1,96 @@
+package gc;
+
+/**
+ * 测试 GC 回收垃圾、保留存活的对象（见 src/heap/gc.h）。
+ * 分配的总量远大于堆（512Mb），没有回收就会 OutOfMemoryError。
+ * 用 -verbose:gc 运行可以看到每次 GC。每行输出都应为 true。
+ */
+public class GcTest {
+    static class Node {
+        int value;
+        Node next;
+        Node prev;  // 与 next 构成环
+        byte[] payload;
+
+        Node(int value) {
+            this.value = value;
+        }
+    }
+
+    // 分配 @mb Mb 的垃圾
+    static void churn(int mb) {
+        for (int i = 0; i < mb * 1024; i++) {
+            byte[] b = new byte[1024];
+            b[0] = (byte) i;
+        }
+    }
+
+    static Node buildList(int n) {
+        Node head = null;
+        for (int i = n - 1; i >= 0; i--) {
+            Node node = new Node(i);
+            node.next = head;
+            node.payload = new byte[] { (byte) i, (byte) (i >> 8) };
+            head = node;
+        }
+        return head;
+    }
+
+    static boolean checkList(Node head, int n) {
+        int i = 0;
+        for (Node node = head; node != null; node = node.next, i++) {
+            if (node.value != i || node.payload[0] != (byte) i || node.payload[1] != (byte) (i >> 8))
+                return false;
+        }
+        return i == n;
+    }
+
+    // 创建 @count 个互相引用的环，每个环有 @len 个节点，创建后就成为垃圾
+    static void cyclicGarbage(int count, int len, int payload) {
+        for (int k = 0; k < count; k++) {
+            Node first = new Node(0);
+            first.payload = new byte[payload];
+            Node last = first;
+            for (int i = 1; i < len; i++) {
+                Node node = new Node(i);
+                node.payload = new byte[payload];
+                node.prev = last;
+                last.next = node;
+                last = node;
+            }
+            last.next = first;
+            first.prev = last;
+        }
+    }
+
+    public static void main(String[] args) {
+        Runtime rt = Runtime.getRuntime();
+
+        // 对象在 Runtime.gc() 和大量分配之后仍然存活，内容不变
+        Node list = buildList(10000);
+        Object o = new Object();
+        int hash = System.identityHashCode(o);
+        String s = new String("still alive");
+
+        rt.gc();
+        System.out.println(checkList(list, 10000));
+        churn(1024);
+        System.out.println(checkList(list, 10000));
+        rt.gc();
+        System.out.println(checkList(list, 10000));
+
+        // 对象被移动后 identity hash code 不变
+        System.out.println(System.identityHashCode(o) == hash);
+        System.out.println(s.equals("still alive"));
+
+        // 环状的垃圾：小对象在年轻代中，大对象（超过 1Mb）直接在老年代中分配
+        cyclicGarbage(20000, 8, 1024);   // 共约 160Mb
+        cyclicGarbage(400, 2, 1 << 20);  // 共约 800Mb
+        rt.gc();
+        long free = rt.freeMemory();
+        cyclicGarbage(400, 2, 1 << 20);
+        rt.gc();
+        System.out.println(rt.freeMemory() >= free - (8 << 20));
+        System.out.println(checkList(list, 10000));
+    }
+}
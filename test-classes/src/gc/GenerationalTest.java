@@ -0,0 +1,102 @@
+package gc;
+
+/**
+ * 测试分代 GC（见 src/heap/heap.h）：
+ * 熬过多次 minor GC 的对象晋升到老年代；
+ * 老年代对象通过 putfield、aastore 和 System.arraycopy 引用的年轻代对象在 minor GC 中存活（卡表写屏障）。
+ * eden 约 100Mb，每次 churn(256) 至少进行两次 minor GC。每行输出都应为 true。
+ */
+public class GenerationalTest {
+    static class Box {
+        int id;
+        Box ref;
+        Object any;
+
+        Box(int id) {
+            this.id = id;
+        }
+    }
+
+    static void churn(int mb) {
+        for (int i = 0; i < mb * 1024; i++) {
+            byte[] b = new byte[1024];
+            b[1] = (byte) i;
+        }
+    }
+
+    static boolean check(Box b, int id) {
+        return b != null && b.id == id;
+    }
+
+    public static void main(String[] args) {
+        // 这些对象熬过多次 minor GC 之后晋升到老年代
+        Box old = new Box(1);
+        Box[] oldArray = new Box[1000];
+        Object[] oldObjects = new Object[1000];
+        Box[] survivors = new Box[1000];
+        for (int i = 0; i < survivors.length; i++) {
+            survivors[i] = new Box(i);
+        }
+        for (int round = 0; round < 10; round++) {
+            churn(256);
+            boolean ok = true;
+            for (int i = 0; i < survivors.length; i++) {
+                ok = ok && check(survivors[i], i);
+            }
+            if (!ok) {
+                System.out.println(false);
+                return;
+            }
+        }
+        System.out.println(true);
+
+        // 老年代到年轻代的引用：putfield
+        old.ref = new Box(2);
+        old.ref.ref = new Box(3);
+        old.any = "young " + old.ref.id;
+
+        // 老年代到年轻代的引用：aastore
+        for (int i = 0; i < oldArray.length; i++) {
+            oldArray[i] = new Box(100 + i);
+        }
+
+        // 老年代到年轻代的引用：System.arraycopy（Array::copy）
+        Object[] young = new Object[oldObjects.length];
+        for (int i = 0; i < young.length; i++) {
+            young[i] = new Box(2000 + i);
+        }
+        System.arraycopy(young, 0, oldObjects, 0, young.length);
+        young = null;
+
+        // 新对象只被老年代对象引用，经过多次 minor GC 仍然存活
+        for (int round = 0; round < 8; round++) {
+            churn(256);
+        }
+        System.out.println(check(old.ref, 2) && check(old.ref.ref, 3));
+        System.out.println("young 2".equals(old.any));
+        boolean ok = true;
+        for (int i = 0; i < oldArray.length; i++) {
+            ok = ok && check(oldArray[i], 100 + i);
+        }
+        System.out.println(ok);
+        ok = true;
+        for (int i = 0; i < oldObjects.length; i++) {
+            ok = ok && check((Box) oldObjects[i], 2000 + i);
+        }
+        System.out.println(ok);
+
+        // 在两次 minor GC 之间反复改写老年代对象中的引用
+        for (int round = 0; round < 20; round++) {
+            for (int i = 0; i < oldArray.length; i++) {
+                oldArray[i].ref = new Box(round * 10000 + i);
+            }
+            churn(64);
+        }
+        ok = true;
+        for (int i = 0; i < oldArray.length; i++) {
+            ok = ok && check(oldArray[i].ref, 19 * 10000 + i);
+        }
+        System.out.println(ok);
+        System.out.println(check(survivors[999], 999));
+    }
+}
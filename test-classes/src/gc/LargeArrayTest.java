@@ -0,0 +1,92 @@
+package gc;
+
+/**
+ * 测试大数组（约 512Kb，超过 TLAB 中对象的上限 TLAB_MAX_SIZE / TLAB_OBJECT_FRACTION）
+ * 不在 TLAB 中分配（见 Heap::alloc）。本地代码持有指向这样的数组深处（超过 128Kb）的指针时发生 GC，
+ * 保守扫描要能找到数组并把它原地固定，否则数组被移动，本地代码读写的是旧的位置。
+ *
+ * 先分配大量小对象使 TLAB 长到最大，之后大数组如果进入 TLAB 就会和它们相邻。
+ * clone 在本地代码中持有源数组的同时分配新数组，分配可能触发 GC；
+ * 另一个线程不停地分配，让 GC 在 arraycopy 等本地方法执行期间随时发生。每行输出都应为 true。
+ */
+public class LargeArrayTest {
+    static final int LEN = 512 * 1024;
+
+    static volatile boolean stop;
+
+    static void fill(byte[] a, int seed) {
+        for (int i = 0; i < a.length; i++) {
+            a[i] = (byte) (i * 31 + seed);
+        }
+    }
+
+    static boolean check(byte[] a, int seed) {
+        if (a.length != LEN)
+            return false;
+        for (int i = 0; i < a.length; i += 97) {
+            if (a[i] != (byte) (i * 31 + seed))
+                return false;
+        }
+        return a[LEN - 1] == (byte) ((LEN - 1) * 31 + seed);
+    }
+
+    static void churn(int kb) {
+        for (int i = 0; i < kb; i++) {
+            byte[] b = new byte[1024];
+            b[0] = (byte) i;
+        }
+    }
+
+    public static void main(String[] args) throws Exception {
+        // TLAB 随分配速率变大
+        churn(64 * 1024);
+
+        Thread allocator = new Thread(() -> {
+            while (!stop) {
+                churn(1024);
+            }
+        });
+        allocator.start();
+
+        boolean ok = true;
+        byte[][] bigs = new byte[16][];
+        for (int round = 0; round < 64; round++) {
+            // 大数组夹在小对象之间分配
+            Object[] small = new Object[64];
+            for (int i = 0; i < small.length; i++) {
+                small[i] = new int[16];
+            }
+            byte[] big = new byte[LEN];
+            fill(big, round);
+            bigs[round % bigs.length] = big;
+
+            // 在本地代码中持有大数组时分配（可能 GC）
+            byte[] copy = big.clone();
+            ok = ok && check(copy, round);
+
+            // 从数组深处复制，偏移量远超 128Kb
+            byte[] tail = new byte[4096];
+            System.arraycopy(big, LEN - 200 * 1024, tail, 0, tail.length);
+            for (int i = 0; i < tail.length; i++) {
+                int k = LEN - 200 * 1024 + i;
+                ok = ok && tail[i] == (byte) (k * 31 + round);
+            }
+            System.arraycopy(tail, 0, copy, LEN - 300 * 1024, tail.length);
+            ok = ok && copy[LEN - 300 * 1024] == tail[0];
+
+            if (round % 8 == 0) {
+                Runtime.getRuntime().gc();
+            }
+        }
+
+        stop = true;
+        allocator.join();
+
+        System.out.println(ok);
+        Runtime.getRuntime().gc();
+        for (int i = 0; i < bigs.length; i++) {
+            ok = ok && check(bigs[i], 48 + i);
+        }
+        System.out.println(ok);
+    }
+}
@@ -0,0 +1,53 @@
+package gc;
+
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * 测试堆（512Mb）用尽时抛出可以捕获的 OutOfMemoryError，
+ * 释放引用之后 GC 能回收这些空间，虚拟机继续正常运行。每行输出都应为 true。
+ */
+public class OutOfMemoryTest {
+
+    // 一直分配 @chunk 字节的数组直到 OutOfMemoryError，返回分配的个数，没有抛出时返回 -1
+    static int fill(int chunk) {
+        List<byte[]> list = new ArrayList<>();
+        try {
+            while (true) {
+                list.add(new byte[chunk]);
+            }
+        } catch (OutOfMemoryError e) {
+            int n = list.size();
+            list = null; // 先释放，处理异常时才有空间分配
+            return n;
+        }
+    }
+
+    public static void main(String[] args) {
+        // 大块在老年代中分配
+        int big = fill(4 << 20);
+        System.out.println(big > 0);
+
+        // 小块在年轻代中分配，晋升到老年代后用尽
+        int small = fill(64 << 10);
+        System.out.println(small > 0);
+
+        // 空间都被回收了，能再次分配差不多同样多的
+        int again = fill(4 << 20);
+        System.out.println(again >= big * 9 / 10);
+
+        // 一次分配超过堆的大小
+        try {
+            long[] huge = new long[256 << 20]; // 2Gb
+            System.out.println(huge.length == 0);
+        } catch (OutOfMemoryError e) {
+            System.out.println(true);
+        }
+
+        StringBuilder sb = new StringBuilder();
+        for (int i = 0; i < 100; i++) {
+            sb.append(i);
+        }
+        System.out.println(sb.length() == 190);
+    }
+}
@@ -0,0 +1,79 @@
+package instructions;
+
+/**
+ * 测试类层次分析（CHA）绑定的调用点在加载了重写方法的子类之后失效。
+ * 每行输出都应为 true。
+ */
+public class ChaInvalidationTest {
+    static class Base {
+        int value() {
+            return 1;
+        }
+    }
+
+    // 只通过 Class.forName 加载，加载之前 Base.value() 只有一个实现
+    static class Sub extends Base {
+        int value() {
+            return 2;
+        }
+    }
+
+    interface Counter {
+        int step();
+    }
+
+    static class One implements Counter {
+        public int step() {
+            return 1;
+        }
+    }
+
+    // 只通过 Class.forName 加载，加载之前 Counter.step() 只有一个实现
+    static class Two implements Counter {
+        public int step() {
+            return 2;
+        }
+    }
+
+    // invokevirtual 调用点
+    static int callValue(Base b) {
+        return b.value();
+    }
+
+    // invokeinterface 调用点
+    static int callStep(Counter c) {
+        return c.step();
+    }
+
+    // 在循环中调用，让方法被编译（内联带 CHA 检查的调用）
+    static int sumValues(Base b, int n) {
+        int sum = 0;
+        for (int i = 0; i < n; i++) {
+            sum += b.value();
+        }
+        return sum;
+    }
+
+    public static void main(String[] args) throws Exception {
+        Base base = new Base();
+        Counter one = new One();
+        int sum = 0;
+        for (int i = 0; i < 20000; i++) {
+            sum += callValue(base) + callStep(one) + sumValues(base, 1);
+        }
+        System.out.println(sum == 3 * 20000);
+
+        Class.forName("instructions.ChaInvalidationTest$Sub");
+        Class.forName("instructions.ChaInvalidationTest$Two");
+
+        // 同样的调用点现在必须分派到重写的方法
+        Base sub = new Sub();
+        Counter two = new Two();
+        System.out.println(callValue(sub) == 2);
+        System.out.println(callValue(base) == 1);
+        System.out.println(callStep(two) == 2);
+        System.out.println(callStep(one) == 1);
+        System.out.println(sumValues(sub, 100) == 200);
+        System.out.println(sumValues(base, 100) == 100);
+    }
+}
@@ -18,6 +18,8 @@ public class LookupSwitch {
     public static void main(String[] args) {
         test(-100);
         test(-200);
+        test(Integer.MIN_VALUE); // 小于所有的 case
+        test(Integer.MAX_VALUE); // 大于所有的 case
 
         for (int i = 0; i < 7; i++)
             test(i);
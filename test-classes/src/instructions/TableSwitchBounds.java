@@ -0,0 +1,39 @@
+package instructions;
+
+/**
+ * case 紧挨着 int 的边界时 javac 生成的 tableswitch 的 high 为 Integer.MAX_VALUE（或 low 为 Integer.MIN_VALUE），
+ * 翻译跳转表和计算 index - low 时都不能溢出。
+ */
+public class TableSwitchBounds {
+    private static String max(int i) {
+        switch (i) {
+            case Integer.MAX_VALUE - 2: return "MAX-2";
+            case Integer.MAX_VALUE - 1: return "MAX-1";
+            case Integer.MAX_VALUE: return "MAX";
+            default: return "default: " + i;
+        }
+    }
+
+    private static String min(int i) {
+        switch (i) {
+            case Integer.MIN_VALUE: return "MIN";
+            case Integer.MIN_VALUE + 1: return "MIN+1";
+            case Integer.MIN_VALUE + 2: return "MIN+2";
+            default: return "default: " + i;
+        }
+    }
+
+    public static void main(String[] args) {
+        System.out.println(max(Integer.MAX_VALUE));
+        System.out.println(max(Integer.MAX_VALUE - 2));
+        System.out.println(max(Integer.MAX_VALUE - 3));
+        System.out.println(max(Integer.MIN_VALUE));
+        System.out.println(max(0));
+
+        System.out.println(min(Integer.MIN_VALUE));
+        System.out.println(min(Integer.MIN_VALUE + 2));
+        System.out.println(min(Integer.MIN_VALUE + 3));
+        System.out.println(min(Integer.MAX_VALUE));
+        System.out.println(min(0));
+    }
+}
@@ -0,0 +1,51 @@
+package instructions;
+
+/**
+ * 测试 invokevirtual 和 invokeinterface 的分派（vtable/itable）。
+ */
+public class VirtualDispatchTest {
+    interface Shape {
+        String name();
+        default String describe() {
+            return "shape " + name();
+        }
+    }
+
+    // 没有实现 name()，name() 在本类中是 miranda 方法
+    static abstract class AbstractShape implements Shape { }
+
+    static class Circle extends AbstractShape {
+        public String name() {
+            return "circle";
+        }
+    }
+
+    // 通过父类实现了 Shape 接口，并重写了 default 方法
+    static class Square extends Circle {
+        public String name() {
+            return "square";
+        }
+        public String describe() {
+            return "square!";
+        }
+    }
+
+    public static void main(String[] args) {
+        AbstractShape a = new Circle();
+        System.out.println(a.name().equals("circle"));          // invokevirtual -> miranda 方法
+        System.out.println(a.describe().equals("shape circle")); // invokevirtual -> default 方法
+
+        Shape s = new Square();
+        System.out.println(s.name().equals("square"));          // invokeinterface
+        System.out.println(s.describe().equals("square!"));
+        System.out.println(s.hashCode() == System.identityHashCode(s)); // invokeinterface -> Object 中的方法
+
+        // 多态调用点
+        Shape[] shapes = { new Circle(), new Square(), new Circle(), new Square() };
+        int n = 0;
+        for (int i = 0; i < 100; i++) {
+            n += shapes[i % shapes.length].name().length();
+        }
+        System.out.println(n == 50 * "circle".length() + 50 * "square".length());
+    }
+}
@@ -0,0 +1,96 @@
+package jit;
+
+/**
+ * 测试优化编译器根据类层次分析（CHA）内联的调用在假设失效后的行为（见 src/jit/opt_compiler.h）。
+ *
+ * 先反复调用 sumValues 和 sumSteps 直到它们被优化编译，循环中的调用被内联，
+ * 再用 Class.forName 加载重写了被调用方法的子类，使内联时的假设失效。
+ * 之后同样的编译后的调用点必须分派到新加载的实现，重新编译后对两种接收者都正确。
+ * 用 -XX:+PrintCompilation 运行可以看到方法被优化编译。每行输出都应为 true。
+ */
+public class InlineInvalidationTest {
+    static class Base {
+        int value() {
+            return 1;
+        }
+    }
+
+    // 只通过 Class.forName 加载，加载之前 Base.value() 只有一个实现
+    static class Sub extends Base {
+        int value() {
+            return 2;
+        }
+    }
+
+    interface Counter {
+        int step();
+    }
+
+    static class One implements Counter {
+        public int step() {
+            return 1;
+        }
+    }
+
+    // 只通过 Class.forName 加载，加载之前 Counter.step() 只有一个实现
+    static class Two implements Counter {
+        public int step() {
+            return 2;
+        }
+    }
+
+    // invokevirtual 调用点，编译后内联 Base.value()
+    static int sumValues(Base b, int n) {
+        int sum = 0;
+        for (int i = 0; i < n; i++) {
+            sum += b.value();
+        }
+        return sum;
+    }
+
+    // invokeinterface 调用点，编译后内联 One.step()
+    static int sumSteps(Counter c, int n) {
+        int sum = 0;
+        for (int i = 0; i < n; i++) {
+            sum += c.step();
+        }
+        return sum;
+    }
+
+    // 调用次数和回边次数都远超优化编译的阈值，给后台的编译线程留出完成编译的时间
+    static final int WARM_UP = 3000;
+
+    public static void main(String[] args) throws Exception {
+        Base base = new Base();
+        Counter one = new One();
+        int values = 0;
+        int steps = 0;
+        for (int i = 0; i < WARM_UP; i++) {
+            values += sumValues(base, 1000);
+            steps += sumSteps(one, 1000);
+        }
+        System.out.println(values == WARM_UP * 1000);
+        System.out.println(steps == WARM_UP * 1000);
+
+        Class.forName("jit.InlineInvalidationTest$Sub");
+        Class.forName("jit.InlineInvalidationTest$Two");
+        Base sub = new Sub();
+        Counter two = new Two();
+
+        // 内联的代码不再适用，必须调用重写的方法
+        System.out.println(sumValues(sub, 100) == 200);
+        System.out.println(sumValues(base, 100) == 100);
+        System.out.println(sumSteps(two, 100) == 200);
+        System.out.println(sumSteps(one, 100) == 100);
+
+        // 交替使用两种接收者，方法按新的类层次重新编译
+        values = 0;
+        steps = 0;
+        for (int i = 0; i < WARM_UP; i++) {
+            values += sumValues((i & 1) == 0 ? base : sub, 1000);
+            steps += sumSteps((i & 1) == 0 ? one : two, 1000);
+        }
+        System.out.println(values == WARM_UP / 2 * 3000);
+        System.out.println(steps == WARM_UP / 2 * 3000);
+    }
+}
@@ -0,0 +1,65 @@
+package jit;
+
+/**
+ * 测试栈上替换（OSR，见 src/jit/jit.h）：下面的方法都只调用一次，
+ * 回边次数达到编译阈值后在循环头处转入编译后的代码，
+ * 转入前在解释器中算出的局部变量要原样接上，循环结束后的结果与解释执行的相同。
+ * 用 -XX:+PrintCompilation 运行可以看到各方法被编译。每行输出都应为 true。
+ */
+public class OsrTest {
+    // int 和 long 的局部变量
+    static long sum(int n) {
+        int count = 0;
+        long sum = 0;
+        for (int i = 0; i < n; i++) {
+            sum += i;
+            count++;
+        }
+        return count == n ? sum : -1;
+    }
+
+    // 从内层循环的循环头转入，外层循环的变量也要接上
+    static int nested(int n, int m) {
+        int total = 0;
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < m; j++) {
+                total += i ^ j;
+            }
+        }
+        return total;
+    }
+
+    // double 的局部变量，每次加 0.5 没有舍入误差
+    static double halves(int n) {
+        double x = 0;
+        for (int i = 0; i < n; i++) {
+            x += 0.5;
+        }
+        return x;
+    }
+
+    // 循环中读写数组，转入时数组的引用在局部变量中
+    static int prefixSums(int[] a) {
+        for (int i = 1; i < a.length; i++) {
+            a[i] += a[i - 1];
+        }
+        return a[a.length - 1];
+    }
+
+    public static void main(String[] args) {
+        int n = 3000000;
+        System.out.println(sum(n) == (long) n * (n - 1) / 2);
+
+        // 对每个 i，j 取遍 [0, 1024) 时 i ^ j 也取遍 [0, 1024)
+        System.out.println(nested(1024, 1024) == 1024 * (1024 * 1023 / 2));
+
+        System.out.println(halves(n + 1) == (n + 1) / 2.0);
+
+        int[] a = new int[100000];
+        for (int i = 0; i < a.length; i++) {
+            a[i] = 1;
+        }
+        System.out.println(prefixSums(a) == a.length);
+        System.out.println(a[a.length / 2] == a.length / 2 + 1);
+    }
+}
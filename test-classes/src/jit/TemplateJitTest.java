@@ -0,0 +1,74 @@
+package jit;
+
+/**
+ * 测试模板 JIT 编译的叶子方法（见 src/jit/jit.h）。
+ * 下面的叶子方法被调用的次数超过编译阈值，之后在编译后的代码中执行；
+ * 编译后的代码抛出的异常由解释执行的调用者捕获。
+ * 用 -XX:+PrintCompilation 运行可以看到各方法被编译。每行输出都应为 true。
+ */
+public class TemplateJitTest {
+    static int div(int a, int b) {
+        return a / b;
+    }
+
+    static int get(int[] a, int i) {
+        return a[i];
+    }
+
+    static long mix(long x, int i) {
+        return x * 31 + (i ^ (x >>> 7));
+    }
+
+    static double average(double a, double b) {
+        return (a + b) / 2;
+    }
+
+    // 调用次数达到优化编译的阈值，两层编译的代码都会执行到
+    static final int CALLS = 50000;
+
+    public static void main(String[] args) {
+        int[] a = new int[10];
+        for (int i = 0; i < a.length; i++) {
+            a[i] = i;
+        }
+
+        int sum = 0;
+        int expected = 0;
+        long x = 1;
+        long expectedX = 1;
+        double avg = 0;
+        for (int i = 0; i < CALLS; i++) {
+            sum += div(i, 7) + get(a, i % 10);
+            expected += i / 7 + i % 10;
+            x = mix(x, i);
+            expectedX = expectedX * 31 + (i ^ (expectedX >>> 7));
+            avg += average(i, i + 1);
+        }
+        System.out.println(sum == expected);
+        System.out.println(x == expectedX);
+        System.out.println(avg == (double) CALLS * CALLS / 2);
+
+        // 编译后的代码中抛出的异常
+        try {
+            div(5, 0);
+            System.out.println(false);
+        } catch (ArithmeticException e) {
+            System.out.println(true);
+        }
+        try {
+            get(a, 10);
+            System.out.println(false);
+        } catch (ArrayIndexOutOfBoundsException e) {
+            System.out.println(true);
+        }
+        try {
+            get(null, 0);
+            System.out.println(false);
+        } catch (NullPointerException e) {
+            System.out.println(true);
+        }
+
+        // 抛出异常之后编译后的代码仍然可用
+        System.out.println(div(100, 7) == 14 && get(a, 9) == 9);
+    }
+}
@@ -0,0 +1,79 @@
+package performance;
+
+/**
+ * 算术密集型方法的基准测试，用于比较解释器优化前后的性能。
+ * 每个测试先预热一轮（完成类初始化、指令改写等），再计时。
+ *
+ * Usage: cabin performance.ArithmeticBenchmark [iterations, in millions]
+ */
+public class ArithmeticBenchmark {
+    static int intLoop(int n) {
+        int sum = 0;
+        for (int i = 0; i < n; i++) {
+            sum += i * 3 + (i >> 1) - (i & 7);
+        }
+        return sum;
+    }
+
+    static long longLoop(int n) {
+        long sum = 0;
+        for (int i = 0; i < n; i++) {
+            long x = i;
+            sum += x * x - (x << 2) + (sum ^ x);
+        }
+        return sum;
+    }
+
+    static double doubleLoop(int n) {
+        double sum = 0;
+        for (int i = 1; i <= n; i++) {
+            sum += 1.0 / i - sum * 0.5 / (i + 1.0);
+        }
+        return sum;
+    }
+
+    static int arrayLoop(int[] a, int rounds) {
+        int sum = 0;
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < a.length; i++) {
+                a[i] = a[i] + i;
+                sum += a[i];
+            }
+        }
+        return sum;
+    }
+
+    static int fib(int n) {
+        return n < 2 ? n : fib(n - 1) + fib(n - 2);
+    }
+
+    static volatile long sink;
+
+    // 不用 lambda，避免基准测试依赖 invokedynamic
+    private static void run(int kernel, int n, int[] a) {
+        switch (kernel) {
+            case 0: sink = intLoop(n); break;
+            case 1: sink = longLoop(n); break;
+            case 2: sink = (long) doubleLoop(n); break;
+            case 3: sink = arrayLoop(a, n / a.length); break;
+            default: sink = fib(25); break;
+        }
+    }
+
+    public static void main(String[] args) {
+        int n = args.length > 0 ? Integer.parseInt(args[0]) * 1000000 : 5000000;
+        int[] a = new int[1024];
+        String[] names = { "int    ", "long   ", "double ", "array  ", "fib(25)" };
+
+        long total = 0;
+        for (int k = 0; k < names.length; k++) {
+            run(k, n, a); // warm up
+            long begin = System.nanoTime();
+            run(k, n, a);
+            long ms = (System.nanoTime() - begin) / 1000000;
+            System.out.println(names[k] + ": " + ms + " ms");
+            total += ms;
+        }
+        System.out.println("total  : " + total + " ms");
+    }
+}
@@ -0,0 +1,143 @@
+package string;
+
+import java.util.Arrays;
+
+/**
+ * 测试用 SIMD 实现的内建方法（见 src/interpreter/intrinsics.h）与逐个元素计算的结果相同。
+ * 向量化的实现每次处理 16 或 32 个元素，剩下的交给标量版本，
+ * 所以长度取遍 0 到 100（字符串的哈希值每 256 个字节一块，另测更长的），
+ * 不同的位置也都放一次不相等的元素。
+ * 用 -XX:-UseIntrinsics 运行应得到同样的结果。每行输出都应为 true。
+ */
+public class IntrinsicsTest {
+    static final int MAX_LEN = 100;
+
+    static byte[] bytes(int len, int seed) {
+        byte[] a = new byte[len];
+        for (int i = 0; i < len; i++) {
+            a[i] = (byte) (i * 31 + seed);
+        }
+        return a;
+    }
+
+    static String latin1(int len) {
+        char[] c = new char[len];
+        for (int i = 0; i < len; i++) {
+            c[i] = (char) ('a' + i % 26);
+        }
+        return new String(c);
+    }
+
+    // Arrays.equals(byte[], byte[])，不相等的字节在每个位置
+    static boolean testArraysEquals() {
+        for (int len = 0; len <= MAX_LEN; len++) {
+            byte[] a = bytes(len, 7);
+            byte[] b = bytes(len, 7);
+            if (!Arrays.equals(a, b))
+                return false;
+            for (int i = 0; i < len; i++) {
+                b[i]++;
+                if (Arrays.equals(a, b))
+                    return false;
+                b[i]--;
+            }
+        }
+        return true;
+    }
+
+    // Arrays.hashCode(int[])
+    static boolean testArraysHashCode() {
+        for (int len = 0; len <= MAX_LEN; len++) {
+            int[] a = new int[len];
+            int h = 1;
+            for (int i = 0; i < len; i++) {
+                a[i] = i * 0x9E3779B9;
+                h = 31 * h + a[i];
+            }
+            if (Arrays.hashCode(a) != h)
+                return false;
+        }
+        return true;
+    }
+
+    // String.hashCode()，长的字符串分块计算
+    static boolean testStringHashCode() {
+        for (int len = 0; len <= 600; len += len < MAX_LEN ? 1 : 37) {
+            String s = latin1(len);
+            int h = 0;
+            for (int i = 0; i < len; i++) {
+                h = 31 * h + s.charAt(i);
+            }
+            if (s.hashCode() != h)
+                return false;
+        }
+        return true;
+    }
+
+    // String.indexOf(int)，要找的字符在每个位置
+    static boolean testStringIndexOf() {
+        for (int len = 0; len <= MAX_LEN; len++) {
+            char[] c = new char[len];
+            Arrays.fill(c, 'a');
+            for (int i = 0; i < len; i++) {
+                c[i] = 'b';
+                if (new String(c).indexOf('b') != i)
+                    return false;
+                c[i] = 'a';
+            }
+            String s = new String(c);
+            if (s.indexOf('b') != -1 || s.indexOf('\u4e2d') != -1)
+                return false;
+        }
+        return true;
+    }
+
+    // String.equals 和 compareTo，不相等的字符在每个位置
+    static boolean testStringCompare() {
+        for (int len = 0; len <= MAX_LEN; len++) {
+            String s = latin1(len);
+            if (!s.equals(latin1(len)) || s.compareTo(latin1(len)) != 0)
+                return false;
+            if (s.compareTo(latin1(len + 1)) != -1)
+                return false;
+            for (int i = 0; i < len; i++) {
+                char[] c = s.toCharArray();
+                c[i]++;
+                String t = new String(c);
+                if (s.equals(t) || s.compareTo(t) != -1 || t.compareTo(s) != 1)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // 由 char[] 构造字符串时压缩为 Latin1，取出字符时再扩展，不能压缩的字符在每个位置
+    static boolean testCompressInflate() {
+        for (int len = 0; len <= MAX_LEN; len++) {
+            char[] c = new char[len];
+            for (int i = 0; i < len; i++) {
+                c[i] = (char) (0x80 + i); // 不小于 0x80 的也能压缩
+            }
+            if (!Arrays.equals(new String(c).toCharArray(), c))
+                return false;
+            for (int i = 0; i < len; i++) {
+                char saved = c[i];
+                c[i] = '\u4e2d';
+                String s = new String(c);
+                if (s.length() != len || s.charAt(i) != '\u4e2d' || !Arrays.equals(s.toCharArray(), c))
+                    return false;
+                c[i] = saved;
+            }
+        }
+        return true;
+    }
+
+    public static void main(String[] args) {
+        System.out.println(testArraysEquals());
+        System.out.println(testArraysHashCode());
+        System.out.println(testStringHashCode());
+        System.out.println(testStringIndexOf());
+        System.out.println(testStringCompare());
+        System.out.println(testCompressInflate());
+    }
+}